@@ -1082,6 +1082,13 @@ EOF
 		$ECHO "$bench_rtfm_line"
 	    fi
 
+	    # report geometry prep time next to the ray rate, large
+	    # meshes can spend longer in prep than in raytracing
+	    bench_prep_line="`grep '^PREP:' ${bench_testname}.log`"
+	    if test ! "x$bench_prep_line" = "x" ; then
+		$ECHO "$bench_prep_line"
+	    fi
+
 	    # did we fail?
 	    if test $retval != 0 ; then
 		$ECHO "RAYTRACE ERROR"
@@ -206,6 +206,18 @@ analyze_get_grid_spacing(struct current_state *context);
 ANALYZE_EXPORT extern void
 analyze_set_grid_ratio(struct current_state *context, fastf_t gridRatio);
 
+/**
+ * enables (1) or disables (0) adaptive grid refinement.  When enabled,
+ * each refinement of the triple grid only subdivides cells whose rays
+ * disagree with their neighbors about the regions they pass through,
+ * or whose in-region length is not yet linear enough to meet the
+ * volume tolerance, so converged areas are not re-sampled.  Features
+ * smaller than the initial grid spacing can be missed entirely.
+ * Single grid and surface area analyses always refine uniformly.
+ */
+ANALYZE_EXPORT extern void
+analyze_set_adaptive(struct current_state *context, int adaptive);
+
 /**
  * sets the grid width and grid height values
  */
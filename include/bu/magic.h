@@ -233,6 +233,7 @@ __BEGIN_DECLS
 #define WDB_PIPESEG_MAGIC		0x9723ffef /**< ?\#?? */
 #define WMEMBER_MAGIC			0x43128912 /**< C??? */
 #define ICV_IMAGE_MAGIC			0x6269666d /**< bifm */
+#define ICV_MAPPED_IMAGE_MAGIC		0x6269666e /**< bifn */
 
 /** @brief Routines involved with handling "magic numbers" used to identify various in-memory data structures. */
 
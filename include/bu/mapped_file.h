@@ -144,6 +144,15 @@ BU_EXPORT extern void bu_pr_mapped_file(const char *title,
  */
 BU_EXPORT extern void bu_free_mapped_files(int verbose);
 
+/**
+ * Release a use of a mapped file and, when that was the last use,
+ * release its storage immediately instead of waiting for the next
+ * bu_free_mapped_files().  Other unused mappings are left alone.
+ *
+ * The caller must not touch mp after this returns.
+ */
+BU_EXPORT extern void bu_free_mapped_file(struct bu_mapped_file *mp);
+
 /**
  * A wrapper for bu_open_mapped_file() which uses a search path to
  * locate the file.
@@ -34,6 +34,8 @@ __BEGIN_DECLS
 /** @{ */
 /** @file bu/simd.h */
 
+#define BU_SIMD_AVX2 9
+#define BU_SIMD_AVX 8
 #define BU_SIMD_SSE4_2 7
 #define BU_SIMD_SSE4_1 6
 #define BU_SIMD_SSE3 5
@@ -53,6 +53,15 @@ __BEGIN_DECLS
  */
 BU_EXPORT extern int64_t bu_gettime(void);
 
+/**
+ * Returns a monotonic time counter in nanoseconds, suitable for
+ * timing short intervals.  The epoch is unspecified, so only the
+ * difference between two calls is meaningful.  Where no monotonic
+ * clock is available this falls back to bu_gettime() scaled to
+ * nanoseconds.
+ */
+BU_EXPORT extern int64_t bu_gettime_ns(void);
+
 /**
  * Evaluate the time_t input as UTC time in ISO format.
  *
@@ -81,6 +81,16 @@ ICV_EXPORT extern int icv_crop(icv_image_t *img,
 			       size_t llx, size_t lly,
 			       size_t ynum,
 			       size_t xnum);
+
+/**
+ * Rectangular crop of a mapped image into a new in-memory image,
+ * touching only the rows that are kept.  Coordinates are as for
+ * icv_rect().
+ *
+ * @return the cropped image, or NULL on failure.
+ */
+ICV_EXPORT extern icv_image_t *icv_mapped_rect(const icv_mapped_image_t *mimg, size_t xorig, size_t yorig, size_t xnum, size_t ynum);
+
 /** @} */
 
 __END_DECLS
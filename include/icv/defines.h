@@ -63,6 +63,8 @@ typedef enum {
 #define ICV_SANITIZED 0X0002
 #define ICV_OPERATIONS_MODE 0x0004
 #define ICV_UNDEFINED_1 0x0008
+#define ICV_FLOAT_KERNELS 0x0010	/**< filters may compute in single precision */
+#define ICV_SCALAR_KERNELS 0x0020	/**< filters never use the SIMD loops */
 
 struct icv_image {
     uint32_t magic;
@@ -97,6 +99,29 @@ typedef struct icv_image icv_image_t;
  */
 #define ICV_IMAGE_IS_INITIALIZED(_i) (((struct icv_image *)(_i) != ICV_IMAGE_NULL) && LIKELY((_i)->magic == ICV_IMAGE_MAGIC))
 
+/**
+ * An 8-bit PIX or BW file mapped into memory with icv_map() rather
+ * than read into an icv_image, for images too large to hold as
+ * doubles.  Rows are stored bottom to top exactly as in the file,
+ * each width*channels bytes long.
+ */
+struct icv_mapped_image {
+    uint32_t magic;
+    ICV_COLOR_SPACE color_space;
+    const unsigned char *data;
+    size_t width, height, channels;
+    void *handle;	/**< PRIVATE - the underlying bu_mapped_file */
+};
+
+
+typedef struct icv_mapped_image icv_mapped_image_t;
+#define ICV_MAPPED_IMAGE_NULL ((struct icv_mapped_image *)0)
+
+/**
+ * returns truthfully whether a icv_mapped_image has been initialized.
+ */
+#define ICV_MAPPED_IMAGE_IS_INITIALIZED(_i) (((struct icv_mapped_image *)(_i) != ICV_MAPPED_IMAGE_NULL) && LIKELY((_i)->magic == ICV_MAPPED_IMAGE_MAGIC))
+
 /* Validation Macros */
 /**
  * Validates input icv_struct, if failure (in validation) returns -1
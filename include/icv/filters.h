@@ -61,6 +61,12 @@ typedef enum {
  * convolves kernel with the image.  Does zero_padding for outbound
  * pixels.
  *
+ * Large images are filtered in parallel.  If img->flags has
+ * ICV_FLOAT_KERNELS set and the CPU has AVX2, the sums are done in
+ * single precision, which is plenty for 8-bit image data.
+ * ICV_SCALAR_KERNELS turns the SIMD loops off altogether, for
+ * checking them against the plain C ones.
+ *
  * @param img Image to be filtered.
  * @param filter_type Type of filter to be used.
  *
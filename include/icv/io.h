@@ -179,6 +179,48 @@ ICV_EXPORT unsigned char *icv_data2uchar(const icv_image_t *bif);
  */
 ICV_EXPORT double *icv_uchar2double(unsigned char *data, size_t size);
 
+/**
+ * Map a PIX or BW file into memory for row-at-a-time access without
+ * reading it into an icv_image.  Nothing is converted up front, so
+ * this is the way to work with images too large to hold as doubles;
+ * see icv_mapped_rect(), icv_mapped_resize(), icv_mapped_diff() and
+ * icv_mapped_pdiff().
+ *
+ * As with icv_read(), pass 0 for width and height to have the size
+ * guessed from the file size.
+ *
+ * @param filename File to map (streams cannot be mapped)
+ * @param format BU_MIME_IMAGE_PIX or BU_MIME_IMAGE_BW
+ * @param width Width of the image, or 0
+ * @param height Height of the image, or 0
+ * @return the mapped image, or NULL with log messages on failure.
+ */
+ICV_EXPORT extern icv_mapped_image_t *icv_map(const char *filename, bu_mime_image_t format, size_t width, size_t height);
+
+/**
+ * Release an image returned by icv_map().
+ */
+ICV_EXPORT extern void icv_unmap(icv_mapped_image_t *mimg);
+
+/**
+ * Returns a pointer to the 8-bit data of row y of a mapped image (0
+ * being the bottom row), or NULL if y is out of range.  The memory
+ * belongs to the mapping and must not be written.
+ */
+ICV_EXPORT extern const unsigned char *icv_mapped_row(const icv_mapped_image_t *mimg, size_t y);
+
+/**
+ * Converts a tile of a mapped image to icv double data.
+ *
+ * @param mimg Mapped image to read from
+ * @param xorig X coordinate of the lower left corner of the tile
+ * @param yorig Y coordinate of the lower left corner of the tile
+ * @param xnum Width of the tile
+ * @param ynum Height of the tile
+ * @param out Room for xnum*ynum*channels doubles, filled bottom row first
+ * @return on success 0, on failure -1
+ */
+ICV_EXPORT extern int icv_mapped_read(const icv_mapped_image_t *mimg, size_t xorig, size_t yorig, size_t xnum, size_t ynum, double *out);
 
 /** @} */
 
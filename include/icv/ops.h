@@ -185,6 +185,15 @@ typedef enum {
  */
 ICV_EXPORT int icv_resize(icv_image_t *bif, ICV_RESIZE_METHOD method, size_t out_width, size_t out_height, size_t factor);
 
+/**
+ * Resize a mapped image with any of the icv_resize() methods,
+ * returning the result as a new in-memory image.  The input is read a
+ * few rows at a time, so only the output has to fit in memory.
+ *
+ * @return the resized image, or NULL on failure.
+ */
+ICV_EXPORT icv_image_t *icv_mapped_resize(const icv_mapped_image_t *mimg, ICV_RESIZE_METHOD method, size_t out_width, size_t out_height, size_t factor);
+
 /**
  * Rotate an image.
  * %s [-rifb | -a angle] [-# bytes] [-s squaresize] [-w width] [-n height] [-o outputfile] inputfile [> outputfile]
@@ -213,6 +222,23 @@ ICV_EXPORT extern icv_image_t *icv_diffimg(icv_image_t *img1, icv_image_t *img2)
  */
 ICV_EXPORT extern uint32_t icv_pdiff(icv_image_t *img1, icv_image_t *img2);
 
+/**
+ * icv_diff() for two mapped images, comparing the 8-bit file data
+ * directly.  Images must have the same number of channels; for BW
+ * images every differing pixel counts as off by one.  Returns -1 on
+ * error.
+ */
+ICV_EXPORT extern int icv_mapped_diff(int *matching, int *off_by_1, int *off_by_many, const icv_mapped_image_t *mimg1, const icv_mapped_image_t *mimg2);
+
+/**
+ * icv_pdiff() for two mapped PIX images.  Rows are hashed straight
+ * from the mapping and the working image is limited to
+ * ICV_PDIFF_MAPPED_SIZE pixels square, so distances reported for
+ * images larger than that may differ slightly from icv_pdiff().
+ */
+#define ICV_PDIFF_MAPPED_SIZE 1024
+ICV_EXPORT extern uint32_t icv_mapped_pdiff(const icv_mapped_image_t *mimg1, const icv_mapped_image_t *mimg2);
+
 /**
  * Fit an image to suggested dimensions.
  */
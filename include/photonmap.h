@@ -68,8 +68,8 @@ struct Photon {
 
 
 struct PSN {
-    struct	Photon	P;
-    fastf_t		Dist;
+    struct	Photon	*P;
+    fastf_t		Dist;		/**< @brief Distance Sq to the Search Position */
 };
 
 
@@ -96,18 +96,20 @@ struct NearestPhotons {
 };
 
 
-struct PNode {
-    struct	Photon	P;
-    struct	PNode	*L;
-    struct	PNode	*R;
-    int			C;		/**< @brief For Threading Purposes to see if it's been computed yet */
-};
-
-
+/**
+ *  Photons are kept in a flat array ordered as a balanced KD-Tree: the
+ *  node for the range [lo, hi) is the photon at lo + (hi - lo)/2, and
+ *  its subtrees are the ranges on either side of it.  Positions,
+ *  normals and splitting axes are also kept one array per component
+ *  so that searching only touches the data it compares.
+ */
 struct PhotonMap {
     int			StoredPhotons;
     int			MaxPhotons;
-    struct	PNode	*Root;
+    struct	Photon	*Photons;	/**< @brief Photons in KD-Tree order */
+    fastf_t		*Pos[3];	/**< @brief Photon Positions, by axis */
+    fastf_t		*Normal[3];	/**< @brief Photon Normals, by axis */
+    char		*Axis;		/**< @brief Splitting Plane of each node */
 };
 
 
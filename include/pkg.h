@@ -82,6 +82,16 @@ struct pkg_header {
     unsigned char pkh_len[4];	/**< @brief Byte count of remainder */
 };
 
+/**
+ * One of the buffers that pkg_sendv() gathers into a single message.
+ * The data are written to the connection straight from the buffer,
+ * without being copied.
+ */
+struct pkg_iovec {
+    const char *pkv_base;	/**< @brief Start of data */
+    size_t pkv_len;		/**< @brief Byte count */
+};
+
 #define	PKG_STREAMLEN	(32*1024)
 struct pkg_conn {
     int	pkc_fd;					/**< @brief TCP connection fd */
@@ -158,11 +168,16 @@ PKG_EXPORT extern int pkg_process(struct pkg_conn *);
  * any data at all.  Thus, it is wise to call call this routine only
  * if:
  *
- *	a)  select() has indicated the presence of data, or
- *	b)  blocking is acceptable.
+ *	a)  poll() or select() has indicated the presence of data, or
+ *	b)  blocking is acceptable, or
+ *	c)  the connection has been made non-blocking with
+ *	    pkg_nonblocking().
  *
  * This routine is the only place where data is taken off the network.
- * All input is appended to the internal buffer for later processing.
+ * All input is appended to the internal buffer for later processing,
+ * except that when the remainder of a partly received message body is
+ * due, it is read straight into the message buffer along with
+ * whatever follows it.
  *
  * Subscripting was used for pkc_incur/pkc_inend to avoid having to
  * recompute pointers after a realloc().
@@ -170,10 +185,41 @@ PKG_EXPORT extern int pkg_process(struct pkg_conn *);
  * Returns -
  *	-1 on error
  *	 0 on EOF
- *	 1 success
+ *	 1 success, possibly with no new data on a non-blocking connection
  */
 PKG_EXPORT extern int pkg_suckin(struct pkg_conn *);
 
+/**
+ * Read and handle whatever input is waiting, without blocking.
+ *
+ * For use by an external event loop, when it reports that the
+ * descriptor from pkg_fileno() is readable.  Does one pkg_suckin()
+ * and then hands every complete message that has arrived to its
+ * handler, as pkg_process() does.
+ *
+ * Returns the number of messages handled, or a negative value on
+ * error or EOF.
+ */
+PKG_EXPORT extern int pkg_service(struct pkg_conn *pc);
+
+/**
+ * Return the descriptor an event loop should watch for input on this
+ * connection, or -1 if the connection is not valid.
+ */
+PKG_EXPORT extern int pkg_fileno(const struct pkg_conn *pc);
+
+/**
+ * Turn non-blocking I/O on (onoff != 0) or off for a connection.
+ *
+ * Reads on a non-blocking connection return at once when there is
+ * nothing to read.  Sends and the pkg_waitfor() family still finish
+ * before returning, waiting for the connection as needed, and taking
+ * in any input that arrives meanwhile.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+PKG_EXPORT extern int pkg_nonblocking(struct pkg_conn *pc, int onoff);
+
 /**
  * Send a message on the connection.
  *
@@ -189,6 +235,19 @@ PKG_EXPORT extern int pkg_suckin(struct pkg_conn *);
  */
 PKG_EXPORT extern int pkg_send(int type, const char *buf, size_t len, struct pkg_conn* pc);
 
+/**
+ * Send a message gathered from several buffers on the connection.
+ *
+ * The iovcnt buffers in iov are sent, in order, as the body of one
+ * message.  Any output queued by pkg_stream(), the header, and the
+ * user's buffers all go out in a single writev() without being
+ * copied, which makes this the cheapest way to send large blocks of
+ * pixels with a small header of their own.
+ *
+ * Returns number of bytes of user data actually sent, or -1.
+ */
+PKG_EXPORT extern int pkg_sendv(int type, const struct pkg_iovec *iov, int iovcnt, struct pkg_conn* pc);
+
 /**
  * Send a two part message on the connection.
  *
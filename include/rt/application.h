@@ -81,6 +81,7 @@ struct rt_i; /* forward declaration */
  * a_purpose        | Printed by librt on errors, but otherwise not used.
  * a_rbeam          | Used to compute beam coverage on geometry,
  * a_diverge        | for spline subdivision & many UV mappings.
+ * a_occluder()     | Set by rt_occluded(), leave zero otherwise.
  *
  *  Note that rt_shootray() returns the (int) return of the
  *  a_hit()/a_miss() function called, as well as placing it in
@@ -123,6 +124,7 @@ struct application {
 					 * This list should be the same as passed to
 					 * rt_gettrees_and_attrs() */
     int                 a_bot_reverse_normal_disabled;  /**< @brief  1= no bot normals get reversed in BOT_UNORIENTED_NORM */
+    int                 (*a_occluder)(struct application *, const struct region *);	/**< @brief  set by rt_occluded(), >0 if a region blocks the ray */
     /* THESE ELEMENTS ARE USED BY THE PROGRAM "rt" AND MAY BE USED BY */
     /* THE LIBRARY AT SOME FUTURE DATE */
     /* AT THIS TIME THEY MAY BE LEFT ZERO */
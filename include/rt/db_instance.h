@@ -45,6 +45,7 @@ __BEGIN_DECLS
 
 struct db_i;   /* forward declaration */
 struct rt_wdb; /* forward declaration */
+struct db_dirindex; /* forward declaration */
 
 /* Callback called when database objects are changed.  The int indicates
  * the change type (0 = mod, 1 = add, 2 = rm). ctx is a user
@@ -134,6 +135,7 @@ struct db_i {
     struct bu_ptbl dbi_changed_clbks;     /**< @brief PRIVATE: dbi_changed_t callbacks registered with dbi */
     struct bu_ptbl dbi_update_nref_clbks; /**< @brief PRIVATE: dbi_update_nref_t callbacks registered with dbi */
     int dbi_use_comb_instance_ids;            /**< @brief PRIVATE: flag to enable/disable comb instance tracking in full paths */
+    struct db_dirindex * dbi_dirindex;  /**< @brief PRIVATE: by-name index over dbi_Head[], see db_lookup() */
 };
 #define DBI_NULL ((struct db_i *)0)
 #define RT_CHECK_DBI(_p) BU_CKMAG(_p, DBI_MAGIC, "struct db_i")
@@ -71,6 +71,7 @@ struct rt_shootray_status {
     int                 out_axis;     /**< @brief  axis ray will leave through */
     struct rt_shootray_status *old_status;
     int                 box_num;        /**< @brief  which cell along ray */
+    int                 occluded;       /**< @brief  an rt_occluded() segment settled the ray */
 };
 
 
@@ -37,6 +37,7 @@ __BEGIN_DECLS
 union tree; /* forward declaration */
 struct resource; /* forward declaration */
 struct db_i; /* forward declaration */
+struct bool_prog; /* forward declaration, private to LIBRT */
 
 /**
  * The region structure.
@@ -61,6 +62,7 @@ struct region {
 #define REGION_FASTGEN_PLATE    1
 #define REGION_FASTGEN_VOLUME   2
     struct bu_attribute_value_set attr_values;  /**< @brief Attribute/value set */
+    struct bool_prog *  reg_prog;       /**< @brief reg_treetop compiled for rt_boolfinal(), or NULL */
 };
 #define REGION_NULL     ((struct region *)0)
 #define RT_CK_REGION(_p) BU_CKMAG(_p, RT_REGION_MAGIC, "struct region")
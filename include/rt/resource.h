@@ -37,6 +37,28 @@
 
 __BEGIN_DECLS
 
+/**
+ * Per-solid profiling counters, indexed by st_bit.
+ */
+struct rt_profile_counts {
+    size_t              pc_shots;       /**< @brief  # calls to ft_shot() or ft_piece_shot() */
+    size_t              pc_hits;        /**< @brief  # of those calls that returned hits */
+    int64_t             pc_ns;          /**< @brief  nanoseconds spent in those calls */
+};
+
+/**
+ * Optional profiling counters, only gathered while rti_profiling is
+ * set.  Each resource accumulates its own without locking and
+ * rt_add_res_stats() merges them into rti_profile.
+ */
+struct rt_profile {
+    size_t              pr_nsolids;     /**< @brief  # entries in pr_by_solid[] */
+    struct rt_profile_counts *pr_by_solid; /**< @brief  array [pr_nsolids], indexed by st_bit */
+    size_t              pr_rays;        /**< @brief  # rays profiled */
+    size_t              pr_cells;       /**< @brief  # space partition cells visited, all rays */
+    size_t              pr_max_cells;   /**< @brief  most cells visited by a single ray */
+};
+
 /**
  * One of these structures is needed per thread of execution, usually
  * with calling applications creating an array with at least MAX_PSW
@@ -101,6 +123,8 @@ struct resource {
     long                re_tree_free;
     struct directory *  re_directory_hd;
     struct bu_ptbl      re_directory_blocks;    /**< @brief  Table of malloc'ed blocks */
+    struct bu_list      re_vshot_packets;       /**< @brief  freelist of rt_vshootray() packet scratch space */
+    struct rt_profile * re_profile;     /**< @brief  profiling counters, NULL unless rti_profiling */
 };
 
 /**
@@ -109,7 +133,7 @@ struct resource {
 RT_EXPORT extern struct resource rt_uniresource;        /**< @brief  default.  Defined in librt/globals.c */
 #define RESOURCE_NULL   ((struct resource *)0)
 #define RT_CK_RESOURCE(_p) BU_CKMAG(_p, RESOURCE_MAGIC, "struct resource")
-#define RT_RESOURCE_INIT_ZERO { RESOURCE_MAGIC, 0, BU_LIST_INIT_ZERO, BU_PTBL_INIT_ZERO, 0, 0, 0, BU_LIST_INIT_ZERO, 0, 0, 0, BU_LIST_INIT_ZERO, BU_LIST_INIT_ZERO, BU_LIST_INIT_ZERO, NULL, 0, NULL, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, 0, 0, BU_PTBL_INIT_ZERO, NULL, 0, 0, 0, NULL, BU_PTBL_INIT_ZERO }
+#define RT_RESOURCE_INIT_ZERO { RESOURCE_MAGIC, 0, BU_LIST_INIT_ZERO, BU_PTBL_INIT_ZERO, 0, 0, 0, BU_LIST_INIT_ZERO, 0, 0, 0, BU_LIST_INIT_ZERO, BU_LIST_INIT_ZERO, BU_LIST_INIT_ZERO, NULL, 0, NULL, 0, 0, 0, 0, 0, 0, 0, 0, NULL, 0, 0, 0, 0, BU_PTBL_INIT_ZERO, NULL, 0, 0, 0, NULL, BU_PTBL_INIT_ZERO, BU_LIST_INIT_ZERO, NULL }
 
 /**
  * Definition of global parallel-processing semaphores.
@@ -126,6 +126,16 @@ struct rt_i {
     /* Parameters for dynamic geometry */
     int                 rti_add_to_new_solids_list;
     struct bu_ptbl      rti_new_solids;
+    /* Parameters for RT_PART_HLBVH space partitioning */
+    struct bvh_flat_node *rti_bvh_nodes; /**< @brief  flattened BVH over finite solids */
+    long                rti_bvh_nnodes; /**< @brief  # of nodes in rti_bvh_nodes */
+    struct soltab **    rti_bvh_prims;  /**< @brief  finite solids, in BVH leaf order */
+    /* Packed copy of the cut tree, walked by rt_advance_to_next_cell() */
+    struct cut_flat_node *rti_cut_flat; /**< @brief  depth-first cut tree nodes */
+    uint8_t *           rti_cut_boxes;  /**< @brief  packed leaf boxnodes and short solid lists */
+    /* Optional per-solid and per-ray profiling, see rt_profile_report() */
+    int                 rti_profiling;  /**< @brief  !0 gathers struct rt_profile counters */
+    struct rt_profile * rti_profile;    /**< @brief  counters merged by rt_add_res_stats() */
 };
 
 
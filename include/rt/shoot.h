@@ -47,6 +47,7 @@
 
 #include "common.h"
 #include "vmath.h"
+#include "bu/vls.h"
 #include "rt/defines.h"
 #include "rt/application.h"
 #include "rt/xray.h"
@@ -93,6 +94,36 @@ __BEGIN_DECLS
 RT_EXPORT extern int rt_shootray(struct application *ap);
 
 
+/**
+ * @brief
+ * Any-hit query for shadow and visibility rays
+ *
+ * Reports whether anything blocks ap->a_ray between its start point
+ * and max_dist along it (all the way out when max_dist <= 0).  The
+ * ray stops at the first conclusive hit instead of building the full
+ * partition list for an a_hit() routine; a_hit, a_miss, a_onehit and
+ * a_ray_length are not used, the rest of ap is as for rt_shootray().
+ *
+ * occluder is asked about each region in the way and returns > 0
+ * when it blocks the ray, 0 when the ray passes through it, and < 0
+ * when that cannot be told without shading it.  When NULL, every
+ * non-air region blocks and air never does.  A segment of a solid
+ * that a blocking, all-union region uses settles the query as soon
+ * as it is shot, before any boolean weaving or evaluation.
+ * Partitions that end within a few distance tolerances of the ray
+ * start, such as the surface the ray leaves from, are ignored.
+ *
+ * Returns -
+ * 1 the ray is blocked
+ * 0 nothing blocks the ray
+ * -1 occluder could not decide on a region in the way, and nothing
+ * else blocks the ray; the caller has to use rt_shootray()
+ */
+RT_EXPORT extern int rt_occluded(struct application *ap,
+				 fastf_t max_dist,
+				 int (*occluder)(struct application *, const struct region *));
+
+
 /**
  * @brief
  * Shoot a bundle of rays
@@ -140,6 +171,24 @@ RT_EXPORT extern struct partition *rt_shootray_simple(struct application *ap,
  */
 RT_EXPORT extern int rt_shootray_bundle(struct application *ap, struct xray *rays, int nrays);
 
+/**
+ * Fire a packet of nrays coherent rays, one per application structure
+ * in the aps[] array.  Each application carries its own a_ray and
+ * callbacks, and is handled as if passed to rt_shootray(), except
+ * that the space partition is walked once for the whole packet and
+ * the primitives are intersected a whole type at a time, through
+ * ft_vshot() for the types that have a tested one.  Every application must use the same a_rt_i and the
+ * same a_resource (taken from aps[0] if unset).  a_ray_length is not
+ * used to end rays early.
+ *
+ * Returns the number of rays for which a_hit() was called.  The
+ * callback return values are left in each a_return.
+ *
+ * PRIVATE: this is new API and should be considered private for the
+ * time being.
+ */
+RT_EXPORT extern int rt_vshootray(struct application *aps, int nrays);
+
 /**
  * To be called only in non-parallel mode, to tally up the statistics
  * from the resource structure(s) into the rt instance structure.
@@ -153,6 +202,23 @@ RT_EXPORT extern void rt_add_res_stats(struct rt_i *rtip,
 /** Tally stats into struct rt_i */
 RT_EXPORT extern void rt_zero_res_stats(struct resource *resp);
 
+/**
+ * Clear the profiling counters merged into rtip->rti_profile, e.g.
+ * at the start of a frame.  Counters are only gathered while
+ * rtip->rti_profiling is set.
+ */
+RT_EXPORT extern void rt_profile_zero(struct rt_i *rtip);
+
+/**
+ * Append the profiling counters tallied by rt_add_res_stats() to
+ * json as a JSON object: ray and space partition cell counts, then
+ * shot calls, hits and nanoseconds spent in ft_shot() (or
+ * ft_piece_shot()) for every solid that was shot and for every
+ * primitive type.
+ */
+RT_EXPORT extern void rt_profile_report(struct bu_vls *json,
+					const struct rt_i *rtip);
+
 
 RT_EXPORT extern void rt_res_pieces_clean(struct resource *resp,
 					  struct rt_i *rtip);
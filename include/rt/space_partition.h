@@ -107,6 +107,56 @@ hlbvh_create(long max_prims_in_node, struct bu_pool *pool, const fastf_t *centro
 	     const fastf_t *bounds_prims, long *total_nodes,
 	     const long n_primitives, long **ordered_prims);
 
+/**
+ * Depth-first flattened BVH node, as walked by rt_shootray() when
+ * rti_space_partition is RT_PART_HLBVH.  The first child of an
+ * interior node immediately follows it in the array.
+ */
+struct bvh_flat_node {
+    fastf_t bounds[6];		/**< @brief min[3], max[3] */
+    union {
+	long primitives_offset;		/**< @brief leaf */
+	long second_child_offset;	/**< @brief interior */
+    } u;
+    long n_primitives;		/**< @brief 0 -> interior node */
+    uint8_t axis;		/**< @brief interior node: xyz */
+};
+
+/**
+ * Maximum depth of a flattened BVH that rt_shootray() will walk.
+ * Deeper trees are rejected at prep time.
+ */
+#define BVH_STACK_SIZE 64
+
+/**
+ * Flatten a tree returned by hlbvh_create() into a depth-first array
+ * of total_nodes entries.  Returns the array, and the depth of the
+ * tree in max_depth.
+ */
+RT_EXPORT extern struct bvh_flat_node *
+hlbvh_flatten(const struct bvh_build_node *root, long total_nodes, long *max_depth);
+
+/**
+ * Depth-first packed copy of the RT_PART_NUBSPT cut tree, as walked
+ * by rt_advance_to_next_cell().  The left child of a cut immediately
+ * follows it in the array; cf_index is the array index of the right
+ * child.  For a leaf, cf_index is the byte offset of its boxnode in
+ * rti_cut_boxes, where short solid lists are stored right after the
+ * boxnode they belong to.
+ */
+struct cut_flat_node {
+    fastf_t cf_point;		/**< @brief cut through axis==point */
+    uint32_t cf_axis;		/**< @brief 0, 1, 2 = cut along X, Y, Z, or CUT_FLAT_LEAF */
+    uint32_t cf_index;		/**< @brief right child, or leaf boxnode offset */
+};
+#define CUT_FLAT_LEAF 3
+
+/**
+ * Longest bn_list that is copied in next to its packed boxnode.
+ * Longer lists stay where rt_cut_it() put them.
+ */
+#define CUT_FLAT_INLINE 16
+
 
 /**
  * Add a solid into a given boxnode, extending the lists there.  This
@@ -123,6 +123,7 @@ struct tie_s {
     point_t min, max;
     vect_t amin, amax, mid;
     fastf_t radius;
+    int simd_level;		/* bu_simd_level() at prep, picks the leaf intersection kernel */
 };
 
 RT_EXPORT extern int tie_check_degenerate;
@@ -0,0 +1,130 @@
+#!/bin/sh
+#                     T R A N S M I T . S H
+# BRL-CAD
+#
+# Copyright (c) 2010-2024 United States Government as represented by
+# the U.S. Army Research Laboratory.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following
+# disclaimer in the documentation and/or other materials provided
+# with the distribution.
+#
+# 3. The name of the author may not be used to endorse or promote
+# products derived from this software without specific prior written
+# permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+# OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+###
+
+# Ensure /bin/sh
+export PATH || (echo "This isn't sh."; sh $0 $*; kill $$)
+
+# source common library functionality, setting ARGS, NAME_OF_THIS,
+# PATH_TO_THIS, and THIS.
+. "$1/regress/library.sh"
+
+if test "x$LOGFILE" = "x" ; then
+    LOGFILE=`pwd`/transmit.log
+    rm -f $LOGFILE
+fi
+log "=== TESTING shadows of transparent objects ==="
+
+RT="`ensearch rt`"
+if test ! -f "$RT" ; then
+    log "Unable to find rt, aborting"
+    exit 1
+fi
+A2G="`ensearch asc2g`"
+if test ! -f "$A2G" ; then
+    log "Unable to find asc2g, aborting"
+    exit 1
+fi
+PIXDIFF="`ensearch pixdiff`"
+if test ! -f "$PIXDIFF" ; then
+    log "Unable to find pixdiff, aborting"
+    exit 1
+fi
+
+# The balls and poles use a shader that only turns transparent when it
+# is run, so they must cast no shadow from either light, and the scene
+# with them has to match the scene without them.
+rm -f transmit.asc
+cat > transmit.asc <<EOF
+title {Untitled BRL-CAD Database}
+units mm
+put {local} ell V {-4 -4 4} A {0.5 0 0} B {0 0.5 0} C {0 0 0.5}
+put {infinite} ell V {-4 4 4} A {0.5 0 0} B {0 0.5 0} C {0 0 0.5}
+put {plate.s} arb8 V1 {-30 -30 -1} V2 {30 -30 -1} V3 {30 30 -1} V4 {-30 30 -1} V5 {-30 -30 0} V6 {30 -30 0} V7 {30 30 0} V8 {-30 30 0}
+put {pole2.s} tgc V {9 2.5 1} H {0 0 10} A {0 -0.25 0} B {0.25 0 0} C {0 -0.25 0} D {0.25 0 0}
+put {pole1.s} tgc V {-11 2.5 1} H {0 0 10} A {0 -0.25 0} B {0.25 0 0} C {0 -0.25 0} D {0.25 0 0}
+put {ball2.s} ell V {10 0 5} A {2 0 0} B {0 2 0} C {0 0 2}
+put {ball1.s} ell V {-10 0 5} A {2 0 0} B {0 2 0} C {0 0 2}
+put {clear_objs.r} comb region yes tree {u {u {l ball1.s} {l pole1.s}} {u {l ball2.s} {l pole2.s}}}
+attr set {clear_objs.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1001} {oshader} {rtrans {t 1}}
+put {plate.r} comb region yes tree {l plate.s}
+attr set {plate.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1000}
+put {infinite.r} comb region yes tree {l infinite}
+attr set {infinite.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1002} {oshader} {light {i 1 v 0}} {rgb} {255/255/255}
+put {local.r} comb region yes tree {l local}
+attr set {local.r} {region} {R} {rgb} {255/255/255} {oshader} {light {s 1}} {region_id} {1003} {material_id} {1} {los} {100}
+put {with.g} comb region no tree {u {u {l infinite.r} {l local.r}} {u {l plate.r} {l clear_objs.r}}}
+put {without.g} comb region no tree {u {u {l infinite.r} {l local.r}} {l plate.r}}
+EOF
+
+run $A2G transmit.asc transmit.g
+
+for obj in with without ; do
+    log "rendering $obj.g..."
+    rm -f transmit.$obj.pix
+    $RT -M -B -p30 -o transmit.$obj.pix transmit.g $obj.g >> $LOGFILE 2>&1 <<EOF
+viewsize 1.600000000000000e+02;
+orientation 0.000000000000000e+00 0.000000000000000e+00 0.000000000000000e+00 1.000000000000000e+00;
+eye_pt 0.000000000000000e+00 0.000000000000000e+00 7.950000000000000e+01;
+start 0; clean;
+end;
+EOF
+done
+
+log "... running $PIXDIFF transmit.with.pix transmit.without.pix > transmit.diff.pix"
+rm -f transmit.diff.pix
+$PIXDIFF transmit.with.pix transmit.without.pix > transmit.diff.pix 2>> $LOGFILE
+
+NUMBER_WRONG=`tail -n1 "$LOGFILE" | tr , '\012' | awk '/many/ {print $1}'`
+log "transmit.with.pix $NUMBER_WRONG off by many"
+
+if [ X$NUMBER_WRONG = X0 ] ; then
+    log "-> transmit.sh succeeded"
+else
+    log "-> transmit.sh FAILED, see $LOGFILE"
+    cat "$LOGFILE"
+fi
+
+exit $NUMBER_WRONG
+
+# Local Variables:
+# mode: sh
+# tab-width: 8
+# sh-indentation: 4
+# sh-basic-offset: 4
+# indent-tabs-mode: t
+# End:
+# ex: shiftwidth=4 tabstop=8
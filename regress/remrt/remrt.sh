@@ -0,0 +1,181 @@
+#!/bin/sh
+#                        R E M R T . S H
+# BRL-CAD
+#
+# Copyright (c) 2024 United States Government as represented by
+# the U.S. Army Research Laboratory.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following
+# disclaimer in the documentation and/or other materials provided
+# with the distribution.
+#
+# 3. The name of the author may not be used to endorse or promote
+# products derived from this software without specific prior written
+# permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+# OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+###
+
+# Ensure /bin/sh
+export PATH || (echo "This isn't sh."; sh $0 $*; kill $$)
+
+# source common library functionality, setting ARGS, NAME_OF_THIS,
+# PATH_TO_THIS, and THIS.
+. "$1/regress/library.sh"
+
+if test "x$LOGFILE" = "x" ; then
+    LOGFILE=`pwd`/remrt.log
+    rm -f $LOGFILE
+fi
+log "=== TESTING remrt with local rtsrv servers ==="
+
+RT="`ensearch rt`"
+if test ! -f "$RT" ; then
+    log "Unable to find rt, aborting"
+    exit 1
+fi
+REMRT="`ensearch remrt`"
+if test ! -f "$REMRT" ; then
+    log "Unable to find remrt, aborting"
+    exit 1
+fi
+RTSRV="`ensearch rtsrv`"
+if test ! -f "$RTSRV" ; then
+    log "Unable to find rtsrv, aborting"
+    exit 1
+fi
+A2G="`ensearch asc2g`"
+if test ! -f "$A2G" ; then
+    log "Unable to find asc2g, aborting"
+    exit 1
+fi
+PIXDIFF="`ensearch pixdiff`"
+if test ! -f "$PIXDIFF" ; then
+    log "Unable to find pixdiff, aborting"
+    exit 1
+fi
+
+NSERVERS=4
+SIZE=128
+TIMEOUT=300
+
+rm -f remrt.asc
+cat > remrt.asc <<EOF
+title {Untitled BRL-CAD Database}
+units mm
+put {plate.s} arb8 V1 {-30 -30 -1} V2 {30 -30 -1} V3 {30 30 -1} V4 {-30 30 -1} V5 {-30 -30 0} V6 {30 -30 0} V7 {30 30 0} V8 {-30 30 0}
+put {ball.s} ell V {-10 0 5} A {5 0 0} B {0 5 0} C {0 0 5}
+put {pole.s} tgc V {10 5 0} H {0 0 20} A {0 -3 0} B {3 0 0} C {0 -1 0} D {1 0 0}
+put {plate.r} comb region yes tree {l plate.s}
+attr set {plate.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1000} {rgb} {200/200/200}
+put {ball.r} comb region yes tree {l ball.s}
+attr set {ball.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1001} {rgb} {255/0/0}
+put {pole.r} comb region yes tree {l pole.s}
+attr set {pole.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1002} {rgb} {0/0/255}
+put {all.g} comb region no tree {u {u {l plate.r} {l ball.r}} {l pole.r}}
+EOF
+
+run $A2G remrt.asc remrt.g
+
+log "rendering remrt.ref.pix with rt..."
+rm -f remrt.ref.pix
+run $RT -s$SIZE -a35 -e25 -o remrt.ref.pix remrt.g all.g
+
+# An empty .remrtrc here keeps remrt from picking up (and starting)
+# any servers listed in one in $HOME.  The local servers volunteer.
+rm -f .remrtrc remrt.pix.* remrt.remrt.log remrt.rtsrv.log
+touch .remrtrc
+
+log "rendering remrt.pix with remrt and $NSERVERS rtsrv servers..."
+$REMRT -s$SIZE -a35 -e25 -o remrt.pix remrt.g all.g < /dev/null > remrt.remrt.log 2>&1 &
+REMRT_PID=$!
+
+PORT=""
+WAITED=0
+while test "x$PORT" = "x" ; do
+    PORT="`sed -n 's/.*Assigned LIBPKG permport \([0-9][0-9]*\).*/\1/p' remrt.remrt.log`"
+    if test "x$PORT" = "x" ; then
+	if test $WAITED -ge 30 || ! kill -0 $REMRT_PID 2>/dev/null ; then
+	    log "remrt did not start listening"
+	    cat remrt.remrt.log >> $LOGFILE
+	    kill $REMRT_PID 2>/dev/null
+	    exit 1
+	fi
+	sleep 1
+	WAITED="`expr $WAITED + 1`"
+    fi
+done
+log "remrt is listening on port $PORT"
+
+SRV_PIDS=""
+i=0
+while test $i -lt $NSERVERS ; do
+    $RTSRV -d 127.0.0.1 $PORT >> remrt.rtsrv.log 2>&1 &
+    SRV_PIDS="$SRV_PIDS $!"
+    i="`expr $i + 1`"
+done
+
+WAITED=0
+while kill -0 $REMRT_PID 2>/dev/null ; do
+    if test $WAITED -ge $TIMEOUT ; then
+	log "remrt did not finish within $TIMEOUT seconds"
+	kill $REMRT_PID 2>/dev/null
+	break
+    fi
+    sleep 1
+    WAITED="`expr $WAITED + 1`"
+done
+kill $SRV_PIDS 2>/dev/null
+cat remrt.remrt.log >> $LOGFILE
+
+NUMBER_WRONG=1
+for pix in remrt.pix.* ; do
+    if test -f "$pix" ; then
+	log "... running $PIXDIFF $pix remrt.ref.pix > remrt.diff.pix"
+	rm -f remrt.diff.pix
+	$PIXDIFF $pix remrt.ref.pix > remrt.diff.pix 2>> $LOGFILE
+	NUMBER_WRONG=`tail -n1 "$LOGFILE" | tr , '\012' | awk '/many/ {print $1}'`
+	if test "x$NUMBER_WRONG" = "x" ; then
+	    NUMBER_WRONG=1
+	fi
+	log "$pix $NUMBER_WRONG off by many"
+    fi
+done
+rm -f .remrtrc
+
+if [ X$NUMBER_WRONG = X0 ] ; then
+    log "-> remrt.sh succeeded"
+else
+    log "-> remrt.sh FAILED, see $LOGFILE"
+    cat "$LOGFILE"
+fi
+
+exit $NUMBER_WRONG
+
+# Local Variables:
+# mode: sh
+# tab-width: 8
+# sh-indentation: 4
+# sh-basic-offset: 4
+# indent-tabs-mode: t
+# End:
+# ex: shiftwidth=4 tabstop=8
@@ -0,0 +1,154 @@
+#!/bin/sh
+#                       R T X R A Y . S H
+# BRL-CAD
+#
+# Copyright (c) 2024 United States Government as represented by
+# the U.S. Army Research Laboratory.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following
+# disclaimer in the documentation and/or other materials provided
+# with the distribution.
+#
+# 3. The name of the author may not be used to endorse or promote
+# products derived from this software without specific prior written
+# permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+# OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+###
+
+# Ensure /bin/sh
+export PATH || (echo "This isn't sh."; sh $0 $*; kill $$)
+
+# source common library functionality, setting ARGS, NAME_OF_THIS,
+# PATH_TO_THIS, and THIS.
+. "$1/regress/library.sh"
+
+if test "x$LOGFILE" = "x" ; then
+    LOGFILE=`pwd`/rtxray.log
+    rm -f $LOGFILE
+fi
+log "=== TESTING rtxray and rtdepth scanline order ==="
+
+RT="`ensearch rt`"
+if test ! -f "$RT" ; then
+    log "Unable to find rt, aborting"
+    exit 1
+fi
+RTXRAY="`ensearch rtxray`"
+if test ! -f "$RTXRAY" ; then
+    log "Unable to find rtxray, aborting"
+    exit 1
+fi
+RTDEPTH="`ensearch rtdepth`"
+if test ! -f "$RTDEPTH" ; then
+    log "Unable to find rtdepth, aborting"
+    exit 1
+fi
+A2G="`ensearch asc2g`"
+if test ! -f "$A2G" ; then
+    log "Unable to find asc2g, aborting"
+    exit 1
+fi
+
+# rtxray and rtdepth fill a single scanline buffer and write it out
+# in order at the end of each row, so they must be handed whole rows.
+# Seen from above, the wedge covers one run of rows, fewer pixels on
+# each going up, which any out of order or mixed up row breaks.  rt takes 2-D tiles
+# and must still see the same pixels hit on every row.
+rm -f rtxray.asc
+cat > rtxray.asc <<EOF
+title {Untitled BRL-CAD Database}
+units mm
+put {wedge.s} arb8 V1 {-40 -40 0} V2 {40 -40 0} V3 {40 -40 10} V4 {-40 -40 10} V5 {-40 40 0} V6 {-40 40 0} V7 {-40 40 10} V8 {-40 40 10}
+put {wedge.r} comb region yes tree {l wedge.s}
+attr set {wedge.r} {region} {R} {los} {100} {material_id} {1} {region_id} {1000} {rgb} {255/255/255}
+EOF
+
+run $A2G rtxray.asc rtxray.g
+
+SIZE=256
+
+render ( ) {
+    log "rendering $2..."
+    rm -f $2
+    $1 -M -s$SIZE $3 -o $2 rtxray.g wedge.r >> $LOGFILE 2>&1 <<EOF
+viewsize 1.000000000000000e+02;
+orientation 0.000000000000000e+00 0.000000000000000e+00 0.000000000000000e+00 1.000000000000000e+00;
+eye_pt 0.000000000000000e+00 0.000000000000000e+00 1.000000000000000e+02;
+start 0; clean;
+end;
+EOF
+}
+
+# print the number of pixels hit on each row, bottom row first
+rowcounts ( ) {
+    od -An -v -tu1 $1 | awk -v width=$SIZE '
+	{ for (i = 1; i <= NF; i++) { if (n % 3 == 0 && $i > 0) hits[int(n / (3 * width))]++; n++ } }
+	END { if (n != 3 * width * width) print "short"; for (y = 0; y < width; y++) print y, hits[y] + 0 }'
+}
+
+render $RTXRAY rtxray.xray.pix
+render $RTDEPTH rtxray.depth.pix
+render $RT rtxray.rt1.pix "-P1 -C0/0/0"
+render $RT rtxray.rt4.pix "-P4 -C0/0/0"
+
+FAILED=0
+
+rowcounts rtxray.depth.pix > rtxray.depth.rows
+if awk -v width=$SIZE '
+	$1 == "short" { bad = 1 }
+	$2 > 0 && (prev > 0 ? $2 > prev : rows > 0) { bad = 1 }
+	{ prev = $2; if ($2 > 0) rows++ }
+	END { if (bad || rows < width / 2 || rows >= width) exit 1 }' rtxray.depth.rows ; then
+    log "rtxray.depth.pix rows are in order"
+else
+    log "rtxray.depth.pix rows are out of order"
+    FAILED="`expr $FAILED + 1`"
+fi
+
+for pix in rtxray.xray.pix rtxray.rt1.pix rtxray.rt4.pix ; do
+    rowcounts $pix > rtxray.rows
+    if cmp -s rtxray.rows rtxray.depth.rows ; then
+	log "$pix hits the same pixels as rtxray.depth.pix"
+    else
+	log "$pix differs from rtxray.depth.pix"
+	FAILED="`expr $FAILED + 1`"
+    fi
+done
+
+if [ X$FAILED = X0 ] ; then
+    log "-> rtxray.sh succeeded"
+else
+    log "-> rtxray.sh FAILED, see $LOGFILE"
+    cat "$LOGFILE"
+fi
+
+exit $FAILED
+
+# Local Variables:
+# mode: sh
+# tab-width: 8
+# sh-indentation: 4
+# sh-basic-offset: 4
+# indent-tabs-mode: t
+# End:
+# ex: shiftwidth=4 tabstop=8
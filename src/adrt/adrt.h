@@ -53,6 +53,12 @@ enum
 };
 
 
+/*
+ * An ADRT_NETOP_COMPRESS message carries one byte, the ADRT_LEVEL_*
+ * compression level (see codec.h) for results sent back on that
+ * connection.  Above ADRT_LEVEL_NONE, ADRT_WORK_FRAME results are
+ * tile deltas against the previous frame sent on the connection.
+ */
 #define ADRT_NETOP_BASE 0x20
 /* top level messages */
 enum
@@ -65,6 +71,7 @@ enum
     ADRT_NETOP_MESG,			/* 25 */
     ADRT_NETOP_QUIT,			/* 26 */
     ADRT_NETOP_SHUTDOWN,		/* 27 */
+    ADRT_NETOP_COMPRESS,		/* 28 */
     ADRT_NETOP_END
 };
 
@@ -80,7 +87,7 @@ enum
 #define ADRT_MESSAGE_MODE_CHANGEP(x) (x & 0x80)
 #define ADRT_MESSAGE_MODE(x) (x & ~0x80)
 
-#define ADRT_VER_KEY		0
+#define ADRT_VER_KEY		1
 #define ADRT_VER_DETAIL		"ADRT - Advanced Distributed Ray Tracer"
 
 #define ADRT_MESH_HIT	0x1
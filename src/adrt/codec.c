@@ -0,0 +1,231 @@
+/*                         C O D E C . C
+ * BRL-CAD / ADRT
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file codec.c
+ *
+ * Packed buffers and tile deltas are read and written with memcpy(),
+ * as their fields fall at unaligned offsets.
+ *
+ */
+
+#include "common.h"
+
+#include <limits.h>
+#include <string.h>
+#include "zlib.h"
+
+#include "codec.h"
+
+/* Defined in librt's cache_lz4.c, which is built into the ADRT programs */
+extern int brl_LZ4_compress_default(const char* source, char* dest, int sourceSize, int maxDestSize);
+extern int brl_LZ4_compressBound(int inputSize);
+extern int brl_LZ4_decompress_safe(const char* source, char* dest, int compressedSize, int maxDecompressedSize);
+
+
+void
+adrt_codec_pack(int level, const uint8_t *src, uint32_t len, tienet_buffer_t *dst)
+{
+    uint8_t codec = ADRT_CODEC_NONE;
+    uint32_t clen = 0;
+
+    if (level > ADRT_LEVEL_MAX)
+	level = ADRT_LEVEL_MAX;
+
+    if (level == ADRT_LEVEL_FAST && len <= INT_MAX) {
+	int bound, ret;
+
+	bound = brl_LZ4_compressBound((int)len);
+	if (bound > 0) {
+	    TIENET_BUFFER_SIZE((*dst), ADRT_CODEC_HEADER + (size_t)bound);
+	    ret = brl_LZ4_compress_default((const char *)src, (char *)&dst->data[ADRT_CODEC_HEADER], (int)len, bound);
+	    if (ret > 0 && (uint32_t)ret < len) {
+		codec = ADRT_CODEC_LZ4;
+		clen = (uint32_t)ret;
+	    }
+	}
+    } else if (level > ADRT_LEVEL_FAST) {
+	uLongf dest_len = compressBound(len);
+
+	TIENET_BUFFER_SIZE((*dst), ADRT_CODEC_HEADER + dest_len);
+	if (compress2(&dst->data[ADRT_CODEC_HEADER], &dest_len, src, len, level) == Z_OK && dest_len < len) {
+	    codec = ADRT_CODEC_ZLIB;
+	    clen = (uint32_t)dest_len;
+	}
+    }
+
+    /* Incompressible, or not asked to compress */
+    if (codec == ADRT_CODEC_NONE) {
+	TIENET_BUFFER_SIZE((*dst), ADRT_CODEC_HEADER + (size_t)len);
+	if (len)
+	    memcpy(&dst->data[ADRT_CODEC_HEADER], src, len);
+	clen = len;
+    }
+
+    dst->data[0] = codec;
+    memcpy(&dst->data[1], &len, 4);
+    dst->ind = ADRT_CODEC_HEADER + clen;
+}
+
+
+int
+adrt_codec_unpack(const uint8_t *src, uint32_t len, tienet_buffer_t *dst)
+{
+    uint32_t raw_len;
+    uLongf dest_len;
+
+    if (len < ADRT_CODEC_HEADER)
+	return -1;
+    memcpy(&raw_len, &src[1], 4);
+    TIENET_BUFFER_SIZE((*dst), raw_len ? raw_len : 1);
+
+    switch (src[0]) {
+	case ADRT_CODEC_NONE:
+	    if (len - ADRT_CODEC_HEADER != raw_len)
+		return -1;
+	    if (raw_len)
+		memcpy(dst->data, &src[ADRT_CODEC_HEADER], raw_len);
+	    break;
+
+	case ADRT_CODEC_LZ4:
+	    if (raw_len > INT_MAX || len - ADRT_CODEC_HEADER > INT_MAX)
+		return -1;
+	    if (brl_LZ4_decompress_safe((const char *)&src[ADRT_CODEC_HEADER], (char *)dst->data,
+					(int)(len - ADRT_CODEC_HEADER), (int)raw_len) != (int)raw_len)
+		return -1;
+	    break;
+
+	case ADRT_CODEC_ZLIB:
+	    dest_len = raw_len;
+	    if (uncompress(dst->data, &dest_len, &src[ADRT_CODEC_HEADER], len - ADRT_CODEC_HEADER) != Z_OK
+		|| dest_len != raw_len)
+		return -1;
+	    break;
+
+	default:
+	    return -1;
+    }
+
+    dst->ind = raw_len;
+    return 0;
+}
+
+
+void
+adrt_codec_delta(const uint8_t *frame, uint8_t *prev, uint16_t w, uint16_t h, tienet_buffer_t *dst)
+{
+    uint32_t nx, ny, tx, ty, tile, count;
+    uint32_t x0, y0, tw, th, row, y;
+    size_t off;
+
+    nx = (w + ADRT_DELTA_TILE - 1) / ADRT_DELTA_TILE;
+    ny = (h + ADRT_DELTA_TILE - 1) / ADRT_DELTA_TILE;
+
+    /* Room for every tile, so the buffer is sized once per frame size */
+    TIENET_BUFFER_SIZE((*dst), 4 + 4 * (size_t)nx * ny + 3 * (size_t)w * h);
+    dst->ind = 4;
+    count = 0;
+
+    for (ty = 0; ty < ny; ty++) {
+	y0 = ty * ADRT_DELTA_TILE;
+	th = (h - y0 < ADRT_DELTA_TILE) ? h - y0 : ADRT_DELTA_TILE;
+
+	for (tx = 0; tx < nx; tx++) {
+	    x0 = tx * ADRT_DELTA_TILE;
+	    tw = (w - x0 < ADRT_DELTA_TILE) ? w - x0 : ADRT_DELTA_TILE;
+	    row = 3 * tw;
+
+	    if (prev) {
+		for (y = 0; y < th; y++) {
+		    off = 3 * ((size_t)(y0 + y) * w + x0);
+		    if (memcmp(&frame[off], &prev[off], row))
+			break;
+		}
+		if (y == th)
+		    continue;	/* unchanged */
+	    }
+
+	    tile = ty * nx + tx;
+	    memcpy(&dst->data[dst->ind], &tile, 4);
+	    dst->ind += 4;
+
+	    for (y = 0; y < th; y++) {
+		off = 3 * ((size_t)(y0 + y) * w + x0);
+		memcpy(&dst->data[dst->ind], &frame[off], row);
+		if (prev)
+		    memcpy(&prev[off], &frame[off], row);
+		dst->ind += row;
+	    }
+	    count++;
+	}
+    }
+
+    memcpy(dst->data, &count, 4);
+}
+
+
+int
+adrt_codec_apply(uint8_t *frame, uint16_t w, uint16_t h, const uint8_t *delta, uint32_t len)
+{
+    uint32_t nx, ny, tile, count, i, ind;
+    uint32_t x0, y0, tw, th, row, y;
+
+    if (len < 4)
+	return -1;
+
+    nx = (w + ADRT_DELTA_TILE - 1) / ADRT_DELTA_TILE;
+    ny = (h + ADRT_DELTA_TILE - 1) / ADRT_DELTA_TILE;
+
+    memcpy(&count, delta, 4);
+    ind = 4;
+
+    for (i = 0; i < count; i++) {
+	if (len - ind < 4)
+	    return -1;
+	memcpy(&tile, &delta[ind], 4);
+	ind += 4;
+	if (tile >= nx * ny)
+	    return -1;
+
+	x0 = (tile % nx) * ADRT_DELTA_TILE;
+	y0 = (tile / nx) * ADRT_DELTA_TILE;
+	tw = (w - x0 < ADRT_DELTA_TILE) ? w - x0 : ADRT_DELTA_TILE;
+	th = (h - y0 < ADRT_DELTA_TILE) ? h - y0 : ADRT_DELTA_TILE;
+	row = 3 * tw;
+	if ((size_t)row * th > len - ind)
+	    return -1;
+
+	for (y = 0; y < th; y++) {
+	    memcpy(&frame[3 * ((size_t)(y0 + y) * w + x0)], &delta[ind], row);
+	    ind += row;
+	}
+    }
+
+    return (ind == len) ? 0 : -1;
+}
+
+
+/*
+ * Local Variables:
+ * mode: C
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
@@ -0,0 +1,82 @@
+/*                         C O D E C . H
+ * BRL-CAD / ADRT
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file codec.h
+ *
+ * Compression and tile-delta encoding of the results that travel from
+ * slaves to the master, and of the frames the master sends observers.
+ *
+ * A packed buffer is a one byte codec tag and the four byte unpacked
+ * length, followed by the data in that codec.  A delta is a four byte
+ * count of changed tiles, then for each tile its four byte index
+ * (row-major, ADRT_DELTA_TILE pixels on a side, clipped at the right
+ * and bottom edges) and its RGB rows.  Multi-byte values are in the
+ * sender's byte order, as elsewhere in the ADRT protocol.
+ */
+
+#ifndef ADRT_CODEC_H
+#define ADRT_CODEC_H
+
+#include "common.h"
+
+#include "tienet.h"
+
+/* codec tags */
+#define ADRT_CODEC_NONE		0
+#define ADRT_CODEC_LZ4		1
+#define ADRT_CODEC_ZLIB		2
+
+/*
+ * Compression levels: 0 sends full frames as is, 1 uses LZ4 for the
+ * lowest latency, and 2 through 9 use zlib at that level for the
+ * smallest frames on slow links.
+ */
+#define ADRT_LEVEL_NONE		0
+#define ADRT_LEVEL_FAST		1
+#define ADRT_LEVEL_MAX		9
+
+#define ADRT_CODEC_HEADER	5
+#define ADRT_DELTA_TILE		32
+
+/* pack len bytes of src into dst at the given level */
+extern void adrt_codec_pack(int level, const uint8_t *src, uint32_t len, tienet_buffer_t *dst);
+
+/* unpack a packed buffer into dst, returns 0 on success, -1 if it is corrupt */
+extern int adrt_codec_unpack(const uint8_t *src, uint32_t len, tienet_buffer_t *dst);
+
+/*
+ * Encode the tiles of a w by h RGB frame that differ from prev into
+ * dst, and update prev to match.  With no prev, every tile is sent.
+ */
+extern void adrt_codec_delta(const uint8_t *frame, uint8_t *prev, uint16_t w, uint16_t h, tienet_buffer_t *dst);
+
+/* apply a delta to a w by h RGB frame, returns 0 on success, -1 if it is corrupt */
+extern int adrt_codec_apply(uint8_t *frame, uint16_t w, uint16_t h, const uint8_t *delta, uint32_t len);
+
+#endif
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
@@ -36,7 +36,6 @@
 #ifdef HAVE_GETOPT_H
 #  include <getopt.h>
 #endif
-#include "zlib.h"
 #include "bnetwork.h"
 #include "bio.h"
 
@@ -54,6 +53,7 @@
 #include "adrt_struct.h"	/* adrt common structs */
 #include "tienet.h"
 #include "tienet_master.h"
+#include "codec.h"
 #include "camera.h"
 #include "dispatcher.h"		/* Dispatcher that creates work units */
 #include "compnet.h"		/* Component Networking, Sends Component Names via Network */
@@ -66,6 +66,10 @@ typedef struct master_socket_s
     int32_t controller;
     int32_t active;
     tienet_sem_t frame_sem;
+    uint8_t level;		/* compression level, ADRT_LEVEL_* */
+    tienet_buffer_t last;	/* last frame sent, for tile deltas */
+    uint16_t last_w;
+    uint16_t last_h;
     struct master_socket_s *prev;
     struct master_socket_s *next;
 } master_socket_t;
@@ -86,6 +90,7 @@ typedef struct master_s
 
     tienet_buffer_t buf;
     tienet_buffer_t buf_comp;
+    tienet_buffer_t buf_delta;
 
     uint32_t frame_ind;
     uint8_t slave_data[64];
@@ -115,6 +120,7 @@ master_setup(void)
 
     TIENET_BUFFER_INIT(master.buf);
     TIENET_BUFFER_INIT(master.buf_comp);
+    TIENET_BUFFER_INIT(master.buf_delta);
 
     /* -1 indicates this slot is not used and thus does not contain an open project. */
     for (i = 0; i < ADRT_MAX_WORKSPACE_NUM; i++)
@@ -160,6 +166,7 @@ master_init(int port, int obs_port, char *list, char *exec, char *comp_host, int
 
     TIENET_BUFFER_FREE(master.buf);
     TIENET_BUFFER_FREE(master.buf_comp);
+    TIENET_BUFFER_FREE(master.buf_delta);
 
     /* Wait for networking thread to end */
     bu_thrd_join(master.networking_thread, NULL);
@@ -320,6 +327,26 @@ master_result(tienet_buffer_t *result)
 }
 
 
+/*
+ * Encode the current frame into master.buf_delta as the tiles that
+ * differ from the last frame this observer was sent.
+ */
+static void
+master_frame_delta(master_socket_t *sock)
+{
+    if (sock->last_w != master.image_w || sock->last_h != master.image_h) {
+	/* First frame at this size, send all of it */
+	adrt_codec_delta(master.buf.data, NULL, master.image_w, master.image_h, &master.buf_delta);
+	TIENET_BUFFER_SIZE(sock->last, master.buf.ind);
+	memcpy(sock->last.data, master.buf.data, master.buf.ind);
+	sock->last_w = master.image_w;
+	sock->last_h = master.image_h;
+    } else {
+	adrt_codec_delta(master.buf.data, sock->last.data, master.image_w, master.image_h, &master.buf_delta);
+    }
+}
+
+
 int
 master_networking(void *ptr)
 {
@@ -423,6 +450,10 @@ master_networking(void *ptr)
 		    master.socklist->num = new_socket;
 		    master.socklist->controller = master.active_connections ? 0 : 1;
 		    master.socklist->active = 1;
+		    master.socklist->level = ADRT_LEVEL_FAST;
+		    TIENET_BUFFER_INIT(master.socklist->last);
+		    master.socklist->last_w = 0;
+		    master.socklist->last_h = 0;
 		    master.socklist->next = tmp;
 		    master.socklist->prev = NULL;
 		    tienet_sem_init(&(master.socklist->frame_sem), 0);
@@ -448,6 +479,8 @@ master_networking(void *ptr)
 		if (sock == master.socklist)
 		    master.socklist = master.socklist->next;
 		close(sock->num);
+		TIENET_BUFFER_FREE(sock->last);
+		sock->last.data = NULL;
 		if (!sock->next)
 		    break;
 		sock = sock->next;
@@ -469,6 +502,18 @@ master_networking(void *ptr)
 		    tienet_send(sock->num, &endian, 2);
 		    break;
 
+		case ADRT_NETOP_COMPRESS:
+		    {
+			uint8_t level;
+
+			tienet_recv(sock->num, &level, 1);
+			sock->level = (level > ADRT_LEVEL_MAX) ? ADRT_LEVEL_MAX : level;
+
+			/* Start over with a whole frame */
+			sock->last_w = sock->last_h = 0;
+		    }
+		    break;
+
 		case ADRT_NETOP_REQWID:
 		    {
 			uint16_t i;
@@ -564,21 +609,24 @@ master_networking(void *ptr)
 			tienet_send(sock->num, &master.buf.ind, 4);
 
 #if defined(ADRT_USE_COMPRESSION) && ADRT_USE_COMPRESSION
-			{
-			    unsigned long dest_len;
-			    unsigned int comp_size;
-
-			    dest_len = master.buf.ind + 32;
-			    TIENET_BUFFER_SIZE(master.buf_comp, dest_len);
-
+			if (sock->level == ADRT_LEVEL_NONE) {
 			    /* result data */
-			    compress(&master.buf_comp.data[sizeof(unsigned int)], &dest_len, master.buf.data, master.buf.ind);
-			    comp_size = dest_len;
-
-			    TCOPY(uint32_t, &comp_size, 0, master.buf_comp.data, 0);
-
-			    /* int compressed data size in bytes followed by actual rgb frame data */
-			    tienet_send(sock->num, master.buf_comp.data, comp_size + sizeof(unsigned int));
+			    tienet_send(sock->num, master.buf.data, master.buf.ind);
+			} else {
+			    uint8_t *data = master.buf.data;
+			    uint32_t len = master.buf.ind;
+
+			    /* Frames only carry the tiles that changed since this observer's last one */
+			    if (op == ADRT_WORK_FRAME && len == 3 * (uint32_t)master.image_w * master.image_h) {
+				master_frame_delta(sock);
+				data = master.buf_delta.data;
+				len = master.buf_delta.ind;
+			    }
+			    adrt_codec_pack(sock->level, data, len, &master.buf_comp);
+
+			    /* packed size in bytes followed by the packed result */
+			    tienet_send(sock->num, &master.buf_comp.ind, 4);
+			    tienet_send(sock->num, master.buf_comp.data, master.buf_comp.ind);
 			}
 #else
 			/* result data */
@@ -31,7 +31,6 @@
 #include "bio.h"
 #include "bsocket.h"
 #include "bnetwork.h"
-#include "zlib.h"
 #include <stdlib.h>
 #include <string.h>
 #ifdef HAVE_NETDB_H
@@ -46,6 +45,7 @@
 /* adrt headers */
 #include "adrt.h"
 #include "tienet.h"
+#include "codec.h"
 
 /* local api headers */
 #include "./tienet_master.h"
@@ -677,7 +677,8 @@ void tienet_master_send_work(tienet_master_socket_t *sock)
 void tienet_master_result(tienet_master_socket_t *sock)
 {
 #if defined(ADRT_USE_COMPRESSION) && ADRT_USE_COMPRESSION
-    unsigned long comp_len, dest_len;
+    unsigned long comp_len;
+    uint32_t result_len;
 #endif
 
     /* A work unit has come in, this slave is officially active */
@@ -706,8 +707,12 @@ void tienet_master_result(tienet_master_socket_t *sock)
     tienet_recv(sock->num, tienet_master_result_buffer_comp.data, comp_len);
 
     /* uncompress the data */
-    dest_len = tienet_master_result_buffer.ind+32;	/* some extra padding for zlib to work with */
-    uncompress(tienet_master_result_buffer.data, &dest_len, tienet_master_result_buffer_comp.data, tienet_master_result_buffer_comp.ind);
+    result_len = tienet_master_result_buffer.ind;
+    if (adrt_codec_unpack(tienet_master_result_buffer_comp.data, tienet_master_result_buffer_comp.ind, &tienet_master_result_buffer)
+	|| tienet_master_result_buffer.ind != result_len) {
+	fprintf(stderr, "corrupt result from slave, dropping it.\n");
+	tienet_master_result_buffer.ind = 0;
+    }
 
     tienet_master_transfer += tienet_master_result_buffer_comp.ind + sizeof(unsigned int);
 #else
@@ -720,7 +725,8 @@ void tienet_master_result(tienet_master_socket_t *sock)
     tienet_master_send_work(sock);
 
     /* Application level result callback function to process results. */
-    tienet_master_fcb_result(&tienet_master_result_buffer);
+    if (tienet_master_result_buffer.ind)
+	tienet_master_fcb_result(&tienet_master_result_buffer);
 
     /*
      * If there's no units still out, the application has indicated it's done generating work,
@@ -30,7 +30,6 @@
 #include "bio.h"
 #include "bsocket.h"
 #include "bnetwork.h"
-#include "zlib.h"
 #include <stdlib.h>
 #include <string.h>
 #ifdef HAVE_NETDB_H
@@ -43,6 +42,7 @@
 /* adrt headers */
 #include "adrt.h"
 #include "tienet.h"
+#include "codec.h"
 
 /* local api headers */
 #include "./tienet_slave.h"
@@ -106,7 +106,6 @@ void tienet_slave_worker(int port, char *host) {
     uint32_t size = 0;
     int slave_socket = 0;
     tienet_buffer_t buffer_comp = {0};
-    unsigned long dest_len = 0;
 
 
     /* Initialize res_buf to NULL for realloc'ing */
@@ -184,8 +183,16 @@ void tienet_slave_worker(int port, char *host) {
 	    if (!result.ind)
 		continue;
 
+#if defined(ADRT_USE_COMPRESSION) && ADRT_USE_COMPRESSION
+	    /* Compress the result buffer, favoring speed */
+	    adrt_codec_pack(ADRT_LEVEL_FAST, result.data, result.ind, &buffer_comp);
+	    size = buffer_comp.ind;
+#else
+	    size = result.ind;
+#endif
+
 	    /* Send Result Back, length of: result + op_code + result_length + compression_length */
-	    TIENET_BUFFER_SIZE(buffer, result.ind+sizeof(short)+sizeof(int)+sizeof(uint32_t));
+	    TIENET_BUFFER_SIZE(buffer, size+sizeof(short)+sizeof(int)+sizeof(uint32_t));
 
 	    buffer.ind = 0;
 
@@ -199,13 +206,6 @@ void tienet_slave_worker(int port, char *host) {
 	    buffer.ind += sizeof(uint32_t);
 
 #if defined(ADRT_USE_COMPRESSION) && ADRT_USE_COMPRESSION
-	    /* Compress the result buffer */
-	    TIENET_BUFFER_SIZE(buffer_comp, result.ind+32);
-
-	    dest_len = buffer_comp.size+32;
-	    compress(buffer_comp.data, &dest_len, result.data, result.ind);
-	    size = (uint32_t)dest_len;
-
 	    /* Pack Compressed Result Length */
 	    TCOPY(uint32_t, &size, 0, buffer.data, buffer.ind);
 	    buffer.ind += sizeof(uint32_t);
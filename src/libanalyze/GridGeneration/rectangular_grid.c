@@ -110,7 +110,15 @@ int rectangular_triple_grid_generator(struct xray *ray, void *context)
 	(grid->view)++;
 	grid->current_point = 0;
     }
-    return (rectangular_grid_generator(ray, grid));
+    if (rectangular_grid_generator(ray, grid) == 1) {
+	/* a skipped last point runs off the end of the view, go on
+	 * to the next one
+	 */
+	if (grid->view < grid->max_views)
+	    return (rectangular_triple_grid_generator(ray, grid));
+	return 1;
+    }
+    return 0;
 }
 
 /*
@@ -92,7 +92,14 @@ struct per_region_data {
  */
 #define A_LENDEN a_color[0]
 #define A_LEN a_color[1]
+#define A_WEIGHT a_color[2]	/* grid cells the ray stands for, negative to retract a sample */
 #define A_STATE a_uptr
+#define A_VIEW a_flag		/* view the ray belongs to */
+#define A_CELL a_uvec		/* size of the ray's grid cell along each model axis */
+#define A_RAYSIG a_vvec[0]	/* hash of the regions along the ray, for adaptive refinement */
+#define A_RAYLEN a_vvec[1]	/* in-region length along the ray, for adaptive refinement */
+
+struct grid_view;
 
 struct current_state {
     int curr_view; 	/* the "view" number we are shooting */
@@ -110,7 +117,7 @@ struct current_state {
     /* sem_stats protects this */
     double *m_lenDensity;
     double *m_len;
-    unsigned long *shots;
+    double *shots;	/* total weight of the rays shot in each view */
 
     /* Plot file I/O protection */
     int sem_plot;
@@ -143,6 +150,8 @@ struct current_state {
     size_t required_number_hits;
     int use_air;
     int use_single_grid;
+    int adaptive;	/* refine only the triple grid cells that have not converged */
+    struct grid_view *gviews;	/* per-view cell trees when adaptive */
     int grid_size_flag; 	/* flag that identifies when the grid-size is mentioned */
     int use_view_information;
     int quiet_missed_report;
@@ -78,6 +78,12 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
     double last_out_dist = -1.0;
     double gap_dist;
     struct current_state *state = (struct current_state *)ap->A_STATE;
+    double weight = ap->A_WEIGHT;
+    int retract = (weight < 0.0); /* repeating a sample to take it back out */
+    int view = ap->A_VIEW;
+    int i_axis = state->grid->single_grid ? state->i_axis : view;
+    uint32_t sig = (uint32_t)ap->A_RAYSIG;
+    double ray_len = 0.0;
 
     if (!segs) /* unexpected */
 	return 0;
@@ -107,14 +113,17 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 	VJOIN1(pt, ap->a_ray.r_pt, pp->pt_inhit->hit_dist, ap->a_ray.r_dir);
 	VJOIN1(opt, ap->a_ray.r_pt, pp->pt_outhit->hit_dist, ap->a_ray.r_dir);
 
-	if (state->debug) {
+	sig = sig * 31 + (uint32_t)pp->pt_regionp->reg_bit + 1;
+	ray_len += dist;
+
+	if (state->debug && !retract) {
 	    bu_semaphore_acquire(BU_SEM_GENERAL);
 	    bu_vls_printf(state->debug_str, "%s %g->%g\n", pp->pt_regionp->reg_name,
 			  pp->pt_inhit->hit_dist, pp->pt_outhit->hit_dist);
 	    bu_semaphore_release(BU_SEM_GENERAL);
 	}
 
-	if (state->analysis_flags & ANALYSIS_EXP_AIR) {
+	if ((state->analysis_flags & ANALYSIS_EXP_AIR) && !retract) {
 
 	    gap_dist = (pp->pt_inhit->hit_dist - last_out_dist);
 
@@ -130,7 +139,7 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 	}
 
 	/* looking for voids in the model */
-	if (state->analysis_flags & ANALYSIS_GAP) {
+	if ((state->analysis_flags & ANALYSIS_GAP) && !retract) {
 	    if (pp->pt_back != PartHeadp) {
 		/* if this entry point is further than the previous
 		 * exit point then we have a void
@@ -145,7 +154,7 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 
 	/* computing the mass of the objects */
 	if (state->analysis_flags & ANALYSIS_MASS) {
-	    if (state->debug) {
+	    if (state->debug && !retract) {
 		bu_semaphore_acquire(BU_SEM_GENERAL);
 		bu_vls_printf(state->debug_str, "Hit %s doing mass\n", pp->pt_regionp->reg_name);
 		bu_semaphore_release(BU_SEM_GENERAL);
@@ -165,16 +174,16 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 		struct per_region_data *prd;
 		vect_t cmass;
 		vect_t lenTorque;
-		fastf_t Lx = state->span[0]/state->steps[0];
-		fastf_t Ly = state->span[1]/state->steps[1];
-		fastf_t Lz = state->span[2]/state->steps[2];
+		fastf_t Lx = ap->A_CELL[X];
+		fastf_t Ly = ap->A_CELL[Y];
+		fastf_t Lz = ap->A_CELL[Z];
 		fastf_t Lx_sq;
 		fastf_t Ly_sq;
 		fastf_t Lz_sq;
 		fastf_t cell_area;
 		int los;
 
-		switch (state->i_axis) {
+		switch (i_axis) {
 		    case 0:
 			Lx_sq = dist*pp->pt_regionp->reg_los*0.01;
 			Lx_sq *= Lx_sq;
@@ -213,28 +222,28 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 
 		/* accumulate the total mass values */
 		val = grams_per_cu_mm * dist * (pp->pt_regionp->reg_los * 0.01);
-		ap->A_LENDEN += val;
+		ap->A_LENDEN += val * weight;
 
 		prd = ((struct per_region_data *)pp->pt_regionp->reg_udata);
 		/* accumulate the per-region per-view mass values */
 		bu_semaphore_acquire(state->sem_stats);
-		prd->r_lenDensity[state->i_axis] += val;
+		prd->r_lenDensity[i_axis] += val * weight;
 
 		/* accumulate the per-object per-view mass values */
-		prd->optr->o_lenDensity[state->i_axis] += val;
+		prd->optr->o_lenDensity[i_axis] += val * weight;
 
 		if (state->analysis_flags & ANALYSIS_CENTROIDS) {
 		    /* calculate the center of mass for this partition */
 		    VJOIN1(cmass, pt, dist*0.5, ap->a_ray.r_dir);
 
 		    /* calculate the lenTorque for this partition (i.e. centerOfMass * lenDensity) */
-		    VSCALE(lenTorque, cmass, val);
+		    VSCALE(lenTorque, cmass, val * weight);
 
 		    /* accumulate per-object per-view torque values */
-		    VADD2(&prd->optr->o_lenTorque[state->i_axis*3], &prd->optr->o_lenTorque[state->i_axis*3], lenTorque);
+		    VADD2(&prd->optr->o_lenTorque[i_axis*3], &prd->optr->o_lenTorque[i_axis*3], lenTorque);
 
 		    /* accumulate the total lenTorque */
-		    VADD2(&state->m_lenTorque[state->i_axis*3], &state->m_lenTorque[state->i_axis*3], lenTorque);
+		    VADD2(&state->m_lenTorque[i_axis*3], &state->m_lenTorque[i_axis*3], lenTorque);
 
 		    if (state->analysis_flags & ANALYSIS_MOMENTS) {
 			vectp_t moi;
@@ -242,25 +251,27 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 			fastf_t dx_sq = cmass[X]*cmass[X];
 			fastf_t dy_sq = cmass[Y]*cmass[Y];
 			fastf_t dz_sq = cmass[Z]*cmass[Z];
-			fastf_t mass = val * cell_area;
+			/* cell_area is this ray's own cell, so the moments
+			 * are absolute rather than weighted */
+			fastf_t mass = retract ? -val * cell_area : val * cell_area;
 			static const fastf_t ONE_TWELFTH = 1.0 / 12.0;
 
 			/* Collect moments and products of inertia for the current object */
-			moi = &prd->optr->o_moi[state->i_axis*3];
+			moi = &prd->optr->o_moi[i_axis*3];
 			moi[X] += ONE_TWELFTH*mass*(Ly_sq + Lz_sq) + mass*(dy_sq + dz_sq);
 			moi[Y] += ONE_TWELFTH*mass*(Lx_sq + Lz_sq) + mass*(dx_sq + dz_sq);
 			moi[Z] += ONE_TWELFTH*mass*(Lx_sq + Ly_sq) + mass*(dx_sq + dy_sq);
-			poi = &prd->optr->o_poi[state->i_axis*3];
+			poi = &prd->optr->o_poi[i_axis*3];
 			poi[X] -= mass*cmass[X]*cmass[Y];
 			poi[Y] -= mass*cmass[X]*cmass[Z];
 			poi[Z] -= mass*cmass[Y]*cmass[Z];
 
 			/* Collect moments and products of inertia for all objects */
-			moi = &state->m_moi[state->i_axis*3];
+			moi = &state->m_moi[i_axis*3];
 			moi[X] += ONE_TWELFTH*mass*(Ly_sq + Lz_sq) + mass*(dy_sq + dz_sq);
 			moi[Y] += ONE_TWELFTH*mass*(Lx_sq + Lz_sq) + mass*(dx_sq + dz_sq);
 			moi[Z] += ONE_TWELFTH*mass*(Lx_sq + Ly_sq) + mass*(dx_sq + dy_sq);
-			poi = &state->m_poi[state->i_axis*3];
+			poi = &state->m_poi[i_axis*3];
 			poi[X] -= mass*cmass[X]*cmass[Y];
 			poi[Y] -= mass*cmass[X]*cmass[Z];
 			poi[Z] -= mass*cmass[Y]*cmass[Z];
@@ -319,25 +330,25 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 	/* compute the volume of the object */
 	if (state->analysis_flags & ANALYSIS_VOLUME) {
 	    struct per_region_data *prd = ((struct per_region_data *)pp->pt_regionp->reg_udata);
-	    ap->A_LEN += dist; /* add to total volume */
+	    ap->A_LEN += dist * weight; /* add to total volume */
 	    {
 		bu_semaphore_acquire(state->sem_worker);
 
 		/* add to region volume */
-		prd->r_len[state->curr_view] += dist;
+		prd->r_len[view] += dist * weight;
 
 		/* add to object volume */
-		prd->optr->o_len[state->curr_view] += dist;
+		prd->optr->o_len[view] += dist * weight;
 
 		bu_semaphore_release(state->sem_worker);
 	    }
-	    if (state->debug) {
+	    if (state->debug && !retract) {
 		bu_semaphore_acquire(BU_SEM_GENERAL);
 		bu_vls_printf(state->debug_str, "\t\tvol hit %s oDist:%g objVol:%g %s\n",
-			      pp->pt_regionp->reg_name, dist, prd->optr->o_len[state->curr_view], prd->optr->o_name);
+			      pp->pt_regionp->reg_name, dist, prd->optr->o_len[view], prd->optr->o_name);
 		bu_semaphore_release(BU_SEM_GENERAL);
 	    }
-	    if (state->plot_volume) {
+	    if (state->plot_volume && !retract) {
 		bu_semaphore_acquire(state->sem_plot);
 		if (ap->a_user & 1) {
 		    pl_color(state->plot_volume, 128, 255, 192);  /* pale green */
@@ -346,19 +357,19 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 		}
 
 		pdv_3line(state->plot_volume, pt, opt);
-		bu_semaphore_acquire(state->sem_plot);
+		bu_semaphore_release(state->sem_plot);
 	    }
 	}
 
 	/* look for two adjacent air regions */
-	if (state->analysis_flags & ANALYSIS_ADJ_AIR) {
+	if ((state->analysis_flags & ANALYSIS_ADJ_AIR) && !retract) {
 	    if (last_air && pp->pt_regionp->reg_aircode &&
 		pp->pt_regionp->reg_aircode != last_air) {
 		state->adj_air_callback(&ap->a_ray, pp, pt, state->adj_air_callback_data);
 	    }
 	}
 
-	if (pp->pt_regionp->reg_aircode) {
+	if (pp->pt_regionp->reg_aircode && !retract) {
 	    /* look for air first on shotlines */
 	    if (pp->pt_back == PartHeadp) {
 		if (state->analysis_flags & ANALYSIS_FIRST_AIR)
@@ -382,19 +393,23 @@ analyze_hit(struct application *ap, struct partition *PartHeadp, struct seg *seg
 	}
 
 	/* note that this region has been seen */
-	((struct per_region_data *)pp->pt_regionp->reg_udata)->hits++;
+	if (!retract)
+	    ((struct per_region_data *)pp->pt_regionp->reg_udata)->hits++;
 
 	last_air = pp->pt_regionp->reg_aircode;
 	last_out_dist = pp->pt_outhit->hit_dist;
 	VJOIN1(last_out_point, ap->a_ray.r_pt, pp->pt_outhit->hit_dist, ap->a_ray.r_dir);
     }
 
-    if (state->analysis_flags & ANALYSIS_EXP_AIR && last_air) {
+    if (state->analysis_flags & ANALYSIS_EXP_AIR && last_air && !retract) {
 	/* the last thing we hit was air.  Make a note of that */
 	pp = PartHeadp->pt_back;
 	state->exp_air_callback(pp, last_out_point, pt, opt, state->exp_air_callback_data);
     }
 
+    ap->A_RAYSIG = sig;
+    ap->A_RAYLEN = ray_len;
+
     /* This value is returned by rt_shootray a hit usually returns 1,
      * miss 0.
      */
@@ -458,6 +473,12 @@ analyze_overlap(struct application *ap,
 	/* too small to matter, pick one or none */
 	return 1;
 
+    /* flag the ray for adaptive refinement, and only report the
+     * overlap the first time the ray is shot */
+    ap->A_RAYSIG = 1;
+    if (ap->A_WEIGHT < 0.0)
+	return 1;
+
     VJOIN1(ihit, rp->r_pt, ihitp->hit_dist, rp->r_dir);
 
     if (state->analysis_flags & ANALYSIS_OVERLAPS) {
@@ -764,6 +785,11 @@ check_terminate(struct current_state *state)
 	    return 0; /* terminate */
 	}
     }
+
+    /* adaptive passes weigh each ray by its own cell, nothing to rescale */
+    if (state->adaptive)
+	return 1;
+
     for (view=0; view < state->num_views; view++) {
 	for (obj = 0; obj < state->num_objects; obj++) {
 	    VSCALE(&state->objs[obj].o_moi[view*3], &state->objs[obj].o_moi[view*3], 0.25);
@@ -776,57 +802,520 @@ check_terminate(struct current_state *state)
     return 1;
 }
 
+static void
+analyze_worker_init(struct application *ap, int cpu, struct current_state *state)
+{
+    RT_APPLICATION_INIT(ap);
+    ap->a_rt_i = (struct rt_i *)state->rtip;	/* application uses this instance */
+    ap->a_hit = analyze_hit;    /* where to go on a hit */
+    ap->a_miss = analyze_miss;  /* where to go on a miss */
+    ap->a_resource = &state->resp[cpu];
+    ap->a_logoverlap = rt_silent_logoverlap;
+    ap->A_LENDEN = 0.0; /* really the cumulative length*density for mass computation*/
+    ap->A_LEN = 0.0;    /* really the cumulative length for volume computation */
+    ap->A_STATE = (void *)state; /* really copying the state ptr to the a_uptr */
+    ap->A_WEIGHT = 1.0;
+    ap->a_overlap = analyze_overlap;
+}
+
+
 /**
- * This routine must be prepared to run in parallel
+ * This routine must be prepared to run in parallel.
+ *
+ * The triple grid hands out the rays of every view from one
+ * generator, so a single bu_parallel() covers a whole pass.
  */
 static void
 analyze_worker(int cpu, void *ptr)
 {
     struct application ap;
     struct current_state *state = (struct current_state *)ptr;
-    unsigned long shot_cnt;
+    struct rectangular_grid *grid = state->grid;
+    double lenden[3] = {0.0, 0.0, 0.0};
+    double len[3] = {0.0, 0.0, 0.0};
+    unsigned long shot_cnt[3] = {0, 0, 0};
+    int view, slot;
+    int ret;
 
     if (state->aborted)
 	return;
 
-    RT_APPLICATION_INIT(&ap);
-    ap.a_rt_i = (struct rt_i *)state->rtip;	/* application uses this instance */
-    ap.a_hit = analyze_hit;    /* where to go on a hit */
-    ap.a_miss = analyze_miss;  /* where to go on a miss */
-    ap.a_resource = &state->resp[cpu];
-    ap.a_logoverlap = rt_silent_logoverlap;
-    ap.A_LENDEN = 0.0; /* really the cumulative length*density for mass computation*/
-    ap.A_LEN = 0.0;    /* really the cumulative length for volume computation */
-    ap.A_STATE = ptr; /* really copying the state ptr to the a_uptr */
-    ap.a_overlap = analyze_overlap;
-
-    shot_cnt = 0;
+    analyze_worker_init(&ap, cpu, state);
+    ap.A_CELL[X] = state->span[X] / state->steps[X];
+    ap.A_CELL[Y] = state->span[Y] / state->steps[Y];
+    ap.A_CELL[Z] = state->span[Z] / state->steps[Z];
+
     while (1) {
 	bu_semaphore_acquire(state->sem_worker);
-	if (rectangular_grid_generator(&ap.a_ray, state->grid) == 1){
+	if (grid->single_grid)
+	    ret = rectangular_grid_generator(&ap.a_ray, grid);
+	else
+	    ret = rectangular_triple_grid_generator(&ap.a_ray, grid);
+	if (ret == 1) {
 	    bu_semaphore_release(state->sem_worker);
 	    break;
 	}
-	ap.a_user = (int)(state->grid->current_point / (state->grid->x_points));
+	ap.a_user = (int)(grid->current_point / (grid->x_points));
+	view = grid->single_grid ? state->curr_view : grid->view - 1;
 	bu_semaphore_release(state->sem_worker);
+
+	slot = grid->single_grid ? 0 : view;
+	ap.A_VIEW = view;
+	ap.A_RAYSIG = 0.0;
+	ap.A_LENDEN = 0.0;
+	ap.A_LEN = 0.0;
 	(void)rt_shootray(&ap);
 	if (state->aborted)
 	    return;
-	shot_cnt++;
+	lenden[slot] += ap.A_LENDEN;
+	len[slot] += ap.A_LEN;
+	shot_cnt[slot]++;
     }
 
-    /* There's nothing else left to work on in this view.  It's time
-     * to add the values we have accumulated to the totals for the
+    /* There's nothing else left to work on in this pass.  It's time
+     * to add the values we have accumulated to the totals for each
      * view and return.  When all threads have been through here,
      * we'll have returned to serial computation.
      */
     bu_semaphore_acquire(state->sem_stats);
-    state->shots[state->curr_view] += shot_cnt;
-    state->m_lenDensity[state->curr_view] += ap.A_LENDEN; /* add our length*density value */
-    state->m_len[state->curr_view] += ap.A_LEN; /* add our volume value */
+    for (slot = 0; slot < 3; slot++) {
+	view = grid->single_grid ? state->curr_view : slot;
+	if (!shot_cnt[slot])
+	    continue;
+	state->shots[view] += shot_cnt[slot];
+	state->m_lenDensity[view] += lenden[slot]; /* add our length*density value */
+	state->m_len[view] += len[slot]; /* add our volume value */
+    }
     bu_semaphore_release(state->sem_stats);
 }
 
+
+/*
+ * Adaptive triple grid refinement.
+ *
+ * Each view keeps a quadtree over a base grid of cells.  Every leaf
+ * has had one ray shot through its center, standing for the whole
+ * cell.  A leaf is split only where it disagrees with a neighbor, in
+ * the regions the ray passed through (or an overlap) or in how much
+ * material it crossed, so flat interiors stop costing rays once they
+ * have been seen.  Splitting a cell re-shoots its center with a
+ * negative weight to take that sample back out and shoots the four
+ * quarter cells in its place.
+ */
+
+struct grid_cell {
+    long child;		/* index of the first of four children, -1 for a leaf */
+    uint32_t sig;	/* A_RAYSIG of the ray through the cell center */
+    float len;		/* A_RAYLEN of the ray through the cell center */
+};
+
+
+struct grid_view {
+    long nx, ny;	/* base cells along u and v */
+    vect_t cell;	/* base cell size along each model axis */
+    struct grid_cell *cells;	/* the nx*ny base cells come first */
+    size_t ncells;
+    size_t max_cells;
+};
+
+
+struct grid_job {
+    long cell;		/* cell to record the ray in, -1 to retract a sample */
+    int view;
+    double u, v;	/* ray position, in base cells */
+    double size;	/* cell size, in base cells */
+    double weight;	/* base cells the ray stands for */
+};
+
+
+struct grid_queue {
+    struct current_state *state;
+    struct grid_job *jobs;
+    size_t njobs;
+    size_t max_jobs;
+    size_t next;	/* protected by sem_worker */
+};
+
+
+struct grid_leaf {
+    long cell;
+    double x, y;	/* lower corner, in base cells */
+    double size;
+};
+
+
+/* rays handed to a worker at a time */
+#define GRID_JOB_CHUNK 64
+
+
+static void
+grid_add_job(struct grid_queue *q, int view, long cell, double u, double v, double size, double weight)
+{
+    struct grid_job *job;
+
+    if (q->njobs == q->max_jobs) {
+	q->max_jobs = q->max_jobs ? q->max_jobs * 2 : 1024;
+	q->jobs = (struct grid_job *)bu_realloc(q->jobs, q->max_jobs * sizeof(struct grid_job), "grid jobs");
+    }
+    job = &q->jobs[q->njobs++];
+    job->cell = cell;
+    job->view = view;
+    job->u = u;
+    job->v = v;
+    job->size = size;
+    job->weight = weight;
+}
+
+
+static long
+grid_add_cells(struct grid_view *gv, size_t n)
+{
+    size_t i, first = gv->ncells;
+
+    if (gv->ncells + n > gv->max_cells) {
+	while (gv->ncells + n > gv->max_cells)
+	    gv->max_cells = gv->max_cells ? gv->max_cells * 2 : 1024;
+	gv->cells = (struct grid_cell *)bu_realloc(gv->cells, gv->max_cells * sizeof(struct grid_cell), "grid cells");
+    }
+    for (i = first; i < first + n; i++) {
+	gv->cells[i].child = -1;
+	gv->cells[i].sig = 0;
+	gv->cells[i].len = 0.0;
+    }
+    gv->ncells += n;
+    return (long)first;
+}
+
+
+/**
+ * Return the leaf holding the point (u, v), in base cells, or -1
+ * when the point is off the grid.
+ */
+static long
+grid_find(const struct grid_view *gv, double u, double v)
+{
+    double x, y, size = 1.0;
+    long cell;
+
+    if (u < 0.0 || v < 0.0 || u >= (double)gv->nx || v >= (double)gv->ny)
+	return -1;
+
+    x = floor(u);
+    y = floor(v);
+    cell = (long)y * gv->nx + (long)x;
+    while (gv->cells[cell].child >= 0) {
+	int quad = 0;
+	size *= 0.5;
+	if (u >= x + size) {
+	    quad |= 1;
+	    x += size;
+	}
+	if (v >= y + size) {
+	    quad |= 2;
+	    y += size;
+	}
+	cell = gv->cells[cell].child + quad;
+    }
+    return cell;
+}
+
+
+static void
+grid_leaves(const struct grid_view *gv, long cell, double x, double y, double size, struct grid_leaf **leaves, size_t *nleaves, size_t *max_leaves)
+{
+    int quad;
+
+    if (gv->cells[cell].child >= 0) {
+	for (quad = 0; quad < 4; quad++)
+	    grid_leaves(gv, gv->cells[cell].child + quad,
+			x + ((quad & 1) ? size * 0.5 : 0.0),
+			y + ((quad & 2) ? size * 0.5 : 0.0),
+			size * 0.5, leaves, nleaves, max_leaves);
+	return;
+    }
+
+    if (*nleaves == *max_leaves) {
+	*max_leaves = *max_leaves ? *max_leaves * 2 : 1024;
+	*leaves = (struct grid_leaf *)bu_realloc(*leaves, *max_leaves * sizeof(struct grid_leaf), "grid leaves");
+    }
+    (*leaves)[*nleaves].cell = cell;
+    (*leaves)[*nleaves].x = x;
+    (*leaves)[*nleaves].y = y;
+    (*leaves)[*nleaves].size = size;
+    (*nleaves)++;
+}
+
+
+/**
+ * A leaf has converged when the cells just beyond each of its sides
+ * saw the same regions along their rays, and the material length
+ * across it is close enough to linear that the center ray gives the
+ * cell's average.  len_tol is the length error allowed per ray.
+ */
+static int
+grid_converged(const struct grid_view *gv, const struct grid_leaf *lf, double len_tol)
+{
+    /* probe points around the leaf, as fractions of its size */
+    static const double probe[8][2] = {
+	{0.25, -0.001}, {0.75, -0.001}, {0.25, 1.001}, {0.75, 1.001},
+	{-0.001, 0.25}, {-0.001, 0.75}, {1.001, 0.25}, {1.001, 0.75}
+    };
+    static const double side[4][2] = {
+	{0.5, -0.001}, {0.5, 1.001}, {-0.001, 0.5}, {1.001, 0.5}
+    };
+    const struct grid_cell *c = &gv->cells[lf->cell];
+    long n[4];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+	long nb = grid_find(gv, lf->x + probe[i][0] * lf->size, lf->y + probe[i][1] * lf->size);
+	if (nb >= 0 && gv->cells[nb].sig != c->sig)
+	    return 0;
+    }
+
+    for (i = 0; i < 4; i++)
+	n[i] = grid_find(gv, lf->x + side[i][0] * lf->size, lf->y + side[i][1] * lf->size);
+
+    /* the center ray is off by about an eighth of the second
+     * difference over the cell
+     */
+    for (i = 0; i < 4; i += 2) {
+	if (n[i] < 0 || n[i+1] < 0)
+	    continue;
+	if (fabs(gv->cells[n[i]].len + gv->cells[n[i+1]].len - 2.0 * c->len) > 8.0 * len_tol)
+	    return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * Queue one ray through the center of every base cell of every view.
+ */
+static void
+grid_init(struct current_state *state, struct grid_queue *q)
+{
+    int view, k;
+    long i, j;
+
+    state->gviews = (struct grid_view *)bu_calloc(state->num_views, sizeof(struct grid_view), "grid views");
+    for (view = 0; view < state->num_views; view++) {
+	struct grid_view *gv = &state->gviews[view];
+	int u_axis = (view+1) % 3;
+	int v_axis = (view+2) % 3;
+
+	for (k = 0; k < 3; k++) {
+	    if (state->steps[k] < 1)
+		state->steps[k] = 1;
+	    gv->cell[k] = state->span[k] / state->steps[k];
+	}
+	gv->nx = state->steps[u_axis];
+	gv->ny = state->steps[v_axis];
+	(void)grid_add_cells(gv, (size_t)(gv->nx * gv->ny));
+
+	for (j = 0; j < gv->ny; j++)
+	    for (i = 0; i < gv->nx; i++)
+		grid_add_job(q, view, j * gv->nx + i, i + 0.5, j + 0.5, 1.0, 1.0);
+    }
+}
+
+
+/**
+ * Split the leaves that have not converged, queueing a retraction of
+ * each one's sample and rays for its four children.  If everything
+ * has converged but the tolerances still are not met, split every
+ * leaf, which is the uniform refinement of the non-adaptive grid.
+ */
+static void
+grid_refine(struct current_state *state, struct grid_queue *q)
+{
+    struct grid_leaf **leaves;
+    size_t *nleaves;
+    char **split;
+    size_t i, nsplit = 0;
+    int view, quad;
+
+    leaves = (struct grid_leaf **)bu_calloc(state->num_views, sizeof(struct grid_leaf *), "leaves");
+    nleaves = (size_t *)bu_calloc(state->num_views, sizeof(size_t), "nleaves");
+    split = (char **)bu_calloc(state->num_views, sizeof(char *), "split");
+
+    for (view = 0; view < state->num_views; view++) {
+	struct grid_view *gv = &state->gviews[view];
+	double len_tol;
+	size_t max_leaves = 0;
+	long i_cell, j_cell;
+
+	for (j_cell = 0; j_cell < gv->ny; j_cell++)
+	    for (i_cell = 0; i_cell < gv->nx; i_cell++)
+		grid_leaves(gv, j_cell * gv->nx + i_cell, (double)i_cell, (double)j_cell, 1.0,
+			    &leaves[view], &nleaves[view], &max_leaves);
+
+	/* spread the volume tolerance over the view, or settle for a
+	 * thousandth of the model depth when there is none
+	 */
+	if (state->volume_tolerance > 0.0)
+	    len_tol = state->volume_tolerance / state->area[view];
+	else
+	    len_tol = state->span[view] * 0.001;
+
+	split[view] = (char *)bu_calloc(nleaves[view] + 1, sizeof(char), "split");
+	for (i = 0; i < nleaves[view]; i++) {
+	    if (!grid_converged(gv, &leaves[view][i], len_tol)) {
+		split[view][i] = 1;
+		nsplit++;
+	    }
+	}
+    }
+
+    for (view = 0; view < state->num_views; view++) {
+	struct grid_view *gv = &state->gviews[view];
+
+	for (i = 0; i < nleaves[view]; i++) {
+	    const struct grid_leaf *lf = &leaves[view][i];
+	    double half = lf->size * 0.5;
+	    double area = lf->size * lf->size;
+	    long child;
+
+	    if (nsplit && !split[view][i])
+		continue;
+
+	    grid_add_job(q, view, -1, lf->x + half, lf->y + half, lf->size, -area);
+
+	    child = grid_add_cells(gv, 4);
+	    gv->cells[lf->cell].child = child;
+	    for (quad = 0; quad < 4; quad++)
+		grid_add_job(q, view, child + quad,
+			     lf->x + ((quad & 1) ? 0.75 : 0.25) * lf->size,
+			     lf->y + ((quad & 2) ? 0.75 : 0.25) * lf->size,
+			     half, area * 0.25);
+	}
+
+	bu_free(split[view], "split");
+	if (leaves[view])
+	    bu_free(leaves[view], "grid leaves");
+    }
+
+    bu_free(split, "split");
+    bu_free(nleaves, "nleaves");
+    bu_free(leaves, "leaves");
+}
+
+
+/**
+ * This routine must be prepared to run in parallel
+ */
+static void
+grid_worker(int cpu, void *ptr)
+{
+    struct application ap;
+    struct grid_queue *q = (struct grid_queue *)ptr;
+    struct current_state *state = q->state;
+    double lenden[3] = {0.0, 0.0, 0.0};
+    double len[3] = {0.0, 0.0, 0.0};
+    double shots[3] = {0.0, 0.0, 0.0};
+    size_t i, first, last;
+    int view;
+
+    if (state->aborted)
+	return;
+
+    analyze_worker_init(&ap, cpu, state);
+
+    while (1) {
+	bu_semaphore_acquire(state->sem_worker);
+	first = q->next;
+	last = first + GRID_JOB_CHUNK;
+	if (last > q->njobs)
+	    last = q->njobs;
+	q->next = last;
+	bu_semaphore_release(state->sem_worker);
+	if (first >= last)
+	    break;
+
+	for (i = first; i < last; i++) {
+	    const struct grid_job *job = &q->jobs[i];
+	    struct grid_view *gv = &state->gviews[job->view];
+	    int u_axis = (job->view+1) % 3;
+	    int v_axis = (job->view+2) % 3;
+
+	    VMOVE(ap.a_ray.r_pt, state->rtip->mdl_min);
+	    ap.a_ray.r_pt[u_axis] += job->u * gv->cell[u_axis];
+	    ap.a_ray.r_pt[v_axis] += job->v * gv->cell[v_axis];
+	    VSETALL(ap.a_ray.r_dir, 0.0);
+	    ap.a_ray.r_dir[job->view] = 1.0;
+	    VSCALE(ap.A_CELL, gv->cell, job->size);
+	    ap.a_user = (int)(job->v / job->size);
+	    ap.A_VIEW = job->view;
+	    ap.A_WEIGHT = job->weight;
+	    ap.A_RAYSIG = 0.0;
+	    ap.A_RAYLEN = 0.0;
+	    ap.A_LENDEN = 0.0;
+	    ap.A_LEN = 0.0;
+	    (void)rt_shootray(&ap);
+	    if (state->aborted)
+		return;
+
+	    lenden[job->view] += ap.A_LENDEN;
+	    len[job->view] += ap.A_LEN;
+	    shots[job->view] += job->weight;
+
+	    /* each cell belongs to exactly one job */
+	    if (job->cell >= 0) {
+		gv->cells[job->cell].sig = (uint32_t)ap.A_RAYSIG;
+		gv->cells[job->cell].len = (float)ap.A_RAYLEN;
+	    }
+	}
+    }
+
+    bu_semaphore_acquire(state->sem_stats);
+    for (view = 0; view < 3; view++) {
+	state->shots[view] += shots[view];
+	state->m_lenDensity[view] += lenden[view];
+	state->m_len[view] += len[view];
+    }
+    bu_semaphore_release(state->sem_stats);
+}
+
+
+static void
+analyze_adaptive_pass(struct current_state *state)
+{
+    struct grid_queue q;
+
+    memset(&q, 0, sizeof(q));
+    q.state = state;
+
+    if (!state->gviews)
+	grid_init(state, &q);
+    else
+	grid_refine(state, &q);
+
+    bu_log("Adaptive grid pass: %zu rays (%g mm finest spacing)\n", q.njobs, state->gridSpacing);
+
+    bu_parallel(grid_worker, state->ncpu, (void *)&q);
+
+    if (q.jobs)
+	bu_free(q.jobs, "grid jobs");
+}
+
+
+static void
+analyze_free_grid_views(struct current_state *state)
+{
+    int view;
+
+    if (!state->gviews)
+	return;
+
+    for (view = 0; view < state->num_views; view++) {
+	if (state->gviews[view].cells)
+	    bu_free(state->gviews[view].cells, "grid cells");
+    }
+    bu_free(state->gviews, "grid views");
+    state->gviews = NULL;
+}
+
+
 /**
  * Do some computations prior to raytracing based upon options the
  * user has specified
@@ -924,6 +1413,11 @@ options_set(struct current_state *state)
 	}
     }
 
+    if (state->adaptive && (state->use_single_grid || (state->analysis_flags & ANALYSIS_SURF_AREA))) {
+	bu_log("Adaptive refinement needs the triple grid and no surface area, refining uniformly\n");
+	state->adaptive = 0;
+    }
+
     if ((state->analysis_flags & (ANALYSIS_ADJ_AIR|ANALYSIS_EXP_AIR|ANALYSIS_FIRST_AIR|ANALYSIS_LAST_AIR|ANALYSIS_UNCONF_AIR)) && ! state->use_air) {
 	bu_log("\nError:  Air regions discarded but air analysis requested!\nSet use_air non-zero or eliminate air analysis\n");
 	return ANALYZE_ERROR;
@@ -1029,7 +1523,7 @@ allocate_region_data(struct current_state *state, char *av[])
 
     state->m_lenDensity = (double *)bu_calloc(state->num_views, sizeof(double), "densityLen");
     state->m_len = (double *)bu_calloc(state->num_views, sizeof(double), "len");
-    state->shots = (unsigned long *)bu_calloc(state->num_views, sizeof(unsigned long), "shots");
+    state->shots = (double *)bu_calloc(state->num_views, sizeof(double), "shots");
     state->m_lenTorque = (fastf_t *)bu_calloc(state->num_views, sizeof(vect_t), "lenTorque");
     state->m_moi = (fastf_t *)bu_calloc(state->num_views, sizeof(vect_t), "moments of inertia");
     state->m_poi = (fastf_t *)bu_calloc(state->num_views, sizeof(vect_t), "products of inertia");
@@ -1140,37 +1634,21 @@ analyze_single_grid_setup(struct current_state *state)
 
 
 static void
-analyze_triple_grid_setup(int view, struct current_state *state)
+analyze_triple_grid_setup(struct current_state *state)
 {
     struct rectangular_grid *grid = (struct rectangular_grid *)state->grid;
+
+    /* rectangular_triple_grid_generator() starts the first view on
+     * its first call
+     */
+    grid->single_grid = 0;
+    grid->view = 0;
+    grid->max_views = state->num_views;
     grid->grid_spacing = state->gridSpacing;
+    VMOVE(grid->mdl_origin, state->rtip->mdl_min);
+    VMOVE(grid->steps, state->steps);
     grid->current_point = 0;
-    state->curr_view = view;
-    state->i_axis = state->curr_view;
-    state->u_axis = (state->curr_view+1) % 3;
-    state->v_axis = (state->curr_view+2) % 3;
-
-    state->u_dir[state->u_axis] = 1;
-    state->u_dir[state->v_axis] = 0;
-    state->u_dir[state->i_axis] = 0;
-
-    state->v_dir[state->u_axis] = 0;
-    state->v_dir[state->v_axis] = 1;
-    state->v_dir[state->i_axis] = 0;
-
-    grid->ray_direction[state->u_axis] = 0;
-    grid->ray_direction[state->v_axis] = 0;
-    grid->ray_direction[state->i_axis] = 1;
-
-    VMOVE(grid->start_coord, state->rtip->mdl_min);
-    grid->start_coord[state->u_axis] += grid->grid_spacing;
-    grid->start_coord[state->v_axis] += grid->grid_spacing;
-
-    VSCALE(grid->dx_grid, state->u_dir, grid->grid_spacing);
-    VSCALE(grid->dy_grid, state->v_dir, grid->grid_spacing);
-
-    grid->x_points = state->steps[state->u_axis] - 1;
-    grid->total_points = grid->x_points * (state->steps[state->v_axis] - 1);
+    grid->total_points = 0;
 }
 
 
@@ -1247,8 +1725,11 @@ shoot_rays(struct current_state *state)
     /* compute */
     double inv_spacing;
     do {
-	inv_spacing = 1.0/state->gridSpacing;
-	VSCALE(state->steps, state->span, inv_spacing);
+	/* adaptive passes keep the base grid of the first pass */
+	if (!state->gviews) {
+	    inv_spacing = 1.0/state->gridSpacing;
+	    VSCALE(state->steps, state->span, inv_spacing);
+	}
 	if (state->analysis_flags & ANALYSIS_SURF_AREA) {
 	    int view;
 	    for (view = 0; view < state->num_views; view++) {
@@ -1266,21 +1747,16 @@ shoot_rays(struct current_state *state)
 	    state->num_views = 1;
 	    analyze_single_grid_setup(state);
 	    bu_parallel(analyze_worker, state->ncpu, (void *)state);
+	} else if (state->adaptive) {
+	    analyze_adaptive_pass(state);
 	} else {
-	    int view;
 	    bu_log("Processing with grid spacing %g mm %ld x %ld x %ld\n",
 		    state->gridSpacing,
 		    state->steps[0]-1,
 		    state->steps[1]-1,
 		    state->steps[2]-1);
-	    for (view = 0; view < state->num_views; view++) {
-		if (state->verbose)
-		    bu_vls_printf(state->verbose_str, "  view %d\n", view);
-		analyze_triple_grid_setup(view, state);
-		bu_parallel(analyze_worker, state->ncpu, (void *)state);
-		if (state->aborted)
-		    break;
-	    }
+	    analyze_triple_grid_setup(state);
+	    bu_parallel(analyze_worker, state->ncpu, (void *)state);
 	}
 	state->grid->refine_flag = 1;
 	state->gridSpacing *= 0.5;
@@ -1459,6 +1935,8 @@ perform_raytracing(struct current_state *state, struct db_i *dbip, char *names[]
 	state->densities = NULL;
     }
 
+    analyze_free_grid_views(state);
+
     rt_free_rti(rtip);
     return ANALYZE_OK;
 }
@@ -50,6 +50,8 @@ analyze_current_state_init(void)
     state->required_number_hits = 1;
     state->ncpu = (int) bu_avail_cpus();
     state->use_single_grid = 0;
+    state->adaptive = 0;
+    state->gviews = NULL;
     state->use_view_information = 0;
     state->debug = 0;
     state->verbose = 0;
@@ -207,6 +209,16 @@ analyze_set_grid_ratio(struct current_state *state, fastf_t gridRatio)
     state->gridRatio = gridRatio;
 }
 
+/*
+ * enables adaptive refinement of the triple grid, where only the
+ * cells that have not converged are subdivided.
+ */
+void
+analyze_set_adaptive(struct current_state *state, int adaptive)
+{
+    state->adaptive = adaptive;
+}
+
 /*
  * sets the grid width and grid height values. A flag is set which
  * calculates the grid_spacing for the new grid size from the viewsize value.
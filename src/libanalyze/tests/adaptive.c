@@ -0,0 +1,136 @@
+/*                      A D A P T I V E . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file adaptive.c
+ *
+ * Measure the volume of a sphere with the triple grid, once refining
+ * uniformly and once adaptively from the same coarse grid, and check
+ * both against each other and against the analytic volume.
+ *
+ */
+
+#include "common.h"
+
+#include <math.h>
+
+#include "bu/app.h"
+#include "raytrace.h"
+#include "wdb.h"
+#include "analyze.h"
+
+/* same bit as in api.c */
+#define ANALYSIS_VOLUME 1
+
+#define RADIUS 100.0
+
+/* Fractions of the analytic volume.  The uniform grid spreads each
+ * view's whole area over its interior points only, which runs about a
+ * spacing per side high, so it gets more room than the adaptive grid,
+ * whose cells cover the view exactly.
+ */
+#define ADAPTIVE_TOL 0.005
+#define UNIFORM_TOL 0.02
+
+
+static int
+sphere_volume(struct db_i *dbip, int adaptive, double *volume)
+{
+    struct current_state *state;
+    char *names[2] = {"sph.r", "anchor.r"};
+    double sph_vol = 4.0 / 3.0 * M_PI * RADIUS * RADIUS * RADIUS;
+
+    state = analyze_current_state_init();
+    analyze_set_grid_spacing(state, 50.0, 0.5);
+    analyze_set_volume_tolerance(state, sph_vol * 0.001);
+    analyze_set_quiet_missed_report(state);
+    analyze_set_adaptive(state, adaptive);
+
+    if (perform_raytracing(state, dbip, names, 2, ANALYSIS_VOLUME)) {
+	bu_log("%s: perform_raytracing failed\n", adaptive ? "adaptive" : "uniform");
+	analyze_free_current_state(state);
+	return 1;
+    }
+
+    *volume = analyze_volume(state, names[0]);
+    bu_log("%s volume %g, grid spacing %g\n", adaptive ? "adaptive" : "uniform",
+	   *volume, analyze_get_grid_spacing(state));
+    analyze_free_current_state(state);
+    return 0;
+}
+
+
+int
+main(int UNUSED(argc), char *argv[])
+{
+    struct db_i *dbip;
+    struct rt_wdb *wdbp;
+    point_t center = VINIT_ZERO;
+    point_t anchor = {-130.0, -113.0, 90.0};
+    double sph_vol = 4.0 / 3.0 * M_PI * RADIUS * RADIUS * RADIUS;
+    double uniform = 0.0, adaptive = 0.0;
+    int ret = 0;
+
+    bu_setprogname(argv[0]);
+
+    dbip = db_open_inmem();
+    if (dbip == DBI_NULL)
+	bu_exit(1, "ERROR: unable to create an in-memory database\n");
+    wdbp = wdb_dbopen(dbip, RT_WDB_TYPE_DB_INMEM);
+    if (mk_sph(wdbp, "sph.s", center, RADIUS) < 0 || mk_comb1(wdbp, "sph.r", "sph.s", 1) < 0)
+	bu_exit(1, "ERROR: unable to write the sphere\n");
+
+    /* Alone, the sphere sits the same way in all three views, which
+     * then agree at any spacing and stop the refinement at once.  A
+     * speck off one corner shifts each view's grid differently.
+     */
+    if (mk_sph(wdbp, "anchor.s", anchor, 1.0) < 0 || mk_comb1(wdbp, "anchor.r", "anchor.s", 1) < 0)
+	bu_exit(1, "ERROR: unable to write the anchor\n");
+
+    if (sphere_volume(dbip, 0, &uniform) || sphere_volume(dbip, 1, &adaptive))
+	ret = 1;
+
+    if (!ret) {
+	if (fabs(uniform - sph_vol) > UNIFORM_TOL * sph_vol) {
+	    bu_log("uniform volume %g, expected %g\n", uniform, sph_vol);
+	    ret = 1;
+	}
+	if (fabs(adaptive - sph_vol) > ADAPTIVE_TOL * sph_vol) {
+	    bu_log("adaptive volume %g, expected %g\n", adaptive, sph_vol);
+	    ret = 1;
+	}
+	if (fabs(adaptive - uniform) > UNIFORM_TOL * sph_vol) {
+	    bu_log("adaptive volume %g and uniform volume %g disagree\n", adaptive, uniform);
+	    ret = 1;
+	}
+    }
+
+    wdb_close(wdbp);
+
+    return ret;
+}
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
@@ -141,6 +141,33 @@ bu_gettime(void)
 }
 
 
+int64_t
+bu_gettime_ns(void)
+{
+#if defined(HAVE_WINDOWS_H)
+
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER now;
+    if (!freq.QuadPart)
+	QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (int64_t)((double)now.QuadPart * (1.0e9 / (double)freq.QuadPart));
+
+#elif defined(CLOCK_MONOTONIC)
+
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+	return (int64_t)ts.tv_sec * (int64_t)1000000000 + (int64_t)ts.tv_nsec;
+    return bu_gettime() * (int64_t)1000;
+
+#else
+
+    return bu_gettime() * (int64_t)1000;
+
+#endif
+}
+
+
 /*
  * Local Variables:
  * mode: C
@@ -433,13 +433,9 @@ bu_data_hash(const void *data, size_t len)
     if (!data || !len)
 	return 0;
 
-    XXH64_state_t h_state;
-    XXH64_reset(&h_state, 0);
-    XXH64_update(&h_state, (const char *)data, len);
-    XXH64_hash_t hash_val;
-    hash_val = XXH64_digest(&h_state);
-    unsigned long long hash = (unsigned long long)hash_val;
-    return hash;
+    /* one-shot hashing skips the streaming state setup, which
+     * dominates for short keys such as object names */
+    return (unsigned long long)XXH64(data, len, 0);
 }
 
 struct bu_data_hash_impl {
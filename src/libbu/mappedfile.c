@@ -488,71 +488,109 @@ bu_pr_mapped_file(const char *title, const struct bu_mapped_file *mp)
 }
 
 
-void
-bu_free_mapped_files(int verbose)
+/**
+ * Release the storage of the unused mapped file in slot i of
+ * all_mapped_files, and close up the gap it leaves.  Caller holds
+ * BU_SEM_MAPPEDFILE.
+ */
+static void
+mapped_file_release(size_t i, int verbose)
 {
-    struct bu_mapped_file *mp;
-    size_t i;
-
-    if (UNLIKELY(bu_debug&BU_DEBUG_MAPPED_FILE))
-	bu_log("bu_free_mapped_files(verbose=%d)\n", verbose);
-
-    bu_semaphore_acquire(BU_SEM_MAPPEDFILE);
-
-    for (i = 0; i < all_mapped_files.size; i++) {
-	mp = all_mapped_files.mapped_files[i];
-
-	if (mp->uses > 0)
-	    continue;
+    struct bu_mapped_file *mp = all_mapped_files.mapped_files[i];
 
-	/* Found one that needs to have storage released */
-	if (UNLIKELY(verbose || (bu_debug&BU_DEBUG_MAPPED_FILE)))
-	    bu_pr_mapped_file("freeing", mp);
+    if (UNLIKELY(verbose || (bu_debug&BU_DEBUG_MAPPED_FILE)))
+	bu_pr_mapped_file("freeing", mp);
 
-	mp->apbuf = (void *)NULL;
+    mp->apbuf = (void *)NULL;
 
-	if (mp->is_mapped) {
-	    int ret;
-	    bu_semaphore_acquire(BU_SEM_SYSCALL);
+    if (mp->is_mapped) {
+	int ret;
+	bu_semaphore_acquire(BU_SEM_SYSCALL);
 #ifdef HAVE_SYS_MMAN_H
-	    ret = munmap(mp->buf, (size_t)mp->buflen);
+	ret = munmap(mp->buf, (size_t)mp->buflen);
 #else
 #  ifdef HAVE_WINDOWS_H
-	    ret = win_munmap(mp->buf, (size_t)mp->buflen, mp->handle);
+	ret = win_munmap(mp->buf, (size_t)mp->buflen, mp->handle);
 #  endif
 #endif
-	    bu_semaphore_release(BU_SEM_SYSCALL);
+	bu_semaphore_release(BU_SEM_SYSCALL);
 
-	    if (UNLIKELY(ret < 0))
-		perror("munmap");
+	if (UNLIKELY(ret < 0))
+	    perror("munmap");
 
-	    /* XXX How to get this chunk of address space back to malloc()? */
-	} else {
-	    bu_free(mp->buf, "bu_mapped_file.buf[]");
-	}
-	mp->buf = (void *)NULL;		/* sanity */
-	bu_free((void *)mp->name, "bu_mapped_file.name");
+	/* XXX How to get this chunk of address space back to malloc()? */
+    } else {
+	bu_free(mp->buf, "bu_mapped_file.buf[]");
+    }
+    mp->buf = (void *)NULL;		/* sanity */
+    bu_free((void *)mp->name, "bu_mapped_file.name");
 
-	bu_free((void *)mp->appl, "bu_mapped_file.appl");
+    bu_free((void *)mp->appl, "bu_mapped_file.appl");
 
-	/* release this one */
-	memset(mp, 0, sizeof(struct bu_mapped_file)); /* sanity */
-	bu_free(mp, "free mapped file holder");
+    /* release this one */
+    memset(mp, 0, sizeof(struct bu_mapped_file)); /* sanity */
+    bu_free(mp, "free mapped file holder");
 
-	/* shift pointers - move everything down one index slot in the array */
-	for (size_t j = i; j < all_mapped_files.size - 1; j++) {
-	    all_mapped_files.mapped_files[j] = all_mapped_files.mapped_files[j+1];
-	}
-	all_mapped_files.mapped_files[all_mapped_files.size - 1] = NULL; /* zero out the last (now invalid) pointer */
-	all_mapped_files.size--;
-	/* Next item to inspect is now in the same index as the item we just removed */
-	i--;
+    /* shift pointers - move everything down one index slot in the array */
+    for (size_t j = i; j < all_mapped_files.size - 1; j++) {
+	all_mapped_files.mapped_files[j] = all_mapped_files.mapped_files[j+1];
     }
+    all_mapped_files.mapped_files[all_mapped_files.size - 1] = NULL; /* zero out the last (now invalid) pointer */
+    all_mapped_files.size--;
+
     /* release the array if we get back to empty */
     if (all_mapped_files.size == 0 && all_mapped_files.capacity > 0) {
 	bu_free(all_mapped_files.mapped_files, "free mapped file pointers");
 	all_mapped_files.capacity = 0;
     }
+}
+
+
+void
+bu_free_mapped_file(struct bu_mapped_file *mp)
+{
+    size_t i;
+
+    if (UNLIKELY(!mp)) {
+	return;
+    }
+
+    if (UNLIKELY(bu_debug&BU_DEBUG_MAPPED_FILE))
+	bu_pr_mapped_file("free:uses--", mp);
+
+    bu_semaphore_acquire(BU_SEM_MAPPEDFILE);
+    if (--mp->uses <= 0) {
+	for (i = 0; i < all_mapped_files.size; i++) {
+	    if (all_mapped_files.mapped_files[i] == mp) {
+		mapped_file_release(i, 0);
+		break;
+	    }
+	}
+    }
+    bu_semaphore_release(BU_SEM_MAPPEDFILE);
+}
+
+
+void
+bu_free_mapped_files(int verbose)
+{
+    size_t i;
+
+    if (UNLIKELY(bu_debug&BU_DEBUG_MAPPED_FILE))
+	bu_log("bu_free_mapped_files(verbose=%d)\n", verbose);
+
+    bu_semaphore_acquire(BU_SEM_MAPPEDFILE);
+
+    i = 0;
+    while (i < all_mapped_files.size) {
+	/* Found one that needs to have storage released?  The next
+	 * item to inspect then moves into the same index.
+	 */
+	if (all_mapped_files.mapped_files[i]->uses > 0)
+	    i++;
+	else
+	    mapped_file_release(i, verbose);
+    }
     bu_semaphore_release(BU_SEM_MAPPEDFILE);
 }
 
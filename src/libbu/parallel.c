@@ -83,51 +83,22 @@
 
 #include "bresource.h"
 
-/*
- * multithreading support for SunOS 5.X / Solaris 2.x
- */
-#if defined(SUNOS) && SUNOS >= 52
-#  include <sys/unistd.h>
-#  include <thread.h>
-#  include <synch.h>
-#  define rt_thread_t thread_t
-#endif /* SUNOS */
-
-/*
- * multithread support built on POSIX Threads (pthread) library.
- */
-#ifdef HAVE_PTHREAD_H
-#  include <pthread.h>
-#  define rt_thread_t pthread_t
-#endif
-
-#ifdef _WIN32
-#  define rt_thread_t HANDLE
-#endif
-
 #include "bio.h"
 
 #include "bu/debug.h"
 #include "bu/log.h"
 #include "bu/malloc.h"
 #include "bu/parallel.h"
-#include "bu/snooze.h"
 #include "bu/str.h"
 
 #include "./parallel.h"
 
-/* #define CPP11THREAD */
-
 
 #if defined(HAVE_SYSCALL) && !defined(HAVE_DECL_SYSCALL) && !defined(syscall)
 long syscall(long number, ...);
 #endif
 
 
-#if defined(CPP11THREAD)
-void parallel_cpp11thread(void (*func)(int, void *), size_t ncpu, void *arg);
-#endif /* CPP11THREAD */
-
 int BU_SEM_THREAD;
 
 
@@ -363,7 +334,6 @@ bu_avail_cpus(void)
 
 #ifdef PARALLEL
 
-#if !defined(HAVE_THREAD_LOCAL)  || !defined(CPP11THREAD)
 /* this function provides book-keeping so that we give out unique
  * thread identifiers and for tracking a thread's parent context.
  *
@@ -420,34 +390,58 @@ parallel_mapping(parallel_action_t action, int id, size_t max)
 }
 
 
+struct parallel_slot {
+    struct parallel_info *parent;
+    size_t max_threads;
+};
+
+
+static int
+parallel_slot_free(void *data)
+{
+    struct parallel_slot *slot = (struct parallel_slot *)data;
+    struct parallel_info *parent = slot->parent;
+    int avail;
+
+    bu_semaphore_acquire(BU_SEM_THREAD);
+    if (parent->started < parent->finished) {
+	/*bu_log("Warning - parent->started (%d) is less than parent->finished (%d)\n", parent->started, parent->finished);*/
+	avail = 1;
+    } else {
+	avail = (parent->started - parent->finished < slot->max_threads);
+    }
+    bu_semaphore_release(BU_SEM_THREAD);
+
+    return avail;
+}
+
+
+/* block (without polling) until the parent context has fewer than
+ * max_threads workers running.  finishing workers wake us through
+ * parallel_slot_signal().
+ */
 static void
 parallel_wait_for_slot(int throttle, struct parallel_info *parent, size_t max_threads)
 {
-    size_t threads = max_threads;
-
-    while (1) {
-	if (parent->started < parent->finished) {
-	    /*bu_log("Warning - parent->started (%d) is less than parent->finished (%d)\n", parent->started, parent->finished);*/
-	    return;
-	}
-	threads = parent->started - parent->finished;
+    struct parallel_slot slot;
 
-	/*bu_log("threads=%d (start %d - done %d)\n", threads, parent->started, parent->finished);
-	  bu_log("max_threads=%d, throttle: %d\n", max_threads, throttle);*/
+    if (!throttle)
+	return;
 
-	if (threads < max_threads || !throttle) {
-	    return;
-	}
-	bu_snooze(BU_SEC2USEC(1));
-    }
+    slot.parent = parent;
+    slot.max_threads = max_threads;
+    parallel_slot_wait(parallel_slot_free, &slot);
 }
 
 
-static void *
+static void
 parallel_interface_arg(void *utd)
 {
     struct thread_data *user_thread_data = (struct thread_data *)utd;
 
+    /* pool threads are reused, so restore whatever ID they had */
+    int prev_cpu = thread_get_cpu();
+
     /* keep track of our parallel ID number */
     thread_set_cpu(user_thread_data->cpu_id);
 
@@ -471,28 +465,11 @@ parallel_interface_arg(void *utd)
     bu_semaphore_release(BU_SEM_THREAD);
 
     parallel_mapping(PARALLEL_PUT, user_thread_data->cpu_id, 0);
+    parallel_slot_signal();
 
-    return NULL;
-}
-
-
-#if defined(_WIN32)
-/**
- * A separate stub to call parallel_interface_arg that avoids a
- *  potential crash* on 64-bit windows and calls ExitThread to
- *  cleanly stop the thread.
- *  *See ThreadProc MSDN documentation.
- */
-static DWORD
-parallel_interface_arg_stub(struct thread_data *user_thread_data)
-{
-    parallel_interface_arg(user_thread_data);
-    ExitThread(0);
-    return 0; /* Extraneous */
+    thread_set_cpu(prev_cpu);
 }
-#endif
 
-#endif /* !HAVE_THREAD_LOCAL || !CPP11THREAD */
 #endif /* PARALLEL */
 
 
@@ -508,32 +485,11 @@ bu_parallel(void (*func)(int, void *), size_t ncpu, void *arg)
     /* do the work anyways */
     (*func)(0, arg);
 
-#elif defined(HAVE_THREAD_LOCAL) && defined(CPP11THREAD)
-
-
-    if (!func)
-	return; /* nothing to do */
-
-    if (ncpu == 1) {
-	func(ncpu, arg);
-	return;
-    } else if (ncpu > MAX_PSW) {
-	bu_log("WARNING: bu_parallel() ncpu(%zd) > MAX_PSW(%d), adjusting ncpu\n", ncpu, MAX_PSW);
-	ncpu = MAX_PSW;
-    }
-
-    parallel_cpp11thread(func, ncpu, arg);
-
 #else
 
     struct thread_data *thread_context;
-    rt_thread_t thread_tbl[MAX_PSW];
+    struct parallel_job *job;
     size_t x;
-    size_t i;
-
-    /* number of threads created/ended */
-    size_t nthreadc;
-    size_t nthreade;
 
     char *libbu_affinity = NULL;
 
@@ -545,8 +501,6 @@ bu_parallel(void (*func)(int, void *), size_t ncpu, void *arg)
 
     struct parallel_info *parent;
 
-    rt_thread_t thread;
-
     if (!func)
 	return; /* nothing to do */
 
@@ -616,204 +570,22 @@ bu_parallel(void (*func)(int, void *), size_t ncpu, void *arg)
 	thread_context[x].parent    = parent;
     }
 
-    /*
-     * multithreading support for SunOS 5.X / Solaris 2.x
+    /* Hand the work to the persistent thread pool.  Every task is
+     * guaranteed a thread of its own, so all ncpu copies run
+     * concurrently just as they did with per-call thread creation.
      */
-#  if defined(SUNOS) && SUNOS >= 52
-
-    nthreadc = 0;
-
-    /* Give the thread system a hint... */
-    {
-	static size_t concurrency = 0; /* Max concurrency we have set */
-	if (ncpu > concurrency) {
-	    if (thr_setconcurrency((int)ncpu)) {
-		bu_log("ERROR parallel.c/bu_parallel(): thr_setconcurrency(%zd) failed\n", ncpu);
-		/* Not much to do, lump it */
-	    } else {
-		concurrency = ncpu;
-	    }
-	}
-    }
-
-    /* Create the threads */
+    job = parallel_job_create();
     for (x = 0; x < ncpu; x++) {
 	parallel_wait_for_slot(throttle, parent, ncpu);
 
-	if (thr_create(0, 0, parallel_interface_arg, &thread_context[x], 0, &thread)) {
-	    bu_log("ERROR: bu_parallel: thr_create(0x0, 0x0, 0x%x, 0x0, 0, 0x%x) failed for processor thread # %d\n",
-		   parallel_interface_arg, &thread, x);
-	    /* Not much to do, lump it */
-	} else {
-	    if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-		bu_log("bu_parallel(): created thread: (thread: 0x%x) (loop:%d) (nthreadc:%zu)\n",
-		       thread, x, nthreadc);
-
-	    thread_tbl[nthreadc] = thread;
-	    nthreadc++;
-	}
-    }
-
-    if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	for (i = 0; i < nthreadc; i++)
-	    bu_log("bu_parallel(): thread_tbl[%d] = 0x%x\n", i, thread_tbl[i]);
-
-    /*
-     * Wait for completion of all threads.  We don't wait for threads
-     * in order.  We wait for any old thread but we keep track of how
-     * many have returned and whether it is one that we started
-     */
-    nthreade = 0;
-    for (x = 0; x < nthreadc; x++) {
-	if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	    bu_log("bu_parallel(): waiting for thread to complete:\t(loop:%d) (nthreadc:%zu) (nthreade:%zu)\n",
-		   x, nthreadc, nthreade);
-
-	if (thr_join((rt_thread_t)0, &thread, NULL)) {
-	    /* badness happened */
-	    perror("thr_join");
-	    bu_log("thr_join() failed");
-	}
-
-	/* Check to see if this is one the threads we created */
-	for (i = 0; i < nthreadc; i++) {
-	    if (thread_tbl[i] == thread) {
-		thread_tbl[i] = (rt_thread_t)-1;
-		nthreade++;
-		break;
-	    }
-	}
-
-	if ((thread_tbl[i] != (rt_thread_t)-1) && i < nthreadc) {
-	    bu_log("bu_parallel(): unknown thread %d completed.\n",
-		   thread);
-	}
-
 	if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	    bu_log("bu_parallel(): thread completed: (thread: %d)\t(loop:%d) (nthreadc:%zu) (nthreade:%zu)\n",
-		   thread, x, nthreadc, nthreade);
-    }
+	    bu_log("bu_parallel(): submitting task %zu (cpu %d)\n", x, thread_context[x].cpu_id);
 
-    if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	bu_log("bu_parallel(): %zu threads created.  %zud threads exited.\n", nthreadc, nthreade);
-#  endif	/* SUNOS */
-
-#  if defined(HAVE_PTHREAD_H)
-
-    /* Create the posix threads.
-     *
-     * Start at 1 so we can treat the parent as thread 0.
-     */
-    nthreadc = 0;
-    for (x = 0; x < ncpu; x++) {
-	pthread_attr_t attrs;
-	pthread_attr_init(&attrs);
-	pthread_attr_setstacksize(&attrs, 10*1024*1024);
-
-	parallel_wait_for_slot(throttle, parent, ncpu);
-
-	if (pthread_create(&thread, &attrs, parallel_interface_arg, &thread_context[x])) {
-	    bu_log("ERROR: bu_parallel: pthread_create(0x0, 0x0, 0x%lx, 0x0, 0, %p) failed for processor thread # %zu\n",
-		   (unsigned long int)parallel_interface_arg, (void *)&thread, x);
-
-	} else {
-	    if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL)) {
-		bu_log("bu_parallel(): created thread: (thread: %p) (loop: %zu) (nthreadc: %zu)\n",
-		       (void*)thread, x, nthreadc);
-	    }
-	    thread_tbl[nthreadc] = thread;
-	    nthreadc++;
-	}
-
-	/* done with the attributes after create */
-	pthread_attr_destroy(&attrs);
+	parallel_job_submit(job, parallel_interface_arg, &thread_context[x]);
     }
 
-    if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL)) {
-	for (i = 0; i < nthreadc; i++) {
-	    bu_log("bu_parallel(): thread_tbl[%zu] = %p\n", i, (void *)thread_tbl[i]);
-	}
-    }
-
-    /*
-     * Wait for completion of all threads.
-     * Wait for them in order.
-     */
-    nthreade = 0;
-    for (x = 0; x < nthreadc; x++) {
-	int ret;
-
-	if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	    bu_log("bu_parallel(): waiting for thread %p to complete:\t(loop:%zu) (nthreadc:%zu) (nthreade:%zu)\n",
-		   (void *)thread_tbl[x], x, nthreadc, nthreade);
-
-	if ((ret = pthread_join(thread_tbl[x], NULL)) != 0) {
-	    /* badness happened */
-	    bu_log("pthread_join(thread_tbl[%zu]=%p) ret=%d\n", x, (void *)thread_tbl[x], ret);
-	}
-
-	nthreade++;
-	thread = thread_tbl[x];
-	thread_tbl[x] = (rt_thread_t)-1;
-
-	if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	    bu_log("bu_parallel(): thread completed: (thread: %p)\t(loop:%zu) (nthreadc:%zu) (nthreade:%zu)\n",
-		   (void *)thread, x, nthreadc, nthreade);
-
-    }
-
-    if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
-	bu_log("bu_parallel(): %zu threads created.  %zu threads exited.\n", nthreadc, nthreade);
-
-#  endif /* end if posix threads */
-
-
-#  ifdef _WIN32
-    /* Create the Win32 threads */
-    nthreadc = 0;
-    for (i = 0; i < ncpu; i++) {
-	parallel_wait_for_slot(throttle, parent, ncpu);
-
-	thread = CreateThread(
-	    NULL,
-	    0,
-	    (LPTHREAD_START_ROUTINE)parallel_interface_arg_stub,
-	    &thread_context[i],
-	    0,
-	    NULL);
-
-	thread_tbl[i] = thread;
-	nthreadc++;
-
-	/* Ensure that all successfully created threads are in sequential order.*/
-	if (thread_tbl[i] == NULL) {
-	    bu_log("bu_parallel(): Error in CreateThread, Win32 error code %d.\n", GetLastError());
-	    --nthreadc;
-	}
-    }
-
-
-    {
-	/* Wait for other threads in the array */
-	DWORD returnCode;
-	returnCode = WaitForMultipleObjects((DWORD)nthreadc, thread_tbl, TRUE, INFINITE);
-	if (returnCode == WAIT_FAILED) {
-	    bu_log("bu_parallel(): Error in WaitForMultipleObjects, Win32 error code %d.\n", GetLastError());
-	}
-    }
-
-    nthreade = 0;
-    for (x = 0; x < nthreadc; x++) {
-	int ret;
-	if ((ret = CloseHandle(thread_tbl[x]) == 0)) {
-	    /* Thread didn't close properly if return value is zero; don't retry and potentially loop forever.  */
-	    bu_log("bu_parallel(): Error closing thread %zu of %zu, Win32 error code %d.\n", x, nthreadc, GetLastError());
-	}
-
-	nthreade++;
-	thread_tbl[x] = (rt_thread_t)-1;
-    }
-#  endif /* end if Win32 threads */
+    /* wait for completion of all tasks */
+    parallel_job_wait(job);
 
     if (UNLIKELY(bu_debug & BU_DEBUG_PARALLEL))
 	bu_log("bu_parallel(%zd) complete\n", ncpu);
@@ -36,6 +36,22 @@ extern int parallel_set_affinity(int cpu);
 extern void thread_set_cpu(int cpu);
 extern int thread_get_cpu(void);
 
+/* parallel_cpp11thread.cpp - persistent worker pool behind bu_parallel() */
+struct parallel_job;
+
+/* a job is a barrier over the tasks submitted to it */
+extern struct parallel_job *parallel_job_create(void);
+extern void parallel_job_submit(struct parallel_job *job, void (*func)(void *), void *arg);
+
+/* block until every task submitted to job has returned, then release it */
+extern void parallel_job_wait(struct parallel_job *job);
+
+/* block until available(data) is non-zero, re-testing whenever
+ * parallel_slot_signal() is called.
+ */
+extern void parallel_slot_wait(int (*available)(void *), void *data);
+extern void parallel_slot_signal(void);
+
 #endif /* LIBBU_PARALLEL_H */
 
 /*
@@ -17,39 +17,226 @@
  * License along with this file; see the file named COPYING for more
  * information.
  */
+/** @file parallel_cpp11thread.cpp
+ *
+ * Persistent pool of worker threads behind bu_parallel().
+ *
+ * Threads are created the first time they are needed and then sleep
+ * on a condition variable between jobs, so repeated bu_parallel()
+ * calls do not pay thread start-up costs.  The pool grows whenever a
+ * submission finds fewer idle threads than queued tasks, so every
+ * task of a job gets a thread of its own right away.  That keeps the
+ * old "ncpu copies running at once" behavior, including for nested
+ * bu_parallel() calls made from inside a task.
+ */
 
 #include "common.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
-#include <vector>
 #include <stddef.h>
 
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
+#include "bu/log.h"
+
+
+/* matches the stack size bu_parallel() threads have always had */
+#define PARALLEL_STACKSIZE (10*1024*1024)
+
+
+struct parallel_job {
+    std::mutex mtx;
+    std::condition_variable done;
+    size_t pending = 0;
+};
+
+
+namespace {
+
+struct pool_task {
+    void (*func)(void *);
+    void *arg;
+    struct parallel_job *job;
+};
+
+
+class parallel_pool {
+public:
+    void submit(const pool_task &task);
+
+private:
+    std::mutex mtx;
+    std::condition_variable work;
+    std::deque<pool_task> queue;
+    size_t idle = 0;	/* threads not currently running a task */
+
+    void spawn();
+    void loop();
+#ifdef HAVE_PTHREAD_H
+    static void *start(void *pool);
+#endif
+};
+
+
+/* The pool is never destroyed: its threads are still parked on the
+ * condition variable when the process exits.
+ */
+parallel_pool &
+pool_instance()
+{
+    static parallel_pool *pool = new parallel_pool;
+    return *pool;
+}
+
+
+std::mutex &
+slot_mutex()
+{
+    static std::mutex *m = new std::mutex;
+    return *m;
+}
+
+
+std::condition_variable &
+slot_cond()
+{
+    static std::condition_variable *cv = new std::condition_variable;
+    return *cv;
+}
+
+
+void
+parallel_pool::loop()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+	work.wait(lock, [this] { return !queue.empty(); });
+
+	pool_task task = queue.front();
+	queue.pop_front();
+	idle--;
+	lock.unlock();
+
+	task.func(task.arg);
 
-extern "C" void
-parallel_cpp11thread(void (*func)(int, void *), size_t ncpu, void *arg)
+	{
+	    std::lock_guard<std::mutex> job_lock(task.job->mtx);
+	    if (--task.job->pending == 0)
+		task.job->done.notify_all();
+	}
+
+	lock.lock();
+	idle++;
+    }
+}
+
+
+#ifdef HAVE_PTHREAD_H
+void *
+parallel_pool::start(void *pool)
 {
-    std::vector<std::thread> threads;
+    static_cast<parallel_pool *>(pool)->loop();
+    return NULL;
+}
+#endif
+
 
-    if (!ncpu) {
-	ncpu = std::thread::hardware_concurrency();
+/* called with mtx held */
+void
+parallel_pool::spawn()
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_t thread;
+    pthread_attr_t attrs;
 
-	/* If ncpu is 0 now, then the hardware either doesn't support
-	 * threads, or they aren't known to the implementation.
-	 * Revert to single threading.
-	 */
-	if (!ncpu)
-	    return func((int)ncpu, arg);
+    pthread_attr_init(&attrs);
+    pthread_attr_setstacksize(&attrs, PARALLEL_STACKSIZE);
+    pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attrs, start, this)) {
+	pthread_attr_destroy(&attrs);
+	bu_bomb("bu_parallel(): unable to create pool thread\n");
     }
+    pthread_attr_destroy(&attrs);
+#else
+    std::thread(&parallel_pool::loop, this).detach();
+#endif
+    idle++;
+}
 
-    /* Create and run threads. */
-    for (size_t i = 0; i < ncpu; ++i)
-	threads.emplace_back(func, i, arg);
 
-    /* Wait for the parallel task to complete. */
-    for (size_t i = 0; i < threads.size(); ++i)
-	threads[i].join();
+void
+parallel_pool::submit(const pool_task &task)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+
+    queue.push_back(task);
+    if (idle < queue.size())
+	spawn();
+    else
+	work.notify_one();
 }
 
+} /* namespace */
+
+
+extern "C" {
+
+
+    struct parallel_job *
+    parallel_job_create(void)
+    {
+	return new parallel_job;
+    }
+
+
+    void
+    parallel_job_submit(struct parallel_job *job, void (*func)(void *), void *arg)
+    {
+	pool_task task = {func, arg, job};
+
+	{
+	    std::lock_guard<std::mutex> lock(job->mtx);
+	    job->pending++;
+	}
+	pool_instance().submit(task);
+    }
+
+
+    void
+    parallel_job_wait(struct parallel_job *job)
+    {
+	{
+	    std::unique_lock<std::mutex> lock(job->mtx);
+	    job->done.wait(lock, [job] { return job->pending == 0; });
+	}
+	delete job;
+    }
+
+
+    void
+    parallel_slot_wait(int (*available)(void *), void *data)
+    {
+	std::unique_lock<std::mutex> lock(slot_mutex());
+	slot_cond().wait(lock, [available, data] { return available(data) != 0; });
+    }
+
+
+    void
+    parallel_slot_signal(void)
+    {
+	std::lock_guard<std::mutex> lock(slot_mutex());
+	slot_cond().notify_all();
+    }
+
+
+} /* extern "C" */
+
 
 // Local Variables:
 // tab-width: 8
@@ -59,5 +246,3 @@ parallel_cpp11thread(void (*func)(int, void *), size_t ncpu, void *arg)
 // c-file-style: "stroustrup"
 // End:
 // ex: shiftwidth=4 tabstop=8
-
-
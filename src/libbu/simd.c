@@ -36,6 +36,21 @@ bu_simd_level(void)
 # else
     int b=0;
     __asm__ volatile("cpuid":"=b"(b),"=c"(c),"=d"(d):"a"(0x1));
+
+    /* AVX needs both the CPU bit and the OS saving the YMM state */
+    if ((c & 0x18000000) == 0x18000000) {
+	int a=0, xcr0=0, xcr0_hi=0;
+	__asm__ volatile("xgetbv":"=a"(xcr0),"=d"(xcr0_hi):"c"(0));
+	if ((xcr0 & 0x6) == 0x6) {
+	    __asm__ volatile("cpuid":"=a"(a),"=b"(b),"=c"(c),"=d"(d):"a"(0x0));
+	    if (a >= 7) {
+		__asm__ volatile("cpuid":"=a"(a),"=b"(b),"=c"(c),"=d"(d):"a"(0x7),"c"(0x0));
+		if (b & 0x20)
+		    return BU_SIMD_AVX2;
+	    }
+	    return BU_SIMD_AVX;
+	}
+    }
 # endif
     if (c & 0x100000)
 	return BU_SIMD_SSE4_2;
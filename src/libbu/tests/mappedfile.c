@@ -251,6 +251,52 @@ test_mapped_file_parallel_with_free(size_t file_cnt, long int test_num)
     return ret;
 }
 
+/* bu_free_mapped_file() must release only its own mapping, leaving the
+ * other closed but cached files in place for the next open. */
+static int
+test_mapped_file_free_one(long int file_cnt, long int test_num)
+{
+    char filename[MAXPATHLEN] = {0};
+    struct bu_mapped_file **mfps;
+    struct bu_mapped_file *mfp;
+    long int i;
+    int ret = 0;
+
+    mfps = (struct bu_mapped_file **)bu_calloc(file_cnt, sizeof(struct bu_mapped_file *), "mapped files");
+    for (i = 0; i < file_cnt; i++) {
+	snprintf(filename, MAXPATHLEN, "%s-%ld-%ld-%ld", FILE_PREFIX, test_num, file_cnt, i);
+	mfps[i] = bu_open_mapped_file(filename, NULL);
+	if (!mfps[i]) {
+	    bu_log("%s -> [FAIL]  (unable to open mapped file)\n", filename);
+	    ret = 1;
+	    goto done;
+	}
+    }
+    for (i = 1; i < file_cnt; i++)
+	bu_close_mapped_file(mfps[i]);
+    bu_free_mapped_file(mfps[0]);
+
+    for (i = 1; i < file_cnt; i++) {
+	snprintf(filename, MAXPATHLEN, "%s-%ld-%ld-%ld", FILE_PREFIX, test_num, file_cnt, i);
+	mfp = bu_open_mapped_file(filename, NULL);
+	if (mfp != mfps[i]) {
+	    bu_log("%s -> [FAIL]  (released along with another file)\n", filename);
+	    ret = 1;
+	}
+	bu_close_mapped_file(mfp);
+    }
+
+    if (mapped_file_read_number(0, test_num, file_cnt) != 0)
+	ret = 1;
+
+    if (ret == 0)
+	bu_log("Test %ld: mapped file single free test: [PASS]\n", test_num);
+
+done:
+    bu_free(mfps, "mapped files");
+    return ret;
+}
+
 int
 main(int ac, char *av[])
 {
@@ -307,6 +353,9 @@ main(int ac, char *av[])
 	case 5:
 	    ret = test_mapped_file_parallel_with_free(file_cnt, test_num);
 	    break;
+	case 6:
+	    ret = test_mapped_file_free_one(file_cnt, test_num);
+	    break;
     }
 
     /* Unmap everything so we can delete files */
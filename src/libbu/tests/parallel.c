@@ -62,6 +62,21 @@ callback(int cpu, void *d)
 }
 
 
+/* pool threads are reused across calls, make sure each one reports
+ * the ID it was handed for this call.
+ */
+static void
+id_callback(int cpu, void *d)
+{
+    int *mismatch = (int *)d;
+
+    if (bu_parallel_id() != cpu)
+	*mismatch = 1;
+
+    counter[cpu] += 1;
+}
+
+
 static void
 recursive_callback(int UNUSED(cpu), void *d)
 {
@@ -199,6 +214,21 @@ main(int argc, char *argv[])
     }
     bu_log("bu_parallel recursive callback, many iterations [PASS]\n");
 
+    /* test many back-to-back calls, reusing the same worker threads */
+    {
+	size_t i;
+	int mismatch = 0;
+
+	memset(counter, 0, sizeof(counter));
+	for (i = 0; i < 1000; i++)
+	    bu_parallel(id_callback, ncpu, &mismatch);
+	if (mismatch || bu_parallel_id() != 0 || tally(MAX_PSW) != ncpu*1000) {
+	    bu_log("bu_parallel repeated calls [FAIL] (got %zd, expected %zd, id mismatch %d)\n", tally(MAX_PSW), ncpu*1000, mismatch);
+	    return 1;
+	}
+	bu_log("bu_parallel repeated calls [PASS]\n");
+    }
+
     return 0;
 }
 
@@ -52,6 +52,10 @@ struct conversion_state
 
     struct rt_bot_internal* bot;        /* converted bot */    
     struct wmember wm;                  /* handle for in-memory combinations */
+
+    long cur_vertex;                    /* last vertex read */
+    long cur_face;                      /* last face written to bot->faces */
+    size_t face_capacity;               /* faces allocated in bot->faces, grown as quads are split */
 };
 
 /* log_elements
@@ -91,21 +95,21 @@ log_elements(p_ply ply_fp)
 static int
 vertex_cb(p_ply_argument argument)
 {
-    static int cur_vertex = -1;
     long vert_index;
-    struct rt_bot_internal bot;
-    struct rt_bot_internal *pbot = &bot;
+    struct conversion_state *pstate = NULL;
+    struct rt_bot_internal *pbot;
     double botval = ply_get_argument_value(argument);
-    if (!ply_get_argument_user_data(argument, (void **)&pbot, &vert_index)) {
+    if (!ply_get_argument_user_data(argument, (void **)&pstate, &vert_index)) {
 	bu_bomb("Unable to import BOT");
     }
+    pbot = pstate->bot;
     if (vert_index == 0) {
-	cur_vertex++;
-	pbot->vertices[cur_vertex*3] = botval * scale_factor;
+	pstate->cur_vertex++;
+	pbot->vertices[pstate->cur_vertex*3] = botval * scale_factor;
     } else if (vert_index == 1) {
-	pbot->vertices[cur_vertex*3+1] = botval * scale_factor;
+	pbot->vertices[pstate->cur_vertex*3+1] = botval * scale_factor;
     } else if (vert_index == 2) {
-	pbot->vertices[cur_vertex*3+2] = botval * scale_factor;
+	pbot->vertices[pstate->cur_vertex*3+2] = botval * scale_factor;
     }
     return 1;
 }
@@ -137,11 +141,10 @@ color_cb(p_ply_argument argument)
 static int
 face_cb(p_ply_argument argument)
 {
-    static int cur_face = -1;
-    
     long list_len, vert_index;
-    struct rt_bot_internal bot;
-    struct rt_bot_internal *pbot = &bot;
+    struct conversion_state *pstate = NULL;
+    struct rt_bot_internal *pbot;
+    long cur_face;
     int botval;
     if (!ply_get_argument_property(argument, NULL, &list_len, &vert_index)) {
 	bu_bomb("Unable to import face lists");
@@ -150,7 +153,9 @@ face_cb(p_ply_argument argument)
 	bu_log("ignoring face with %ld vertices\n", list_len);
 	return 1;
     }
-    ply_get_argument_user_data(argument, (void **)&pbot, NULL);
+    ply_get_argument_user_data(argument, (void **)&pstate, NULL);
+    pbot = pstate->bot;
+    cur_face = pstate->cur_face;
     botval = ply_get_argument_value(argument);
 
     switch (vert_index) {
@@ -167,7 +172,10 @@ face_cb(p_ply_argument argument)
 	case 3:
 	    /* need to break this into two BOT faces */
 	    pbot->num_faces++;
-	    pbot->faces = (int *)bu_realloc(pbot->faces, pbot->num_faces * 3 * sizeof(int), "bot_faces");
+	    if (pbot->num_faces > pstate->face_capacity) {
+		pstate->face_capacity *= 2;
+		pbot->faces = (int *)bu_realloc(pbot->faces, pstate->face_capacity * 3 * sizeof(int), "bot_faces");
+	    }
 	    pbot->faces[cur_face*3+3] = botval;
 	    pbot->faces[cur_face*3+4] = pbot->faces[cur_face*3];
 	    pbot->faces[cur_face*3+5] = pbot->faces[cur_face*3+2];
@@ -177,6 +185,7 @@ face_cb(p_ply_argument argument)
 	    /* will never execute because lists of length > 4 are not allowed */
 	    break;
     }
+    pstate->cur_face = cur_face;
     return 1;
 }
 
@@ -212,19 +221,22 @@ convert_input(struct conversion_state* pstate)
     }
 
     // actual conversion starts here
-    pstate->bot->num_vertices = ply_set_read_cb(ply_fp, "vertex", "x", vertex_cb, pstate->bot, 0);
-    ply_set_read_cb(ply_fp, "vertex", "y", vertex_cb, pstate->bot, 1);
-    ply_set_read_cb(ply_fp, "vertex", "z", vertex_cb, pstate->bot, 2);
+    pstate->bot->num_vertices = ply_set_read_cb(ply_fp, "vertex", "x", vertex_cb, pstate, 0);
+    ply_set_read_cb(ply_fp, "vertex", "y", vertex_cb, pstate, 1);
+    ply_set_read_cb(ply_fp, "vertex", "z", vertex_cb, pstate, 2);
 
     ply_set_read_cb(ply_fp, "face", "red", color_cb, &irgb, 0);
     ply_set_read_cb(ply_fp, "face", "green", color_cb, &irgb, 1);
     ply_set_read_cb(ply_fp, "face", "blue", color_cb, &irgb, 2);
-    pstate->bot->num_faces = ply_set_read_cb(ply_fp, "face", "vertex_indices", face_cb, pstate->bot, 0);
+    pstate->bot->num_faces = ply_set_read_cb(ply_fp, "face", "vertex_indices", face_cb, pstate, 0);
 
     if (pstate->bot->num_faces < 1 || pstate->bot->num_vertices < 1) {
 	bu_log("This PLY file appears to contain no geometry!\n");
 	goto free_bot;
     }
+    pstate->cur_vertex = -1;
+    pstate->cur_face = -1;
+    pstate->face_capacity = pstate->bot->num_faces;
     pstate->bot->faces = (int *)bu_calloc(pstate->bot->num_faces * 3, sizeof(int), "bot faces");
     pstate->bot->vertices = (fastf_t *)bu_calloc(pstate->bot->num_vertices * 3, sizeof(fastf_t), "bot vertices");
 
@@ -247,10 +259,18 @@ convert_input(struct conversion_state* pstate)
     bu_vls_printf(&bot_name, ".bot");
     bu_vls_sprintf(&region_name, "%s.r", bu_vls_addr(&bot_name));
 
-    if (mk_bot(pstate->fd_out, bu_vls_addr(&bot_name), RT_BOT_SOLID, RT_BOT_UNORIENTED, 0, pstate->bot->num_vertices, pstate->bot->num_faces, pstate->bot->vertices, pstate->bot->faces, NULL, NULL)) {
+    /* hand the arrays read above to the database write as they are,
+     * rather than have mk_bot() copy them (it frees the BoT either way)
+     */
+    pstate->bot->mode = RT_BOT_SOLID;
+    if (pstate->face_capacity > pstate->bot->num_faces)
+	pstate->bot->faces = (int *)bu_realloc(pstate->bot->faces, pstate->bot->num_faces * 3 * sizeof(int), "bot_faces");
+    if (wdb_export(pstate->fd_out, bu_vls_addr(&bot_name), (void *)pstate->bot, ID_BOT, mk_conv2mm)) {
+	pstate->bot = NULL;
 	bu_log("ERROR: Failed to write BOT(%s) to database\n", bu_vls_addr(&bot_name));
 	goto free_bot;
     }
+    pstate->bot = NULL;
 
     if (pstate->ply_read_options->verbose || pstate->gcv_options->verbosity_level) {
 	bu_log("Wrote BOT %s\n", bu_vls_addr(&bot_name));
@@ -290,9 +310,9 @@ convert_input(struct conversion_state* pstate)
     }
 
 free_bot:
-    if(pstate->bot->faces)
+    if(pstate->bot && pstate->bot->faces)
 	bu_free(pstate->bot->faces, "pstate->bot->faces");
-    if(pstate->bot->vertices)
+    if(pstate->bot && pstate->bot->vertices)
 	bu_free(pstate->bot->vertices, "pstate->bot->vertices");
 free_mem:
     if(pstate->bot)
@@ -28,6 +28,7 @@
 #include "common.h"
 
 #include <stdlib.h>
+#include <limits.h>
 #include <math.h>
 #include <string.h>
 #include <ctype.h>
@@ -40,6 +41,9 @@
 
 #include "bu/cv.h"
 #include "bu/getopt.h"
+#include "bu/hash.h"
+#include "bu/mapped_file.h"
+#include "bu/parallel.h"
 #include "bu/units.h"
 #include "gcv/api.h"
 #include "vmath.h"
@@ -64,7 +68,8 @@ struct conversion_state
     const struct stl_read_options *stl_read_options;
 
     const char *input_file;	/* name of the input file */
-    FILE *fd_in;		/* input file */
+    FILE *fd_in;		/* input file (ASCII) */
+    struct bu_mapped_file *mf_in;	/* input file (binary) */
     struct rt_wdb *fd_out;	/* Resulting BRL-CAD file */
 
     struct wmember all_head;
@@ -77,11 +82,23 @@ struct conversion_state
 };
 
 
-/* Size of blocks of faces to malloc */
+/* Initial number of faces to malloc, doubled as needed */
 #define BOT_FBLOCK 128
 
 #define MAX_LINE_SIZE 512
 
+/* Binary STL: an 80 byte header and a facet count, then one 50 byte
+ * record per facet (normal, three vertices, attribute byte count).
+ */
+#define STL_BIN_HEADER_SIZE 84
+#define STL_BIN_FACET_SIZE 50
+
+/* vertices per unit of work in the parallel binary reader */
+#define STL_BIN_CHUNK 65536
+
+/* hash shards for vertex deduplication, a power of two */
+#define STL_BIN_SHARDS 256
+
 
 static void
 Add_face(struct conversion_state *pstate, int face[3])
@@ -91,7 +108,7 @@ Add_face(struct conversion_state *pstate, int face[3])
 	pstate->bot_fsize = BOT_FBLOCK;
 	pstate->bot_fcurr = 0;
     } else if (pstate->bot_fcurr >= pstate->bot_fsize) {
-	pstate->bot_fsize += BOT_FBLOCK;
+	pstate->bot_fsize *= 2;
 	pstate->bot_faces = (int *)bu_realloc((void *)pstate->bot_faces, 3 * pstate->bot_fsize * sizeof(int), "bot_faces increase");
     }
 
@@ -99,6 +116,33 @@ Add_face(struct conversion_state *pstate, int face[3])
     pstate->bot_fcurr++;
 }
 
+/*
+ * Write a BoT that takes over the vertex tree's array and the given
+ * faces array instead of copying them the way mk_bot() does.  The
+ * vertex tree is left empty and ready for the next part, and faces
+ * belongs to the database write afterwards.
+ */
+static int
+stl_export_bot(struct conversion_state *pstate, const char *name, int *faces, size_t num_faces)
+{
+    struct rt_bot_internal *bot;
+
+    BU_ALLOC(bot, struct rt_bot_internal);
+    bot->magic = RT_BOT_INTERNAL_MAGIC;
+    bot->mode = RT_BOT_SOLID;
+    bot->orientation = RT_BOT_UNORIENTED;
+    bot->num_vertices = pstate->tree->curr_vert;
+    bot->vertices = (fastf_t *)bu_realloc(pstate->tree->the_array, bot->num_vertices * 3 * sizeof(fastf_t), "bot vertices");
+    bot->num_faces = num_faces;
+    bot->faces = (int *)bu_realloc(faces, num_faces * 3 * sizeof(int), "bot faces");
+
+    pstate->tree->the_array = (fastf_t *)NULL;
+    pstate->tree->max_vert = 0;
+    bg_vert_tree_clean(pstate->tree);
+
+    return wdb_export(pstate->fd_out, name, (void *)bot, ID_BOT, mk_conv2mm);
+}
+
 static void
 mk_unique_brlcad_name(struct conversion_state *pstate, struct bu_vls *name)
 {
@@ -314,9 +358,8 @@ Convert_part_ascii(struct conversion_state *pstate, char line[MAX_LINE_SIZE])
 	    bu_log("\t%d faces were degenerate\n", degenerate_count);
     }
 
-    mk_bot(pstate->fd_out, bu_vls_addr(&solid_name), RT_BOT_SOLID, RT_BOT_UNORIENTED, 0, pstate->tree->curr_vert, pstate->bot_fcurr,
-	   pstate->tree->the_array, pstate->bot_faces, NULL, NULL);
-    bg_vert_tree_clean(pstate->tree);
+    stl_export_bot(pstate, bu_vls_addr(&solid_name), pstate->bot_faces, pstate->bot_fcurr);
+    pstate->bot_faces = NULL;
 
     if (face_count && !solid_in_region) {
 	(void)mk_addmember(bu_vls_addr(&solid_name), &head.l, NULL, WMOP_UNION);
@@ -354,88 +397,254 @@ static void stl_read_lswap(unsigned int *v)
 	| ((r & 0xff000000) >> 24);
 }
 
+
+/*
+ * Binary facets are read straight out of the mapped input file.
+ * Nearly every vertex appears bitwise-identical in several facets, so
+ * these are folded together first, in parallel: vertices are bucketed
+ * into hash shards and each shard is deduplicated by one thread.  The
+ * serial bg_vert_tree pass, which applies the distance tolerance,
+ * then only sees each distinct vertex once.
+ */
+struct stl_bin_state {
+    const unsigned char *facets;	/* first facet record */
+    size_t nverts;
+    size_t nchunks;
+    size_t *shard_pos;		/* [nchunks][STL_BIN_SHARDS] counts, then positions */
+    size_t shard_start[STL_BIN_SHARDS + 1];
+    int *order;			/* vertex indices grouped by shard */
+    int *rep;			/* vertex hash, then first bitwise-equal vertex */
+    int phase;
+    size_t nwork;
+    size_t next;		/* semaphored */
+};
+
+
+static const unsigned char *
+stl_bin_vertex(const struct stl_bin_state *bs, size_t v)
+{
+    return bs->facets + (v / 3) * STL_BIN_FACET_SIZE + 12 + (v % 3) * 12;
+}
+
+
+static void
+stl_bin_decode(const unsigned char *raw, float flts[3])
+{
+    unsigned char buf[12];
+    int i;
+
+    memcpy(buf, raw, sizeof(buf));
+
+    /* swap bytes to convert from Little-endian to network order (big-endian) */
+    for (i = 0; i < 3; i++)
+	stl_read_lswap((unsigned int *)&buf[i*4]);
+
+    /* now use our network to native host format conversion tools */
+    bu_cv_ntohf((unsigned char *)flts, buf, 3);
+}
+
+
+static void
+stl_bin_chunk(struct stl_bin_state *bs, size_t c)
+{
+    size_t *pos = &bs->shard_pos[c * STL_BIN_SHARDS];
+    size_t v = c * STL_BIN_CHUNK;
+    size_t end = v + STL_BIN_CHUNK;
+
+    if (end > bs->nverts)
+	end = bs->nverts;
+
+    if (bs->phase == 0) {
+	/* hash and count */
+	for (; v < end; v++) {
+	    unsigned int h = (unsigned int)bu_data_hash(stl_bin_vertex(bs, v), 12);
+	    bs->rep[v] = (int)h;
+	    pos[h & (STL_BIN_SHARDS - 1)]++;
+	}
+    } else {
+	/* scatter, keeping each shard in vertex order */
+	for (; v < end; v++) {
+	    unsigned int h = (unsigned int)bs->rep[v];
+	    bs->order[pos[h & (STL_BIN_SHARDS - 1)]++] = (int)v;
+	}
+    }
+}
+
+
+static void
+stl_bin_shard(struct stl_bin_state *bs, size_t s)
+{
+    size_t n = bs->shard_start[s + 1] - bs->shard_start[s];
+    size_t tsize = 16;
+    size_t mask, i;
+    int *table;
+
+    if (!n)
+	return;
+
+    while (tsize < 2 * n)
+	tsize <<= 1;
+    mask = tsize - 1;
+    table = (int *)bu_malloc(tsize * sizeof(int), "stl vertex table");
+    memset(table, -1, tsize * sizeof(int));
+
+    for (i = bs->shard_start[s]; i < bs->shard_start[s + 1]; i++) {
+	int v = bs->order[i];
+	const unsigned char *raw = stl_bin_vertex(bs, (size_t)v);
+	size_t slot = ((unsigned int)bs->rep[v] / STL_BIN_SHARDS) & mask;
+
+	while (table[slot] >= 0 && memcmp(stl_bin_vertex(bs, (size_t)table[slot]), raw, 12))
+	    slot = (slot + 1) & mask;
+	if (table[slot] < 0)
+	    table[slot] = v;
+	bs->rep[v] = table[slot];
+    }
+
+    bu_free(table, "stl vertex table");
+}
+
+
+static void
+stl_bin_worker(int UNUSED(cpu), void *data)
+{
+    struct stl_bin_state *bs = (struct stl_bin_state *)data;
+    size_t w;
+
+    while (1) {
+	bu_semaphore_acquire(BU_SEM_GENERAL);
+	w = bs->next++;
+	bu_semaphore_release(BU_SEM_GENERAL);
+
+	if (w >= bs->nwork)
+	    break;
+
+	if (bs->phase < 2)
+	    stl_bin_chunk(bs, w);
+	else
+	    stl_bin_shard(bs, w);
+    }
+}
+
+
+static void
+stl_bin_run(struct stl_bin_state *bs, int phase, size_t nwork, size_t ncpu)
+{
+    bs->phase = phase;
+    bs->nwork = nwork;
+    bs->next = 0;
+    bu_parallel(stl_bin_worker, ncpu, bs);
+}
+
+
 static void
 Convert_part_binary(struct conversion_state *pstate)
 {
-    unsigned char buf[51];
+    const unsigned char *buf = (const unsigned char *)pstate->mf_in->buf;
     unsigned long num_facets=0;
-    float flts[12];
-    vect_t normal;
-    int tmp_face[3];
+    struct stl_bin_state bs;
     struct wmember head;
     struct bu_vls solid_name = BU_VLS_INIT_ZERO;
     struct bu_vls region_name = BU_VLS_INIT_ZERO;
+    size_t nfacets, ncpu, pos, c, s, v, f;
+    int *faces;
     int face_count=0;
     int degenerate_count=0;
-    size_t ret;
 
     bu_vls_strcat(&solid_name, "s.stl");
     bu_vls_strcat(&region_name, "r.stl");
     bu_log("\tUsing solid name: %s\n", bu_vls_addr(&solid_name));
 
-
-    ret = fread(buf, 4, 1, pstate->fd_in);
-    if (ret != 1)
-	perror("fread");
-
-    /* swap bytes to convert from Little-endian to network order (big-endian) */
-    stl_read_lswap((unsigned int *)buf);
-
-    /* now use our network to native host format conversion tools */
-    num_facets = ntohl(*(uint32_t *)buf);
-
+    /* facet count is little-endian, right after the header */
+    num_facets = (unsigned long)buf[80] | ((unsigned long)buf[81] << 8)
+	| ((unsigned long)buf[82] << 16) | ((unsigned long)buf[83] << 24);
     bu_log("\t%ld facets\n", num_facets);
-    while (fread(buf, 48, 1, pstate->fd_in)) {
-	int i;
-	double pt[3];
-
-	/* swap bytes to convert from Little-endian to network order (big-endian) */
-	for (i=0; i<12; i++) {
-	    stl_read_lswap((unsigned int *)&buf[i*4]);
-	}
 
-	/* now use our network to native host format conversion tools */
-	bu_cv_ntohf((unsigned char *)flts, buf, 12);
+    /* like a reader that stops at EOF, trust the file length over the header */
+    nfacets = (pstate->mf_in->buflen - STL_BIN_HEADER_SIZE) / STL_BIN_FACET_SIZE;
+    if (nfacets != num_facets)
+	bu_log("\tfile holds %zu complete facets\n", nfacets);
+    if (nfacets > (size_t)INT_MAX / 3) {
+	bu_log("\ttoo many facets for a single BoT, ignoring part\n");
+	bu_vls_free(&region_name);
+	bu_vls_free(&solid_name);
+	return;
+    }
 
-	/* unused attribute byte count */
-	ret = fread(buf, 2, 1, pstate->fd_in);
-	if (ret != 1)
-	    perror("fread");
+    memset(&bs, 0, sizeof(bs));
+    bs.facets = buf + STL_BIN_HEADER_SIZE;
+    bs.nverts = nfacets * 3;
+    bs.nchunks = (bs.nverts + STL_BIN_CHUNK - 1) / STL_BIN_CHUNK;
+    ncpu = pstate->gcv_options->max_cpus;
+    if (bs.nverts) {
+	bs.shard_pos = (size_t *)bu_calloc(bs.nchunks * STL_BIN_SHARDS, sizeof(size_t), "stl shard positions");
+	bs.order = (int *)bu_malloc(bs.nverts * sizeof(int), "stl vertex order");
+	bs.rep = (int *)bu_malloc(bs.nverts * sizeof(int), "stl vertex reps");
+
+	stl_bin_run(&bs, 0, bs.nchunks, ncpu);
+
+	/* turn per-chunk shard counts into scatter positions */
+	pos = 0;
+	for (s = 0; s < STL_BIN_SHARDS; s++) {
+	    bs.shard_start[s] = pos;
+	    for (c = 0; c < bs.nchunks; c++) {
+		size_t cnt = bs.shard_pos[c * STL_BIN_SHARDS + s];
+		bs.shard_pos[c * STL_BIN_SHARDS + s] = pos;
+		pos += cnt;
+	    }
+	}
+	bs.shard_start[STL_BIN_SHARDS] = pos;
 
-	VMOVE(normal, flts);
-	VSCALE(pt, &flts[3], pstate->gcv_options->scale_factor);
-	tmp_face[0] = bg_vert_tree_add(pstate->tree, V3ARGS(pt), pstate->gcv_options->calculational_tolerance.dist_sq);
-	VSCALE(pt, &flts[6], pstate->gcv_options->scale_factor);
-	tmp_face[1] = bg_vert_tree_add(pstate->tree, V3ARGS(pt), pstate->gcv_options->calculational_tolerance.dist_sq);
-	VSCALE(pt, &flts[9], pstate->gcv_options->scale_factor);
-	tmp_face[2] = bg_vert_tree_add(pstate->tree, V3ARGS(pt), pstate->gcv_options->calculational_tolerance.dist_sq);
+	stl_bin_run(&bs, 1, bs.nchunks, ncpu);
+	bu_free(bs.shard_pos, "stl shard positions");
+	stl_bin_run(&bs, 2, STL_BIN_SHARDS, ncpu);
+	bu_free(bs.order, "stl vertex order");
+    }
 
-	/* check for degenerate faces */
-	if (tmp_face[0] == tmp_face[1]) {
-	    degenerate_count++;
-	    continue;
+    /* Distinct vertices go through the tolerance test in file order,
+     * as before; repeats take the index their first copy got.  Since
+     * rep[v] <= v, rep is rewritten in place into the face array.
+     */
+    faces = bs.rep;
+    if (pstate->tree->max_vert < bs.nverts / 4) {
+	pstate->tree->max_vert = bs.nverts / 4;
+	pstate->tree->the_array = (fastf_t *)bu_realloc(pstate->tree->the_array, pstate->tree->max_vert * 3 * sizeof(fastf_t), "tree->the_array");
+    }
+    for (v = 0; v < bs.nverts; v++) {
+	if ((size_t)faces[v] == v) {
+	    float flts[3];
+	    double pt[3];
+
+	    stl_bin_decode(stl_bin_vertex(&bs, v), flts);
+	    VSCALE(pt, flts, pstate->gcv_options->scale_factor);
+	    faces[v] = (int)bg_vert_tree_add(pstate->tree, V3ARGS(pt), pstate->gcv_options->calculational_tolerance.dist_sq);
+	} else {
+	    faces[v] = faces[faces[v]];
 	}
+    }
 
-	if (tmp_face[0] == tmp_face[2]) {
-	    degenerate_count++;
-	    continue;
-	}
+    for (f = 0; f < nfacets; f++) {
+	int *tmp_face = &faces[f*3];
 
-	if (tmp_face[1] == tmp_face[2]) {
+	/* check for degenerate faces */
+	if (tmp_face[0] == tmp_face[1] || tmp_face[0] == tmp_face[2] || tmp_face[1] == tmp_face[2]) {
 	    degenerate_count++;
 	    continue;
 	}
 
 	if (pstate->gcv_options->debug_mode) {
 	    int n;
+	    float flts[3];
+	    vect_t normal;
 
+	    stl_bin_decode(bs.facets + f * STL_BIN_FACET_SIZE, flts);
+	    VMOVE(normal, flts);
 	    bu_log("Making Face:\n");
 	    for (n=0; n<3; n++)
 		bu_log("\tvertex #%d: (%g %g %g)\n", tmp_face[n], V3ARGS(&pstate->tree->the_array[3*tmp_face[n]]));
 	    VPRINT(" normal", normal);
 	}
 
-	Add_face(pstate, tmp_face);
+	VMOVE(&faces[face_count*3], tmp_face);
 	face_count++;
     }
 
@@ -444,15 +653,18 @@ Convert_part_binary(struct conversion_state *pstate)
 	bu_log("\tpart has no solid parts, ignoring\n");
 	if (degenerate_count)
 	    bu_log("\t%d faces were degenerate\n", degenerate_count);
+	if (faces)
+	    bu_free(faces, "stl vertex reps");
+	bg_vert_tree_clean(pstate->tree);
+	bu_vls_free(&region_name);
+	bu_vls_free(&solid_name);
 	return;
     } else {
 	if (degenerate_count)
 	    bu_log("\t%d faces were degenerate\n", degenerate_count);
     }
 
-    mk_bot(pstate->fd_out, bu_vls_addr(&solid_name), RT_BOT_SOLID, RT_BOT_UNORIENTED, 0,
-	   pstate->tree->curr_vert, pstate->bot_fcurr, pstate->tree->the_array, pstate->bot_faces, NULL, NULL);
-    bg_vert_tree_clean(pstate->tree);
+    stl_export_bot(pstate, bu_vls_addr(&solid_name), faces, (size_t)face_count);
 
     BU_LIST_INIT(&head.l);
     if (face_count) {
@@ -475,6 +687,9 @@ Convert_part_binary(struct conversion_state *pstate)
 	pstate->id_no++;
     }
 
+    bu_vls_free(&region_name);
+    bu_vls_free(&solid_name);
+
     return;
 }
 
@@ -485,15 +700,9 @@ Convert_input(struct conversion_state *pstate)
     char line[ MAX_LINE_SIZE ];
 
     if (pstate->stl_read_options->binary) {
-	if (fread(line, 80, 1, pstate->fd_in) < 1) {
-	    if (feof(pstate->fd_in)) {
-		bu_exit(EXIT_FAILURE, "Unexpected EOF in input file!\n");
-	    } else {
-		bu_log("Error reading input file\n");
-		perror("stl-g");
-		bu_exit(EXIT_FAILURE, "Error reading input file\n");
-	    }
-	}
+	if (pstate->mf_in->buflen < STL_BIN_HEADER_SIZE)
+	    bu_exit(EXIT_FAILURE, "Unexpected EOF in input file!\n");
+	memcpy(line, pstate->mf_in->buf, 80);
 	line[80] = '\0';
 	bu_log("header data:\n%s\n\n", line);
 	Convert_part_binary(pstate);
@@ -567,7 +776,12 @@ stl_read(struct gcv_context *context, const struct gcv_opts *gcv_options, const
     struct rt_wdb *wdbp = wdb_dbopen(context->dbip, RT_WDB_TYPE_DB_INMEM);
     state.fd_out = wdbp;
 
-    if ((state.fd_in = fopen(source_path, "rb")) == NULL) {
+    if (state.stl_read_options->binary) {
+	if ((state.mf_in = bu_open_mapped_file(source_path, "stl")) == NULL) {
+	    bu_log("Cannot open input file (%s)\n", source_path);
+	    bu_exit(1, NULL);
+	}
+    } else if ((state.fd_in = fopen(source_path, "rb")) == NULL) {
 	bu_log("Cannot open input file (%s)\n", source_path);
 	perror("libgcv");
 	bu_exit(1, NULL);
@@ -585,7 +799,15 @@ stl_read(struct gcv_context *context, const struct gcv_opts *gcv_options, const
     /* make a top level group */
     mk_lcomb(wdbp, "all", &state.all_head, 0, (char *)NULL, (char *)NULL, (unsigned char *)NULL, 0);
 
-    fclose(state.fd_in);
+    if (state.mf_in) {
+	/* nothing else wants this file cached, release the mapping now */
+	bu_close_mapped_file(state.mf_in);
+	bu_free_mapped_files(0);
+    } else {
+	fclose(state.fd_in);
+    }
+    if (state.bot_faces)
+	bu_free(state.bot_faces, "bot_faces");
 
     return 1;
 }
@@ -56,6 +56,7 @@ check_show_help(struct ged *gedp)
 
     bu_vls_printf(&str, "\nOptions:\n\n");
     bu_vls_printf(&str, "  -a #[deg|rad] - Azimuth angle.\n");
+    bu_vls_printf(&str, "  -A - Adaptive grid refinement, only subdividing cells that have not converged.\n");
     bu_vls_printf(&str, "  -d - Set debug flag.\n");
     bu_vls_printf(&str, "  -e #[deg|rad] - Elevation angle.\n");
     bu_vls_printf(&str, "  -f filename - Specifies that density values should be taken from an external file instead of from the _DENSITIES object in the database.\n");
@@ -139,7 +140,7 @@ parse_check_args(int ac, char *av[], struct check_parameters* options, struct cu
     double a;
     char *p;
 
-    char *options_str = "a:de:f:g:G:iM:n:N:opP:qrRs:S:t:U:u:vV:h?";
+    char *options_str = "a:Ade:f:g:G:iM:n:N:opP:qrRs:S:t:U:u:vV:h?";
 
     /* Turn off getopt's error messages */
     bu_opterr = 0;
@@ -156,6 +157,9 @@ parse_check_args(int ac, char *av[], struct check_parameters* options, struct cu
 		analyze_set_azimuth(state, options->azimuth_deg);
 		options->getfromview = 0;
 		break;
+	    case 'A':
+		analyze_set_adaptive(state, 1);
+		break;
 	    case 'd':
 		options->debug = 1;
 		options->debug_str = bu_vls_vlsinit();
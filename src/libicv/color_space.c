@@ -32,14 +32,74 @@
 #include "bu/malloc.h"
 #include "bu/log.h"
 #include "icv.h"
+#include "icv_private.h"
+
+
+/* Conversions are done in row bands by tile_rows() */
+struct color_state {
+    const double *in_data;
+    double *out_data;
+    size_t width;
+    int plane;			/* -1 for a weighted sum, 3 for the mean */
+    double rweight, gweight, bweight;
+};
+
+
+static void
+gray2rgb_rows(size_t start, size_t end, void *data)
+{
+    const struct color_state *cs = (const struct color_state *)data;
+    const double *in_data = cs->in_data + start*cs->width;
+    double *out_data = cs->out_data + start*cs->width*3;
+    size_t i;
+
+    for (i = 0; i < (end - start)*cs->width; i++) {
+	*(out_data) = *in_data;
+	*(out_data+1) = *in_data;
+	*(out_data+2) = *in_data;
+	out_data+=3;
+	in_data++;
+    }
+}
+
+
+static void
+rgb2gray_rows(size_t start, size_t end, void *data)
+{
+    const struct color_state *cs = (const struct color_state *)data;
+    const double *in_data = cs->in_data + start*cs->width*3;
+    double *out_data = cs->out_data + start*cs->width;
+    size_t size = (end - start)*cs->width;
+    size_t in, out;
+    double value;
+
+    if (cs->plane < 0) {
+	for (in = out = 0; out < size; out++, in += 3) {
+	    value = cs->rweight*in_data[in] + cs->gweight*in_data[in+1] + cs->bweight*in_data[in+2];
+	    if (value > 1.0) {
+		out_data[out] = 1.0;
+	    } else if (value < 0.0) {
+		out_data[out] = 0.0;
+	    } else
+		out_data[out] = value;
+	}
+    } else if (cs->plane < 3) {
+	for (in = cs->plane, out = 0; out < size; out++, in += 3)
+	    out_data[out] = in_data[in];
+    } else {
+	/* uniform weight */
+	for (in = out = 0; out < size; out++, in += 3)
+	    out_data[out] = (in_data[in] + in_data[in+1] + in_data[in+2]) / 3.0;
+    }
+}
+
 
 int
 icv_gray2rgb(icv_image_t *img)
 {
-    double *out_data, *op;
-    double *in_data;
+    struct color_state cs;
+    double *op;
     size_t size;
-    size_t i = 0;
 
     ICV_IMAGE_VAL_INT(img);
 
@@ -53,15 +113,11 @@ icv_gray2rgb(icv_image_t *img)
     }
 
     size = img->height*img->width;
-    op = out_data = (double *)bu_malloc(size*3*sizeof(double), "Out Image Data");
-    in_data = img->data;
-    for (i =0 ; i < size; i++) {
-	*(out_data) = *in_data;
-	*(out_data+1) = *in_data;
-	*(out_data+2) = *in_data;
-	out_data+=3;
-	in_data++;
-    }
+    op = (double *)bu_malloc(size*3*sizeof(double), "Out Image Data");
+    cs.in_data = img->data;
+    cs.out_data = op;
+    cs.width = img->width;
+    tile_rows(img->height, img->width*3, gray2rgb_rows, &cs);
 
     bu_free(img->data, "icv_gray2rgb : gray image data");
     img->data = op;
@@ -74,12 +130,12 @@ icv_gray2rgb(icv_image_t *img)
 int
 icv_rgb2gray(icv_image_t *img, ICV_COLOR color, double rweight, double gweight, double bweight)
 {
-    double *out_data, *in_data;
-    size_t in, out, size;
+    struct color_state cs;
+    double *out_data;
+    size_t size;
     int multiple_colors = 0; /* will set to 0 if it's found only 1 color is referenced */
     int num_color_planes;
 
-    double value;
     int red = 0 , green = 0 , blue = 0 ;
 
     ICV_IMAGE_VAL_INT(img);
@@ -140,7 +196,6 @@ icv_rgb2gray(icv_image_t *img, ICV_COLOR color, double rweight, double gweight,
     /* Gets number of planes according to the status of arguments
        check */
     num_color_planes = red + green + blue;
-    in_data = img->data;
 
 
     /* If function is called with zero for weight of respective plane
@@ -154,30 +209,23 @@ icv_rgb2gray(icv_image_t *img, ICV_COLOR color, double rweight, double gweight,
 
     size = img->height*img->width;
     out_data = (double*) bu_malloc(size*sizeof(double), "Out Image Data");
-    if (multiple_colors) {
-	for (in = out = 0; out < size; out++, in += 3) {
-	    value = rweight*in_data[in] + gweight*in_data[in+1] + bweight*in_data[in+2];
-	    if (value > 1.0) {
-		out_data[out] = 1.0;
-	    } else if (value < 0.0) {
-		out_data[out] = 0.0;
-	    } else
-		out_data[out] = value;
-	}
-    } else if (red) {
-	for (in = out = 0; out < size; out++, in += 3)
-	    out_data[out] = in_data[in];
-    } else if (green) {
-	for (in = out = 0; out < size; out++, in += 3)
-	    out_data[out] = in_data[in+1];
-    } else if (blue) {
-	for (in = out = 0; out < size; out++, in += 3)
-	    out_data[out] = in_data[in+2];
-    } else {
-	/* uniform weight */
-	for (in = out = 0; out < size; out++, in += 3)
-	    out_data[out] = (in_data[in] + in_data[in+1] + in_data[in+2]) / 3.0;
-    }
+    if (multiple_colors)
+	cs.plane = -1;
+    else if (red)
+	cs.plane = 0;
+    else if (green)
+	cs.plane = 1;
+    else if (blue)
+	cs.plane = 2;
+    else
+	cs.plane = 3;
+    cs.in_data = img->data;
+    cs.out_data = out_data;
+    cs.width = img->width;
+    cs.rweight = rweight;
+    cs.gweight = gweight;
+    cs.bweight = bweight;
+    tile_rows(img->height, img->width*3, rgb2gray_rows, &cs);
     bu_free(img->data, "icv_image_rgb2gray : rgb image data");
     img->data = out_data;
     img->color_space = ICV_COLOR_SPACE_GRAY;
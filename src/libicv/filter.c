@@ -24,17 +24,35 @@
  * images are taken care.
  */
 
+#include "common.h"
+
+#include <string.h>
+
+/* The convolution inner loops have AVX2 variants, compiled through a
+ * target attribute and only called when bu_simd_level() reports the
+ * CPU supports them.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define FILTER_SIMD 1
+# include <immintrin.h>
+#endif
+
 #include "bu/log.h"
 #include "bu/malloc.h"
+#include "bu/simd.h"
 #include "icv.h"
 
 #include "vmath.h"
+#include "icv_private.h"
 
 #define KERN_DEFAULT 3
 
+/* samples of a row convolved at a time, sized to stay in L1 */
+#define FILTER_SPAN 512
+
 /* private functions */
 
-static void
+static int
 get_kernel(ICV_FILTER filter_type, double *kern, double *offset)
 {
     switch (filter_type) {
@@ -82,13 +100,12 @@ get_kernel(ICV_FILTER filter_type, double *kern, double *offset)
 	    break;
 	default :
 	    bu_log("Filter Type not Implemented.\n");
-	    bu_free(kern, "Freeing Kernel, Wrong filter");
-	    kern = NULL;
+	    return -1;
     }
-    return;
+    return 0;
 }
 
-static void
+static int
 get_kernel3(ICV_FILTER3 filter_type, double *kern, double *offset)
 {
     switch (filter_type) {
@@ -154,10 +171,224 @@ get_kernel3(ICV_FILTER3 filter_type, double *kern, double *offset)
 	    break;
 	default :
 	    bu_log("Filter Type not Implemented.\n");
-	    bu_free(kern, "Freeing Kernel, Wrong filter");
-	    kern = NULL;
+	    return -1;
     }
-    return;
+    return 0;
+}
+
+struct filter_state {
+    const double *in[3];	/* source frames */
+    size_t nframes;
+    const double *kern;		/* KERN_DEFAULT^2 weights per frame */
+    double offset;
+    double *out;
+    size_t width, height, channels;
+    int simd;			/* FILTER_SCALAR, FILTER_AVX2 or FILTER_AVX2_FLOAT */
+};
+
+#define FILTER_SCALAR 0
+#define FILTER_AVX2 1
+#define FILTER_AVX2_FLOAT 2
+
+
+/* acc[i] += k*src[i] */
+static void
+filter_axpy(double *acc, const double *src, double k, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+	acc[i] += k * src[i];
+}
+
+
+#ifdef FILTER_SIMD
+/* Same sums as filter_axpy(), four at a time; no FMA, so the results
+ * match the scalar loop exactly.
+ */
+__attribute__((target("avx2")))
+static void
+filter_axpy_avx2(double *acc, const double *src, double k, size_t n)
+{
+    const __m256d kv = _mm256_set1_pd(k);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+	__m256d a = _mm256_loadu_pd(acc + i);
+	__m256d b = _mm256_loadu_pd(src + i);
+	_mm256_storeu_pd(acc + i, _mm256_add_pd(a, _mm256_mul_pd(kv, b)));
+    }
+    for (; i < n; i++)
+	acc[i] += k * src[i];
+}
+
+
+__attribute__((target("avx2")))
+static void
+filter_axpy_avx2f(float *acc, const float *src, float k, size_t n)
+{
+    const __m256 kv = _mm256_set1_ps(k);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+	__m256 a = _mm256_loadu_ps(acc + i);
+	__m256 b = _mm256_loadu_ps(src + i);
+	_mm256_storeu_ps(acc + i, _mm256_add_ps(a, _mm256_mul_ps(kv, b)));
+    }
+    for (; i < n; i++)
+	acc[i] += k * src[i];
+}
+
+
+/* Single precision span of one row, KERN_DEFAULT taps wide.  Every
+ * source row the span needs is converted to float once, with zeros
+ * standing in for samples off either edge, and the taps run eight
+ * samples at a time.
+ */
+__attribute__((target("avx2")))
+static void
+filter_span_float(const struct filter_state *fs, size_t y, size_t s0, size_t s1, float *scratch)
+{
+    size_t ch = fs->channels;
+    size_t ws = fs->width * ch;
+    size_t n = s1 - s0;
+    size_t rowlen = n + 2 * ch;
+    float *acc = scratch;
+    float *src = scratch + FILTER_SPAN;
+    double *out = fs->out + y * ws + s0;
+    size_t f, ky, kx, i;
+
+    memset(acc, 0, n * sizeof(float));
+
+    for (f = 0; f < fs->nframes; f++) {
+	for (ky = 0; ky < KERN_DEFAULT; ky++) {
+	    const double *rp;
+
+	    if (y + ky < 1 || y + ky - 1 >= fs->height)
+		continue;
+	    rp = fs->in[f] + (y + ky - 1) * ws;
+
+	    /* src[i] holds sample s0 - ch + i of this row */
+	    for (i = 0; i < rowlen; i++) {
+		size_t s = s0 + i;
+		src[i] = (s >= ch && s - ch < ws) ? (float)rp[s - ch] : 0.0f;
+	    }
+
+	    for (kx = 0; kx < KERN_DEFAULT; kx++) {
+		double k = fs->kern[(f * KERN_DEFAULT + ky) * KERN_DEFAULT + kx];
+		if (ZERO(k))
+		    continue;
+		filter_axpy_avx2f(acc, src + kx * ch, (float)k, n);
+	    }
+	}
+    }
+
+    for (i = 0; i < n; i++)
+	out[i] = (double)acc[i] + fs->offset;
+}
+#endif
+
+
+/* Double precision span [s0, s1) of output row y.  Each tap is a
+ * shifted multiply-add of one source row, clipped at the left and
+ * right edges; rows off the top and bottom are skipped.  Together
+ * that is the zero padding.
+ */
+static void
+filter_span(const struct filter_state *fs, size_t y, size_t s0, size_t s1, double *acc)
+{
+    size_t ch = fs->channels;
+    size_t ws = fs->width * ch;
+    double *out = fs->out + y * ws + s0;
+    size_t f, ky, kx, i;
+
+    memset(acc, 0, (s1 - s0) * sizeof(double));
+
+    for (f = 0; f < fs->nframes; f++) {
+	for (ky = 0; ky < KERN_DEFAULT; ky++) {
+	    const double *rp;
+
+	    if (y + ky < 1 || y + ky - 1 >= fs->height)
+		continue;
+	    rp = fs->in[f] + (y + ky - 1) * ws;
+
+	    for (kx = 0; kx < KERN_DEFAULT; kx++) {
+		double k = fs->kern[(f * KERN_DEFAULT + ky) * KERN_DEFAULT + kx];
+		size_t lo = s0, hi = s1;
+
+		if (ZERO(k))
+		    continue;
+
+		/* output sample s reads source sample s + (kx-1)*ch */
+		if (kx * ch < ch && lo < ch)
+		    lo = ch;
+		if (kx * ch > ch && hi > ws + ch - kx * ch)
+		    hi = ws + ch - kx * ch;
+		if (lo >= hi)
+		    continue;
+
+#ifdef FILTER_SIMD
+		if (fs->simd != FILTER_SCALAR) {
+		    filter_axpy_avx2(acc + (lo - s0), rp + lo + kx * ch - ch, k, hi - lo);
+		    continue;
+		}
+#endif
+		filter_axpy(acc + (lo - s0), rp + lo + kx * ch - ch, k, hi - lo);
+	    }
+	}
+    }
+
+    for (i = 0; i < s1 - s0; i++)
+	out[i] = acc[i] + fs->offset;
+}
+
+
+static void
+filter_rows(size_t start, size_t end, void *data)
+{
+    const struct filter_state *fs = (const struct filter_state *)data;
+    size_t ws = fs->width * fs->channels;
+    double acc[FILTER_SPAN];
+    float *scratch = NULL;
+    size_t y, s0, s1;
+
+#ifdef FILTER_SIMD
+    if (fs->simd == FILTER_AVX2_FLOAT)
+	scratch = (float *)bu_malloc((2 * FILTER_SPAN + 2 * fs->channels) * sizeof(float), "filter scratch");
+#endif
+
+    for (y = start; y < end; y++) {
+	for (s0 = 0; s0 < ws; s0 = s1) {
+	    s1 = s0 + FILTER_SPAN;
+	    if (s1 > ws)
+		s1 = ws;
+#ifdef FILTER_SIMD
+	    if (scratch) {
+		filter_span_float(fs, y, s0, s1, scratch);
+		continue;
+	    }
+#endif
+	    filter_span(fs, y, s0, s1, acc);
+	}
+    }
+
+    if (scratch)
+	bu_free(scratch, "filter scratch");
+}
+
+
+static void
+filter_run(struct filter_state *fs, uint16_t flags)
+{
+    fs->simd = FILTER_SCALAR;
+#ifdef FILTER_SIMD
+    if (!(flags & ICV_SCALAR_KERNELS) && bu_simd_level() >= BU_SIMD_AVX2)
+	fs->simd = (flags & ICV_FLOAT_KERNELS) ? FILTER_AVX2_FLOAT : FILTER_AVX2;
+#else
+    (void)flags;
+#endif
+
+    tile_rows(fs->height, fs->width * fs->channels * fs->nframes * KERN_DEFAULT, filter_rows, fs);
 }
 
 /* end of private functions */
@@ -167,18 +398,9 @@ get_kernel3(ICV_FILTER3 filter_type, double *kern, double *offset)
 int
 icv_filter(icv_image_t *img, ICV_FILTER filter_type)
 {
-    double *kern = NULL, *kern_p = NULL;
-    double c_val;
-    double *out_data, *in_data, *data_p;
-    double offset = 0;
-    size_t k_dim = KERN_DEFAULT, k_dim_half, k_dim_half_ceil;
-    size_t size;
-    size_t h, w, k, i;
-    size_t widthstep;
-    size_t index, n_index; /**< index is the index of the pixel in
-			      * out image and n_index corresponds to
-			      * the nearby pixel in input image
-			      */
+    struct filter_state fs;
+    double kern[KERN_DEFAULT*KERN_DEFAULT];
+    double *in_data;
 
     /* TODO A new Functionality. Update the get_kernel function to
      * accommodate the generalized kernel length. This can be based
@@ -187,54 +409,24 @@ icv_filter(icv_image_t *img, ICV_FILTER filter_type)
 
     ICV_IMAGE_VAL_INT(img);
 
-    kern = (double *)bu_malloc(k_dim*k_dim*sizeof(double), "icv_filter : Kernel Allocation");
-    get_kernel(filter_type, kern, &offset);
-
-    if (!kern)
+    memset(&fs, 0, sizeof(fs));
+    if (get_kernel(filter_type, kern, &fs.offset) < 0)
 	return -1;
 
-    widthstep = img->width*img->channels;
-
     in_data = img->data;
-    size = img->height*img->width*img->channels;
+
+    fs.in[0] = in_data;
+    fs.nframes = 1;
+    fs.kern = kern;
+    fs.width = img->width;
+    fs.height = img->height;
+    fs.channels = img->channels;
     /* Replaces data pointer in place */
-    img->data = out_data = (double*)bu_malloc(size*sizeof(double), "icv_filter : out_image_data");
-
-    /* Kernel Dimension is always considered to be odd*/
-    k_dim_half = k_dim/2*img->channels;
-    k_dim_half_ceil = (k_dim - k_dim/2)*img->channels;
-    index = 0;
-    for (h = 0; h < img->height; h++) {
-	VMOVEN(out_data, in_data+index, k_dim_half);
-	out_data+=k_dim_half;
-
-	for (w = 0; w < widthstep - k_dim*img->channels; w++) {
-	    c_val = 0;
-	    kern_p = kern;
-
-	    for (k = 0; k <= k_dim; k++) {
-		n_index = index + (k-(k_dim/2))*widthstep;
-		data_p = in_data + n_index;
-		for (i = 0; i<=k_dim; i++) {
-		    /* Ensures that the arguments are given a zero value for
-		     * out of bound pixels. Thus behaves similar to zero padding
-		     */
-		    if (n_index < size) {
-			c_val += (*kern_p++)*(*data_p);
-			data_p += img->channels;
-			/* Ensures out bound in image */
-			n_index += img->channels;
-		    }
-		}
-	    }
-	    *out_data = c_val + offset;
-	    out_data++;
-	    index++;
-	}
-	index = (h+1)*widthstep;
-	VMOVEN(out_data,in_data+index -k_dim_half_ceil*img->channels,k_dim_half_ceil*img->channels );
-	out_data+= k_dim_half_ceil;
-    }
+    fs.out = (double *)bu_malloc(img->height*img->width*img->channels*sizeof(double), "icv_filter : out_image_data");
+
+    filter_run(&fs, img->flags);
+
+    img->data = fs.out;
     bu_free(in_data, "icv:filter Input Image Data");
     return 0;
 }
@@ -242,82 +434,43 @@ icv_filter(icv_image_t *img, ICV_FILTER filter_type)
 icv_image_t *
 icv_filter3(icv_image_t *old_img, icv_image_t *curr_img, icv_image_t *new_img, ICV_FILTER3 filter_type)
 {
+    struct filter_state fs;
+    double kern[KERN_DEFAULT*KERN_DEFAULT*3];
     icv_image_t *out_img;
-    double *kern = NULL;
-    double *kern_old, *kern_curr, *kern_new;
-    double c_val;
-    double *out_data;
-    double *old_data, *curr_data, *new_data;
-    double *old_data_p, *curr_data_p, *new_data_p;
-    double offset = 0;
-    size_t k_dim = KERN_DEFAULT;
-    size_t size;
-    size_t s, k, i;
-    size_t widthstep;
-    size_t index, n_index; /**< index is the index of the pixel in
-			      * out image and n_index corresponds to
-			      * the nearby pixel in input image
-			      */
 
     ICV_IMAGE_VAL_PTR(old_img);
     ICV_IMAGE_VAL_PTR(curr_img);
     ICV_IMAGE_VAL_PTR(new_img);
 
-    if ((old_img->width == curr_img->width && curr_img->width == new_img->width) && \
-	(old_img->height == curr_img->height && curr_img->height == new_img->height) && \
-	(old_img->channels == curr_img->channels && curr_img->channels == new_img->channels)) {
+    if (!((old_img->width == curr_img->width && curr_img->width == new_img->width) && \
+	  (old_img->height == curr_img->height && curr_img->height == new_img->height) && \
+	  (old_img->channels == curr_img->channels && curr_img->channels == new_img->channels))) {
 	bu_log("icv_filter3 : Image Parameters not Equal");
 	return NULL;
     }
 
-    kern = (double *)bu_malloc(k_dim*k_dim*3*sizeof(double), "icv_filter3 : Kernel Allocation");
-    get_kernel3(filter_type, kern, &offset);
-
-    if (!kern)
+    memset(&fs, 0, sizeof(fs));
+    if (get_kernel3(filter_type, kern, &fs.offset) < 0)
 	return NULL;
 
-    widthstep = old_img->width*old_img->channels;
-
-    old_data = old_img->data;
-    curr_data = curr_img->data;
-    new_data = new_img->data;
-
-    size = old_img->height*old_img->width*old_img->channels;
-
     out_img = icv_create(old_img->width, old_img->height, old_img->color_space);
 
-    out_data = out_img->data;
-
-    index = 0;
-
-    for (s = 0; s <= size; s++) {
-	c_val = 0;
-	kern_old = kern;
-	kern_curr = kern + k_dim*k_dim-1;
-	kern_new = kern + 2*k_dim*k_dim-1;
-	for (k = 0; k <= k_dim; k++) {
-	    n_index = index + (k-(k_dim/2))*widthstep;
-	    old_data_p = old_data + n_index;
-	    curr_data_p = curr_data + n_index;
-	    new_data_p = new_data + n_index;
-	    for (i = 0; i<=k_dim; i++) {
-		/* Ensures that the arguments are given a zero value for
-		   out of bound pixels. Thus behaves similar to zero padding */
-		if (n_index < size) {
-		    c_val += (*kern_old++)*(*old_data_p);
-		    c_val += (*kern_curr++)*(*curr_data_p);
-		    c_val += (*kern_new++)*(*new_data_p);
-		    old_data_p += old_img->channels;
-		    curr_data_p += old_img->channels;
-		    new_data_p += old_img->channels;
-		    n_index += old_img->channels;
-		}
-	    }
-	}
-	index++;
-	*out_data++ = c_val + offset;
-    }
-    return 0;
+    /* kernel weights are the old, current and new frames in turn */
+    fs.in[0] = old_img->data;
+    fs.in[1] = curr_img->data;
+    fs.in[2] = new_img->data;
+    fs.nframes = 3;
+    fs.kern = kern;
+    fs.width = old_img->width;
+    fs.height = old_img->height;
+    fs.channels = old_img->channels;
+    fs.out = out_img->data;
+
+    /* single precision only if every frame allows it, scalar if any asks */
+    filter_run(&fs, (old_img->flags & curr_img->flags & new_img->flags & ICV_FLOAT_KERNELS)
+	       | ((old_img->flags | curr_img->flags | new_img->flags) & ICV_SCALAR_KERNELS));
+
+    return out_img;
 }
 
 
@@ -50,6 +50,14 @@ extern icv_image_t* ppm_read(const char *filename);
 extern int rle_write(icv_image_t *bif, const char *filename);
 extern icv_image_t* rle_read(const char *filename);
 
+/* defined in tile.c */
+
+/* Calls func on bands of rows covering [0, nrows), spread over the
+ * available cpus.  rowlen is the number of samples in a row; small
+ * images are done in one call from the calling thread.
+ */
+extern void tile_rows(size_t nrows, size_t rowlen, void (*func)(size_t start, size_t end, void *data), void *data);
+
 #endif /* ICV_PRIVATE_H */
 
 /*
@@ -0,0 +1,295 @@
+/*                        M A P P E D . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file libicv/mapped.c
+ *
+ * Read-only access to PIX and BW files through bu_open_mapped_file(),
+ * so that images too large to expand into doubles can still be
+ * cropped, resized and compared a band of rows at a time.
+ *
+ */
+
+#include "common.h"
+
+#include <string.h>
+
+#include "bu/log.h"
+#include "bu/malloc.h"
+#include "bu/mapped_file.h"
+#include "bu/parallel.h"
+#include "icv_private.h"
+
+/* pixels compared per band by icv_mapped_diff() */
+#define DIFF_SPAN 4096
+
+
+icv_mapped_image_t *
+icv_map(const char *filename, bu_mime_image_t format, size_t width, size_t height)
+{
+    icv_mapped_image_t *mimg;
+    struct bu_mapped_file *mp;
+    ICV_COLOR_SPACE color_space;
+    size_t channels;
+
+    if (!filename) {
+	bu_log("icv_map: cannot map a stream\n");
+	return NULL;
+    }
+
+    switch (format) {
+	case BU_MIME_IMAGE_PIX:
+	    color_space = ICV_COLOR_SPACE_RGB;
+	    channels = 3;
+	    break;
+	case BU_MIME_IMAGE_BW:
+	    color_space = ICV_COLOR_SPACE_GRAY;
+	    channels = 1;
+	    break;
+	default:
+	    bu_log("icv_map: only PIX and BW files can be mapped\n");
+	    return NULL;
+    }
+
+    mp = bu_open_mapped_file(filename, "icv_map");
+    if (!mp) {
+	bu_log("icv_map: unable to open %s\n", filename);
+	return NULL;
+    }
+
+    if (!width || !height) {
+	if (!icv_image_size(NULL, 0, mp->buflen, format, &width, &height)) {
+	    /* same fallback as icv_read(), one long row */
+	    width = mp->buflen / channels;
+	    height = 1;
+	}
+    }
+
+    if (!width || mp->buflen < width * height * channels) {
+	bu_log("icv_map: %s holds %zu bytes, too few for a %zux%zu image\n",
+	       filename, mp->buflen, width, height);
+	bu_close_mapped_file(mp);
+	return NULL;
+    }
+
+    BU_ALLOC(mimg, struct icv_mapped_image);
+    mimg->magic = ICV_MAPPED_IMAGE_MAGIC;
+    mimg->color_space = color_space;
+    mimg->data = (const unsigned char *)mp->buf;
+    mimg->width = width;
+    mimg->height = height;
+    mimg->channels = channels;
+    mimg->handle = (void *)mp;
+
+    return mimg;
+}
+
+
+void
+icv_unmap(icv_mapped_image_t *mimg)
+{
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg))
+	return;
+
+    /* drop only this image's mapping, other users of the cache keep theirs */
+    bu_free_mapped_file((struct bu_mapped_file *)mimg->handle);
+
+    mimg->magic = 0;
+    bu_free(mimg, "icv_mapped_image");
+}
+
+
+const unsigned char *
+icv_mapped_row(const icv_mapped_image_t *mimg, size_t y)
+{
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg) || y >= mimg->height)
+	return NULL;
+
+    return mimg->data + y * mimg->width * mimg->channels;
+}
+
+
+int
+icv_mapped_read(const icv_mapped_image_t *mimg, size_t xorig, size_t yorig, size_t xnum, size_t ynum, double *out)
+{
+    const unsigned char *in;
+    size_t rowlen, x, y;
+
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg) || !out)
+	return -1;
+
+    if (xorig + xnum > mimg->width || yorig + ynum > mimg->height) {
+	bu_log("icv_mapped_read: tile extends past the image\n");
+	return -1;
+    }
+
+    rowlen = xnum * mimg->channels;
+    for (y = 0; y < ynum; y++) {
+	in = icv_mapped_row(mimg, yorig + y) + xorig * mimg->channels;
+	for (x = 0; x < rowlen; x++)
+	    *out++ = ICV_CONV_8BIT(in[x]);
+    }
+
+    return 0;
+}
+
+
+struct rect_state {
+    const icv_mapped_image_t *mimg;
+    icv_image_t *out;
+    size_t xorig, yorig;
+};
+
+
+static void
+rect_rows(size_t start, size_t end, void *data)
+{
+    const struct rect_state *rs = (const struct rect_state *)data;
+    size_t rowlen = rs->out->width * rs->out->channels;
+
+    (void)icv_mapped_read(rs->mimg, rs->xorig, rs->yorig + start, rs->out->width, end - start,
+			  rs->out->data + start * rowlen);
+}
+
+
+icv_image_t *
+icv_mapped_rect(const icv_mapped_image_t *mimg, size_t xorig, size_t yorig, size_t xnum, size_t ynum)
+{
+    struct rect_state rs;
+
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg))
+	return NULL;
+
+    if (!xnum || !ynum || xorig + xnum > mimg->width || yorig + ynum > mimg->height) {
+	bu_log("icv_mapped_rect : Cropped region not within the image\n");
+	return NULL;
+    }
+
+    rs.mimg = mimg;
+    rs.out = icv_create(xnum, ynum, mimg->color_space);
+    rs.xorig = xorig;
+    rs.yorig = yorig;
+    tile_rows(ynum, xnum * mimg->channels, rect_rows, &rs);
+
+    return rs.out;
+}
+
+
+struct diff_state {
+    const unsigned char *d1, *d2;
+    size_t npixels;
+    size_t channels;
+    size_t matching;	/* semaphored */
+    size_t off_by_1;	/* semaphored */
+    size_t off_by_many;	/* semaphored */
+};
+
+
+static void
+diff_rows(size_t start, size_t end, void *data)
+{
+    struct diff_state *ds = (struct diff_state *)data;
+    size_t first = start * DIFF_SPAN;
+    size_t last = end * DIFF_SPAN;
+    size_t matching = 0, off_by_1 = 0, off_by_many = 0;
+    size_t i, c;
+
+    if (last > ds->npixels)
+	last = ds->npixels;
+
+    /* renders being compared usually agree almost everywhere */
+    if (!memcmp(ds->d1 + first * ds->channels, ds->d2 + first * ds->channels, (last - first) * ds->channels)) {
+	matching = last - first;
+    } else {
+	for (i = first; i < last; i++) {
+	    const unsigned char *p1 = ds->d1 + i * ds->channels;
+	    const unsigned char *p2 = ds->d2 + i * ds->channels;
+	    int dcnt = 0;
+
+	    for (c = 0; c < ds->channels; c++)
+		dcnt += (p1[c] != p2[c]) ? 1 : 0;
+
+	    switch (dcnt) {
+		case 0:
+		    matching++;
+		    break;
+		case 1:
+		    off_by_1++;
+		    break;
+		default:
+		    off_by_many++;
+	    }
+	}
+    }
+
+    bu_semaphore_acquire(BU_SEM_GENERAL);
+    ds->matching += matching;
+    ds->off_by_1 += off_by_1;
+    ds->off_by_many += off_by_many;
+    bu_semaphore_release(BU_SEM_GENERAL);
+}
+
+
+int
+icv_mapped_diff(int *matching, int *off_by_1, int *off_by_many,
+		const icv_mapped_image_t *mimg1, const icv_mapped_image_t *mimg2)
+{
+    struct diff_state ds;
+    size_t s1, s2, smax;
+
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg1) || !ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg2))
+	return -1;
+
+    if (mimg1->channels != mimg2->channels) {
+	bu_log("icv_mapped_diff : Images do not have the same number of channels\n");
+	return -1;
+    }
+
+    s1 = mimg1->width * mimg1->height;
+    s2 = mimg2->width * mimg2->height;
+    smax = (s1 > s2) ? s1 : s2;
+
+    ds.d1 = mimg1->data;
+    ds.d2 = mimg2->data;
+    ds.npixels = (s1 < s2) ? s1 : s2;
+    ds.channels = mimg1->channels;
+    ds.matching = ds.off_by_1 = ds.off_by_many = 0;
+    tile_rows((ds.npixels + DIFF_SPAN - 1) / DIFF_SPAN, DIFF_SPAN * ds.channels, diff_rows, &ds);
+
+    ds.off_by_many += smax - ds.npixels;
+
+    if (matching)
+	(*matching) += (int)ds.matching;
+    if (off_by_1)
+	(*off_by_1) += (int)ds.off_by_1;
+    if (off_by_many)
+	(*off_by_many) += (int)ds.off_by_many;
+
+    return (ds.off_by_1 || ds.off_by_many) ? 1 : 0;
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
@@ -35,40 +35,138 @@
 #include "bu/malloc.h"
 #include "bn/tol.h"
 #include "vmath.h"
+#include "icv_private.h"
 
 
-int icv_sanitize(icv_image_t* img)
+/* The per-sample operations below are done in row bands by
+ * tile_rows().  Each loop is a plain array walk the compiler can
+ * vectorize.
+ */
+enum ops_op {
+    OPS_SANITIZE,
+    OPS_ADD_VAL,
+    OPS_MULTIPLY_VAL,
+    OPS_DIVIDE_VAL,
+    OPS_POW_VAL,
+    OPS_ADD,
+    OPS_SUB,
+    OPS_MULTIPLY,
+    OPS_DIVIDE,
+    OPS_SATURATE
+};
+
+struct ops_state {
+    enum ops_op op;
+    double *out;
+    const double *in1, *in2;
+    double val;
+    size_t rowlen;		/* samples per row */
+};
+
+
+static void
+ops_rows(size_t start, size_t end, void *data)
+{
+    const struct ops_state *os = (const struct ops_state *)data;
+    size_t first = start * os->rowlen;
+    size_t n = (end - start) * os->rowlen;
+    double *out = os->out + first;
+    const double *in1 = os->in1 + first;
+    const double *in2 = os->in2 ? os->in2 + first : NULL;
+    double val = os->val;
+    size_t i;
+
+    switch (os->op) {
+	case OPS_SANITIZE:
+	    for (i = 0; i < n; i++) {
+		if (out[i] > 1.0)
+		    out[i] = 1.0;
+		else if (out[i] < 0)
+		    out[i] = 0;
+	    }
+	    break;
+	case OPS_ADD_VAL:
+	    for (i = 0; i < n; i++)
+		out[i] += val;
+	    break;
+	case OPS_MULTIPLY_VAL:
+	    for (i = 0; i < n; i++)
+		out[i] *= val;
+	    break;
+	case OPS_DIVIDE_VAL:
+	    /* Since data is double dividing by 0 will result in INF and -INF */
+	    for (i = 0; i < n; i++)
+		out[i] /= val;
+	    break;
+	case OPS_POW_VAL:
+	    for (i = 0; i < n; i++)
+		out[i] = pow(out[i], val);
+	    break;
+	case OPS_ADD:
+	    for (i = 0; i < n; i++)
+		out[i] = in1[i] + in2[i];
+	    break;
+	case OPS_SUB:
+	    for (i = 0; i < n; i++)
+		out[i] = in1[i] - in2[i];
+	    break;
+	case OPS_MULTIPLY:
+	    for (i = 0; i < n; i++)
+		out[i] = in1[i] * in2[i];
+	    break;
+	case OPS_DIVIDE:
+	    for (i = 0; i < n; i++)
+		out[i] = in1[i] / (in2[i] + VDIVIDE_TOL);
+	    break;
+	case OPS_SATURATE: {
+	    double rwgt = 0.31*(1.0-val);
+	    double gwgt = 0.61*(1.0-val);
+	    double bwgt = 0.08*(1.0-val);
+
+	    for (i = 0; i + 2 < n; i += 3) {
+		double rt = out[i];
+		double gt = out[i+1];
+		double bt = out[i+2];
+		double bw = (rwgt*rt + gwgt*gt + bwgt*bt);	/* monochrome intensity */
+		out[i] = bw + val*rt;
+		out[i+1] = bw + val*gt;
+		out[i+2] = bw + val*bt;
+	    }
+	    break; }
+    }
+}
+
+
+static void
+ops_run(enum ops_op op, icv_image_t *out, const icv_image_t *img1, const icv_image_t *img2, double val)
 {
-    double *data = NULL;
-    size_t size;
+    struct ops_state os;
+
+    os.op = op;
+    os.out = out->data;
+    os.in1 = img1 ? img1->data : out->data;
+    os.in2 = img2 ? img2->data : NULL;
+    os.val = val;
+    os.rowlen = out->width*out->channels;
 
+    tile_rows(out->height, os.rowlen, ops_rows, &os);
+}
+
+
+int icv_sanitize(icv_image_t* img)
+{
     ICV_IMAGE_VAL_INT(img);
 
-    data= img->data;
-    for (size = img->width*img->height*img->channels; size>0; size--) {
-	if (*data>1.0)
-	    *data = 1.0;
-	else if (*data<0)
-	    *data = 0;
-	data++;
-    }
+    ops_run(OPS_SANITIZE, img, NULL, NULL, 0.0);
     img->flags |= ICV_SANITIZED;
     return 0;
 }
 
 int icv_add_val(icv_image_t* img, double val)
 {
-    double *data = NULL;
-    size_t size;
-
-    data = img->data;
-
     ICV_IMAGE_VAL_INT(img);
 
-    for (size = img->width*img->height*img->channels; size>0; size--) {
-	*data += val;
-	data++;
-    }
+    ops_run(OPS_ADD_VAL, img, NULL, NULL, val);
 
     if (img->flags & ICV_OPERATIONS_MODE)
 	img->flags&=(!ICV_SANITIZED);
@@ -80,17 +178,9 @@ int icv_add_val(icv_image_t* img, double val)
 
 int icv_multiply_val(icv_image_t* img, double val)
 {
-    double *data = NULL;
-    size_t size;
-
     ICV_IMAGE_VAL_INT(img);
 
-    data = img->data;
-
-    for (size = img->width*img->height*img->channels; size>0; size--) {
-	*data *= val;
-	 data++;
-    }
+    ops_run(OPS_MULTIPLY_VAL, img, NULL, NULL, val);
     if ((img->flags & ICV_OPERATIONS_MODE))
 	img->flags&=(!ICV_SANITIZED);
     else
@@ -101,19 +191,9 @@ int icv_multiply_val(icv_image_t* img, double val)
 
 int icv_divide_val(icv_image_t* img, double val)
 {
-    double *data = NULL;
-    size_t size;
-
     ICV_IMAGE_VAL_INT(img);
 
-    data = img->data;
-
-    /* Since data is double dividing by 0 will result in INF and -INF */
-
-    for (size = img->width*img->height*img->channels; size>0; size--) {
-	*data /= val;
-	 data++;
-     }
+    ops_run(OPS_DIVIDE_VAL, img, NULL, NULL, val);
 
     if ((img->flags & ICV_OPERATIONS_MODE))
 	img->flags&=(!ICV_SANITIZED);
@@ -125,17 +205,9 @@ int icv_divide_val(icv_image_t* img, double val)
 
 int icv_pow_val(icv_image_t* img, double val)
 {
-    double *data = NULL;
-    size_t size;
-
     ICV_IMAGE_VAL_INT(img);
 
-    data = img->data;
-
-    for (size = img->width*img->height*img->channels; size>0; size--) {
-	*data = pow(*data,val);
-	 data++;
-    }
+    ops_run(OPS_POW_VAL, img, NULL, NULL, val);
 
     if ((img->flags & ICV_OPERATIONS_MODE))
 	img->flags&=(!ICV_SANITIZED);
@@ -147,8 +219,6 @@ int icv_pow_val(icv_image_t* img, double val)
 
 icv_image_t *icv_add(icv_image_t *img1, icv_image_t *img2)
 {
-    double *data1, *data2, *out_data;
-    size_t size;
     icv_image_t *out_img;
 
     ICV_IMAGE_VAL_PTR(img1);
@@ -159,15 +229,9 @@ icv_image_t *icv_add(icv_image_t *img1, icv_image_t *img2)
 	return NULL;
     }
 
-    data1 =img1->data;
-    data2 =img2->data;
-
     out_img = icv_create(img1->width, img1->height, img1->color_space);
 
-    out_data = out_img->data;
-
-    for (size = img1->width*img1->height*img1->channels; size>0; size--)
-	*out_data++ = *data1++ + *data2++;
+    ops_run(OPS_ADD, out_img, img1, img2, 0.0);
 
     icv_sanitize(out_img);
 
@@ -176,8 +240,6 @@ icv_image_t *icv_add(icv_image_t *img1, icv_image_t *img2)
 
 icv_image_t *icv_sub(icv_image_t *img1, icv_image_t *img2)
 {
-    double *data1, *data2, *out_data;
-    size_t size;
     icv_image_t *out_img;
 
     ICV_IMAGE_VAL_PTR(img1);
@@ -188,15 +250,9 @@ icv_image_t *icv_sub(icv_image_t *img1, icv_image_t *img2)
 	return NULL;
     }
 
-    data1 =img1->data;
-    data2 =img2->data;
-
     out_img = icv_create(img1->width, img1->height, img1->color_space);
 
-    out_data = out_img->data;
-
-    for (size = img1->width*img1->height*img1->channels; size>0; size--)
-	*out_data++ = *data1++ - *data2++;
+    ops_run(OPS_SUB, out_img, img1, img2, 0.0);
 
     icv_sanitize(out_img);
 
@@ -205,8 +261,6 @@ icv_image_t *icv_sub(icv_image_t *img1, icv_image_t *img2)
 
 icv_image_t *icv_multiply(icv_image_t *img1, icv_image_t *img2)
 {
-    double *data1, *data2, *out_data;
-    size_t size;
     icv_image_t *out_img;
 
     ICV_IMAGE_VAL_PTR(img1);
@@ -217,15 +271,9 @@ icv_image_t *icv_multiply(icv_image_t *img1, icv_image_t *img2)
 	return NULL;
     }
 
-    data1 =img1->data;
-    data2 =img2->data;
-
     out_img = icv_create(img1->width, img1->height, img1->color_space);
 
-    out_data = out_img->data;
-
-    for (size = img1->width*img1->height*img1->channels; size>0; size--)
-	*out_data++ = *data1++ * *data2++;
+    ops_run(OPS_MULTIPLY, out_img, img1, img2, 0.0);
 
     icv_sanitize(out_img);
 
@@ -235,8 +283,6 @@ icv_image_t *icv_multiply(icv_image_t *img1, icv_image_t *img2)
 
 icv_image_t *icv_divide(icv_image_t *img1, icv_image_t *img2)
 {
-    double *data1, *data2, *out_data;
-    size_t size;
     icv_image_t *out_img;
 
     ICV_IMAGE_VAL_PTR(img1);
@@ -247,15 +293,9 @@ icv_image_t *icv_divide(icv_image_t *img1, icv_image_t *img2)
 	return NULL;
     }
 
-    data1 =img1->data;
-    data2 =img2->data;
-
     out_img = icv_create(img1->width, img1->height, img1->color_space);
 
-    out_data = out_img->data;
-
-    for (size = img1->width*img1->height*img1->channels; size>0; size--)
-	*out_data++ = *data1++ / (*data2++ + VDIVIDE_TOL);
+    ops_run(OPS_DIVIDE, out_img, img1, img2, 0.0);
 
     icv_sanitize(out_img);
 
@@ -264,12 +304,6 @@ icv_image_t *icv_divide(icv_image_t *img1, icv_image_t *img2)
 
 int icv_saturate(icv_image_t* img, double sat)
 {
-    double *data;
-    double bw;			/* monochrome intensity */
-    double rwgt, gwgt, bwgt;
-    double rt, gt, bt;
-    size_t size;
-
     ICV_IMAGE_VAL_INT(img);
 
     if (img == NULL) {
@@ -282,23 +316,7 @@ int icv_saturate(icv_image_t* img, double sat)
 	return -1;
     }
 
-    data = img->data;
-    size = img->width*img->height;
-    rwgt = 0.31*(1.0-sat);
-    gwgt = 0.61*(1.0-sat);
-    bwgt = 0.08*(1.0-sat);
-    while (size-- > 0) {
-	rt = *data;
-	gt = *(data+1);
-	bt = *(data+2);
-	bw = (rwgt*rt + gwgt*gt + bwgt*bt);
-	rt = bw + sat*rt;
-	gt = bw + sat*gt;
-	bt = bw + sat*bt;
-	*data++ = rt;
-	*data++ = gt;
-	*data++ = bt;
-    }
+    ops_run(OPS_SATURATE, img, NULL, NULL, sat);
     icv_sanitize(img);
     return 0;
 }
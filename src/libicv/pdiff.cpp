@@ -106,6 +106,57 @@ icv_pdiff(icv_image_t *img1, icv_image_t *img2)
     return hasher->hamming_distance(hash1, hash2);
 }
 
+/* Feed a mapped PIX file to prep a row at a time, top row first,
+ * straight out of the mapping.
+ */
+static void
+load_mapped(const icv_mapped_image_t *mimg, imghash::Preprocess *prep)
+{
+    prep->start(mimg->height, mimg->width, 3);
+    for (size_t i = 0; i < mimg->height; i++) {
+	if (!prep->add_row(icv_mapped_row(mimg, mimg->height - 1 - i)))
+	    break;
+    }
+}
+
+
+extern "C" uint32_t
+icv_mapped_pdiff(const icv_mapped_image_t *mimg1, const icv_mapped_image_t *mimg2)
+{
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg1) || !ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg2))
+	return -1;
+
+    if (mimg1->channels != 3 || mimg2->channels != 3) {
+	bu_log("icv_mapped_pdiff : only RGB images can be compared\n");
+	return -1;
+    }
+
+    std::unique_ptr<imghash::Hasher> hasher;
+    int dct_size = 4; // 1024 bits
+    hasher = std::make_unique<imghash::DCTHasher>(8 * dct_size, true);
+
+    /* the working image is d x d floats, which is what would
+     * otherwise exhaust memory on a large render */
+    size_t d1 = (mimg1->width < mimg1->height) ? mimg1->width : mimg1->height;
+    if (d1 > ICV_PDIFF_MAPPED_SIZE)
+	d1 = ICV_PDIFF_MAPPED_SIZE;
+    imghash::Preprocess prep1(d1, d1);
+    load_mapped(mimg1, &prep1);
+    imghash::Image<float> pimg1 = prep1.stop();
+
+    size_t d2 = (mimg2->width < mimg2->height) ? mimg2->width : mimg2->height;
+    if (d2 > ICV_PDIFF_MAPPED_SIZE)
+	d2 = ICV_PDIFF_MAPPED_SIZE;
+    imghash::Preprocess prep2(d2, d2);
+    load_mapped(mimg2, &prep2);
+    imghash::Image<float> pimg2 = prep2.stop();
+
+    auto hash1 = hasher->apply(pimg1);
+    auto hash2 = hasher->apply(pimg2);
+
+    return hasher->hamming_distance(hash1, hash2);
+}
+
 /*
  * Local Variables:
  * tab-width: 8
@@ -38,6 +38,7 @@
 #include "bu/mime.h"
 #include "bu/str.h"
 #include "bu/units.h"
+#include "icv_private.h"
 
 
 struct xy_size {
@@ -291,205 +292,316 @@ icv_image_size(const char *name, size_t udpi, size_t file_size, bu_mime_image_t
     return      0;
 }
 
-static int
-shrink_image(icv_image_t* bif, size_t factor)
+/* Every resize method writes a fresh output buffer one row at a
+ * time, so they all go through tile_rows() with this.  The input is
+ * either an icv_image or a mapped file; in the latter case rows are
+ * converted on demand into a per-band scratch buffer.
+ */
+struct size_state {
+    const icv_image_t *bif;
+    const icv_mapped_image_t *mimg;
+    size_t in_width, in_height, channels;
+    double *out_data;
+    size_t out_width, out_height;
+    size_t factor;
+    double xstep, ystep;
+    void (*row)(const struct size_state *ss, size_t j, double *out_p, double *scratch);
+};
+
+
+/* returns input row y, converting it into scratch if it is mapped */
+static const double *
+size_in_row(const struct size_state *ss, size_t y, double *scratch)
 {
-    double *data_p, *res_p; /**< input and output pointers */
-    double *p;
-    size_t facsq, py, px;
-    size_t x, y, c;
-    size_t widthstep =  bif->width*bif->channels;
-    if (UNLIKELY(factor < 1)) {
-	bu_log("Cannot shrink image to 0 factor, factor should be a positive value.");
-	return -1;
-    }
+    size_t rowlen = ss->in_width*ss->channels;
+    const unsigned char *in;
+    size_t i;
 
-    facsq = factor*factor;
-    res_p = bif->data;
-    p = (double *)bu_malloc(bif->channels*sizeof(double), "shrink_image : Pixel Values Temp Buffer");
+    if (ss->bif)
+	return ss->bif->data + y*rowlen;
 
-    for (y = 0; y < bif->height; y += factor)
-	for (x = 0; x < bif->width; x += factor) {
+    in = icv_mapped_row(ss->mimg, y);
+    for (i = 0; i < rowlen; i++)
+	scratch[i] = ICV_CONV_8BIT(in[i]);
+    return scratch;
+}
 
-	    for (c = 0; c < bif->channels; c++) {
-		p[c]= 0;
-	    }
 
-	    for (py = 0; py < factor; py++) {
-		data_p = bif->data + (y+py)*widthstep;
-		for (px = 0; px < factor; px++) {
-		    for (c = 0; c < bif->channels; c++) {
-			p[c] += *data_p++;
-		    }
-		}
-	    }
+static void
+size_rows(size_t start, size_t end, void *data)
+{
+    const struct size_state *ss = (const struct size_state *)data;
+    size_t rowlen = ss->out_width*ss->channels;
+    double *scratch = NULL;
+    size_t j;
 
-	    for (c = 0; c < bif->channels; c++)
-		*res_p++ = p[c]/facsq;
-	}
+    /* binterp_row() needs two input rows at once */
+    if (ss->mimg)
+	scratch = (double *)bu_malloc(2*ss->in_width*ss->channels*sizeof(double), "size_rows scratch");
 
-    bif->width = (int)bif->width/factor;
-    bif->height = (int)bif->height/factor;
-    bif->data = (double *)bu_realloc(bif->data, (size_t)(bif->width*bif->height*bif->channels)*sizeof(double), "shrink_image : Reallocation");
+    for (j = start; j < end; j++)
+	ss->row(ss, j, ss->out_data + j*rowlen, scratch);
 
-    return 0;
+    if (scratch)
+	bu_free(scratch, "size_rows scratch");
+}
+
+
+static void
+shrink_row(const struct size_state *ss, size_t j, double *res_p, double *scratch)
+{
+    size_t factor = ss->factor;
+    size_t facsq = factor*factor;
+    size_t rowlen = ss->out_width*ss->channels;
+    const double *data_p;
+    double *r;
+    size_t py, px, i, c;
+
+    for (i = 0; i < rowlen; i++)
+	res_p[i] = 0;
+
+    /* one input row at a time, summing in the same order as a
+     * pixel-by-pixel walk of each factor x factor block */
+    for (py = 0; py < factor; py++) {
+	data_p = size_in_row(ss, j*factor+py, scratch);
+	r = res_p;
+	for (i = 0; i < ss->out_width; i++) {
+	    for (px = 0; px < factor; px++) {
+		for (c = 0; c < ss->channels; c++) {
+		    r[c] += *data_p++;
+		}
+	    }
+	    r += ss->channels;
+	}
+    }
 
+    for (i = 0; i < rowlen; i++)
+	res_p[i] /= facsq;
 }
 
 
 static int
-under_sample(icv_image_t* bif, size_t factor)
+shrink_image(struct size_state *ss, size_t factor)
 {
-    double *data_p, *res_p;
-    size_t x, y, widthstep;
-
     if (UNLIKELY(factor < 1)) {
 	bu_log("Cannot shrink image to 0 factor, factor should be a positive value.");
 	return -1;
     }
-
-    widthstep = bif->width*bif->channels;
-    res_p = bif->data;
-
-    for (y = 0; y < bif->height; y += factor) {
-	data_p = bif->data + widthstep*y;
-	for (x = 0; x < bif->width;
-	     x += factor, res_p += bif->channels, data_p += factor * bif->channels)
-	    VMOVEN(res_p, data_p, bif->channels);
+    if (UNLIKELY(factor > ss->in_width || factor > ss->in_height)) {
+	bu_log("Cannot shrink image by a factor larger than the image.");
+	return -1;
     }
 
-    bif->width = (int)bif->width/factor;
-    bif->height = (int)bif->height/factor;
-    bif->data = (double *)bu_realloc(bif->data, (size_t)(bif->width*bif->height*bif->channels)*sizeof(double), "under_sample : Reallocation");
+    ss->factor = factor;
+    ss->row = shrink_row;
+    ss->out_width = ss->in_width/factor;
+    ss->out_height = ss->in_height/factor;
 
     return 0;
+
 }
 
 
-static int
-ninterp(icv_image_t* bif, size_t out_width, size_t out_height)
+static void
+under_sample_row(const struct size_state *ss, size_t j, double *res_p, double *scratch)
 {
-    double xstep, ystep;
-    size_t i, j;
-    size_t x, y;
-    size_t widthstep;
-    double *in_r, *in_c; /* Pointer to row and col of input buffers */
-    double *out_data, *out_p;
-    xstep = (double)(bif->width-1) / (double)(out_width) - 1.0e-06;
-    ystep = (double)(bif->height-1) / (double)(out_height) - 1.0e-06;
+    const double *data_p = size_in_row(ss, j*ss->factor, scratch);
+    size_t i;
 
-    if ((xstep < 1.0 && ystep > 1.0) || (xstep > 1.0 && ystep < 1.0)) {
-	bu_log("Operation unsupported.  Cannot stretch one dimension while compressing the other.\n");
+    for (i = 0; i < ss->out_width;
+	 i++, res_p += ss->channels, data_p += ss->factor * ss->channels)
+	VMOVEN(res_p, data_p, ss->channels);
+}
+
+
+static int
+under_sample(struct size_state *ss, size_t factor)
+{
+    if (UNLIKELY(factor < 1)) {
+	bu_log("Cannot shrink image to 0 factor, factor should be a positive value.");
 	return -1;
     }
+    if (UNLIKELY(factor > ss->in_width || factor > ss->in_height)) {
+	bu_log("Cannot shrink image by a factor larger than the image.");
+	return -1;
+    }
+
+    ss->factor = factor;
+    ss->row = under_sample_row;
+    ss->out_width = ss->in_width/factor;
+    ss->out_height = ss->in_height/factor;
+
+    return 0;
+}
 
-    out_p = out_data = (double *)bu_malloc(out_width*out_height*bif->channels*sizeof(double), "ninterp : out_data");
 
-    widthstep= bif->width*bif->channels;
+static void
+ninterp_row(const struct size_state *ss, size_t j, double *out_p, double *scratch)
+{
+    size_t i;
+    size_t x, y;
+    const double *in_r, *in_c; /* Pointer to row and col of input buffers */
 
-    for (j = 0; j < out_height; j++) {
-	y = (int)(j*ystep);
-	in_r = bif->data + y*widthstep;
+    y = (int)(j*ss->ystep);
+    in_r = size_in_row(ss, y, scratch);
 
-	for (i = 0; i < out_width; i++) {
-	    x = (int)(i*xstep);
+    for (i = 0; i < ss->out_width; i++) {
+	x = (int)(i*ss->xstep);
 
-	    in_c = in_r + x*bif->channels;
+	in_c = in_r + x*ss->channels;
 
-	    VMOVEN(out_p, in_c, bif->channels);
-	    out_p += bif->channels;
-	}
+	VMOVEN(out_p, in_c, ss->channels);
+	out_p += ss->channels;
     }
+}
+
 
-    bu_free(bif->data, "ninterp : in_data");
+static int
+ninterp(struct size_state *ss, size_t out_width, size_t out_height)
+{
+    ss->xstep = (double)(ss->in_width-1) / (double)(out_width) - 1.0e-06;
+    ss->ystep = (double)(ss->in_height-1) / (double)(out_height) - 1.0e-06;
 
-    bif->data = out_data;
+    if ((ss->xstep < 1.0 && ss->ystep > 1.0) || (ss->xstep > 1.0 && ss->ystep < 1.0)) {
+	bu_log("Operation unsupported.  Cannot stretch one dimension while compressing the other.\n");
+	return -1;
+    }
 
-    bif->width = out_width;
-    bif->height = out_height;
+    ss->row = ninterp_row;
+    ss->out_width = out_width;
+    ss->out_height = out_height;
 
     return 0;
 
 }
 
 
-static int
-binterp(icv_image_t *bif, size_t out_width, size_t out_height)
+static void
+binterp_row(const struct size_state *ss, size_t j, double *out_p, double *scratch)
 {
-    size_t i, j;
+    size_t i;
     size_t c;
     double x, y, dx, dy, mid1, mid2;
-    double xstep, ystep;
-    double *out_data, *out_p;
-    double *upp_r, *low_r; /* upper and lower row */
-    double *upp_c, *low_c;
-    size_t widthstep;
-
-    xstep = (double)(bif->width - 1) / (double)out_width - 1.0e-6;
-    ystep = (double)(bif->height -1) / (double)out_height - 1.0e-6;
+    const double *upp_r, *low_r; /* upper and lower row */
+    const double *upp_c, *low_c;
 
-    if ((xstep < 1.0 && ystep > 1.0) || (xstep > 1.0 && ystep < 1.0)) {
-	bu_log("Operation unsupported.  Cannot stretch one dimension while compressing the other.\n");
-	return -1;
-    }
+    y = j*ss->ystep;
+    dy = y - (int)y;
 
-    out_p = out_data = (double *)bu_malloc(out_width*out_height*bif->channels*sizeof(double), "binterp : out data");
+    low_r = size_in_row(ss, (size_t)(int)y, scratch);
+    upp_r = size_in_row(ss, (size_t)(int)(y+1), scratch ? scratch + ss->in_width*ss->channels : NULL);
 
-    widthstep = bif->width*bif->channels;
+    for (i = 0; i < ss->out_width; i++) {
+	x = i*ss->xstep;
+	dx = x - (int)x;
 
-    for (j = 0; j < out_height; j++) {
-	y = j*ystep;
-	dy = y - (int)y;
+	upp_c = upp_r + (int)x*ss->channels;
+	low_c = low_r + (int)x*ss->channels;
 
-	low_r = bif->data + widthstep* (int)y;
-	upp_r = bif->data + widthstep* (int)(y+1);
+	for (c = 0; c < ss->channels; c++) {
+	    mid1 = low_c[0] + dx * ((double)low_c[ss->channels] - (double)low_c[0]);
+	    mid2 = upp_c[0] + dx * ((double)upp_c[ss->channels] - (double)upp_c[0]);
+	    *out_p = mid1 + dy * (mid2 - mid1);
 
-	for (i = 0; i < out_width; i++) {
-	    x = i*xstep;
-	    dx = x - (int)x;
+	    out_p++;
+	    upp_c++;
+	    low_c++;
+	}
+    }
+}
 
-	    upp_c = upp_r + (int)x*bif->channels;
-	    low_c = low_r + (int)x*bif->channels;
 
-	    for (c = 0; c < bif->channels; c++) {
-		mid1 = low_c[0] + dx * ((double)low_c[bif->channels] - (double)low_c[0]);
-		mid2 = upp_c[0] + dx * ((double)upp_c[bif->channels] - (double)upp_c[0]);
-		*out_p = mid1 + dy * (mid2 - mid1);
+static int
+binterp(struct size_state *ss, size_t out_width, size_t out_height)
+{
+    ss->xstep = (double)(ss->in_width - 1) / (double)out_width - 1.0e-6;
+    ss->ystep = (double)(ss->in_height -1) / (double)out_height - 1.0e-6;
 
-		out_p++;
-		upp_c++;
-		low_c++;
-	    }
-	}
+    if ((ss->xstep < 1.0 && ss->ystep > 1.0) || (ss->xstep > 1.0 && ss->ystep < 1.0)) {
+	bu_log("Operation unsupported.  Cannot stretch one dimension while compressing the other.\n");
+	return -1;
     }
-    bu_free(bif->data, "binterp : Input Data");
-    bif->data = out_data;
-    bif->width = out_width;
-    bif->height = out_height;
+
+    ss->row = binterp_row;
+    ss->out_width = out_width;
+    ss->out_height = out_height;
+
     return 0;
 
 }
 
 
-int
-icv_resize(icv_image_t *bif, ICV_RESIZE_METHOD method, size_t out_width, size_t out_height, size_t factor)
+/* Picks the row function and output size for a method, after the
+ * input fields of ss have been filled in.
+ */
+static int
+size_setup(struct size_state *ss, ICV_RESIZE_METHOD method, size_t out_width, size_t out_height, size_t factor)
 {
-    ICV_IMAGE_VAL_INT(bif);
-
     switch (method) {
 	case ICV_RESIZE_UNDERSAMPLE :
-	    return under_sample(bif, factor);
+	    return under_sample(ss, factor);
 	case ICV_RESIZE_SHRINK :
-	    return shrink_image(bif, factor);
+	    return shrink_image(ss, factor);
 	case ICV_RESIZE_NINTERP :
-	    return ninterp(bif, out_width, out_height);
+	    return ninterp(ss, out_width, out_height);
 	case ICV_RESIZE_BINTERP :
-	    return binterp(bif, out_width, out_height);
+	    return binterp(ss, out_width, out_height);
 	default :
 	    bu_log("icv_resize : Invalid Option to resize");
 	    return -1;
     }
+}
+
+
+int
+icv_resize(icv_image_t *bif, ICV_RESIZE_METHOD method, size_t out_width, size_t out_height, size_t factor)
+{
+    struct size_state ss;
+
+    ICV_IMAGE_VAL_INT(bif);
+
+    ss.bif = bif;
+    ss.mimg = NULL;
+    ss.in_width = bif->width;
+    ss.in_height = bif->height;
+    ss.channels = bif->channels;
+    if (size_setup(&ss, method, out_width, out_height, factor) < 0)
+	return -1;
+
+    ss.out_data = (double *)bu_malloc(ss.out_width*ss.out_height*ss.channels*sizeof(double), "icv_resize");
+    tile_rows(ss.out_height, ss.out_width*ss.channels, size_rows, &ss);
+
+    bu_free(bif->data, "icv_resize");
+    bif->data = ss.out_data;
+    bif->width = ss.out_width;
+    bif->height = ss.out_height;
+
+    return 0;
+}
+
+
+icv_image_t *
+icv_mapped_resize(const icv_mapped_image_t *mimg, ICV_RESIZE_METHOD method, size_t out_width, size_t out_height, size_t factor)
+{
+    struct size_state ss;
+    icv_image_t *out;
+
+    if (!ICV_MAPPED_IMAGE_IS_INITIALIZED(mimg))
+	return NULL;
+
+    ss.bif = NULL;
+    ss.mimg = mimg;
+    ss.in_width = mimg->width;
+    ss.in_height = mimg->height;
+    ss.channels = mimg->channels;
+    if (size_setup(&ss, method, out_width, out_height, factor) < 0)
+	return NULL;
+
+    out = icv_create(ss.out_width, ss.out_height, mimg->color_space);
+    ss.out_data = out->data;
+    tile_rows(ss.out_height, ss.out_width*ss.channels, size_rows, &ss);
 
+    return out;
 }
 
 
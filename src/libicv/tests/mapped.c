@@ -0,0 +1,157 @@
+/*                        M A P P E D . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file mapped.c
+ *
+ * Check that the mapped image routines agree with their in-memory
+ * counterparts on a generated PIX file.  The image and the results
+ * are large enough for tile_rows() to split the work across threads.
+ *
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bu/app.h"
+#include "bu/exit.h"
+#include "bu/file.h"
+#include "bu/log.h"
+#include "bu/malloc.h"
+#include "icv.h"
+
+#define TEST_WIDTH 601
+#define TEST_HEIGHT 457
+#define TEST_FILE1 "icv_mapped_1.pix"
+#define TEST_FILE2 "icv_mapped_2.pix"
+
+
+static int
+write_pix(const char *name, const unsigned char *data, size_t len)
+{
+    FILE *fp = fopen(name, "wb");
+
+    if (!fp)
+	return -1;
+    if (fwrite(data, 1, len, fp) != len) {
+	fclose(fp);
+	return -1;
+    }
+    return fclose(fp);
+}
+
+
+int
+main(int UNUSED(argc), char *argv[])
+{
+    size_t len = TEST_WIDTH * TEST_HEIGHT * 3;
+    unsigned char *d1, *d2;
+    icv_mapped_image_t *m1, *m2;
+    icv_image_t *bif, *out;
+    int matching = 0, off_by_1 = 0, off_by_many = 0;
+    int method;
+    size_t i;
+    int ret = 0;
+
+    bu_setprogname(argv[0]);
+
+    d1 = (unsigned char *)bu_malloc(len, "d1");
+    d2 = (unsigned char *)bu_malloc(len, "d2");
+    srand(3);
+    for (i = 0; i < len; i++)
+	d1[i] = d2[i] = (unsigned char)(rand() & 0xff);
+    d2[5] ^= 1;
+    d2[300] ^= 1;
+    d2[301] ^= 1;
+    d2[len / 2] ^= 8;
+    d2[len - 1] ^= 4;
+
+    if (write_pix(TEST_FILE1, d1, len) || write_pix(TEST_FILE2, d2, len))
+	bu_exit(1, "ERROR: unable to write test images\n");
+
+    m1 = icv_map(TEST_FILE1, BU_MIME_IMAGE_PIX, TEST_WIDTH, TEST_HEIGHT);
+    m2 = icv_map(TEST_FILE2, BU_MIME_IMAGE_PIX, TEST_WIDTH, TEST_HEIGHT);
+    if (!m1 || !m2)
+	bu_exit(1, "ERROR: icv_map failed\n");
+
+    /* each resize method gives the same result either way */
+    for (method = ICV_RESIZE_UNDERSAMPLE; method <= ICV_RESIZE_BINTERP; method++) {
+	size_t ow = (method == ICV_RESIZE_NINTERP || method == ICV_RESIZE_BINTERP) ? 400 : 0;
+	size_t oh = ow ? 300 : 0;
+
+	bif = icv_read(TEST_FILE1, BU_MIME_IMAGE_PIX, TEST_WIDTH, TEST_HEIGHT);
+	if (!bif || icv_resize(bif, (ICV_RESIZE_METHOD)method, ow, oh, 3) < 0)
+	    bu_exit(1, "ERROR: icv_resize method %d failed\n", method);
+	out = icv_mapped_resize(m1, (ICV_RESIZE_METHOD)method, ow, oh, 3);
+	if (!out || out->width != bif->width || out->height != bif->height
+	    || memcmp(out->data, bif->data, bif->width * bif->height * 3 * sizeof(double))) {
+	    bu_log("icv_mapped_resize method %d differs from icv_resize\n", method);
+	    ret = 1;
+	}
+	icv_destroy(bif);
+	if (out)
+	    icv_destroy(out);
+    }
+
+    bif = icv_read(TEST_FILE1, BU_MIME_IMAGE_PIX, TEST_WIDTH, TEST_HEIGHT);
+    icv_rect(bif, 10, 20, 500, 400);
+    out = icv_mapped_rect(m1, 10, 20, 500, 400);
+    if (!out || memcmp(out->data, bif->data, 500 * 400 * 3 * sizeof(double))) {
+	bu_log("icv_mapped_rect differs from icv_rect\n");
+	ret = 1;
+    }
+    icv_destroy(bif);
+    if (out)
+	icv_destroy(out);
+
+    if (icv_mapped_diff(&matching, &off_by_1, &off_by_many, m1, m2) != 1
+	|| matching != TEST_WIDTH * TEST_HEIGHT - 4 || off_by_1 != 2 || off_by_many != 2) {
+	bu_log("icv_mapped_diff: matching %d, off by 1 %d, off by many %d\n", matching, off_by_1, off_by_many);
+	ret = 1;
+    }
+    if (icv_mapped_diff(NULL, NULL, NULL, m1, m1) != 0) {
+	bu_log("icv_mapped_diff reports differences between identical images\n");
+	ret = 1;
+    }
+    if (icv_mapped_pdiff(m1, m1) != 0) {
+	bu_log("icv_mapped_pdiff reports differences between identical images\n");
+	ret = 1;
+    }
+
+    icv_unmap(m1);
+    icv_unmap(m2);
+    bu_file_delete(TEST_FILE1);
+    bu_file_delete(TEST_FILE2);
+    bu_free(d1, "d1");
+    bu_free(d2, "d2");
+
+    return ret;
+}
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
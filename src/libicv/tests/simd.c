@@ -0,0 +1,397 @@
+/*                          S I M D . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file simd.c
+ *
+ * Run the filters with ICV_SCALAR_KERNELS, with the default (AVX2
+ * where the CPU has it) loops and with ICV_FLOAT_KERNELS on images of
+ * odd widths and heights.  Check the three against each other and
+ * against a plain zero padded convolution.  Also check icv_filter3()
+ * frame handling, unknown filter types, and the shrink and
+ * undersample resizes on sizes the factor does not divide.
+ *
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bu/app.h"
+#include "bu/log.h"
+#include "bu/malloc.h"
+#include "bu/simd.h"
+#include "icv.h"
+
+/* the reference sums in a different order */
+#define REF_TOL 1.0e-12
+#define FLOAT_TOL 1.0e-5
+
+struct test_size {
+    size_t width, height;
+};
+
+/* one pixel, less than a kernel, prime sizes, several 512 sample
+ * spans per row, and one large enough to be split into row bands */
+static const struct test_size sizes[] = {
+    {1, 1}, {2, 3}, {7, 5}, {37, 23}, {601, 3}, {3, 257}, {301, 293}, {0, 0}
+};
+
+static const ICV_FILTER filters[] = {
+    ICV_FILTER_LOW_PASS, ICV_FILTER_LAPLACIAN, ICV_FILTER_HORIZONTAL_GRAD,
+    ICV_FILTER_VERTICAL_GRAD, ICV_FILTER_HIGH_PASS, ICV_FILTER_NULL,
+    ICV_FILTER_BOXCAR_AVERAGE
+};
+
+/* kernels checked against the reference convolution; the gradient is
+ * lopsided, so misplaced taps show up */
+static const double hgrad_kern[9] = {
+    1.0/6.0, 0, -1.0/6.0,
+    1.0/6.0, 0, -1.0/6.0,
+    1.0/6.0, 0, -1.0/6.0
+};
+
+static const double laplacian_kern[9] = {
+    -1.0/16.0, -1.0/16.0, -1.0/16.0,
+    -1.0/16.0, 8.0/16.0, -1.0/16.0,
+    -1.0/16.0, -1.0/16.0, -1.0/16.0
+};
+
+/* the new frame weighs differently from the other two */
+static const double smear_kern[27] = {
+    1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69,
+    1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69, 1.0/69,
+    2.0/69, 2.0/69, 2.0/69, 2.0/69, 35.0/69, 2.0/69, 2.0/69, 2.0/69, 2.0/69
+};
+
+
+static icv_image_t *
+random_image(size_t width, size_t height, ICV_COLOR_SPACE color_space)
+{
+    icv_image_t *img = icv_create(width, height, color_space);
+    size_t i, n = width * height * img->channels;
+
+    for (i = 0; i < n; i++)
+	img->data[i] = (double)(rand() & 0xff) / 255.0;
+    return img;
+}
+
+
+static icv_image_t *
+copy_image(const icv_image_t *img, uint16_t flags)
+{
+    icv_image_t *out = icv_create(img->width, img->height, img->color_space);
+
+    memcpy(out->data, img->data, img->width * img->height * img->channels * sizeof(double));
+    out->flags |= flags;
+    return out;
+}
+
+
+/* sample c of pixel (x, y), zero off the edges */
+static double
+sample(const icv_image_t *img, long x, long y, size_t c)
+{
+    if (x < 0 || y < 0 || x >= (long)img->width || y >= (long)img->height)
+	return 0.0;
+    return img->data[(y * img->width + x) * img->channels + c];
+}
+
+
+static double *
+reference_filter(const icv_image_t **frames, size_t nframes, const double *kern, double offset)
+{
+    const icv_image_t *img = frames[0];
+    size_t n = img->width * img->height * img->channels;
+    double *out = (double *)bu_malloc(n * sizeof(double), "reference");
+    size_t f, x, y, c;
+    long kx, ky;
+
+    for (y = 0; y < img->height; y++) {
+	for (x = 0; x < img->width; x++) {
+	    for (c = 0; c < img->channels; c++) {
+		double sum = offset;
+		for (f = 0; f < nframes; f++)
+		    for (ky = 0; ky < 3; ky++)
+			for (kx = 0; kx < 3; kx++)
+			    sum += kern[(f * 3 + ky) * 3 + kx]
+				* sample(frames[f], (long)x + kx - 1, (long)y + ky - 1, c);
+		out[(y * img->width + x) * img->channels + c] = sum;
+	    }
+	}
+    }
+    return out;
+}
+
+
+static int
+compare(const char *what, const icv_image_t *img, const double *expect, size_t width, size_t height, double tol)
+{
+    size_t i, n = width * height * img->channels;
+
+    if (img->width != width || img->height != height) {
+	bu_log("%s: got %zux%zu, expected %zux%zu\n", what, img->width, img->height, width, height);
+	return 1;
+    }
+    for (i = 0; i < n; i++) {
+	if (!(fabs(img->data[i] - expect[i]) <= tol)) {
+	    bu_log("%s: sample %zu (pixel %zu,%zu) is %.17g, expected %.17g\n", what, i,
+		   (i / img->channels) % width, (i / img->channels) / width, img->data[i], expect[i]);
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+
+static int
+test_filters(size_t width, size_t height, ICV_COLOR_SPACE color_space)
+{
+    icv_image_t *img = random_image(width, height, color_space);
+    const icv_image_t *frames[1];
+    char what[128];
+    size_t i;
+    int ret = 0;
+
+    frames[0] = img;
+
+    for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+	icv_image_t *scalar = copy_image(img, ICV_SCALAR_KERNELS);
+	icv_image_t *simd = copy_image(img, 0);
+	icv_image_t *sfloat = copy_image(img, ICV_FLOAT_KERNELS);
+	const double *kern = NULL;
+	double offset = 0.5;
+	double *ref = NULL;
+
+	snprintf(what, sizeof(what), "filter %d, %zux%zux%zu", (int)filters[i], width, height, img->channels);
+
+	if (icv_filter(scalar, filters[i]) < 0 || icv_filter(simd, filters[i]) < 0
+	    || icv_filter(sfloat, filters[i]) < 0) {
+	    bu_log("%s: icv_filter failed\n", what);
+	    ret = 1;
+	    goto next;
+	}
+
+	/* the AVX2 double loops add in the same order, so these match exactly */
+	ret += compare(what, simd, scalar->data, width, height, 0.0);
+	ret += compare(what, sfloat, scalar->data, width, height, FLOAT_TOL);
+
+	if (filters[i] == ICV_FILTER_HORIZONTAL_GRAD)
+	    kern = hgrad_kern;
+	if (filters[i] == ICV_FILTER_LAPLACIAN)
+	    kern = laplacian_kern;
+	if (kern) {
+	    ref = reference_filter(frames, 1, kern, offset);
+	    ret += compare(what, scalar, ref, width, height, REF_TOL);
+	    bu_free(ref, "reference");
+	}
+
+    next:
+	icv_destroy(scalar);
+	icv_destroy(simd);
+	icv_destroy(sfloat);
+    }
+
+    icv_destroy(img);
+    return ret;
+}
+
+
+static int
+test_filter3(size_t width, size_t height, ICV_COLOR_SPACE color_space)
+{
+    icv_image_t *in[3], *scalar_in[3];
+    icv_image_t *simd, *scalar, *other;
+    const icv_image_t *frames[3];
+    double *ref;
+    char what[128];
+    int i;
+    int ret = 0;
+
+    for (i = 0; i < 3; i++) {
+	in[i] = random_image(width, height, color_space);
+	scalar_in[i] = copy_image(in[i], ICV_SCALAR_KERNELS);
+	frames[i] = in[i];
+    }
+    snprintf(what, sizeof(what), "filter3 smear, %zux%zux%zu", width, height, in[0]->channels);
+
+    /* matching images have to be accepted and give back a new image */
+    simd = icv_filter3(in[0], in[1], in[2], ICV_FILTER3_ANIMATION_SMEAR);
+    scalar = icv_filter3(scalar_in[0], scalar_in[1], scalar_in[2], ICV_FILTER3_ANIMATION_SMEAR);
+    if (!simd || !scalar) {
+	bu_log("%s: icv_filter3 rejected matching images\n", what);
+	ret = 1;
+    } else {
+	ret += compare(what, simd, scalar->data, width, height, 0.0);
+	ref = reference_filter(frames, 3, smear_kern, 0.0);
+	ret += compare(what, scalar, ref, width, height, REF_TOL);
+	bu_free(ref, "reference");
+    }
+    if (simd)
+	icv_destroy(simd);
+    if (scalar)
+	icv_destroy(scalar);
+
+    /* and mismatched ones rejected */
+    other = random_image(width + 1, height, color_space);
+    simd = icv_filter3(in[0], other, in[2], ICV_FILTER3_ANIMATION_SMEAR);
+    if (simd) {
+	bu_log("%s: icv_filter3 accepted a mismatched frame\n", what);
+	icv_destroy(simd);
+	ret = 1;
+    }
+    icv_destroy(other);
+
+    for (i = 0; i < 3; i++) {
+	icv_destroy(in[i]);
+	icv_destroy(scalar_in[i]);
+    }
+    return ret;
+}
+
+
+/* unknown filter types must leave the image alone, not free the
+ * kernel and carry on */
+static int
+test_unknown_filter(void)
+{
+    icv_image_t *img = random_image(7, 5, ICV_COLOR_SPACE_RGB);
+    icv_image_t *orig = copy_image(img, 0);
+    icv_image_t *out;
+    int ret = 0;
+
+    if (icv_filter(img, (ICV_FILTER)99) != -1) {
+	bu_log("unknown filter: icv_filter did not fail\n");
+	ret = 1;
+    }
+    ret += compare("unknown filter", img, orig->data, 7, 5, 0.0);
+
+    out = icv_filter3(img, img, img, (ICV_FILTER3)99);
+    if (out) {
+	bu_log("unknown filter: icv_filter3 did not fail\n");
+	icv_destroy(out);
+	ret = 1;
+    }
+
+    icv_destroy(img);
+    icv_destroy(orig);
+    return ret;
+}
+
+
+static int
+test_resize(size_t width, size_t height, ICV_COLOR_SPACE color_space, size_t factor)
+{
+    icv_image_t *img = random_image(width, height, color_space);
+    icv_image_t *shrunk = copy_image(img, 0);
+    icv_image_t *under = copy_image(img, 0);
+    size_t ow = width / factor, oh = height / factor;
+    size_t ch = img->channels;
+    double *shrink_ref, *under_ref;
+    size_t x, y, c, px, py;
+    char what[128];
+    int ret = 0;
+
+    if (!ow || !oh) {
+	icv_destroy(img);
+	icv_destroy(shrunk);
+	icv_destroy(under);
+	return 0;
+    }
+
+    /* each output pixel is the mean of its own block, and the leftover
+     * columns and rows are dropped */
+    shrink_ref = (double *)bu_calloc(ow * oh * ch, sizeof(double), "shrink reference");
+    under_ref = (double *)bu_calloc(ow * oh * ch, sizeof(double), "undersample reference");
+    for (y = 0; y < oh; y++) {
+	for (x = 0; x < ow; x++) {
+	    for (c = 0; c < ch; c++) {
+		double sum = 0.0;
+		for (py = 0; py < factor; py++)
+		    for (px = 0; px < factor; px++)
+			sum += sample(img, (long)(x * factor + px), (long)(y * factor + py), c);
+		shrink_ref[(y * ow + x) * ch + c] = sum / (double)(factor * factor);
+		under_ref[(y * ow + x) * ch + c] = sample(img, (long)(x * factor), (long)(y * factor), c);
+	    }
+	}
+    }
+
+    snprintf(what, sizeof(what), "shrink by %zu, %zux%zux%zu", factor, width, height, ch);
+    if (icv_resize(shrunk, ICV_RESIZE_SHRINK, 0, 0, factor) < 0) {
+	bu_log("%s: icv_resize failed\n", what);
+	ret = 1;
+    } else {
+	ret += compare(what, shrunk, shrink_ref, ow, oh, REF_TOL);
+    }
+
+    snprintf(what, sizeof(what), "undersample by %zu, %zux%zux%zu", factor, width, height, ch);
+    if (icv_resize(under, ICV_RESIZE_UNDERSAMPLE, 0, 0, factor) < 0) {
+	bu_log("%s: icv_resize failed\n", what);
+	ret = 1;
+    } else {
+	ret += compare(what, under, under_ref, ow, oh, 0.0);
+    }
+
+    bu_free(shrink_ref, "shrink reference");
+    bu_free(under_ref, "undersample reference");
+    icv_destroy(img);
+    icv_destroy(shrunk);
+    icv_destroy(under);
+    return ret;
+}
+
+
+int
+main(int UNUSED(argc), char *argv[])
+{
+    const struct test_size *sp;
+    int ret = 0;
+
+    bu_setprogname(argv[0]);
+    srand(5);
+
+    if (bu_simd_level() < BU_SIMD_AVX2)
+	bu_log("no AVX2 on this CPU, checking the scalar loops only\n");
+
+    for (sp = sizes; sp->width; sp++) {
+	ret += test_filters(sp->width, sp->height, ICV_COLOR_SPACE_GRAY);
+	ret += test_filters(sp->width, sp->height, ICV_COLOR_SPACE_RGB);
+	ret += test_filter3(sp->width, sp->height, ICV_COLOR_SPACE_GRAY);
+	ret += test_filter3(sp->width, sp->height, ICV_COLOR_SPACE_RGB);
+	ret += test_resize(sp->width, sp->height, ICV_COLOR_SPACE_RGB, 2);
+	ret += test_resize(sp->width, sp->height, ICV_COLOR_SPACE_GRAY, 3);
+    }
+    ret += test_unknown_filter();
+
+    if (ret)
+	bu_log("%d checks failed\n", ret);
+    return ret ? 1 : 0;
+}
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
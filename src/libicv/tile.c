@@ -0,0 +1,104 @@
+/*                          T I L E . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file libicv/tile.c
+ *
+ * Splits the rows of an image operation into bands and hands them
+ * out to the available cpus.
+ *
+ */
+
+#include "common.h"
+
+#include "bu/parallel.h"
+#include "icv_private.h"
+
+/* rows handed to a thread at a time */
+#define TILE_ROWS 16
+
+/* below this many samples an operation stays in the calling thread */
+#define TILE_PARALLEL_MIN (256*1024)
+
+
+struct tile_state {
+    size_t nrows;
+    size_t next;		/* semaphored */
+    void (*func)(size_t, size_t, void *);
+    void *data;
+};
+
+
+static void
+tile_worker(int UNUSED(cpu), void *arg)
+{
+    struct tile_state *ts = (struct tile_state *)arg;
+    size_t start, end;
+
+    while (1) {
+	bu_semaphore_acquire(BU_SEM_GENERAL);
+	start = ts->next;
+	ts->next += TILE_ROWS;
+	bu_semaphore_release(BU_SEM_GENERAL);
+
+	if (start >= ts->nrows)
+	    break;
+
+	end = start + TILE_ROWS;
+	if (end > ts->nrows)
+	    end = ts->nrows;
+	ts->func(start, end, ts->data);
+    }
+}
+
+
+void
+tile_rows(size_t nrows, size_t rowlen, void (*func)(size_t start, size_t end, void *data), void *data)
+{
+    struct tile_state ts;
+    size_t ncpu;
+
+    if (!nrows)
+	return;
+
+    ncpu = bu_avail_cpus();
+    if (ncpu > (nrows + TILE_ROWS - 1) / TILE_ROWS)
+	ncpu = (nrows + TILE_ROWS - 1) / TILE_ROWS;
+
+    if (ncpu < 2 || nrows * rowlen < TILE_PARALLEL_MIN) {
+	func(0, nrows, data);
+	return;
+    }
+
+    ts.nrows = nrows;
+    ts.next = 0;
+    ts.func = func;
+    ts.data = data;
+    bu_parallel(tile_worker, ncpu, &ts);
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
@@ -27,36 +27,30 @@
 
 #include <limits.h>
 #include <stdlib.h>
-#include <time.h>
-
-#ifdef HAVE_UNISTD_H
-#  include <unistd.h>
-#endif
-#ifdef HAVE_ALARM
-#  include <signal.h>
-#endif
 
 #include "bu/parallel.h"
+#include "bu/time.h"
 #include "photonmap.h"
 
-#if defined(HAVE_SRAND48) && !defined(HAVE_DECL_SRAND48)
-extern void srand48(long int seedval);
-#endif
+/* photons emitted by a thread between updates of the shared counts */
+#define EMIT_BATCH	64
+
+/* photons claimed at a time while building the irradiance cache */
+#define IC_BATCH	8
+
+/* seconds between irradiance cache progress reports */
+#define IC_REPORT	60
+
+/* searches for up to this many photons need no allocation */
+#define SEARCH_STACK	128
 
 int PM_Activated;
 int PM_Visualize;
 
 struct PhotonMap *PMap[PM_MAPS];/* Photon Map (KD-TREE) */
-struct Photon *Emit[PM_MAPS];	/* Emitted Photons */
-struct Photon CurPh;
 vect_t BBMin;			/* Min Bounding Box */
 vect_t BBMax;			/* Max Bounding Box */
-int Depth;			/* Used to determine how many times the photon has propagated */
-int PType;			/* Used to determine the type of Photon: Direct, Indirect, Specular, Caustic */
 int PInit;
-int EPL;			/* Emitted Photons For the Light */
-int EPS[PM_MAPS];		/* Emitted Photons For the Light */
-int ICSize;
 double ScaleFactor;
 struct IrradCache *IC;		/* Irradiance Cache for Hypersampling */
 char *Map;			/* Used for Irradiance HyperSampling Cache */
@@ -66,173 +60,378 @@ int GPM_HEIGHT;
 int GPM_RAYS;			/* Number of Sample Rays for each Direction in Irradiance Hemi */
 double GPM_ATOL;		/* Angular Tolerance for Photon Gathering */
 struct resource GPM_RTAB[MAX_PSW];	/* Resource Table for Multi-threading */
-int HitG, HitB;
+static int sem_photonmap = 0;
+
+
+/* Per-thread photon emission state, reached through a_uptr */
+struct PhotonWorker {
+    struct PhotonEmission *Shared;
+    uint64_t Seed;			/* drand48() state of this thread */
+    vect_t Power;			/* Power of the photon being traced */
+    int Depth;				/* Used to determine how many times the photon has propagated */
+    int PType;				/* Used to determine the type of Photon: Direct, Indirect, Specular, Caustic */
+    struct Photon *Buf[PM_MAPS];	/* Photons stored by this thread */
+    int Num[PM_MAPS];
+    int Size[PM_MAPS];
+    int Synced[PM_MAPS];		/* Part of Num[] already added to Shared->Stored[] */
+    int Seen[PM_MAPS];			/* Shared->Stored[] at the last update */
+    int EPL;				/* Emitted Photons For the Light */
+    int EPS[PM_MAPS];			/* Emitted Photons For each map */
+    int HitG, HitB;
+    int BBInit;
+    vect_t BBMin, BBMax;
+};
+
+
+struct PhotonEmission {
+    struct application *ap;
+    int cpus;
+    int Importons;			/* Emit importons from the eye instead of photons */
+    point_t Eye;
+    double ScaleIndirect;
+    int Stored[PM_MAPS];		/* semaphored */
+    struct PhotonWorker *Workers;
+};
+
+
+struct TreeJob {
+    int Lo, Hi;
+};
+
+
+struct TreeBuild {
+    struct Photon *List;
+    struct TreeJob *Jobs;
+    int NJobs;
+    int Next;				/* semaphored */
+};
+
+
+/* Same generator as drand48(), but with the state kept by the caller */
+static double
+PRand(uint64_t *Seed)
+{
+    *Seed = (*Seed * 0x5DEECE66DULL + 0xB) & 0xFFFFFFFFFFFFULL;
+    return (double)*Seed / 281474976710656.0;
+}
 
 
-/* Split so that equal numbers are above and below the splitting plane */
-int
-FindMedian(struct Photon *List, int Num, int Axis)
+static uint64_t
+PSeed(int Seed)
 {
-    int i;
-    fastf_t Min, Max, Mean;
-
-    Min = Max = List[0].Pos[Axis];
-    for (i = 1; i < Num; i++) {
-	if (List[i].Pos[Axis] < Min)
-	    Min = List[i].Pos[Axis];
-	if (List[i].Pos[Axis] > Max)
-	    Max = List[i].Pos[Axis];
-    }
-    Mean = (Min+Max)/2.0;
-    i = 0;
-    while (List[i].Pos[Axis] < Mean && i < Num)
-	i++;
-
-    return i;
+    return ((uint64_t)(unsigned int)Seed << 16) | 0x330E;
 }
 
 
-/* Generate a KD-Tree from a Flat Array of Photons */
+/* Rearrange List[Lo, Hi) so that the photon at K splits it along Axis */
 void
-BuildTree(struct Photon *EList, int ESize, struct PNode *Root)
+FindMedian(struct Photon *List, int Lo, int Hi, int K, int Axis)
 {
-    struct Photon *LList, *RList;
-    vect_t Min, Max;
-    int i, Axis, MedianIndex, LInd, RInd;
+    struct Photon T;
+    fastf_t a, b, c, Pivot;
+    int i, j;
+
+    Hi--;
+    while (Hi > Lo) {
+	a = List[Lo].Pos[Axis];
+	b = List[Lo + (Hi - Lo)/2].Pos[Axis];
+	c = List[Hi].Pos[Axis];
+	Pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+	i = Lo;
+	j = Hi;
+	while (i <= j) {
+	    while (List[i].Pos[Axis] < Pivot)
+		i++;
+	    while (List[j].Pos[Axis] > Pivot)
+		j--;
+	    if (i <= j) {
+		T = List[i];
+		List[i] = List[j];
+		List[j] = T;
+		i++;
+		j--;
+	    }
+	}
+
+	if (K <= j)
+	    Hi = j;
+	else if (K >= i)
+	    Lo = i;
+	else
+	    return;
+    }
+}
 
 
-    /* Allocate memory for left and right lists */
-    LList = (struct Photon*)bu_calloc(ESize, sizeof(struct Photon), "LList");
-    RList = (struct Photon*)bu_calloc(ESize, sizeof(struct Photon), "RList");
+/* Choose the splitting plane for the node of List[Lo, Hi) and move the median photon into place */
+static void
+SplitRange(struct Photon *List, int Lo, int Hi)
+{
+    vect_t Min, Max;
+    int i, Axis, Mid;
 
     /* Find the Bounding volume of the Current list of photons */
-    Min[0] = Max[0] = EList[0].Pos[0];
-    Min[1] = Max[1] = EList[0].Pos[1];
-    Min[2] = Max[2] = EList[0].Pos[2];
-    for (i = 1; i < ESize; i++) {
-	if (EList[i].Pos[0] < Min[0]) Min[0] = EList[i].Pos[0];
-	if (EList[i].Pos[1] < Min[1]) Min[1] = EList[i].Pos[1];
-	if (EList[i].Pos[2] < Min[2]) Min[2] = EList[i].Pos[2];
-	if (EList[i].Pos[0] > Max[0]) Max[0] = EList[i].Pos[0];
-	if (EList[i].Pos[1] > Max[1]) Max[1] = EList[i].Pos[1];
-	if (EList[i].Pos[2] > Max[2]) Max[2] = EList[i].Pos[2];
+    VMOVE(Min, List[Lo].Pos);
+    VMOVE(Max, List[Lo].Pos);
+    for (i = Lo + 1; i < Hi; i++) {
+	VMIN(Min, List[i].Pos);
+	VMAX(Max, List[i].Pos);
     }
 
     /* Obtain splitting Axis, which is the largest dimension of the bounding volume */
-    Max[0] -= Min[0];
-    Max[1] -= Min[1];
-    Max[2] -= Min[2];
+    VSUB2(Max, Max, Min);
     Axis = 0;
     if (Max[1] > Max[0] && Max[1] > Max[2]) Axis = 1;
     if (Max[2] > Max[0] && Max[2] > Max[1]) Axis = 2;
 
-    /* Find Median Photon to split by. */
-    MedianIndex = FindMedian(EList, ESize, Axis);
+    Mid = Lo + (Hi - Lo)/2;
+    FindMedian(List, Lo, Hi, Mid, Axis);
+    List[Mid].Axis = Axis;
+}
+
 
-    /* Build Left and Right Lists and make sure the Median Photon is not included in either list. */
-    LInd = RInd = 0;
-    for (i = 0; i < ESize; i++) {
-	if (i != MedianIndex) {
-	    if (EList[i].Pos[Axis] < EList[MedianIndex].Pos[Axis]) {
-		LList[LInd++] = EList[i];
-	    } else {
-		RList[RInd++] = EList[i];
+static void
+BuildRange(struct Photon *List, int Lo, int Hi)
+{
+    int Mid;
+
+    while (Hi - Lo > 1) {
+	SplitRange(List, Lo, Hi);
+	Mid = Lo + (Hi - Lo)/2;
+	BuildRange(List, Lo, Mid);
+	Lo = Mid + 1;
+    }
+    if (Hi - Lo == 1)
+	List[Lo].Axis = 0;
+}
+
+
+static void
+TreeThread(int UNUSED(cpu), void *arg)
+{
+    struct TreeBuild *tb = (struct TreeBuild *)arg;
+    int job;
+
+    while (1) {
+	bu_semaphore_acquire(sem_photonmap);
+	job = tb->Next++;
+	bu_semaphore_release(sem_photonmap);
+
+	if (job >= tb->NJobs)
+	    return;
+	BuildRange(tb->List, tb->Jobs[job].Lo, tb->Jobs[job].Hi);
+    }
+}
+
+
+/* Generate a KD-Tree from a Flat Array of Photons */
+void
+BuildTree(struct PhotonMap *PM, int cpus)
+{
+    struct TreeBuild tb;
+    struct TreeJob *Next, *Tmp;
+    int i, j, N, MaxJobs;
+
+    N = PM->StoredPhotons;
+    if (!N)
+	return;
+    if (cpus < 1)
+	cpus = 1;
+
+    /* Split the top of the tree here until there are enough subtrees to
+     * keep every thread busy, then build the subtrees in parallel. */
+    MaxJobs = 16*cpus + 2;
+    tb.List = PM->Photons;
+    tb.Jobs = (struct TreeJob *)bu_calloc(MaxJobs, sizeof(struct TreeJob), "TreeJob");
+    Next = (struct TreeJob *)bu_calloc(MaxJobs, sizeof(struct TreeJob), "TreeJob");
+    tb.Jobs[0].Lo = 0;
+    tb.Jobs[0].Hi = N;
+    tb.NJobs = 1;
+    tb.Next = 0;
+
+    while (cpus > 1 && tb.NJobs < 8*cpus && tb.NJobs > 0) {
+	int Mid;
+
+	for (i = j = 0; i < tb.NJobs; i++) {
+	    SplitRange(tb.List, tb.Jobs[i].Lo, tb.Jobs[i].Hi);
+	    Mid = tb.Jobs[i].Lo + (tb.Jobs[i].Hi - tb.Jobs[i].Lo)/2;
+	    if (Mid > tb.Jobs[i].Lo) {
+		Next[j].Lo = tb.Jobs[i].Lo;
+		Next[j++].Hi = Mid;
+	    }
+	    if (tb.Jobs[i].Hi > Mid + 1) {
+		Next[j].Lo = Mid + 1;
+		Next[j++].Hi = tb.Jobs[i].Hi;
 	    }
-	    /*
-	      if (EList[i].Pos[Axis] < Median.Pos[Axis]) {
-	      LList[LInd++] = EList[i];
-	      } else {
-	      RList[RInd++] = EList[i];
-	      }
-	    */
 	}
+	Tmp = tb.Jobs;
+	tb.Jobs = Next;
+	Next = Tmp;
+	tb.NJobs = j;
     }
 
-    /* Store the Median Photon into the KD-Tree. */
-    /* bu_log("insertKD: %.3f, %.3f, %.3f\n", EList[MedianIndex].Pos[0], EList[MedianIndex].Pos[1], EList[MedianIndex].Pos[2]);*/
-    Root->P = EList[MedianIndex];
-    Root->P.Axis = Axis;
-    Root->C = 0;
-
-    /* With Left and Right if either contain any photons then repeat this process */
-    /* if (LInd) bu_log("Left Branch\n");*/
-    if (LInd) {
-	BU_ALLOC(Root->L, struct PNode);
-	Root->L->L = 0;
-	Root->L->R = 0;
-	BuildTree(LList, LInd, Root->L);
+    if (cpus > 1 && tb.NJobs > 1)
+	bu_parallel(TreeThread, cpus, &tb);
+    else
+	TreeThread(0, &tb);
+
+    bu_free(tb.Jobs, "TreeJob");
+    bu_free(Next, "TreeJob");
+
+    /* Pull out the fields that searching compares */
+    for (i = 0; i < 3; i++) {
+	PM->Pos[i] = (fastf_t *)bu_realloc(PM->Pos[i], N * sizeof(fastf_t), "Pos");
+	PM->Normal[i] = (fastf_t *)bu_realloc(PM->Normal[i], N * sizeof(fastf_t), "Normal");
     }
-    /* if (RInd) bu_log("Right Branch\n");*/
-    if (RInd) {
-	BU_ALLOC(Root->R, struct PNode);
-	Root->R->L = 0;
-	Root->R->R = 0;
-	BuildTree(RList, RInd, Root->R);
+    PM->Axis = (char *)bu_realloc(PM->Axis, N, "Axis");
+    for (i = 0; i < N; i++) {
+	for (j = 0; j < 3; j++) {
+	    PM->Pos[j][i] = PM->Photons[i].Pos[j];
+	    PM->Normal[j][i] = PM->Photons[i].Normal[j];
+	}
+	PM->Axis[i] = (char)PM->Photons[i].Axis;
     }
+}
+
 
-    bu_free(LList, "LList");
-    bu_free(RList, "RList");
+/*
+  After inserting a new node it must be brought upwards until both children
+  are less than it.
+*/
+void
+HeapUp(struct PhotonSearch *S, int ind)
+{
+    struct PSN c;
+    int i;
+
+    c = S->List[ind];
+    while (ind) {
+	i = (ind - 1)/2;
+	if (S->List[i].Dist >= c.Dist)
+	    break;
+	S->List[ind] = S->List[i];
+	ind = i;
+    }
+    S->List[ind] = c;
 }
 
 
+/*
+  Sift the new Root node down, choosing the child with the larger distance
+  each time, until it is no closer than either of its children.
+*/
 void
-LocatePhotons(struct PhotonSearch *Search, struct PNode *Root)
+HeapDown(struct PhotonSearch *S, int ind)
+{
+    struct PSN c;
+    int i;
+
+    c = S->List[ind];
+    while ((i = 2*ind + 1) < S->Found) {
+	if (i + 1 < S->Found && S->List[i + 1].Dist > S->List[i].Dist)
+	    i++;
+	if (S->List[i].Dist <= c.Dist)
+	    break;
+	S->List[ind] = S->List[i];
+	ind = i;
+    }
+    S->List[ind] = c;
+}
+
+
+/* Search the subtree of List[Lo, Hi), keeping the closest photons in a max-heap */
+static void
+LocateRange(struct PhotonSearch *Search, const struct PhotonMap *PM, int Lo, int Hi)
 {
-    fastf_t Dist, TDist, angle, MDist;
-    int i, MaxInd, Axis;
+    fastf_t Dist, dx, dy, dz, angle;
+    int Mid, Axis;
 
-    if (!Root)
+    if (Lo >= Hi)
 	return;
 
-    Axis = Root->P.Axis;
-    Dist = Search->Pos[Axis] - Root->P.Pos[Axis];
+    Mid = Lo + (Hi - Lo)/2;
+    Axis = PM->Axis[Mid];
+    Dist = Search->Pos[Axis] - PM->Pos[Axis][Mid];
 
     if (Dist < 0) {
 	/* Left of plane - search left subtree first */
-	LocatePhotons(Search, Root->L);
+	LocateRange(Search, PM, Lo, Mid);
 	if (Dist*Dist < Search->RadSq)
-	    LocatePhotons(Search, Root->R);
+	    LocateRange(Search, PM, Mid + 1, Hi);
     } else {
 	/* Right of plane - search right subtree first */
-	LocatePhotons(Search, Root->R);
+	LocateRange(Search, PM, Mid + 1, Hi);
 	if (Dist*Dist < Search->RadSq)
-	    LocatePhotons(Search, Root->L);
+	    LocateRange(Search, PM, Lo, Mid);
     }
 
-    /* REPLACE, Find Distance between Root Photon and NP->Pos */
-    Dist = (Root->P.Pos[0] - Search->Pos[0])*(Root->P.Pos[0] - Search->Pos[0]) + (Root->P.Pos[1] - Search->Pos[1])*(Root->P.Pos[1] - Search->Pos[1]) + (Root->P.Pos[2] - Search->Pos[2])*(Root->P.Pos[2] - Search->Pos[2]);
+    dx = PM->Pos[0][Mid] - Search->Pos[0];
+    dy = PM->Pos[1][Mid] - Search->Pos[1];
+    dz = PM->Pos[2][Mid] - Search->Pos[2];
+    Dist = dx*dx + dy*dy + dz*dz;
+    if (Dist >= Search->RadSq)
+	return;
 
-    angle = VDOT(Search->Normal, Root->P.Normal);
-    if (Dist < Search->RadSq && angle > GPM_ATOL) {
-	/* Check that Result is within Radius and Angular Tolerance */
-	/* if (Dist < NP->RadSq) {*/
-	if (Search->Found < Search->Max) {
-	    Search->List[Search->Found++].P = Root->P;
-	} else {
-	    MDist = (Search->Pos[0] - Search->List[0].P.Pos[0])*(Search->Pos[0] - Search->List[0].P.Pos[0])+(Search->Pos[1] - Search->List[0].P.Pos[1])*(Search->Pos[1] - Search->List[0].P.Pos[1])+(Search->Pos[2] - Search->List[0].P.Pos[2])*(Search->Pos[2] - Search->List[0].P.Pos[2]);
-	    MaxInd = 0;
-	    for (i = 1; i < Search->Found; i++) {
-		TDist = (Search->Pos[0] - Search->List[i].P.Pos[0])*(Search->Pos[0] - Search->List[i].P.Pos[0])+(Search->Pos[1] - Search->List[i].P.Pos[1])*(Search->Pos[1] - Search->List[i].P.Pos[1])+(Search->Pos[2] - Search->List[i].P.Pos[2])*(Search->Pos[2] - Search->List[i].P.Pos[2]);
-		if (TDist > MDist) {
-		    MDist = TDist;
-		    MaxInd = i;
-		}
-	    }
+    /* Check that Result is within Radius and Angular Tolerance */
+    angle = Search->Normal[0]*PM->Normal[0][Mid] + Search->Normal[1]*PM->Normal[1][Mid] + Search->Normal[2]*PM->Normal[2][Mid];
+    if (angle <= GPM_ATOL)
+	return;
 
-	    if (Dist < MDist)
-		Search->List[MaxInd].P = Root->P;
-	}
+    if (Search->Found < Search->Max) {
+	Search->List[Search->Found].P = &PM->Photons[Mid];
+	Search->List[Search->Found].Dist = Dist;
+	HeapUp(Search, Search->Found++);
+    } else if (Dist < Search->List[0].Dist) {
+	/* Replace the farthest photon found so far */
+	Search->List[0].P = &PM->Photons[Mid];
+	Search->List[0].Dist = Dist;
+	HeapDown(Search, 0);
     }
 }
 
 
-/* Places photon into flat array that wwill form the final kd-tree. */
+/* The map is only read here, so any number of threads may search it at once */
 void
-Store(point_t Pos, vect_t Dir, vect_t Normal, int map)
+LocatePhotons(struct PhotonSearch *Search, const struct PhotonMap *PM)
+{
+    if (PM->StoredPhotons)
+	LocateRange(Search, PM, 0, PM->StoredPhotons);
+}
+
+
+/* Add this thread's new photons to the shared counts, and see everyone else's */
+static void
+SyncPhotons(struct PhotonWorker *pw)
 {
-    struct PhotonSearch Search;
     int i;
 
+    bu_semaphore_acquire(sem_photonmap);
+    for (i = 0; i < PM_MAPS; i++) {
+	pw->Shared->Stored[i] += pw->Num[i] - pw->Synced[i];
+	pw->Synced[i] = pw->Num[i];
+	pw->Seen[i] = pw->Shared->Stored[i];
+    }
+    bu_semaphore_release(sem_photonmap);
+}
+
+
+/* Number of photons stored in a map by all threads, as far as this thread knows */
+static int
+StoredPhotons(const struct PhotonWorker *pw, int map)
+{
+    return pw->Seen[map] + pw->Num[map] - pw->Synced[map];
+}
+
+
+/* Places photon into this thread's flat array, merged later to form the final kd-tree. */
+void
+Store(struct PhotonWorker *pw, point_t Pos, vect_t Dir, vect_t Normal, int map)
+{
+    struct PhotonSearch Search;
+    struct PSN Nearest;
+    struct Photon *P;
+
     /* If Importance Mapping is enabled, Check to see if the Photon is in an area that is considered important, if not then disregard it */
     if (map != PM_IMPORTANCE && PMap[PM_IMPORTANCE]->StoredPhotons) {
 	/* Do a KD-Tree lookup and if the photon is within a distance of sqrt(ScaleFactor) from the nearest importon then keep it, otherwise discard it */
@@ -240,49 +439,33 @@ Store(point_t Pos, vect_t Dir, vect_t Normal, int map)
 	Search.RadSq = ScaleFactor;
 	Search.Found = 0;
 	Search.Max = 1;
-	Search.Pos[0] = Pos[0];
-	Search.Pos[1] = Pos[1];
-	Search.Pos[2] = Pos[2];
-	Search.Normal[0] = Normal[0];
-	Search.Normal[1] = Normal[1];
-	Search.Normal[2] = Normal[2];
-
-	Search.List = (struct PSN*)bu_calloc(Search.Max, sizeof(struct PSN), "Search.List");
-	LocatePhotons(&Search, PMap[PM_IMPORTANCE]->Root);
-	bu_free(Search.List, "Search.List");
+	VMOVE(Search.Pos, Pos);
+	VMOVE(Search.Normal, Normal);
+	Search.List = &Nearest;
+	LocatePhotons(&Search, PMap[PM_IMPORTANCE]);
 
 	if (!Search.Found) {
-	    HitB++;
+	    pw->HitB++;
 	    return;
 	}
     }
 
-
-    if (PMap[map]->StoredPhotons < PMap[map]->MaxPhotons) {
-	HitG++;
-	for (i = 0; i < 3; i++) {
-	    /* Store Position, Direction, and Power of Photon */
-	    Emit[map][PMap[map]->StoredPhotons].Pos[i] = Pos[i];
-	    Emit[map][PMap[map]->StoredPhotons].Dir[i] = Dir[i];
-	    Emit[map][PMap[map]->StoredPhotons].Normal[i] = Normal[i];
-	    Emit[map][PMap[map]->StoredPhotons].Power[i] = CurPh.Power[i];
+    if (StoredPhotons(pw, map) < PMap[map]->MaxPhotons) {
+	pw->HitG++;
+	if (pw->Num[map] == pw->Size[map]) {
+	    pw->Size[map] = pw->Size[map] ? 2*pw->Size[map] : 1024;
+	    pw->Buf[map] = (struct Photon *)bu_realloc(pw->Buf[map], pw->Size[map] * sizeof(struct Photon), "Photons");
 	}
-	PMap[map]->StoredPhotons++;
-	/*
-	  if (map != PM_IMPORTANCE && PMap[PM_IMPORTANCE]->StoredPhotons < PMap[PM_IMPORTANCE]->MaxPhotons)
-	  bu_log("Map2: %d, Size: %d\n", map, PMap[map]->StoredPhotons);
-	*/
-	/*
-	  if (map == PM_IMPORTANCE)
-	  bu_log("Map: %d, Size: %d, [%.3f, %.3f, %.3f] [%.3f, %.3f, %.3f]\n", map, PMap[map]->StoredPhotons, Pos[0], Pos[1], Pos[2], CurPh.Power[0], CurPh.Power[1], CurPh.Power[2]);
-	*/
-    }
 
-    /*
-      bu_log("[%d][%d][%.3f, %.3f, %.3f]\n", map, PMap[map]->StoredPhotons, CurPh.Power[0], CurPh.Power[1], CurPh.Power[2]);
-      if (!(PMap[map]->StoredPhotons % 64))
-      bu_log("[%d][%d][%.3f, %.3f, %.3f]\n", map, PMap[map]->StoredPhotons, Pos[0], Pos[1], Pos[2]);
-    */
+	/* Store Position, Direction, and Power of Photon */
+	P = &pw->Buf[map][pw->Num[map]++];
+	VMOVE(P->Pos, Pos);
+	VMOVE(P->Dir, Dir);
+	VMOVE(P->Normal, Normal);
+	VMOVE(P->Power, pw->Power);
+	VSETALL(P->Irrad, 0);
+	P->Axis = 0;
+    }
 }
 
 
@@ -307,19 +490,13 @@ SpecularReflect(vect_t normal, vect_t rdir)
 
 /* Compute a random reflected diffuse direction */
 void
-DiffuseReflect(vect_t normal, vect_t rdir)
+DiffuseReflect(vect_t normal, vect_t rdir, uint64_t *Seed)
 {
     /* Allow Photons to get a random direction at most 60 degrees to the normal */
     do {
-#ifndef HAVE_DRAND48
-	rdir[0] = 2.0*rand()/(double)RAND_MAX-1.0;
-	rdir[1] = 2.0*rand()/(double)RAND_MAX-1.0;
-	rdir[2] = 2.0*rand()/(double)RAND_MAX-1.0;
-#else
-	rdir[0] = 2.0*drand48()-1.0;
-	rdir[1] = 2.0*drand48()-1.0;
-	rdir[2] = 2.0*drand48()-1.0;
-#endif
+	rdir[0] = 2.0*PRand(Seed)-1.0;
+	rdir[1] = 2.0*PRand(Seed)-1.0;
+	rdir[2] = 2.0*PRand(Seed)-1.0;
 	VUNITIZE(rdir);
     } while (VDOT(rdir, normal) < 0.5);
 }
@@ -457,6 +634,7 @@ int PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED
 int
 HitRef(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(finished_segs))
 {
+    struct PhotonWorker *pw = (struct PhotonWorker *)ap->a_uptr;
     struct partition *part;
     vect_t pt, normal, spec;
     fastf_t refi, transmit;
@@ -484,11 +662,11 @@ HitRef(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(f
 
     if (Refract(ap->a_ray.r_dir, normal, refi, 1.0)) {
 	/*
-	  bu_log("1D: %d, [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f]\n", Depth, pt[0], pt[1], pt[2], ap->a_ray.r_dir[0], ap->a_ray.r_dir[1], ap->a_ray.r_dir[2], normal[0], normal[1], normal[2]);
+	  bu_log("1D: %d, [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f]\n", pw->Depth, pt[0], pt[1], pt[2], ap->a_ray.r_dir[0], ap->a_ray.r_dir[1], ap->a_ray.r_dir[2], normal[0], normal[1], normal[2]);
 	  bu_log("p1: [%.3f, %.3f, %.3f]\n", part->pt_inhit->hit_point[0], part->pt_inhit->hit_point[1], part->pt_inhit->hit_point[2]);
 	  bu_log("p2: [%.3f, %.3f, %.3f]\n", part->pt_outhit->hit_point[0], part->pt_outhit->hit_point[1], part->pt_outhit->hit_point[2]);
 	*/
-	Depth++;
+	pw->Depth++;
 	rt_shootray(ap);
     } else {
 	bu_log("TIF\n");
@@ -499,10 +677,11 @@ HitRef(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(f
 }
 
 //#define PHIT_DEBUG
-/* Callback for Photon Hit, The 'current' photon is Emit[PMap->StoredPhotons] */
+/* Callback for Photon Hit, The 'current' photon is the one being traced by the thread in a_uptr */
 int
 PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(finished_segs))
 {
+    struct PhotonWorker *pw = (struct PhotonWorker *)ap->a_uptr;
     struct partition *part;
     vect_t pt, normal, color, spec, power;
     fastf_t refi, transmit, prob, prob_diff, prob_spec, prob_ref;
@@ -546,24 +725,13 @@ PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(fin
 
 
     /* Generate Bounding Box for Scaling Phase */
-    if (PInit) {
-	BBMin[0] = BBMax[0] = pt[0];
-	BBMin[1] = BBMax[1] = pt[1];
-	BBMin[2] = BBMax[2] = pt[2];
-	PInit = 0;
+    if (!pw->BBInit) {
+	VMOVE(pw->BBMin, pt);
+	VMOVE(pw->BBMax, pt);
+	pw->BBInit = 1;
     } else {
-	if (pt[0] < BBMin[0])
-	    BBMin[0] = pt[0];
-	if (pt[0] > BBMax[0])
-	    BBMax[0] = pt[0];
-	if (pt[1] < BBMin[1])
-	    BBMin[1] = pt[1];
-	if (pt[1] > BBMax[1])
-	    BBMax[1] = pt[1];
-	if (pt[2] < BBMin[2])
-	    BBMin[2] = pt[2];
-	if (pt[2] > BBMax[2])
-	    BBMax[2] = pt[2];
+	VMIN(pw->BBMin, pt);
+	VMAX(pw->BBMax, pt);
     }
 
     /* Fetch Intersection Normal */
@@ -582,11 +750,7 @@ PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(fin
     prob_ref = MaxFloat(color[0]+spec[0], color[1]+spec[1], color[2]+spec[2]);
     prob_diff = ((color[0]+color[1]+color[2])/(color[0]+color[1]+color[2]+spec[0]+spec[1]+spec[2]))*prob_ref;
     prob_spec = prob_ref - prob_diff;
-#ifndef HAVE_DRAND48
-    prob = rand()/(double)RAND_MAX;
-#else
-    prob = drand48();
-#endif
+    prob = PRand(&pw->Seed);
 
     /* bu_log("pr: %.3f, pd: %.3f, [%.3f, %.3f, %.3f] [%.3f, %.3f, %.3f]\n", prob_ref, prob_diff, color[0], color[1], color[2], spec[0], spec[1], spec[2]);*/
     /* bu_log("prob: %.3f, prob_diff: %.3f, pd+ps: %.3f\n", prob, prob_diff, prob_diff+prob_spec);*/
@@ -594,41 +758,41 @@ PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(fin
     if (prob < 1.0 - transmit) {
 	if (prob < prob_diff) {
 	    /* Store power of incident Photon */
-	    power[0] = CurPh.Power[0];
-	    power[1] = CurPh.Power[1];
-	    power[2] = CurPh.Power[2];
+	    power[0] = pw->Power[0];
+	    power[1] = pw->Power[1];
+	    power[2] = pw->Power[2];
 
 
 	    /* Scale Power of reflected photon */
-	    CurPh.Power[0] = power[0]*color[0]/prob_diff;
-	    CurPh.Power[1] = power[1]*color[1]/prob_diff;
-	    CurPh.Power[2] = power[2]*color[2]/prob_diff;
+	    pw->Power[0] = power[0]*color[0]/prob_diff;
+	    pw->Power[1] = power[1]*color[1]/prob_diff;
+	    pw->Power[2] = power[2]*color[2]/prob_diff;
 
 	    /* Store Photon */
-	    Store(pt, ap->a_ray.r_dir, normal, PType);
+	    Store(pw, pt, ap->a_ray.r_dir, normal, pw->PType);
 
 	    /* Assign diffuse reflection direction */
-	    DiffuseReflect(normal, ap->a_ray.r_dir);
+	    DiffuseReflect(normal, ap->a_ray.r_dir, &pw->Seed);
 
 	    /* Assign pt */
 	    ap->a_ray.r_pt[0] = pt[0];
 	    ap->a_ray.r_pt[1] = pt[1];
 	    ap->a_ray.r_pt[2] = pt[2];
 
-	    if (PType != PM_CAUSTIC) {
-		Depth++;
+	    if (pw->PType != PM_CAUSTIC) {
+		pw->Depth++;
 		rt_shootray(ap);
 	    }
 	} else if (prob >= prob_diff && prob < prob_diff + prob_spec) {
 	    /* Store power of incident Photon */
-	    power[0] = CurPh.Power[0];
-	    power[1] = CurPh.Power[1];
-	    power[2] = CurPh.Power[2];
+	    power[0] = pw->Power[0];
+	    power[1] = pw->Power[1];
+	    power[2] = pw->Power[2];
 
 	    /* Scale power of reflected photon */
-	    CurPh.Power[0] = power[0]*spec[0]/prob_spec;
-	    CurPh.Power[1] = power[1]*spec[1]/prob_spec;
-	    CurPh.Power[2] = power[2]*spec[2]/prob_spec;
+	    pw->Power[0] = power[0]*spec[0]/prob_spec;
+	    pw->Power[1] = power[1]*spec[1]/prob_spec;
+	    pw->Power[2] = power[2]*spec[2]/prob_spec;
 
 	    /* Reflective */
 	    SpecularReflect(normal, ap->a_ray.r_dir);
@@ -638,34 +802,34 @@ PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(fin
 	    ap->a_ray.r_pt[1] = pt[1];
 	    ap->a_ray.r_pt[2] = pt[2];
 
-	    if (PType != PM_IMPORTANCE)
-		PType = PM_CAUSTIC;
-	    Depth++;
+	    if (pw->PType != PM_IMPORTANCE)
+		pw->PType = PM_CAUSTIC;
+	    pw->Depth++;
 	    rt_shootray(ap);
 	} else {
 	    /* Store Photon */
-	    Store(pt, ap->a_ray.r_dir, normal, PType);
+	    Store(pw, pt, ap->a_ray.r_dir, normal, pw->PType);
 	}
     } else {
-	if (refi > 1.0 && (PType == PM_CAUSTIC || Depth == 0)) {
-	    if (PType != PM_IMPORTANCE)
-		PType = PM_CAUSTIC;
+	if (refi > 1.0 && (pw->PType == PM_CAUSTIC || pw->Depth == 0)) {
+	    if (pw->PType != PM_IMPORTANCE)
+		pw->PType = PM_CAUSTIC;
 
 	    /* Store power of incident Photon */
-	    power[0] = CurPh.Power[0];
-	    power[1] = CurPh.Power[1];
-	    power[2] = CurPh.Power[2];
+	    power[0] = pw->Power[0];
+	    power[1] = pw->Power[1];
+	    power[2] = pw->Power[2];
 
 	    /* Scale power of reflected photon */
-	    CurPh.Power[0] = power[0]*spec[0]/prob_spec;
-	    CurPh.Power[1] = power[1]*spec[1]/prob_spec;
-	    CurPh.Power[2] = power[2]*spec[2]/prob_spec;
+	    pw->Power[0] = power[0]*spec[0]/prob_spec;
+	    pw->Power[1] = power[1]*spec[1]/prob_spec;
+	    pw->Power[2] = power[2]*spec[2]/prob_spec;
 
 	    /* Refractive or Reflective */
 	    if (refi > 1.0 && prob < transmit) {
-		CurPh.Power[0] = power[0];
-		CurPh.Power[1] = power[1];
-		CurPh.Power[2] = power[2];
+		pw->Power[0] = power[0];
+		pw->Power[1] = power[1];
+		pw->Power[2] = power[2];
 
 		if (!Refract(ap->a_ray.r_dir, normal, 1.0, refi))
 		    printf("TIF0\n");
@@ -688,8 +852,8 @@ PHit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(fin
 	    ap->a_ray.r_pt[1] = pt[1];
 	    ap->a_ray.r_pt[2] = pt[2];
 
-	    /* bu_log("2D: %d, [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f]\n", Depth, pt[0], pt[1], pt[2], ap->a_ray.r_dir[0], ap->a_ray.r_dir[1], ap->a_ray.r_dir[2], normal[0], normal[1], normal[2]);*/
-	    Depth++;
+	    /* bu_log("2D: %d, [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f], [%.3f, %.3f, %.3f]\n", pw->Depth, pt[0], pt[1], pt[2], ap->a_ray.r_dir[0], ap->a_ray.r_dir[1], ap->a_ray.r_dir[2], normal[0], normal[1], normal[2]);*/
+	    pw->Depth++;
 	    rt_shootray(ap);
 	}
     }
@@ -711,52 +875,56 @@ PMiss(struct application *UNUSED(ap))
  * This function also handles setting a default power for the photons based
  * on the size of the scene, i.e. power of light source */
 void
-ScalePhotonPower(int map)
+ScalePhotonPower(int map, double Emitted)
 {
     int i;
 
     for (i = 0; i < PMap[map]->StoredPhotons; i++) {
-	Emit[map][i].Power[0] *= ScaleFactor/(double)EPS[map];
-	Emit[map][i].Power[1] *= ScaleFactor/(double)EPS[map];
-	Emit[map][i].Power[2] *= ScaleFactor/(double)EPS[map];
+	PMap[map]->Photons[i].Power[0] *= ScaleFactor/Emitted;
+	PMap[map]->Photons[i].Power[1] *= ScaleFactor/Emitted;
+	PMap[map]->Photons[i].Power[2] *= ScaleFactor/Emitted;
     }
 }
 
 
+/* Pick a random direction, uniform over the sphere */
+static void
+RandomDirection(vect_t Dir, uint64_t *Seed)
+{
+    do {
+	Dir[0] = 2.0*PRand(Seed)-1.0;
+	Dir[1] = 2.0*PRand(Seed)-1.0;
+	Dir[2] = 2.0*PRand(Seed)-1.0;
+    } while (Dir[0]*Dir[0] + Dir[1]*Dir[1] + Dir[2]*Dir[2] > 1);
+
+    /* Normalize Ray Direction */
+    VUNITIZE(Dir);
+}
+
+
 /* Generate Importons and emit them into the scene from the eye position */
 void
 EmitImportonsRandom(struct application *ap, point_t eye_pos)
 {
-    while (PMap[PM_IMPORTANCE]->StoredPhotons < PMap[PM_IMPORTANCE]->MaxPhotons) {
-	do {
-	    /* Set Ray Direction to application ptr */
-#ifndef HAVE_DRAND48
-	    ap->a_ray.r_dir[0] = 2.0*rand()/(double)RAND_MAX-1.0;
-	    ap->a_ray.r_dir[1] = 2.0*rand()/(double)RAND_MAX-1.0;
-	    ap->a_ray.r_dir[2] = 2.0*rand()/(double)RAND_MAX-1.0;
-#else
-	    ap->a_ray.r_dir[0] = 2.0*drand48()-1.0;
-	    ap->a_ray.r_dir[1] = 2.0*drand48()-1.0;
-	    ap->a_ray.r_dir[2] = 2.0*drand48()-1.0;
-#endif
-	} while (ap->a_ray.r_dir[0]*ap->a_ray.r_dir[0] + ap->a_ray.r_dir[1]*ap->a_ray.r_dir[1] + ap->a_ray.r_dir[2]*ap->a_ray.r_dir[2] > 1);
+    struct PhotonWorker *pw = (struct PhotonWorker *)ap->a_uptr;
+    int n = 0;
 
-	/* Normalize Ray Direction */
-	VUNITIZE(ap->a_ray.r_dir);
-
-	/* Set Ray Position to application ptr */
-	ap->a_ray.r_pt[0] = eye_pos[0];
-	ap->a_ray.r_pt[1] = eye_pos[1];
-	ap->a_ray.r_pt[2] = eye_pos[2];
+    while (StoredPhotons(pw, PM_IMPORTANCE) < PMap[PM_IMPORTANCE]->MaxPhotons) {
+	/* Set Ray Direction and Position to application ptr */
+	RandomDirection(ap->a_ray.r_dir, &pw->Seed);
+	VMOVE(ap->a_ray.r_pt, eye_pos);
 
 	/* Shoot Importon into Scene */
-	CurPh.Power[0] = 0;
-	CurPh.Power[1] = 100000000;
-	CurPh.Power[2] = 0;
+	VSET(pw->Power, 0, 100000000, 0);
 
-	Depth = 0;
-	PType = PM_IMPORTANCE;
+	pw->Depth = 0;
+	pw->PType = PM_IMPORTANCE;
+	ap->a_hit = PHit;
+	ap->a_onehit = 0;
 	rt_shootray(ap);
+
+	if (!(++n % EMIT_BATCH))
+	    SyncPhotons(pw);
     }
 }
 
@@ -765,71 +933,113 @@ EmitImportonsRandom(struct application *ap, point_t eye_pos)
 void
 EmitPhotonsRandom(struct application *ap, double ScaleIndirect)
 {
+    struct PhotonWorker *pw = (struct PhotonWorker *)ap->a_uptr;
     struct light_specific *lp;
-    int i;
+    int i, n = 0;
 
-    /*
-      for (i = 0; i < 8; i++)
-      bu_log("sample points: [%.3f, %.3f, %.3f]\n", lp->lt_sample_pts[i].lp_pt[0], lp->lt_sample_pts[i].lp_pt[1], lp->lt_sample_pts[i].lp_pt[2]);
-    */
     while (1) {
 	for (BU_LIST_FOR(lp, light_specific, &(LightHead.l))) {
 	    /* If the Global Photon Map Completes before the Caustics Map, then it probably means there are no caustic objects in the Scene */
-	    if (PMap[PM_GLOBAL]->StoredPhotons == PMap[PM_GLOBAL]->MaxPhotons && (!PMap[PM_CAUSTIC]->StoredPhotons || PMap[PM_CAUSTIC]->StoredPhotons == PMap[PM_CAUSTIC]->MaxPhotons))
+	    if (StoredPhotons(pw, PM_GLOBAL) >= PMap[PM_GLOBAL]->MaxPhotons
+		&& (!StoredPhotons(pw, PM_CAUSTIC) || StoredPhotons(pw, PM_CAUSTIC) >= PMap[PM_CAUSTIC]->MaxPhotons))
 		return;
 
-	    do {
-		/* do {*/
-		/* Set Ray Direction to application ptr */
-#ifndef HAVE_DRAND48
-		ap->a_ray.r_dir[0] = 2.0*rand()/(double)RAND_MAX-1.0;
-		ap->a_ray.r_dir[1] = 2.0*rand()/(double)RAND_MAX-1.0;
-		ap->a_ray.r_dir[2] = 2.0*rand()/(double)RAND_MAX-1.0;
-#else
-		ap->a_ray.r_dir[0] = 2.0*drand48()-1.0;
-		ap->a_ray.r_dir[1] = 2.0*drand48()-1.0;
-		ap->a_ray.r_dir[2] = 2.0*drand48()-1.0;
-#endif
-	    } while (ap->a_ray.r_dir[0]*ap->a_ray.r_dir[0] + ap->a_ray.r_dir[1]*ap->a_ray.r_dir[1] + ap->a_ray.r_dir[2]*ap->a_ray.r_dir[2] > 1);
-	    /* Normalize Ray Direction */
-	    VUNITIZE(ap->a_ray.r_dir);
-
-	    /* Set Ray Position to application ptr */
-	    ap->a_ray.r_pt[0] = lp->lt_pos[0];
-	    ap->a_ray.r_pt[1] = lp->lt_pos[1];
-	    ap->a_ray.r_pt[2] = lp->lt_pos[2];
-
+	    /* Set Ray Direction and Position to application ptr */
+	    RandomDirection(ap->a_ray.r_dir, &pw->Seed);
+	    VMOVE(ap->a_ray.r_pt, lp->lt_pos);
 
 	    /* Shoot Photon into Scene, (4.0) is used to align phong's attenuation with photonic energies, it's a heuristic */
-	    /*bu_log("Shooting Ray: [%.3f, %.3f, %.3f] [%.3f, %.3f, %.3f]\n", lp->lt_pos[0], lp->lt_pos[1], lp->lt_pos[2], x, y, z);*/
-	    CurPh.Power[0] = 1000.0 * ScaleIndirect * lp->lt_intensity * lp->lt_color[0];
-	    CurPh.Power[1] = 1000.0 * ScaleIndirect * lp->lt_intensity * lp->lt_color[1];
-	    CurPh.Power[2] = 1000.0 * ScaleIndirect * lp->lt_intensity * lp->lt_color[2];
+	    VSCALE(pw->Power, lp->lt_color, 1000.0 * ScaleIndirect * lp->lt_intensity);
 
-	    Depth = 0;
-	    PType = PM_GLOBAL;
+	    pw->Depth = 0;
+	    pw->PType = PM_GLOBAL;
 
-	    EPL++;
+	    pw->EPL++;
 	    for (i = 0; i < PM_MAPS; i++)
-		if (PMap[i]->StoredPhotons < PMap[i]->MaxPhotons)
-		    EPS[i]++;
+		if (StoredPhotons(pw, i) < PMap[i]->MaxPhotons)
+		    pw->EPS[i]++;
 
+	    ap->a_hit = PHit;
+	    ap->a_onehit = 0;
 	    rt_shootray(ap);
-	    /* bu_log("1: %d, 2: %d\n", PMap[PM_GLOBAL]->StoredPhotons, PMap[PM_CAUSTIC]->StoredPhotons);*/
+
+	    if (!(++n % EMIT_BATCH))
+		SyncPhotons(pw);
 	}
     }
 }
 
 
-void
-SanityCheck(struct PNode *Root, int LR)
+static void
+EmitThread(int cpu, void *arg)
 {
-    if (!Root)
-	return;
+    struct PhotonEmission *pe = (struct PhotonEmission *)arg;
+    struct PhotonWorker *pw = &pe->Workers[cpu];
+    struct application a;
+
+    a = *pe->ap;
+    a.a_resource = &GPM_RTAB[cpu];
+    a.a_uptr = (void *)pw;
+
+    if (pe->Importons)
+	EmitImportonsRandom(&a, pe->Eye);
+    else
+	EmitPhotonsRandom(&a, pe->ScaleIndirect);
+
+    SyncPhotons(pw);
+}
+
+
+/* Trace photons on every thread, each into its own buffers, then merge the buffers into the maps */
+static void
+EmitPhotons(struct PhotonEmission *pe)
+{
+    struct PhotonWorker *pw;
+    int i, j, n;
+
+    for (i = 0; i < PM_MAPS; i++)
+	pe->Stored[i] = 0;
+    for (i = 0; i < pe->cpus; i++) {
+	pw = &pe->Workers[i];
+	pw->Shared = pe;
+	pw->HitG = pw->HitB = 0;
+	for (j = 0; j < PM_MAPS; j++)
+	    pw->Num[j] = pw->Synced[j] = pw->Seen[j] = 0;
+    }
+
+    if (pe->cpus > 1)
+	bu_parallel(EmitThread, pe->cpus, pe);
+    else
+	EmitThread(0, pe);
+
+    for (j = 0; j < PM_MAPS; j++) {
+	if (!pe->Stored[j])
+	    continue;
+	PMap[j]->Photons = (struct Photon *)bu_realloc(PMap[j]->Photons, pe->Stored[j] * sizeof(struct Photon), "Photons");
+	for (i = n = 0; i < pe->cpus; i++) {
+	    pw = &pe->Workers[i];
+	    if (pw->Num[j])
+		memcpy(PMap[j]->Photons + n, pw->Buf[j], pw->Num[j] * sizeof(struct Photon));
+	    n += pw->Num[j];
+	    pw->Num[j] = pw->Synced[j] = 0;
+	}
+	PMap[j]->StoredPhotons = n;
+    }
 
-    bu_log("Pos[%d]: [%.3f, %.3f, %.3f]\n", LR, Root->P.Pos[0], Root->P.Pos[1], Root->P.Pos[2]);
-    SanityCheck(Root->L, 1);
-    SanityCheck(Root->R, 2);
+    /* Generate Bounding Box for Scaling Phase */
+    for (i = 0; i < pe->cpus; i++) {
+	pw = &pe->Workers[i];
+	if (!pw->BBInit)
+	    continue;
+	if (PInit) {
+	    VMOVE(BBMin, pw->BBMin);
+	    VMOVE(BBMax, pw->BBMax);
+	    PInit = 0;
+	} else {
+	    VMIN(BBMin, pw->BBMin);
+	    VMAX(BBMax, pw->BBMax);
+	}
+    }
 }
 
 
@@ -851,6 +1061,7 @@ void
 GetEstimate(vect_t irrad, point_t pos, vect_t normal, fastf_t rad, int np, int map, double max_rad, int centog, int min_np)
 {
     struct PhotonSearch Search;
+    struct PSN List[SEARCH_STACK];
     int i;
     fastf_t tmp, dist, Filter, ScaleFilter;
     vect_t t, Centroid;
@@ -869,18 +1080,22 @@ GetEstimate(vect_t irrad, point_t pos, vect_t normal, fastf_t rad, int np, int m
     Search.Normal[1] = normal[1];
     Search.Normal[2] = normal[2];
 
-    Search.List = (struct PSN*)bu_calloc(Search.Max, sizeof(struct PSN), "PSN");
+    if (Search.Max > SEARCH_STACK)
+	Search.List = (struct PSN*)bu_calloc(Search.Max, sizeof(struct PSN), "PSN");
+    else
+	Search.List = List;
     do {
 	Search.Found = 0;
 	Search.RadSq *= 4.0;
-	LocatePhotons(&Search, PMap[map]->Root);
+	LocatePhotons(&Search, PMap[map]);
 	if (!Search.Found && Search.RadSq > ScaleFactor*ScaleFactor/100.0)
 	    break;
     } while (Search.Found < Search.Max && Search.RadSq < max_rad*max_rad);
 
     /* bu_log("Found: %d\n", Search.Found);*/
     if (Search.Found < min_np) {
-	bu_free(Search.List, "Search.List");
+	if (Search.List != List)
+	    bu_free(Search.List, "Search.List");
 	return;
     }
 
@@ -889,13 +1104,13 @@ GetEstimate(vect_t irrad, point_t pos, vect_t normal, fastf_t rad, int np, int m
     Centroid[0] = Centroid[1] = Centroid[2] = 0;
 
     for (i = 0; i < Search.Found; i++) {
-	t[0] = Search.List[i].P.Pos[0] - pos[0];
-	t[1] = Search.List[i].P.Pos[1] - pos[1];
-	t[2] = Search.List[i].P.Pos[2] - pos[2];
+	t[0] = Search.List[i].P->Pos[0] - pos[0];
+	t[1] = Search.List[i].P->Pos[1] - pos[1];
+	t[2] = Search.List[i].P->Pos[2] - pos[2];
 
-	Centroid[0] += Search.List[i].P.Pos[0];
-	Centroid[1] += Search.List[i].P.Pos[1];
-	Centroid[2] += Search.List[i].P.Pos[2];
+	Centroid[0] += Search.List[i].P->Pos[0];
+	Centroid[1] += Search.List[i].P->Pos[1];
+	Centroid[2] += Search.List[i].P->Pos[2];
 
 	dist = t[0]*t[0] + t[1]*t[1] + t[2]*t[2];
 	if (dist > Search.RadSq)
@@ -920,18 +1135,18 @@ GetEstimate(vect_t irrad, point_t pos, vect_t normal, fastf_t rad, int np, int m
     }
 
     for (i = 0; i < Search.Found; i++) {
-	t[0] = Search.List[i].P.Pos[0] - pos[0];
-	t[1] = Search.List[i].P.Pos[1] - pos[1];
-	t[2] = Search.List[i].P.Pos[2] - pos[2];
+	t[0] = Search.List[i].P->Pos[0] - pos[0];
+	t[1] = Search.List[i].P->Pos[1] - pos[1];
+	t[2] = Search.List[i].P->Pos[2] - pos[2];
 
 	dist = t[0]*t[0] + t[1]*t[1] + t[2]*t[2];
 	/* Filter= 0.50;*/
 	/* Filter= ConeFilter(dist, NP.RadSq);*/
 	Filter = 0.5*GaussFilter(dist, Search.RadSq);
 
-	irrad[0] += Search.List[i].P.Power[0]*Filter*ScaleFilter;
-	irrad[1] += Search.List[i].P.Power[1]*Filter*ScaleFilter;
-	irrad[2] += Search.List[i].P.Power[2]*Filter*ScaleFilter;
+	irrad[0] += Search.List[i].P->Power[0]*Filter*ScaleFilter;
+	irrad[1] += Search.List[i].P->Power[1]*Filter*ScaleFilter;
+	irrad[2] += Search.List[i].P->Power[2]*Filter*ScaleFilter;
     }
 
     t[0] = sqrt((Centroid[0] - pos[0])*(Centroid[0] - pos[0])+(Centroid[1] - pos[1])*(Centroid[1] - pos[1])+(Centroid[2] - pos[2])*(Centroid[2] - pos[2]));
@@ -959,7 +1174,8 @@ GetEstimate(vect_t irrad, point_t pos, vect_t normal, fastf_t rad, int np, int m
       irrad[1] *= M_1_PI / NP.RadSq;
       irrad[2] *= M_1_PI / NP.RadSq;
     */
-    bu_free(Search.List, "Search.List");
+    if (Search.List != List)
+	bu_free(Search.List, "Search.List");
     /* bu_log("Radius: %.3f, Max Phot: %d, Found: %d, Power: [%.4f, %.4f, %.4f], Pos: [%.3f, %.3f, %.3f]\n", sqrt(NP.RadSq), NP.Max, NP.Found, irrad[0], irrad[1], irrad[2], pos[0], pos[1], pos[2]);*/
 }
 
@@ -1026,7 +1242,7 @@ Polar2Euclidian(vect_t Dir, vect_t Normal, double Theta, double Phi)
  * Irradiance Calculation for a given position
  */
 void
-Irradiance(int pid, struct Photon *P, struct application *ap)
+Irradiance(int pid, struct Photon *P, struct application *ap, uint64_t *Seed)
 {
     struct application *lap;		/* local application instance */
     int i, j, M, N;
@@ -1044,13 +1260,8 @@ Irradiance(int pid, struct Photon *P, struct application *ap)
     P->Irrad[0] = P->Irrad[1] = P->Irrad[2] = 0.0;
     for (i = 1; i <= M; i++) {
 	for (j = 1; j <= N; j++) {
-#ifndef HAVE_DRAND48
-	    theta = asin(sqrt((j-rand()/(double)RAND_MAX)/M));
-	    phi = (M_2PI)*((i-rand()/(double)RAND_MAX)/N);
-#else
-	    theta = asin(sqrt((j-drand48())/M));
-	    phi = (M_2PI)*((i-drand48())/N);
-#endif
+	    theta = asin(sqrt((j-PRand(Seed))/M));
+	    phi = (M_2PI)*((i-PRand(Seed))/N);
 
 	    /* Assign pt */
 	    lap->a_ray.r_pt[0] = P->Pos[0];
@@ -1079,81 +1290,73 @@ Irradiance(int pid, struct Photon *P, struct application *ap)
 }
 
 
+struct IrradianceJob {
+    struct application *ap;
+    int Seed;
+    int Next;				/* semaphored */
+    int64_t Start;
+    int64_t Report;			/* semaphored */
+};
+
+
+static void
+IrradianceProgress(int Done, int Total, int64_t Elapsed)
+{
+    struct bu_vls msg = BU_VLS_INIT_ZERO;
+    double p, tl;
+
+    p = (double)Done/(double)Total;
+    bu_vls_printf(&msg, "    Irradiance Cache Progress: %d%%", (int)(100.0*p));
+    if (p > 0.0) {
+	/* seconds left if the remaining photons go as fast as the first ones */
+	tl = (1.0/p - 1.0) * (double)Elapsed / 1.0e6;
+	bu_vls_printf(&msg, "  Approximate time left:");
+	if (tl >= 86400.0)
+	    bu_vls_printf(&msg, " %dd", (int)(tl/86400.0));
+	if (tl >= 3600.0)
+	    bu_vls_printf(&msg, " %dh", (int)fmod(tl/3600.0, 24.0));
+	if (tl >= 60.0)
+	    bu_vls_printf(&msg, " %dm", (int)fmod(tl/60.0, 60.0));
+	bu_vls_printf(&msg, " %ds", (int)fmod(tl, 60.0));
+    }
+    bu_log("%s\n", bu_vls_cstr(&msg));
+    bu_vls_free(&msg);
+}
+
+
 /*
  * Irradiance Cache for Indirect Illumination
  * Go through each photon and use it for the position of the hemisphere
  * and then determine whether that should be included as a Cache Pt.
+ * Threads claim IC_BATCH photons at a time; whichever thread claims a
+ * batch once IC_REPORT seconds have passed reports the progress.
  */
 void
-BuildIrradianceCache(int pid, struct PNode *Node, struct application *ap)
+IrradianceThread(int pid, void *arg)
 {
-    static int sem_photonmap = 0;
-    if (!sem_photonmap)
-	sem_photonmap = bu_semaphore_register("sem_photonmap");
-
-    if (!Node)
-	return;
+    struct IrradianceJob *job = (struct IrradianceJob *)arg;
+    struct PhotonMap *PM = PMap[PM_GLOBAL];
+    uint64_t Seed = PSeed(job->Seed + pid);
+    int64_t now;
+    int i, first;
 
-    /* Determine if this pt will be used by calculating a weight */
-    bu_semaphore_acquire(sem_photonmap);
-    if (!Node->C) {
-	ICSize++;
-	Node->C++;
-#ifndef HAVE_ALARM
-	if (!(ICSize%(PMap[PM_GLOBAL]->MaxPhotons/8)))
-	    bu_log("    Irradiance Cache Progress: %d%%\n", (int)(0.5+100.0*ICSize/PMap[PM_GLOBAL]->MaxPhotons));
-#endif
-	bu_semaphore_release(sem_photonmap);
-	Irradiance(pid, &Node->P, ap);
-    } else {
+    while (1) {
+	bu_semaphore_acquire(sem_photonmap);
+	first = job->Next;
+	job->Next += IC_BATCH;
+	now = bu_gettime();
+	if (first < PM->StoredPhotons && now - job->Report >= (int64_t)IC_REPORT * 1000000) {
+	    job->Report = now;
+	    IrradianceProgress(first, PM->StoredPhotons, now - job->Start);
+	}
 	bu_semaphore_release(sem_photonmap);
-    }
 
-    BuildIrradianceCache(pid, Node->L, ap);
-    BuildIrradianceCache(pid, Node->R, ap);
-}
-
-
-#ifdef HAVE_ALARM
-static int starttime = 0;
-void
-alarmhandler(int sig)
-{
-    int t;
-    float p, tl;
-    if (sig != SIGALRM)
-	bu_bomb("Funky signals\n");
-    t = time(NULL) - starttime;
-    p = (float)ICSize/PMap[PM_GLOBAL]->MaxPhotons + .015;
-    tl = (float)t*1.0/p - t;
-    bu_log("    Irradiance Cache Progress: %d%%  Approximate time left: %f%f",
-	   (int)(100.0*p), (1.0/p-1.0)*(float)t, (float)t*1.0/p);
-#define BAH(s, w) if (tl > (s)) { float d = floor(tl / (((s) == 0)?1.0:(float)(s))); \
-	tl -= d * (s); bu_log("%d "w, (int)d, d>1?"s":""); }
-    BAH(60*60*24, "day%s, ");
-    BAH(60*60, "hour%s, ");
-    BAH(60, "minute%s, ");
-    BAH(0, "second%s.");
-#undef BAH
-    bu_log("\n");
-    alarm(60);
-    return;
-}
-#endif
+	if (first >= PM->StoredPhotons)
+	    return;
 
-void
-IrradianceThread(int pid, void *arg)
-{
-#ifdef HAVE_ALARM
-    starttime = time(NULL);
-    signal(SIGALRM, alarmhandler);
-    alarm(60);
-    BuildIrradianceCache(pid, PMap[PM_GLOBAL]->Root, (struct application*)arg);
-    alarm(0);
-    starttime = 0;
-#else
-    BuildIrradianceCache(pid, PMap[PM_GLOBAL]->Root, (struct application*)arg);
-#endif
+	for (i = first; i < first + IC_BATCH && i < PM->StoredPhotons; i++)
+	    Irradiance(pid, &PM->Photons[i], job->ap, &Seed);
+    }
 }
 
 
@@ -1162,22 +1365,16 @@ Initialize(int MAP, int MapSize)
 {
     BU_ALLOC(PMap[MAP], struct PhotonMap);
     PMap[MAP]->MaxPhotons = MapSize;
-
-    BU_ALLOC(PMap[MAP]->Root, struct PNode);
     PMap[MAP]->StoredPhotons = 0;
-    if (MapSize > 0)
-	BU_ALLOC(Emit[MAP], struct Photon);
-    else
-	Emit[MAP] = NULL;
 }
 
 
 int
-LoadFile(char *pmfile)
+LoadFile(char *pmfile, int cpus)
 {
     size_t ret;
     FILE *FH;
-    int I1 = 0, i;
+    int I1 = 0;
     short S1;
     char C1;
 
@@ -1225,13 +1422,12 @@ LoadFile(char *pmfile)
 
 	Initialize(PM_GLOBAL, I1);
 	bu_log("Reading Global: %d\n", I1);
-	for (i = 0; i < I1; i++) {
-	    ret = fread(&Emit[PM_GLOBAL][i], sizeof(struct Photon), 1, FH);
-	    if (ret != 1) {
+	if (I1) {
+	    PMap[PM_GLOBAL]->Photons = (struct Photon *)bu_calloc(I1, sizeof(struct Photon), "Photons");
+	    ret = fread(PMap[PM_GLOBAL]->Photons, sizeof(struct Photon), I1, FH);
+	    if (ret != (size_t)I1) {
 		fclose(FH);
 		bu_log("Error reading irradiance cache file (global)\n");
-	    /* bu_log("Pos: [%.3f, %.3f, %.3f], Power: [%.3f, %.3f, %.3f]\n", Emit[PM_GLOBAL][i].Pos[0], Emit[PM_GLOBAL][i].Pos[1], Emit[PM_GLOBAL][i].Pos[2], Emit[PM_GLOBAL][i].Power[0], Emit[PM_GLOBAL][i].Power[1], Emit[PM_GLOBAL][i].Power[2]);*/
-	    /* bu_log("Pos: [%.3f, %.3f, %.3f], Irrad: [%.3f, %.3f, %.3f]\n", Emit[PM_GLOBAL][i].Pos[0], Emit[PM_GLOBAL][i].Pos[1], Emit[PM_GLOBAL][i].Pos[2], Emit[PM_GLOBAL][i].Irrad[0], Emit[PM_GLOBAL][i].Irrad[1], Emit[PM_GLOBAL][i].Irrad[2]);*/
 		return 0;
 	    }
 	}
@@ -1252,9 +1448,10 @@ LoadFile(char *pmfile)
 
 	Initialize(PM_CAUSTIC, I1);
 	bu_log("Reading Caustic: %d\n", I1);
-	for (i = 0; i < I1; i++) {
-	    ret = fread(&Emit[PM_CAUSTIC][i], sizeof(struct Photon), 1, FH);
-	    if (ret != 1) {
+	if (I1) {
+	    PMap[PM_CAUSTIC]->Photons = (struct Photon *)bu_calloc(I1, sizeof(struct Photon), "Photons");
+	    ret = fread(PMap[PM_CAUSTIC]->Photons, sizeof(struct Photon), I1, FH);
+	    if (ret != (size_t)I1) {
 		fclose(FH);
 		bu_log("Error reading irradiance cache file (caustic)\n");
 		return 0;
@@ -1262,10 +1459,10 @@ LoadFile(char *pmfile)
 	}
 
 	PMap[PM_GLOBAL]->StoredPhotons = PMap[PM_GLOBAL]->MaxPhotons;
-	BuildTree(Emit[PM_GLOBAL], PMap[PM_GLOBAL]->StoredPhotons, PMap[PM_GLOBAL]->Root);
+	BuildTree(PMap[PM_GLOBAL], cpus);
 
 	PMap[PM_CAUSTIC]->StoredPhotons = PMap[PM_CAUSTIC]->MaxPhotons;
-	BuildTree(Emit[PM_CAUSTIC], PMap[PM_CAUSTIC]->StoredPhotons, PMap[PM_CAUSTIC]->Root);
+	BuildTree(PMap[PM_CAUSTIC], cpus);
 	fclose(FH);
 	return 1;
     }
@@ -1275,17 +1472,16 @@ LoadFile(char *pmfile)
 
 
 void
-WritePhotons(struct PNode *Root, FILE *FH)
+WritePhotons(struct PhotonMap *PM, FILE *FH)
 {
     size_t ret;
-    if (!Root)
+
+    if (!PM->StoredPhotons)
 	return;
 
-    ret = fwrite(&Root->P, sizeof(struct Photon), 1, FH);
-    if (ret != 1)
+    ret = fwrite(PM->Photons, sizeof(struct Photon), PM->StoredPhotons, FH);
+    if (ret != (size_t)PM->StoredPhotons)
 	bu_log("Unable to write photons\n");
-    WritePhotons(Root->L, FH);
-    WritePhotons(Root->R, FH);
 }
 
 
@@ -1330,8 +1526,7 @@ WritePhotonFile(char *pmfile)
 	    bu_log("Error writing irradiance cache file (photons)\n");
 
 	/* Write each photon to file */
-	if (PMap[PM_GLOBAL]->StoredPhotons)
-	    WritePhotons(PMap[PM_GLOBAL]->Root, FH);
+	WritePhotons(PMap[PM_GLOBAL], FH);
 
 	/* === Write PM_CAUSTIC Data === */
 	C1 = PM_CAUSTIC;
@@ -1346,8 +1541,7 @@ WritePhotonFile(char *pmfile)
 	    bu_log("Error writing irradiance cache file (number of photons)\n");
 
 	/* Write each photon to file */
-	if (PMap[PM_CAUSTIC]->StoredPhotons)
-	    WritePhotons(PMap[PM_CAUSTIC]->Root, FH);
+	WritePhotons(PMap[PM_CAUSTIC], FH);
 
 	fclose(FH);
     }
@@ -1360,7 +1554,9 @@ WritePhotonFile(char *pmfile)
 void
 BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int height, int UNUSED(Hypersample), int GlobalPhotons, double CausticsPercent, int Rays, double AngularTolerance, int RandomSeed, int ImportanceMapping, int IrradianceHypersampling, int VisualizeIrradiance, double ScaleIndirect, char pmfile[255])
 {
-    int i, MapSize[PM_MAPS];
+    struct PhotonEmission pe;
+    struct IrradianceJob job;
+    int i, j, MapSize[PM_MAPS], EPL, EPS[PM_MAPS], HitG, HitB;
     double ratio;
 
     PM_Visualize = VisualizeIrradiance;
@@ -1368,9 +1564,16 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
     GPM_WIDTH = width;
     GPM_HEIGHT = height;
 
+    if (cpus < 1)
+	cpus = 1;
+    if (cpus > MAX_PSW)
+	cpus = MAX_PSW;
+    if (!sem_photonmap)
+	sem_photonmap = bu_semaphore_register("sem_photonmap");
+
     /* If the user has specified a cache file then first check to see if there is any valid data within it,
        otherwise utilize the file to push the resulting irradiance cache data into for future use. */
-    if (!LoadFile(pmfile)) {
+    if (!LoadFile(pmfile, cpus)) {
 	/*
 	  bu_log("pos: [%.3f, %.3f, %.3f]\n", eye_pos[0], eye_pos[1], eye_pos[2]);
 	  bu_log("I, V, Imp, H: %.3f, %d, %d, %d\n", LightIntensity, VisualizeIrradiance, ImportanceMapping, IrradianceHypersampling);
@@ -1383,23 +1586,11 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
 
 	PInit = 1;
 
-#ifndef HAVE_SRAND48
-	srand(RandomSeed);
-#else
-	srand48(RandomSeed);
-#endif
-	/* bu_log("Photon Structure Size: %d\n", sizeof(struct PNode));*/
-
 	/*
 	  bu_log("Checking application struct\n");
 	  RT_CK_APPLICATION(ap);
 	*/
 
-	/* Initialize Emitted Photons for each map to 0 */
-	EPL = 0;
-	for (i = 0; i < PM_MAPS; i++)
-	    EPS[i] = 0;
-
 	CausticsPercent /= 100.0;
 	MapSize[PM_IMPORTANCE] = GlobalPhotons/8;
 	MapSize[PM_GLOBAL] = (int)((1.0-CausticsPercent)*GlobalPhotons);
@@ -1413,6 +1604,11 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
 	Initialize(PM_SHADOW, MapSize[PM_SHADOW]);
 	Initialize(PM_IMPORTANCE, MapSize[PM_IMPORTANCE]);
 
+	memset(GPM_RTAB, 0, sizeof(GPM_RTAB));
+	for (i = 0; i < cpus; i++) {
+	    rt_init_resource(&GPM_RTAB[i], i, ap->a_rt_i);
+	}
+
 	/* Populate Application Structure */
 	/* Set Recursion Level, Magic Number, Hit/Miss Callbacks, and Purpose */
 	ap->a_level = 1;
@@ -1423,22 +1619,46 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
 	ap->a_logoverlap = rt_silent_logoverlap;
 	ap->a_purpose = "Importance Mapping";
 
+	/* Each thread traces its own photons with its own random numbers */
+	memset(&pe, 0, sizeof(pe));
+	pe.ap = ap;
+	pe.cpus = cpus;
+	VMOVE(pe.Eye, eye_pos);
+	pe.ScaleIndirect = ScaleIndirect;
+	pe.Workers = (struct PhotonWorker *)bu_calloc(cpus, sizeof(struct PhotonWorker), "PhotonWorker");
+	for (i = 0; i < cpus; i++)
+	    pe.Workers[i].Seed = PSeed(RandomSeed + i);
 
 	if (ImportanceMapping) {
 	    bu_log("  Building Importance Map...\n");
-	    EmitImportonsRandom(ap, eye_pos);
-	    BuildTree(Emit[PM_IMPORTANCE], PMap[PM_IMPORTANCE]->StoredPhotons, PMap[PM_IMPORTANCE]->Root);
+	    pe.Importons = 1;
+	    EmitPhotons(&pe);
+	    BuildTree(PMap[PM_IMPORTANCE], cpus);
 	    ScaleFactor = MaxFloat(BBMax[0]-BBMin[0], BBMax[1]-BBMin[1], BBMax[2]-BBMin[2]);
 	}
 
-	HitG = HitB = 0;
 	bu_log("  Emitting Photons...\n");
-	EmitPhotonsRandom(ap, ScaleIndirect);
-	/* EmitPhotonsRandom(ap, &(LightHead.l), LightIntensity);*/
+	pe.Importons = 0;
+	EmitPhotons(&pe);
 
 	/* Generate Scale Factor */
 	ScaleFactor = MaxFloat(BBMax[0]-BBMin[0], BBMax[1]-BBMin[1], BBMax[2]-BBMin[2]);
 
+	/* Initialize Emitted Photons for each map to 0 */
+	EPL = HitG = HitB = 0;
+	for (j = 0; j < PM_MAPS; j++)
+	    EPS[j] = 0;
+	for (i = 0; i < cpus; i++) {
+	    EPL += pe.Workers[i].EPL;
+	    HitG += pe.Workers[i].HitG;
+	    HitB += pe.Workers[i].HitB;
+	    for (j = 0; j < PM_MAPS; j++) {
+		EPS[j] += pe.Workers[i].EPS[j];
+		bu_free(pe.Workers[i].Buf[j], "Photons");
+	    }
+	}
+	bu_free(pe.Workers, "PhotonWorker");
+
 	bu_log("HitGB: %d, %d\n", HitG, HitB);
 	bu_log("Scale Factor: %.3f\n", ScaleFactor);
 	ratio = (double)HitG/((double)(HitG+HitB));
@@ -1447,20 +1667,14 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
 	EPS[PM_CAUSTIC] *= ratio;
 
 	/* Scale Photon Power */
-	ScalePhotonPower(PM_GLOBAL);
-	ScalePhotonPower(PM_CAUSTIC);
-
-	/*
-	  for (i = 0; i < PMap->StoredPhotons; i++)
-	  bu_log("insertLS[%d]: %.3f, %.3f, %.3f\n", i, Emit[i].Pos[0], Emit[i].Pos[1], Emit[i].Pos[2]);
-	*/
+	ScalePhotonPower(PM_GLOBAL, (double)EPS[PM_GLOBAL]);
+	ScalePhotonPower(PM_CAUSTIC, (double)EPS[PM_CAUSTIC]);
 
 
 	bu_log("  Building KD-Tree...\n");
 	/* Balance KD-Tree */
 	for (i = 0; i < 3; i++)
-	    if (PMap[i]->StoredPhotons)
-		BuildTree(Emit[i], PMap[i]->StoredPhotons, PMap[i]->Root);
+	    BuildTree(PMap[i], cpus);
 
 
 	bu_log("  Building Irradiance Cache...\n");
@@ -1470,17 +1684,16 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
 	ap->a_hit = ICHit;
 	ap->a_miss = ICMiss;
 	ap->a_logoverlap = rt_silent_logoverlap;
-	ICSize = 0;
 
+	job.ap = ap;
+	job.Seed = RandomSeed;
+	job.Next = 0;
+	job.Start = job.Report = bu_gettime();
 	if (cpus > 1) {
-	    memset(GPM_RTAB, 0, sizeof(GPM_RTAB));
-	    for (i = 0; i < MAX_PSW; i++) {
-		rt_init_resource(&GPM_RTAB[i], i, ap->a_rt_i);
-	    }
-	    bu_parallel(IrradianceThread, cpus, ap);
+	    bu_parallel(IrradianceThread, cpus, &job);
 	} else {
 	    /* This will allow profiling for single threaded rendering */
-	    IrradianceThread(0, ap);
+	    IrradianceThread(0, &job);
 	}
 
 	/* Allocate Memory for Irradiance Cache and Initialize Pixel Map */
@@ -1494,89 +1707,8 @@ BuildPhotonMap(struct application *ap, point_t eye_pos, int cpus, int width, int
 	    }
 	}
 
-
-	/*
-	  bu_log("  Sanity Check...\n");
-	  SanityCheck(PMap[PM_GLOBAL]->Root, 0);
-	*/
-
 	WritePhotonFile(pmfile);
-
-	for (i = 0; i < PM_MAPS; i++) {
-	    bu_free(Emit[i], "Photons");
-	    Emit[i] = NULL;
-	}
-
-    }
-}
-
-
-void
-Swap(struct PSN *a, struct PSN *b)
-{
-    struct PSN c;
-
-    /*
-      c.P = a->P;
-      c.Dist = a->Dist;
-      a->P = b->P;
-      a->Dist = b->Dist;
-      b->P = c.P;
-      b->Dist = c.Dist;
-    */
-    /* bu_log("  SWAP_IN: %.3f, %.3f\n", a->Dist, b->Dist);*/
-    memcpy(&c, a, sizeof(struct PSN));
-    memcpy(a, b, sizeof(struct PSN));
-    memcpy(b, &c, sizeof(struct PSN));
-    /* bu_log("  SWAP_OT: %.3f, %.3f\n", a->Dist, b->Dist);*/
-}
-
-
-/*
-  After inserting a new node it must be brought upwards until both children
-  are less than it.
-*/
-void
-HeapUp(struct PhotonSearch *S, int ind)
-{
-    int i;
-
-    if (!ind)
-	return;
-
-    i = ((ind+1)-(ind+1)%2)/2-1;
-    /* bu_log("  CHECK: %.3f > %.3f :: [%d] > [%d]\n", S->List[ind].Dist, S->List[i].Dist, ind, i);*/
-    if (S->List[ind].Dist > S->List[i].Dist) {
-	/* bu_log("SWAP_A: %.3f, %.3f\n", S->List[i].Dist, S->List[ind].Dist);*/
-	Swap(&S->List[i], &S->List[ind]);
-	/* bu_log("SWAP_B: %.3f, %.3f\n", S->List[i].Dist, S->List[ind].Dist);*/
-    }
-    HeapUp(S, i);
-}
-
-
-/*
-  Sift the new Root node down, by choosing the child with the highest number
-  since choosing a child with the highest number may reduce the number of
-  recursions the number will have to propagate
-*/
-void
-HeapDown(struct PhotonSearch *S, int ind)
-{
-    int c;
-
-    if (2*ind+1 > S->Found)
-	return;
-
-    c = 2*ind+1 < S->Found ? S->List[2*ind+2].Dist > S->List[2*ind+1].Dist ? 2*ind+2 : 2*ind+1 : 2*ind+1;
-    /* bu_log(" c: %d\n", c);*/
-
-    if (S->List[c].Dist > S->List[ind].Dist) {
-	/* bu_log("SWAP_C: %.3f, %.3f :: %d, %d :: %d\n", S->List[c].Dist, S->List[ind].Dist, c, ind, S->Found);*/
-	Swap(&S->List[c], &S->List[ind]);
-	/* bu_log("SWAP_D: %.3f, %.3f :: %d, %d :: %d\n", S->List[c].Dist, S->List[ind].Dist, c, ind, S->Found);*/
     }
-    HeapDown(S, c);
 }
 
 
@@ -1591,6 +1723,7 @@ void
 IrradianceEstimate(struct application *ap, vect_t irrad, point_t pos, vect_t normal)
 {
     struct PhotonSearch Search;
+    struct PSN List[32];
     int i, idx;
     fastf_t dist, TotDist;
     vect_t t, cirrad;
@@ -1635,51 +1768,50 @@ IrradianceEstimate(struct application *ap, vect_t irrad, point_t pos, vect_t nor
     /* NP.RadSq = (4.0*ScaleFactor/PMap[PM_GLOBAL]->MaxPhotons) * (4.0*ScaleFactor/PMap[PM_GLOBAL]->MaxPhotons);*/
     /* NP.Max = 2.0*pow(PMap[PM_GLOBAL]->StoredPhotons, 0.5);*/
     /* Search.Max = PMap[PM_GLOBAL]->StoredPhotons / 50;*/
-    Search.Max = 32;
+    Search.Max = sizeof(List)/sizeof(List[0]);
 
     Search.Normal[0] = normal[0];
     Search.Normal[1] = normal[1];
     Search.Normal[2] = normal[2];
 
-    Search.List = (struct PSN*)bu_calloc(Search.Max, sizeof(struct PSN), "Search.List");
+    Search.List = List;
     do {
 	Search.Found = 0;
 	Search.RadSq *= 4.0;
-	LocatePhotons(&Search, PMap[PM_GLOBAL]->Root);
+	LocatePhotons(&Search, PMap[PM_GLOBAL]);
     } while (Search.Found < Search.Max && Search.RadSq < ScaleFactor * ScaleFactor / 64.0);
 
 
     irrad[0] = irrad[1] = irrad[2] = 0;
     TotDist = 0;
     for (i = 0; i < Search.Found; i++) {
-	t[0] = Search.List[i].P.Pos[0] - pos[0];
-	t[1] = Search.List[i].P.Pos[1] - pos[1];
-	t[2] = Search.List[i].P.Pos[2] - pos[2];
+	t[0] = Search.List[i].P->Pos[0] - pos[0];
+	t[1] = Search.List[i].P->Pos[1] - pos[1];
+	t[2] = Search.List[i].P->Pos[2] - pos[2];
 	TotDist += t[0]*t[0] + t[1]*t[1] + t[2]*t[2];
     }
 
 
     for (i = 0; i < Search.Found; i++) {
-	t[0] = Search.List[i].P.Pos[0] - pos[0];
-	t[1] = Search.List[i].P.Pos[1] - pos[1];
-	t[2] = Search.List[i].P.Pos[2] - pos[2];
+	t[0] = Search.List[i].P->Pos[0] - pos[0];
+	t[1] = Search.List[i].P->Pos[1] - pos[1];
+	t[2] = Search.List[i].P->Pos[2] - pos[2];
 
 	t[0] = (t[0]*t[0] + t[1]*t[1] + t[2]*t[2])/TotDist;
 	/*
-	  irrad[0] += Search.List[i].P.Irrad[0] * t[0];
-	  irrad[1] += Search.List[i].P.Irrad[1] * t[0];
-	  irrad[2] += Search.List[i].P.Irrad[2] * t[0];
+	  irrad[0] += Search.List[i].P->Irrad[0] * t[0];
+	  irrad[1] += Search.List[i].P->Irrad[1] * t[0];
+	  irrad[2] += Search.List[i].P->Irrad[2] * t[0];
 	*/
-	irrad[0] += Search.List[i].P.Irrad[0];
-	irrad[1] += Search.List[i].P.Irrad[1];
-	irrad[2] += Search.List[i].P.Irrad[2];
+	irrad[0] += Search.List[i].P->Irrad[0];
+	irrad[1] += Search.List[i].P->Irrad[1];
+	irrad[2] += Search.List[i].P->Irrad[2];
     }
     if (Search.Found) {
 	irrad[0] /= (double)Search.Found;
 	irrad[1] /= (double)Search.Found;
 	irrad[2] /= (double)Search.Found;
     }
-    bu_free(Search.List, "Search.List");
 
     /* GetEstimate(cirrad, pos, normal, (int)(ScaleFactor/100.0), PMap[PM_CAUSTIC]->MaxPhotons/50, PM_CAUSTIC, 1, 0);*/
     /* GetEstimate(cirrad, pos, normal, (int)(ScaleFactor/pow(2, (log(PMap[PM_CAUSTIC]->MaxPhotons/2)/log(4)))), PMap[PM_CAUSTIC]->MaxPhotons / 50, PM_CAUSTIC, 0, 0);*/
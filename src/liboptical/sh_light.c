@@ -1130,6 +1130,62 @@ light_miss(register struct application *ap)
 }
 
 
+/*
+ * Shaders whose only source of transparency is a transmit parameter
+ * that sets reg_transmit at setup time.  Anything else may set
+ * sw_transmit while shading, so it has to be shaded to be sure.
+ */
+static const char *opaque_shaders[] = {
+    "default", "phong", "plastic", "mirror", "cook", "cmirror", NULL
+};
+
+
+/*
+ * What light_occluder() is handed through a_uptr: the light shot at,
+ * and whether the ray was seen to meet that light's region.
+ */
+struct light_target {
+    struct light_specific *lsp;
+    int reached;
+};
+
+
+/**
+ * rt_occluded() callback for shadow rays.  Regions with one of the
+ * opaque_shaders[] and no reg_transmit block the light.  Lights, air
+ * and anything that might transmit need the shading done by
+ * light_hit(), so they are left undecided, except for the light being
+ * shot at, which the ray is meant to reach and which is noted in
+ * lt->reached.
+ */
+static int
+light_occluder(struct application *ap, const struct region *regp)
+{
+    struct light_target *lt = (struct light_target *)(ap->a_uptr);
+    struct light_specific *lspi;
+    const char **name;
+
+    if (regp == lt->lsp->lt_rp) {
+	lt->reached = 1;
+	return 0;
+    }
+    if (regp->reg_aircode != 0)
+	return -1;
+    for (BU_LIST_FOR(lspi, light_specific, &(LightHead.l))) {
+	if (lspi->lt_rp == regp)
+	    return -1;
+    }
+    if (regp->reg_transmit || !regp->reg_mfuncs)
+	return -1;
+
+    for (name = opaque_shaders; *name; name++) {
+	if (BU_STR_EQUAL(((struct mfuncs *)regp->reg_mfuncs)->mf_name, *name))
+	    return 1;
+    }
+    return -1;
+}
+
+
 #define VF_SEEN 1
 #define VF_BACKFACE 2
 
@@ -1155,6 +1211,10 @@ light_vis(struct light_obs_stuff *los, char *flags)
     int tryagain = 0;
     double VisRayvsLightN;
     double VisRayvsSurfN;
+    fastf_t light_dist = 0.0;	/* to the point shot at, 0 for infinite lights */
+    fastf_t occ_dist;
+    int occ_status;
+    struct light_target target;
 
     if (optical_debug & OPTICAL_DEBUG_LIGHT) bu_log("light_vis\n");
 
@@ -1347,6 +1407,8 @@ light_vis(struct light_obs_stuff *los, char *flags)
 	bu_semaphore_release(BU_SEM_SYSCALL);
     }
 
+    if (!los->lsp->lt_infinite)
+	light_dist = MAGNITUDE(shoot_dir);
     VUNITIZE(shoot_dir);
 
     /*
@@ -1410,6 +1472,38 @@ light_vis(struct light_obs_stuff *los, char *flags)
     RT_CK_LIGHT((struct light_specific *)(sub_ap.a_uptr));
     RT_CK_AP(&sub_ap);
 
+    /* Most shadow rays only need to know whether something opaque is
+     * in the way, which rt_occluded() answers without building the
+     * partition list.  Only shade along the ray when it meets
+     * something that might let light through.
+     *
+     * A visible, finite light is only lit when the ray meets it, so
+     * its ray runs just past the point shot at, which should be on or
+     * in the light's region.  Should the ray get there without
+     * meeting the region, light_hit() has to decide.
+     */
+    target.lsp = los->lsp;
+    target.reached = 0;
+    sub_ap.a_uptr = (void *)&target;
+    if (los->lsp->lt_invisible || los->lsp->lt_infinite)
+	occ_dist = light_dist - los->ap->a_rt_i->rti_tol.dist;
+    else
+	occ_dist = light_dist + los->ap->a_rt_i->rti_tol.dist;
+    occ_status = rt_occluded(&sub_ap, occ_dist, light_occluder);
+    sub_ap.a_uptr = (void *)los->lsp;
+
+    if (occ_status > 0) {
+	if (optical_debug & OPTICAL_DEBUG_LIGHT)
+	    bu_log("light occluded: %s\n", los->lsp->lt_name);
+	return 0;
+    }
+    if (occ_status == 0 && (los->lsp->lt_invisible || los->lsp->lt_infinite || target.reached)) {
+	if (optical_debug & OPTICAL_DEBUG_LIGHT)
+	    bu_log("light unoccluded: %s\n", los->lsp->lt_name);
+	VSETALL(los->inten, 1);
+	return 1;
+    }
+
     if (optical_debug & OPTICAL_DEBUG_LIGHT)
 	bu_log("shooting level %d from %d\n", sub_ap.a_level, __LINE__);
 
@@ -77,6 +77,10 @@
 #  include <sys/uio.h>		/* for struct iovec (writev) */
 #endif
 
+#ifdef HAVE_POLL_H
+#  include <poll.h>
+#endif
+
 #include <errno.h>
 
 #include "bio.h"
@@ -117,6 +121,16 @@ extern struct hostent *gethostbyname(const char *);
 #  define PKG_SEND(d, buf, nbytes) write((d), (buf), (nbytes))
 #endif
 
+#ifdef HAVE_WINSOCK_H
+#  define PKG_WOULDBLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#  define PKG_WOULDBLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif
+
+/* descriptors a connection reads from and writes to */
+#define PKG_INFD(pc) (((pc)->pkc_fd == PKG_STDIO_MODE) ? (pc)->pkc_in_fd : (pc)->pkc_fd)
+#define PKG_OUTFD(pc) (((pc)->pkc_fd == PKG_STDIO_MODE) ? (pc)->pkc_out_fd : (pc)->pkc_fd)
+
 #define PKG_CK(p) { \
 	if (p==PKC_NULL||p->pkc_magic!=PKG_MAGIC) { \
 		snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "%s: bad pointer %p line %d\n", __FILE__, (void *)(p), __LINE__); \
@@ -125,6 +139,7 @@ extern struct hostent *gethostbyname(const char *);
 }
 
 #define MAXQLEN 512	/* largest packet we will queue on stream */
+#define MAXIOV 16	/* most buffers handed to one writev() */
 
 /* A macro for logging a string message when the debug file is open */
 #ifndef NO_DEBUG_CHECKING
@@ -862,6 +877,108 @@ pkg_close(struct pkg_conn *pc)
 }
 
 
+static int _pkg_suckin(struct pkg_conn *pc, int *gotp);
+
+
+/**
+ * Wait up to msec milliseconds (forever when negative) for input on
+ * the connection, or, when wantwrite is set, for room to write.
+ * While waiting to write, any input that arrives is taken into the
+ * input buffer, so that two peers sending to each other at once
+ * cannot deadlock.
+ *
+ * Returns >0 when ready, 0 on timeout and -1 on error.
+ *
+ * This is a private implementation function.
+ */
+static int
+_pkg_wait(struct pkg_conn *pc, int wantwrite, int msec)
+{
+    int infd = PKG_INFD(pc);
+    int outfd = PKG_OUTFD(pc);
+    int i;
+#ifdef HAVE_POLL_H
+    struct pollfd pfd[2];
+    int npfd = 1;
+
+    pfd[0].fd = infd;
+    pfd[0].events = POLLIN;
+    if (wantwrite) {
+	if (outfd == infd) {
+	    pfd[0].events |= POLLOUT;
+	} else {
+	    pfd[1].fd = outfd;
+	    pfd[1].events = POLLOUT;
+	    npfd = 2;
+	}
+    }
+
+    for (;;) {
+	pfd[0].revents = pfd[1].revents = 0;
+	i = poll(pfd, npfd, msec);
+	if (i < 0 && errno == EINTR)
+	    continue;
+	if (i <= 0 || !wantwrite)
+	    return i;
+	if (pfd[npfd-1].revents & (POLLOUT|POLLERR|POLLHUP|POLLNVAL))
+	    return i;
+
+	/* Only input is ready; take it in and keep waiting */
+	if (_pkg_suckin(pc, NULL) < 1)
+	    return 1;	/* let the write discover what happened */
+    }
+#else
+    struct timeval tv;
+    fd_set ibits, obits;
+    int maxfd = (infd > outfd) ? infd : outfd;
+
+    for (;;) {
+	FD_ZERO(&ibits);
+	FD_ZERO(&obits);
+	FD_SET(infd, &ibits);
+	if (wantwrite)
+	    FD_SET(outfd, &obits);
+	tv.tv_sec = msec / 1000;
+	tv.tv_usec = (msec % 1000) * 1000;
+
+	// TODO - select doesn't work on non-socket file descriptors on Windows,
+	// so PKG_STDIO_MODE isn't going to fly there.
+	i = select(maxfd+1, &ibits, wantwrite ? &obits : (fd_set *)0, (fd_set *)0, (msec < 0) ? NULL : &tv);
+	if (i < 0 && errno == EINTR)
+	    continue;
+	if (i <= 0 || !wantwrite)
+	    return i;
+	if (FD_ISSET(outfd, &obits))
+	    return i;
+
+	if (_pkg_suckin(pc, NULL) < 1)
+	    return 1;
+    }
+#endif
+}
+
+
+/**
+ * Take in more input for a caller that cannot proceed without it.
+ * On a non-blocking connection with nothing to read yet, wait for
+ * input to arrive.  Returns as pkg_suckin().
+ *
+ * This is a private implementation function.
+ */
+static int
+_pkg_suckwait(struct pkg_conn *pc)
+{
+    int got;
+    int ret;
+
+    while ((ret = _pkg_suckin(pc, &got)) == 1 && got == 0) {
+	if (_pkg_wait(pc, 0, -1) < 0)
+	    return -1;
+    }
+    return ret;
+}
+
+
 /**
  * A functional replacement for bu_mread() through the first level
  * input buffer.
@@ -881,7 +998,7 @@ _pkg_inget(struct pkg_conn *pc, char *buf, size_t count)
 
 	while ((len = pc->pkc_inend - pc->pkc_incur) <= 0) {
 	    /* This can block */
-	    if (pkg_suckin(pc) < 1)
+	    if (_pkg_suckwait(pc) < 1)
 		return count - todo;
 	}
 	/* Input Buffer has some data in it, move to caller's buffer */
@@ -905,226 +1022,145 @@ _pkg_inget(struct pkg_conn *pc, char *buf, size_t count)
 static void
 _pkg_checkin(struct pkg_conn *pc, int nodelay)
 {
+    int i;
 
-    struct timeval tv;
-    fd_set bits;
-    ssize_t i;
-    unsigned int j;
-
-    /* Check socket for unexpected input */
-    tv.tv_sec = 0;
-    if (nodelay)
-	tv.tv_usec = 0;		/* poll -- no waiting */
-    else
-	tv.tv_usec = 20000;	/* 20 ms */
-
+    /* Check connection for unexpected input */
     errno = 0;
-    FD_ZERO(&bits);
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	FD_SET(pc->pkc_in_fd, &bits);
-    } else {
-	FD_SET(pc->pkc_fd, &bits);
-    }
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	// TODO - select doesn't work on non-socket file descriptors on Windows,
-	// so this isn't going to fly there.
-	i = select(pc->pkc_in_fd+1, &bits, (fd_set *)0, (fd_set *)0, &tv);
-    } else {
-	i = select(pc->pkc_fd+1, &bits, (fd_set *)0, (fd_set *)0, &tv);
-    }
+    i = _pkg_wait(pc, 0, nodelay ? 0 : 20);
     if (_pkg_debug) {
 	_pkg_timestamp();
 	fprintf(_pkg_debug,
-		"_pkg_checkin: select on fd %d returned %ld\n",
-		pc->pkc_fd,
-		(long int)i);
+		"_pkg_checkin: wait on fd %d returned %d\n",
+		pc->pkc_fd, i);
 	fflush(_pkg_debug);
     }
     if (i > 0) {
-	for (j = 0; j < FD_SETSIZE; j++)
-	    if (FD_ISSET(j, &bits)) break;
-
-	if (j < FD_SETSIZE) {
-	    /* Some fd is ready for I/O */
-	    (void)pkg_suckin(pc);
-	} else {
-	    /* Odd condition, bits! */
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE,
-		     "_pkg_checkin: select returned %ld, bits=0\n",
-		     (long int)i);
-	    (pc->pkc_errlog)(_pkg_errbuf);
-	}
+	(void)pkg_suckin(pc);
     } else if (i < 0) {
 	/* Error condition */
-	if (errno != EINTR && errno != EBADF)
-	    _pkg_perror(pc->pkc_errlog, "_pkg_checkin: select");
+	if (errno != EBADF)
+	    _pkg_perror(pc->pkc_errlog, "_pkg_checkin: wait");
     }
 }
 
 
-int
-pkg_send(int type, const char *buf, size_t len, struct pkg_conn *pc)
+/**
+ * Write out a list of buffers, picking up after partial writes, and
+ * waiting for room whenever a non-blocking connection is full.  At
+ * most MAXIOV buffers go to each writev().
+ *
+ * Returns the number of bytes written, which is short of the total
+ * only on error, or -1 if an error came before anything was written.
+ *
+ * This is a private implementation function.
+ */
+static ssize_t
+_pkg_writev(struct pkg_conn *pc, const struct pkg_iovec *iov, int cnt)
 {
-#ifdef HAVE_WRITEV
-    static struct iovec cmdvec[2];
-#endif
-    static struct pkg_header hdr;
+    int fd = PKG_OUTFD(pc);
+    size_t off = 0;	/* bytes of iov[0] already written */
+    ssize_t total = 0;
     ssize_t i;
 
-    PKG_CK(pc);
-
-    if (_pkg_debug) {
-	_pkg_timestamp();
-	fprintf(_pkg_debug,
-		"pkg_send(type=%d, buf=%p, len=%llu, pc=%p)\n",
-		type, (void *)buf, (unsigned long long)len, (void *)pc);
-	fflush(_pkg_debug);
-    }
-
-    /* Check for any pending input, no delay */
-    /* Input may be read, but not acted upon, to prevent deep recursion */
-    _pkg_checkin(pc, 1);
-
-    /* Flush any queued stream output first. */
-    if (pc->pkc_strpos > 0) {
-	/*
-	 * Buffered output is already queued, and needs to be flushed
-	 * before sending this one.  If this pkg will also fit in the
-	 * buffer, add it to the stream, and then send the whole thing
-	 * with one flush.  Otherwise, just flush, and proceed.
-	 */
-	if (len <= MAXQLEN && len <= PKG_STREAMLEN -
-	    sizeof(struct pkg_header) - pc->pkc_strpos) {
-	    (void)pkg_stream(type, buf, len, pc);
-	    return (pkg_flush(pc) < 0) ? -1 : (int)len;
+    while (cnt > 0) {
+	if (off >= iov->pkv_len) {
+	    iov++;
+	    cnt--;
+	    off = 0;
+	    continue;
 	}
-	if (pkg_flush(pc) < 0)
-	    return -1;	/* assumes 2nd write would fail too */
-    }
-
-    pkg_pshort((char *)hdr.pkh_magic, (unsigned long)PKG_MAGIC);
-    pkg_pshort((char *)hdr.pkh_type, (unsigned short)type);	/* should see if valid type */
-    pkg_plong((char *)hdr.pkh_len, (unsigned long)len);
-
 #ifdef HAVE_WRITEV
-    cmdvec[0].iov_base = (void *)&hdr;
-    cmdvec[0].iov_len = sizeof(hdr);
-    cmdvec[1].iov_base = (void *)buf;
-    cmdvec[1].iov_len = len;
+	{
+	    struct iovec vec[MAXIOV];
+	    int n;
 
-    /*
-     * TODO: set this FD to NONBIO.  If not all output got sent, loop
-     * in select() waiting for capacity to go out, and reading input
-     * as well.  Prevents deadlocking.
-     */
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = writev(pc->pkc_out_fd, cmdvec, (len>0)?2:1);
-    } else {
-	i = writev(pc->pkc_fd, cmdvec, (len>0)?2:1);
-    }
-    if (i != (ssize_t)(len+sizeof(hdr))) {
-	if (i < 0) {
-	    _pkg_perror(pc->pkc_errlog, "pkg_send: writev");
-	    return -1;
+	    for (n = 0; n < cnt && n < MAXIOV; n++) {
+		vec[n].iov_base = (void *)iov[n].pkv_base;
+		vec[n].iov_len = iov[n].pkv_len;
+	    }
+	    vec[0].iov_base = (void *)(iov->pkv_base + off);
+	    vec[0].iov_len -= off;
+	    errno = 0;
+	    i = writev(fd, vec, n);
 	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_send of %llu+%llu, wrote %d\n",
-		 (unsigned long long)sizeof(hdr), (unsigned long long)len, (int)i);
-	(pc->pkc_errlog)(_pkg_errbuf);
-	return i-sizeof(hdr);	/* amount of user data sent */
-    }
 #else
-    /*
-     * On the assumption that buffer copying is less expensive than
-     * having this transmission broken into two network packets (with
-     * TCP, each with a "push" bit set), merge it all into one buffer
-     * here, unless size is enormous.
-     */
-    if (len + sizeof(hdr) <= 16*1024) {
-	char tbuf[16*1024] = {0};
-
-	memcpy(tbuf, (char *)&hdr, sizeof(hdr));
-	if (len > 0)
-	    memcpy(tbuf+sizeof(hdr), buf, len);
-
 	errno = 0;
-	if (pc->pkc_fd == PKG_STDIO_MODE) {
-	    i = PKG_SEND(pc->pkc_out_fd, tbuf, len+sizeof(hdr));
-	} else {
-	    i = PKG_SEND(pc->pkc_fd, tbuf, len+sizeof(hdr));
-	}
-	if ((size_t)i != len+sizeof(hdr)) {
-	    if (i < 0) {
-		if (errno == EBADF)
-		    return -1;
-		_pkg_perror(pc->pkc_errlog, "pkg_send: tbuf write");
-		return -1;
-	    }
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_send of %zu, wrote %zd\n",
-		     len, i-(ssize_t)sizeof(hdr));
-	    (pc->pkc_errlog)(_pkg_errbuf);
-	    return (int)(i-sizeof(hdr));	/* amount of user data sent */
-	}
-	return (int)len;
-    }
-    /* Send them separately */
-    errno = 0;
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = PKG_SEND(pc->pkc_out_fd, (char *)&hdr, sizeof(hdr));
-    } else {
-	i = PKG_SEND(pc->pkc_fd, (char *)&hdr, sizeof(hdr));
-    }
-    if (i != sizeof(hdr)) {
+	i = PKG_SEND(fd, iov->pkv_base + off, iov->pkv_len - off);
+#endif
 	if (i < 0) {
-	    if (errno == EBADF)
-		return -1;
-	    _pkg_perror(pc->pkc_errlog, "pkg_send: header write");
-	    return -1;
+	    if (errno == EINTR)
+		continue;
+	    if (PKG_WOULDBLOCK() && _pkg_wait(pc, 1, -1) > 0)
+		continue;
+	    return (total > 0) ? total : -1;
 	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_send header of %llu, wrote %zd\n",
-		 (unsigned long long)sizeof(hdr), i);
-	(pc->pkc_errlog)(_pkg_errbuf);
-	return -1;		/* amount of user data sent */
-    }
-    if (len <= 0)
-	return 0;
-    errno = 0;
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = PKG_SEND(pc->pkc_out_fd, buf, len);
-    } else {
-	i = PKG_SEND(pc->pkc_fd, buf, len);
-    }
-    if ((size_t)i != len) {
-	if (i < 0) {
-	    if (errno == EBADF)
-		return -1;
-	    _pkg_perror(pc->pkc_errlog, "pkg_send: write");
-	    return -1;
+	if (i == 0)
+	    return total;
+	total += i;
+
+	/* Step past whatever went out */
+	while (cnt > 0 && (size_t)i >= iov->pkv_len - off) {
+	    i -= iov->pkv_len - off;
+	    iov++;
+	    cnt--;
+	    off = 0;
 	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_send of %zu, wrote %zd\n", len, i);
-	(pc->pkc_errlog)(_pkg_errbuf);
-	return i;		/* amount of user data sent */
+	off += i;
+    }
+    return total;
+}
+
+
+/**
+ * Append a message to the pkc_stream buffer, which the caller has
+ * made sure has room for it.
+ *
+ * This is a private implementation function.
+ */
+static void
+_pkg_enqueue(int type, const struct pkg_iovec *iov, int iovcnt, size_t len, struct pkg_conn *pc)
+{
+    struct pkg_header hdr;
+    int i;
+
+    pkg_pshort((char *)hdr.pkh_magic, (unsigned short)PKG_MAGIC);
+    pkg_pshort((char *)hdr.pkh_type, (unsigned short)type);	/* should see if valid type */
+    pkg_plong((char *)hdr.pkh_len, (unsigned long)len);
+
+    memcpy(&(pc->pkc_stream[pc->pkc_strpos]), (char *)&hdr, sizeof(struct pkg_header));
+    pc->pkc_strpos += sizeof(struct pkg_header);
+    for (i = 0; i < iovcnt; i++) {
+	if (iov[i].pkv_len <= 0)
+	    continue;
+	memcpy(&(pc->pkc_stream[pc->pkc_strpos]), iov[i].pkv_base, iov[i].pkv_len);
+	pc->pkc_strpos += (int)iov[i].pkv_len;
     }
-#endif
-    return (int)len;
 }
 
 
 int
-pkg_2send(int type, const char *buf1, size_t len1, const char *buf2, size_t len2, struct pkg_conn *pc)
+pkg_sendv(int type, const struct pkg_iovec *iov, int iovcnt, struct pkg_conn *pc)
 {
-#ifdef HAVE_WRITEV
-    static struct iovec cmdvec[3];
-#endif
-    static struct pkg_header hdr;
+    struct pkg_iovec stackvec[MAXIOV];
+    struct pkg_iovec *vec = stackvec;
+    struct pkg_header hdr;
+    size_t len = 0;
+    size_t queued;
     ssize_t i;
+    int n = 0;
 
     PKG_CK(pc);
 
+    if (iovcnt < 0 || (iovcnt > 0 && iov == NULL))
+	return -1;
+    for (n = 0; n < iovcnt; n++)
+	len += iov[n].pkv_len;
+
     if (_pkg_debug) {
 	_pkg_timestamp();
 	fprintf(_pkg_debug,
-		"pkg_send2(type=%d, buf1=%p, len1=%llu, buf2=%p, len2=%llu, pc=%p)\n",
-		type, (void *)buf1, (unsigned long long)len1, (void *)buf2, (unsigned long long)len2, (void *)pc);
+		"pkg_sendv(type=%d, iov=%p, iovcnt=%d, len=%llu, pc=%p)\n",
+		type, (void *)iov, iovcnt, (unsigned long long)len, (void *)pc);
 	fflush(_pkg_debug);
     }
 
@@ -1132,161 +1168,103 @@ pkg_2send(int type, const char *buf1, size_t len1, const char *buf2, size_t len2
     /* Input may be read, but not acted upon, to prevent deep recursion */
     _pkg_checkin(pc, 1);
 
-    /* Flush any queued stream output first. */
-    if (pc->pkc_strpos > 0) {
-	if (pkg_flush(pc) < 0)
-	    return -1;	/* assumes 2nd write would fail too */
+    /*
+     * If stream output is already queued and this message will also
+     * fit in the buffer, add it to the stream and send the whole
+     * thing with one flush.
+     */
+    if (pc->pkc_strpos > 0 && len <= MAXQLEN && len <= PKG_STREAMLEN -
+	sizeof(struct pkg_header) - pc->pkc_strpos) {
+	_pkg_enqueue(type, iov, iovcnt, len, pc);
+	return (pkg_flush(pc) < 0) ? -1 : (int)len;
     }
 
     pkg_pshort((char *)hdr.pkh_magic, (unsigned short)PKG_MAGIC);
     pkg_pshort((char *)hdr.pkh_type, (unsigned short)type);	/* should see if valid type */
-    pkg_plong((char *)hdr.pkh_len, (unsigned long)(len1+len2));
-
-#ifdef HAVE_WRITEV
-    cmdvec[0].iov_base = (void *)&hdr;
-    cmdvec[0].iov_len = sizeof(hdr);
-    cmdvec[1].iov_base = (void *)buf1;
-    cmdvec[1].iov_len = len1;
-    cmdvec[2].iov_base = (void *)buf2;
-    cmdvec[2].iov_len = len2;
+    pkg_plong((char *)hdr.pkh_len, (unsigned long)len);
 
     /*
-     * TODO: set this FD to NONBIO.  If not all output got sent, loop
-     * in select() waiting for capacity to go out, and reading input
-     * as well.  Prevents deadlocking.
+     * Otherwise any queued stream output, the header and the user's
+     * buffers all go out together, without being copied.
      */
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = writev(pc->pkc_out_fd, cmdvec, 3);
-    } else {
-	i = writev(pc->pkc_fd, cmdvec, 3);
-    }
-    if (i != (ssize_t)(len1+len2+sizeof(hdr))) {
-	if (i < 0) {
-	    _pkg_perror(pc->pkc_errlog, "pkg_2send: writev");
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE,
-		     "pkg_send2(type=%d, buf1=x%lx, len1=%ld, buf2=x%lx, len2=%ld, pc=x%lx)\n",
-		     type, (unsigned long int)buf1, (long)len1,
-		     (unsigned long int)buf2, (long)len2, (unsigned long int)pc);
-	    (pc->pkc_errlog)(_pkg_errbuf);
+    if (iovcnt + 2 > MAXIOV) {
+	if ((vec = (struct pkg_iovec *)malloc((iovcnt + 2) * sizeof(struct pkg_iovec))) == NULL) {
+	    _pkg_perror(pc->pkc_errlog, "pkg_sendv: malloc fail");
 	    return -1;
 	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send of %llu+%llu+%llu, wrote %ld\n",
-		 (unsigned long long)sizeof(hdr), (unsigned long long)len1, (unsigned long long)len2, (long int)i);
-	(pc->pkc_errlog)(_pkg_errbuf);
-	return i-sizeof(hdr);	/* amount of user data sent */
     }
-#else
-    /*
-     * On the assumption that buffer copying is less expensive than
-     * having this transmission broken into two network packets (with
-     * TCP, each with a "push" bit set), merge it all into one buffer
-     * here, unless size is enormous.
-     */
-    if (len1 + len2 + sizeof(hdr) <= 16*1024) {
-	char tbuf[16*1024] = {0};
-
-	memcpy(tbuf, (char *)&hdr, sizeof(hdr));
-	if (len1 > 0)
-	    memcpy(tbuf+sizeof(hdr), buf1, len1);
-	if (len2 > 0)
-	    memcpy(tbuf+sizeof(hdr)+len1, buf2, len2);
-	errno = 0;
-	if (pc->pkc_fd == PKG_STDIO_MODE) {
-	    i = PKG_SEND(pc->pkc_out_fd, tbuf, len1+len2+sizeof(hdr));
-	} else {
-	    i = PKG_SEND(pc->pkc_fd, tbuf, len1+len2+sizeof(hdr));
-	}
-	if ((size_t)i != len1+len2+sizeof(hdr)) {
-	    if (i < 0) {
-		if (errno == EBADF)
-		    return -1;
-		_pkg_perror(pc->pkc_errlog, "pkg_2send: tbuf write");
-		return -1;
-	    }
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send of %llu+%llu, wrote %zd\n",
-		     (unsigned long long)len1, (unsigned long long)len2, i-(ssize_t)sizeof(hdr));
-	    (pc->pkc_errlog)(_pkg_errbuf);
-	    return (int)(i-sizeof(hdr));	/* amount of user data sent */
-	}
-	return (int)(len1+len2);
+    n = 0;
+    queued = (size_t)pc->pkc_strpos;
+    if (queued > 0) {
+	vec[n].pkv_base = pc->pkc_stream;
+	vec[n++].pkv_len = queued;
     }
-    /* Send it in three pieces */
-    errno = 0;
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = (ssize_t)PKG_SEND(pc->pkc_out_fd, (char *)&hdr, sizeof(hdr));
-    } else {
-	i = (ssize_t)PKG_SEND(pc->pkc_fd, (char *)&hdr, sizeof(hdr));
-    }
-    if (i != sizeof(hdr)) {
-	if (i < 0) {
-	    if (errno == EBADF)
-		return -1;
-	    _pkg_perror(pc->pkc_errlog, "pkg_2send: header write");
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send write(%d, %p, %zu) ret=%zd\n",
-		     pc->pkc_fd, (void *)&hdr, sizeof(hdr), i);
-	    (pc->pkc_errlog)(_pkg_errbuf);
-	    return -1;
-	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send of %zu+%zu+%zu, wrote header=%zd\n",
-		 sizeof(hdr), len1, len2, i);
-	(pc->pkc_errlog)(_pkg_errbuf);
-	return -1;		/* amount of user data sent */
+    vec[n].pkv_base = (const char *)&hdr;
+    vec[n++].pkv_len = sizeof(hdr);
+    if (iovcnt > 0) {
+	memcpy(&vec[n], iov, iovcnt * sizeof(struct pkg_iovec));
+	n += iovcnt;
     }
 
-    errno = 0;
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = PKG_SEND(pc->pkc_out_fd, buf1, len1);
-    } else {
-	i = PKG_SEND(pc->pkc_fd, buf1, len1);
+    i = _pkg_writev(pc, vec, n);
+    if (vec != stackvec)
+	free(vec);
+
+    if (i < 0) {
+	if (errno != EBADF)
+	    _pkg_perror(pc->pkc_errlog, "pkg_sendv: writev");
+	return -1;
     }
-    if ((size_t)i != len1) {
-	if (i < 0) {
-	    if (errno == EBADF)
-		return -1;
-	    _pkg_perror(pc->pkc_errlog, "pkg_2send: write buf1");
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send write(%d, %p, %zu) ret=%zd\n",
-		     pc->pkc_fd, (void *)buf1, len1, i);
-	    (pc->pkc_errlog)(_pkg_errbuf);
-	    return -1;
-	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send of %zu+%zu+%zu, wrote len1=%zd\n",
-		 sizeof(hdr), len1, len2, i);
+    if ((size_t)i < queued) {
+	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_sendv: flush of %llu, wrote %ld\n",
+		 (unsigned long long)queued, (long)i);
 	(pc->pkc_errlog)(_pkg_errbuf);
-	return i;		/* amount of user data sent */
+	pc->pkc_strpos -= (int)i;
+	/* copy leftovers to front of stream */
+	memmove(pc->pkc_stream, pc->pkc_stream + i, (size_t)pc->pkc_strpos);
+	return -1;
     }
-    if (len2 <= (size_t)0)
-	return i;
+    pc->pkc_strpos = 0;
+    i -= queued;
 
-    errno = 0;
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = PKG_SEND(pc->pkc_out_fd, buf2, len2);
-    } else {
-	i = PKG_SEND(pc->pkc_fd, buf2, len2);
-    }
-    if (i != (ssize_t)len2) {
-	if (i < 0) {
-	    if (errno == EBADF)
-		return -1;
-	    _pkg_perror(pc->pkc_errlog, "pkg_2send: write buf2");
-	    snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send write(%d, %p, %zu) ret=%zd\n",
-		     pc->pkc_fd, (void *)buf2, len2, i);
-	    (pc->pkc_errlog)(_pkg_errbuf);
-	    return -1;
-	}
-	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_2send of %zu+%zu+%zu, wrote len2=%zd\n",
-		 sizeof(hdr), len1, len2, i);
+    if ((size_t)i != len + sizeof(hdr)) {
+	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_sendv of %llu+%llu, wrote %ld\n",
+		 (unsigned long long)sizeof(hdr), (unsigned long long)len, (long)i);
 	(pc->pkc_errlog)(_pkg_errbuf);
-	return (int)(len1+i);		/* amount of user data sent */
+	return (int)(i - (ssize_t)sizeof(hdr));	/* amount of user data sent */
     }
-#endif
-    return (int)(len1+len2);
+    return (int)len;
+}
+
+
+int
+pkg_send(int type, const char *buf, size_t len, struct pkg_conn *pc)
+{
+    struct pkg_iovec iov;
+
+    iov.pkv_base = buf;
+    iov.pkv_len = len;
+    return pkg_sendv(type, &iov, (len > 0) ? 1 : 0, pc);
+}
+
+
+int
+pkg_2send(int type, const char *buf1, size_t len1, const char *buf2, size_t len2, struct pkg_conn *pc)
+{
+    struct pkg_iovec iov[2];
+
+    iov[0].pkv_base = buf1;
+    iov[0].pkv_len = len1;
+    iov[1].pkv_base = buf2;
+    iov[1].pkv_len = len2;
+    return pkg_sendv(type, iov, 2, pc);
 }
 
 
 int
 pkg_stream(int type, const char *buf, size_t len, struct pkg_conn *pc)
 {
-    static struct pkg_header hdr;
+    struct pkg_iovec iov;
 
     if (_pkg_debug) {
 	_pkg_timestamp();
@@ -1303,14 +1281,9 @@ pkg_stream(int type, const char *buf, size_t len, struct pkg_conn *pc)
 	pkg_flush(pc);
 
     /* Queue it */
-    pkg_pshort((char *)hdr.pkh_magic, (unsigned short)PKG_MAGIC);
-    pkg_pshort((char *)hdr.pkh_type, (unsigned short)type);	/* should see if valid type */
-    pkg_plong((char *)hdr.pkh_len, (unsigned long)len);
-
-    memcpy(&(pc->pkc_stream[pc->pkc_strpos]), (char *)&hdr, sizeof(struct pkg_header));
-    pc->pkc_strpos += sizeof(struct pkg_header);
-    memcpy(&(pc->pkc_stream[pc->pkc_strpos]), buf, len);
-    pc->pkc_strpos += (int)len;
+    iov.pkv_base = buf;
+    iov.pkv_len = len;
+    _pkg_enqueue(type, &iov, 1, len, pc);
 
     return (int)(len + sizeof(struct pkg_header));
 }
@@ -1319,6 +1292,7 @@ pkg_stream(int type, const char *buf, size_t len, struct pkg_conn *pc)
 int
 pkg_flush(struct pkg_conn *pc)
 {
+    struct pkg_iovec iov;
     int i;
 
     if (_pkg_debug) {
@@ -1334,12 +1308,9 @@ pkg_flush(struct pkg_conn *pc)
 	return 0;
     }
 
-    errno = 0;
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	i = write(pc->pkc_out_fd, pc->pkc_stream, (size_t)pc->pkc_strpos);
-    } else {
-	i = write(pc->pkc_fd, pc->pkc_stream, (size_t)pc->pkc_strpos);
-    }
+    iov.pkv_base = pc->pkc_stream;
+    iov.pkv_len = (size_t)pc->pkc_strpos;
+    i = (int)_pkg_writev(pc, &iov, 1);
     if (i != pc->pkc_strpos) {
 	if (i < 0) {
 	    if (errno == EBADF)
@@ -1796,13 +1767,26 @@ pkg_block(struct pkg_conn *pc)
 	/* Now pkc_left >= 0 */
     }
 
-    /* Read the rest of the message, blocking if necessary */
-    if (pc->pkc_left > 0) {
-	if (_pkg_inget(pc, pc->pkc_curpos, (size_t)pc->pkc_left) != (size_t)pc->pkc_left) {
-	    pc->pkc_left = -1;
-	    return -1;
+    /*
+     * Read the rest of the message, blocking if necessary.  When
+     * nothing is buffered, pkg_suckin() reads the body straight into
+     * the message buffer.
+     */
+    while (pc->pkc_left > 0) {
+	size_t len = pc->pkc_inend - pc->pkc_incur;
+
+	if (len <= 0) {
+	    if (_pkg_suckwait(pc) < 1) {
+		pc->pkc_left = -1;
+		return -1;
+	    }
+	    continue;
 	}
-	pc->pkc_left = 0;
+	if (len > (size_t)pc->pkc_left)
+	    len = pc->pkc_left;
+	len = _pkg_inget(pc, pc->pkc_curpos, len);
+	pc->pkc_curpos += len;
+	pc->pkc_left -= (int)len;
     }
 
     /* Now, pkc_left == 0, dispatch the message */
@@ -1810,10 +1794,17 @@ pkg_block(struct pkg_conn *pc)
 }
 
 
-int
-pkg_suckin(struct pkg_conn *pc)
+/**
+ * The body of pkg_suckin(), which also reports through gotp how many
+ * bytes were taken in.
+ *
+ * This is a private implementation function.
+ */
+static int
+_pkg_suckin(struct pkg_conn *pc, int *gotp)
 {
     size_t avail;
+    int direct = 0;
     int got;
     int ret;
 
@@ -1880,12 +1871,31 @@ pkg_suckin(struct pkg_conn *pc)
     }
 
     /* Take as much as the system will give us, up to buffer size */
-    if (pc->pkc_fd == PKG_STDIO_MODE) {
-	got = PKG_READ(pc->pkc_in_fd, &pc->pkc_inbuf[pc->pkc_inend], avail);
-    } else {
-	got = PKG_READ(pc->pkc_fd, &pc->pkc_inbuf[pc->pkc_inend], avail);
-    }
-    if (got <= 0) {
+    errno = 0;
+#ifdef HAVE_READV
+    if (pc->pkc_left > 0 && pc->pkc_curpos != (char *)0 && pc->pkc_incur >= pc->pkc_inend) {
+	/*
+	 * The rest of a message body is due and none of it is
+	 * buffered.  Read it straight into the message buffer, and
+	 * whatever follows it into the input buffer.
+	 */
+	struct iovec vec[2];
+
+	vec[0].iov_base = pc->pkc_curpos;
+	vec[0].iov_len = (size_t)pc->pkc_left;
+	vec[1].iov_base = &pc->pkc_inbuf[pc->pkc_inend];
+	vec[1].iov_len = avail;
+	got = (int)readv(PKG_INFD(pc), vec, 2);
+	if (got > 0) {
+	    direct = (got > pc->pkc_left) ? pc->pkc_left : got;
+	    pc->pkc_curpos += direct;
+	    pc->pkc_left -= direct;
+	    got -= direct;
+	}
+    } else
+#endif
+	got = PKG_READ(PKG_INFD(pc), &pc->pkc_inbuf[pc->pkc_inend], avail);
+    if (got <= 0 && direct == 0) {
 	if (got == 0) {
 	    if (_pkg_debug) {
 		_pkg_timestamp();
@@ -1897,6 +1907,12 @@ pkg_suckin(struct pkg_conn *pc)
 	    ret = 0;	/* EOF */
 	    goto out;
 	}
+	if (errno == EINTR || PKG_WOULDBLOCK()) {
+	    /* Nothing to take in just now */
+	    got = 0;
+	    ret = 1;
+	    goto out;
+	}
 #ifndef HAVE_WINSOCK_H
 	_pkg_perror(pc->pkc_errlog, "pkg_suckin: read");
 	snprintf(_pkg_errbuf, MAX_PKG_ERRBUF_SIZE, "pkg_suckin: read(%d, %p, %ld) ret=%d inbuf=%p, inend=%d\n",
@@ -1922,14 +1938,82 @@ pkg_suckin(struct pkg_conn *pc)
     if (_pkg_debug) {
 	_pkg_timestamp();
 	fprintf(_pkg_debug,
-		"pkg_suckin() ret=%d, got %d, total=%d\n",
-		ret, got, pc->pkc_inend - pc->pkc_incur);
+		"pkg_suckin() ret=%d, got %d+%d, total=%d\n",
+		ret, direct, got, pc->pkc_inend - pc->pkc_incur);
 	fflush(_pkg_debug);
     }
+    if (gotp)
+	*gotp = direct + got;
     return ret;
 }
 
 
+int
+pkg_suckin(struct pkg_conn *pc)
+{
+    return _pkg_suckin(pc, NULL);
+}
+
+
+int
+pkg_fileno(const struct pkg_conn *pc)
+{
+    if (pc == PKC_NULL || pc == PKC_ERROR)
+	return -1;
+    return PKG_INFD(pc);
+}
+
+
+int
+pkg_nonblocking(struct pkg_conn *pc, int onoff)
+{
+    PKG_CK(pc);
+
+#if defined(HAVE_WINSOCK_H)
+    {
+	u_long mode = onoff ? 1 : 0;
+	if (ioctlsocket(pc->pkc_fd, FIONBIO, &mode) != 0) {
+	    _pkg_perror(pc->pkc_errlog, "pkg_nonblocking: FIONBIO");
+	    return -1;
+	}
+    }
+#elif defined(FIONBIO)
+    {
+	int mode = onoff ? 1 : 0;
+	if (ioctl(PKG_INFD(pc), FIONBIO, &mode) < 0 ||
+	    (PKG_OUTFD(pc) != PKG_INFD(pc) && ioctl(PKG_OUTFD(pc), FIONBIO, &mode) < 0)) {
+	    _pkg_perror(pc->pkc_errlog, "pkg_nonblocking: FIONBIO");
+	    return -1;
+	}
+    }
+#else
+    if (onoff) {
+	pc->pkc_errlog("pkg_nonblocking: not supported on this platform\n");
+	return -1;
+    }
+#endif
+    return 0;
+}
+
+
+int
+pkg_service(struct pkg_conn *pc)
+{
+    int ret;
+    int cnt;
+
+    PKG_CK(pc);
+
+    ret = pkg_suckin(pc);
+
+    /* Whatever did arrive is handled, even at EOF */
+    cnt = pkg_process(pc);
+    if (ret < 1)
+	return -1;
+    return cnt;
+}
+
+
 /*
  * Local Variables:
  * mode: C
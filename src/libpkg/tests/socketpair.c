@@ -0,0 +1,349 @@
+/*                    S O C K E T P A I R . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file socketpair.c
+ *
+ * Run two non-blocking pkg connections against each other over a
+ * socketpair, one in each of two processes, and check the bytes and
+ * the order of every message that arrives.
+ *
+ * First each side in turn sends the other a big message followed by
+ * a burst of small ones.  The reader stops partway into the big
+ * message, waits until the writer is done, and then expects a single
+ * pkg_service() to read the rest of the body straight into the
+ * message buffer, the small messages into the input buffer, and to
+ * dispatch them all.
+ *
+ * Then both sides send several megabytes in many odd-sized buffers at
+ * once, without reading in between.  Neither socket can hold that, so
+ * the writes come back short and would block, and the sends only
+ * finish if each one takes in its peer's input while it waits.
+ *
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "bio.h"
+#include "pkg.h"
+
+#define MSG_BIG 1
+#define MSG_SMALL 2
+
+#define ROUNDS 4		/* big messages sent one way at a time */
+#define NSMALL 16		/* small messages after each of them */
+#define NBIG 6			/* big messages sent both ways at once */
+#define NPIECE 20		/* buffers per big message, over MAXIOV */
+
+#define ONEWAY_MSGS (ROUNDS * (NSMALL + 1))
+#define TOTAL_MSGS (ONEWAY_MSGS + NBIG)
+
+static const char *who = "parent";
+static int received = 0;	/* messages from the peer so far */
+static int bad = 0;
+
+
+static size_t
+msg_len(int seq)
+{
+    if (seq >= ONEWAY_MSGS)
+	return (1 << 20) + (size_t)(seq - ONEWAY_MSGS) * 4099 + 1;
+    if (seq % (NSMALL + 1) == 0)
+	return 100000 + (size_t)seq * 13;
+    return 1 + (size_t)(seq * 37) % 200;
+}
+
+
+static int
+msg_type(int seq)
+{
+    return (seq < ONEWAY_MSGS && seq % (NSMALL + 1)) ? MSG_SMALL : MSG_BIG;
+}
+
+
+static unsigned char
+msg_byte(int seq, size_t i)
+{
+    return (unsigned char)((i * 7) ^ (i >> 9) ^ (size_t)(seq * 29));
+}
+
+
+static void
+recv_msg(struct pkg_conn *pc, char *buf)
+{
+    int seq = received++;
+    size_t len = msg_len(seq);
+    size_t i;
+
+    if (pc->pkc_type != msg_type(seq) || pc->pkc_len != len) {
+	fprintf(stderr, "%s: message %d is type %d, %lu bytes, expected type %d, %lu bytes\n",
+		who, seq, pc->pkc_type, (unsigned long)pc->pkc_len, msg_type(seq), (unsigned long)len);
+	bad++;
+    } else {
+	for (i = 0; i < len; i++) {
+	    if ((unsigned char)buf[i] != msg_byte(seq, i)) {
+		fprintf(stderr, "%s: message %d differs at byte %lu\n", who, seq, (unsigned long)i);
+		bad++;
+		break;
+	    }
+	}
+    }
+    free(buf);
+}
+
+
+static void
+errlog(const char *msg)
+{
+    fprintf(stderr, "%s: %s", who, msg);
+}
+
+
+static const struct pkg_switch pkgswitch[] = {
+    { MSG_BIG, recv_msg, "big", NULL },
+    { MSG_SMALL, recv_msg, "small", NULL },
+    { 0, NULL, NULL, NULL }
+};
+
+
+/* Send message seq, cut into odd-sized buffers that partial writes
+ * will land in the middle of.
+ */
+static int
+send_msg(struct pkg_conn *pc, int seq)
+{
+    struct pkg_iovec iov[NPIECE];
+    size_t len = msg_len(seq);
+    size_t i, start = 0;
+    int n, cnt;
+    char *body;
+    int ret;
+
+    body = (char *)malloc(len);
+    if (!body)
+	return -1;
+    for (i = 0; i < len; i++)
+	body[i] = (char)msg_byte(seq, i);
+
+    cnt = (len > 1000) ? NPIECE : 2;
+    for (n = 0; n < cnt; n++) {
+	size_t end = (n == cnt - 1) ? len : len * (n + 1) / cnt - (size_t)(n % 3);
+	iov[n].pkv_base = body + start;
+	iov[n].pkv_len = end - start;
+	start = end;
+    }
+
+    ret = pkg_sendv(msg_type(seq), iov, cnt, pc);
+    free(body);
+    return (ret == (int)len) ? 0 : -1;
+}
+
+
+/* Wait for input and handle it, returning the number of messages
+ * dispatched.
+ */
+static int
+service(struct pkg_conn *pc)
+{
+    struct pollfd pfd;
+    int n;
+
+    pfd.fd = pkg_fileno(pc);
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, -1) < 0)
+	return -1;
+    n = pkg_service(pc);
+    if (n < 0)
+	fprintf(stderr, "%s: pkg_service failed\n", who);
+    return n;
+}
+
+
+static int
+send_oneway(struct pkg_conn *pc, int syncfd)
+{
+    char c = 'x';
+    int seq;
+
+    for (seq = 0; seq < ONEWAY_MSGS; seq++) {
+	if (send_msg(pc, seq) < 0) {
+	    fprintf(stderr, "%s: pkg_sendv of message %d failed\n", who, seq);
+	    return -1;
+	}
+	if ((seq + 1) % (NSMALL + 1) == 0 && write(syncfd, &c, 1) != 1)
+	    return -1;
+    }
+    return 0;
+}
+
+
+static int
+recv_oneway(struct pkg_conn *pc, int syncfd, int *splits)
+{
+    int round;
+    char c;
+
+    for (round = 0; round < ROUNDS; round++) {
+	int target = (round + 1) * (NSMALL + 1);
+	int waited = 0;
+
+	while (received < target) {
+	    /* Partway into the big body, with nothing buffered */
+	    if (!waited && pc->pkc_left > 0 && pc->pkc_curpos && pc->pkc_incur >= pc->pkc_inend) {
+		int before = received;
+
+		if (read(syncfd, &c, 1) != 1)
+		    return -1;
+		waited = 1;
+		if (pkg_service(pc) < 0)
+		    return -1;
+		if (received - before > 1)
+		    (*splits)++;
+		continue;
+	    }
+	    if (service(pc) < 0)
+		return -1;
+	}
+	if (!waited && read(syncfd, &c, 1) != 1)
+	    return -1;
+    }
+    return 0;
+}
+
+
+static int
+both_ways(struct pkg_conn *pc)
+{
+    int seq;
+
+    for (seq = ONEWAY_MSGS; seq < TOTAL_MSGS; seq++) {
+	if (send_msg(pc, seq) < 0) {
+	    fprintf(stderr, "%s: pkg_sendv of message %d failed\n", who, seq);
+	    return -1;
+	}
+    }
+
+    /* The sends could only finish by taking in the peer's messages */
+    if (received == ONEWAY_MSGS && pc->pkc_left < 0 && pc->pkc_incur >= pc->pkc_inend) {
+	fprintf(stderr, "%s: no input was taken in while sending\n", who);
+	return -1;
+    }
+
+    while (received < TOTAL_MSGS) {
+	if (service(pc) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+
+static int
+run(int fd, int syncfd, int sends_first)
+{
+    struct pkg_conn *pc;
+    int splits = 0;
+    int ret = 0;
+
+    if (dup2(fd, STDIN_FILENO) < 0)
+	return 1;
+    close(fd);
+    pc = pkg_transerver(pkgswitch, errlog);
+    if (pc == PKC_ERROR || pc == PKC_NULL || pkg_nonblocking(pc, 1) < 0) {
+	fprintf(stderr, "%s: unable to set up the connection\n", who);
+	return 1;
+    }
+
+    if (sends_first)
+	ret = send_oneway(pc, syncfd) || recv_oneway(pc, syncfd, &splits);
+    else
+	ret = recv_oneway(pc, syncfd, &splits) || send_oneway(pc, syncfd);
+
+    if (!ret && splits == 0) {
+	fprintf(stderr, "%s: no read was split between a message body and the input buffer\n", who);
+	ret = 1;
+    }
+
+    if (!ret)
+	ret = both_ways(pc);
+
+    pkg_close(pc);
+    close(syncfd);
+
+    if (!ret && received != TOTAL_MSGS) {
+	fprintf(stderr, "%s: %d messages received, expected %d\n", who, received, TOTAL_MSGS);
+	ret = 1;
+    }
+    return (ret || bad) ? 1 : 0;
+}
+
+
+int
+main(int UNUSED(argc), char *UNUSED(argv[]))
+{
+    int sv[2], sync[2];
+    int status;
+    int ret;
+    pid_t pid;
+
+    /* A hung send is a failure, not a stuck test */
+    alarm(120);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, sync) < 0) {
+	perror("socketpair");
+	return 1;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+	perror("fork");
+	return 1;
+    }
+    if (pid == 0) {
+	who = "child";
+	close(sv[0]);
+	close(sync[0]);
+	exit(run(sv[1], sync[1], 0));
+    }
+    close(sv[1]);
+    close(sync[1]);
+    ret = run(sv[0], sync[0], 1);
+
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	fprintf(stderr, "child failed\n");
+	ret = 1;
+    }
+    return ret;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
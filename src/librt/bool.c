@@ -43,6 +43,7 @@
 #include "bu/parallel.h"
 #include "vmath.h"
 #include "raytrace.h"
+#include "./librt_private.h"
 
 
 /* Boolean values.  Not easy to change, but defined symbolically */
@@ -142,6 +143,101 @@ bool_weave0seg(struct seg *segp, struct partition *PartHdp, struct application *
 }
 
 
+/**
+ * Partitions on the list being woven, in list order, so the first
+ * partition a new segment can touch is found by binary search instead
+ * of walking the list from the front for every segment.  Partitions
+ * never overlap, so their out distances are nondecreasing; the table
+ * is only used when that holds, and is rebuilt after anything that
+ * edits the list behind its back.
+ *
+ * The weave itself stays on the linked lists.  Sorting the segments
+ * and sweeping them into partitions would be cheaper, but the
+ * tolerance fusing below depends on the order segments arrive in, so
+ * a sweep cannot give the same partitions.  Segments and partitions
+ * already come from per-resource blocks and freelists, so there is
+ * no per-ray arena either.
+ */
+#define BOOL_WEAVE_LOCAL 64
+
+struct bool_weave_index {
+    struct partition **pts;
+    size_t len;
+    size_t cap;
+    int state;		/* 0 stale, 1 usable, -1 unsorted (walk the list) */
+    struct partition *local[BOOL_WEAVE_LOCAL];
+};
+
+
+static void
+bool_weave_index_grow(struct bool_weave_index *wi, size_t want)
+{
+    if (want <= wi->cap)
+	return;
+
+    while (wi->cap < want)
+	wi->cap *= 2;
+    if (wi->pts == wi->local) {
+	wi->pts = (struct partition **)bu_malloc(wi->cap * sizeof(struct partition *), "bool_weave_index");
+	memcpy(wi->pts, wi->local, wi->len * sizeof(struct partition *));
+    } else {
+	wi->pts = (struct partition **)bu_realloc(wi->pts, wi->cap * sizeof(struct partition *), "bool_weave_index");
+    }
+}
+
+
+static void
+bool_weave_index_build(struct bool_weave_index *wi, struct partition *PartHdp)
+{
+    struct partition *pp;
+
+    wi->len = 0;
+    wi->state = 1;
+    for (pp = PartHdp->pt_forw; pp != PartHdp; pp = pp->pt_forw) {
+	if (wi->len && pp->pt_outhit->hit_dist < wi->pts[wi->len-1]->pt_outhit->hit_dist)
+	    wi->state = -1;
+	bool_weave_index_grow(wi, wi->len + 1);
+	wi->pts[wi->len++] = pp;
+    }
+}
+
+
+static void
+bool_weave_index_insert(struct bool_weave_index *wi, size_t i, struct partition *pp)
+{
+    if (wi->state != 1)
+	return;
+
+    bool_weave_index_grow(wi, wi->len + 1);
+    if (i < wi->len)
+	memmove(&wi->pts[i+1], &wi->pts[i], (wi->len - i) * sizeof(struct partition *));
+    wi->pts[i] = pp;
+    wi->len++;
+}
+
+
+/**
+ * Index of the first partition that a segment starting at start_dist
+ * is not entirely beyond.  Everything before it would be skipped by
+ * the first test in the rt_boolweave() loop.
+ */
+static size_t
+bool_weave_index_find(const struct bool_weave_index *wi, fastf_t start_dist, fastf_t tol_dist)
+{
+    size_t lo = 0;
+    size_t hi = wi->len;
+
+    while (lo < hi) {
+	size_t mid = lo + (hi - lo) / 2;
+	if (start_dist - wi->pts[mid]->pt_outhit->hit_dist > tol_dist)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+
 _BU_ATTR_FLATTEN void
 rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, struct application *ap)
 {
@@ -152,9 +248,16 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 
     register fastf_t diff, diff_se;
     register fastf_t tol_dist;
+    struct bool_weave_index wi;
+    size_t i;
 
     RT_CK_PT_HD(PartHdp);
 
+    wi.pts = wi.local;
+    wi.len = 0;
+    wi.cap = BOOL_WEAVE_LOCAL;
+    wi.state = 0;
+
     tol_dist = rtip->rti_tol.dist;
 
     RT_CK_RTI(ap->a_rt_i);
@@ -252,6 +355,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 	    pp->pt_outseg = segp;
 	    pp->pt_outhit = &segp->seg_out;
 	    APPEND_PT(pp, PartHdp);
+	    bool_weave_index_insert(&wi, wi.len, pp);
 	    if (RT_G_DEBUG&RT_DEBUG_PARTITION) bu_log("No partitions yet, segment forms first partition\n");
 	} else if (ap->a_no_booleans) {
 	    lasthit = &segp->seg_in;
@@ -277,9 +381,11 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 	    newpp->pt_outseg = segp;
 	    newpp->pt_outhit = &segp->seg_out;
 	    INSERT_PT(newpp, pp);
+	    wi.state = 0;
 	} else if (NEAR_ZERO(diff, tol_dist)) {
 	    /* Check for zero-thickness segment, within tol */
 	    bool_weave0seg(segp, PartHdp, ap);
+	    wi.state = 0;
 	} else if (segp->seg_in.hit_dist >= PartHdp->pt_back->pt_outhit->hit_dist) {
 	    /*
 	     * Segment starts exactly at last partition's end, or
@@ -297,6 +403,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 	    pp->pt_outseg = segp;
 	    pp->pt_outhit = &segp->seg_out;
 	    APPEND_PT(pp, PartHdp->pt_back);
+	    bool_weave_index_insert(&wi, wi.len, pp);
 	} else {
 	    /* Loop through current partition list weaving the current
 	     * input segment into the list. The following three
@@ -308,7 +415,19 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 	    lastseg = segp;
 	    lasthit = &segp->seg_in;
 	    lastflip = 0;
-	    for (pp=PartHdp->pt_forw; pp != PartHdp; pp=pp->pt_forw) {
+
+	    /* skip straight past partitions the segment starts beyond */
+	    if (wi.state == 0)
+		bool_weave_index_build(&wi, PartHdp);
+	    if (wi.state == 1) {
+		i = bool_weave_index_find(&wi, lasthit->hit_dist, tol_dist);
+		pp = (i < wi.len) ? wi.pts[i] : PartHdp;
+	    } else {
+		i = 0;
+		pp = PartHdp->pt_forw;
+	    }
+
+	    for (; pp != PartHdp; pp=pp->pt_forw, i++) {
 
 		if (RT_G_DEBUG&RT_DEBUG_PARTITION) {
 		    bu_log("At start of loop:\n");
@@ -380,6 +499,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 		    newpp->pt_outhit = &segp->seg_in;
 		    newpp->pt_outflip = 1;
 		    INSERT_PT(newpp, pp);
+		    bool_weave_index_insert(&wi, i++, newpp);
 		    if (RT_G_DEBUG&RT_DEBUG_PARTITION) {
 			bu_log("seg starts within p. Split p at seg start, advance. (diff = %g)\n", diff);
 			bu_log("newpp starts at %.12e, pp starts at %.12e\n",
@@ -445,6 +565,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 			newpp->pt_outhit = &segp->seg_out;
 			newpp->pt_outflip = 0;
 			INSERT_PT(newpp, pp);
+			bool_weave_index_insert(&wi, i++, newpp);
 			if (RT_G_DEBUG&RT_DEBUG_PARTITION) bu_log("seg between 2 partitions\n");
 			break;
 		    } else if (diff < tol_dist) {
@@ -466,6 +587,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 			newpp->pt_outhit->hit_dist = pp->pt_inhit->hit_dist;
 			newpp->pt_outflip = 0;
 			INSERT_PT(newpp, pp);
+			bool_weave_index_insert(&wi, i++, newpp);
 			if (RT_G_DEBUG&RT_DEBUG_PARTITION) bu_log("seg ends at partition start, fuse\n");
 			break;
 		    }
@@ -484,6 +606,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 		    lasthit = pp->pt_inhit;
 		    lastflip = newpp->pt_outflip;
 		    INSERT_PT(newpp, pp);
+		    bool_weave_index_insert(&wi, i++, newpp);
 		    if (RT_G_DEBUG&RT_DEBUG_PARTITION) bu_log("insert seg before p start, ends after p ends.  Making new partition for initial portion.\n");
 		}
 
@@ -542,6 +665,7 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 		    pp->pt_inhit = &segp->seg_out;
 		    pp->pt_inflip = 1;
 		    INSERT_PT(newpp, pp);
+		    bool_weave_index_insert(&wi, i++, newpp);
 		    if (RT_G_DEBUG&RT_DEBUG_PARTITION) {
 			bu_log("start together, seg shorter than partition\n");
 			bu_log("newpp starts at %.12e, pp starts at %.12e\n",
@@ -570,12 +694,16 @@ rt_boolweave(struct seg *out_hd, struct seg *in_hd, struct partition *PartHdp, s
 		newpp->pt_outseg = segp;
 		newpp->pt_outhit = &segp->seg_out;
 		APPEND_PT(newpp, PartHdp->pt_back);
+		bool_weave_index_insert(&wi, wi.len, newpp);
 	    }
 	}
 
 	if (RT_G_DEBUG&RT_DEBUG_PARTITION)
 	    rt_pr_partitions(rtip, PartHdp, "After weave");
     }
+    if (wi.pts != wi.local)
+	bu_free(wi.pts, "bool_weave_index");
+
     if (RT_G_DEBUG&RT_DEBUG_PARTITION)
 	bu_log("--------------------Leaving Booleweave\n");
 }
@@ -1399,6 +1527,180 @@ pop:
 }
 
 
+/*
+ * Region trees compiled to a flat jump program.  Each instruction
+ * tests whether one solid is present in the partition and names the
+ * instruction to go to next for either answer; a negative target
+ * ends the evaluation with that result.  Union, intersection and
+ * subtraction just route their operands' true/false exits, so the
+ * program is one instruction per leaf, visited in the same
+ * short-circuit order bool_eval() uses, with no stack.  XOR needs its
+ * right operand twice, once under each outcome of the left.
+ */
+#define BOOL_PROG_FALSE -1
+#define BOOL_PROG_TRUE -2
+#define BOOL_PROG_GUARD -3
+
+/* give up and walk the tree if XOR duplication gets out of hand */
+#define BOOL_PROG_MAX (1<<20)
+
+struct bool_insn {
+    const struct soltab *bi_stp;	/* NULL for OP_NOP, always false */
+    int bi_true;
+    int bi_false;
+};
+
+struct bool_prog {
+    int bp_len;
+    int bp_entry;		/* first instruction to run */
+    struct bool_insn *bp_insns;
+};
+
+
+/* number of instructions tp compiles to, or 0 if it can't be compiled */
+static size_t
+bool_prog_size(const union tree *tp)
+{
+    size_t l, r;
+
+    switch (tp->tr_op) {
+	case OP_NOP:
+	case OP_SOLID:
+	    return 1;
+	case OP_UNION:
+	case OP_INTERSECT:
+	case OP_SUBTRACT:
+	case OP_XOR:
+	    l = bool_prog_size(tp->tr_b.tb_left);
+	    r = bool_prog_size(tp->tr_b.tb_right);
+	    if (!l || !r)
+		return 0;
+	    if (tp->tr_op == OP_XOR)
+		r *= 2;
+	    if (l + r > BOOL_PROG_MAX)
+		return 0;
+	    return l + r;
+	default:
+	    return 0;
+    }
+}
+
+
+/*
+ * Append the code for tp to code[*len], operands last-evaluated
+ * first so that each operand's entry point is known by the time the
+ * code that jumps to it is emitted.  Returns tp's entry point.
+ */
+static int
+bool_prog_emit(struct bool_insn *code, int *len, const union tree *tp, int on_true, int on_false)
+{
+    int rentry, rentry2;
+
+    switch (tp->tr_op) {
+	case OP_NOP:
+	    code[*len].bi_stp = NULL;
+	    code[*len].bi_true = on_true;
+	    code[*len].bi_false = on_false;
+	    return (*len)++;
+	case OP_SOLID:
+	    code[*len].bi_stp = tp->tr_a.tu_stp;
+	    code[*len].bi_true = on_true;
+	    code[*len].bi_false = on_false;
+	    return (*len)++;
+	case OP_UNION:
+	    rentry = bool_prog_emit(code, len, tp->tr_b.tb_right, on_true, on_false);
+	    return bool_prog_emit(code, len, tp->tr_b.tb_left, on_true, rentry);
+	case OP_INTERSECT:
+	    rentry = bool_prog_emit(code, len, tp->tr_b.tb_right, on_true, on_false);
+	    return bool_prog_emit(code, len, tp->tr_b.tb_left, rentry, on_false);
+	case OP_SUBTRACT:
+	    rentry = bool_prog_emit(code, len, tp->tr_b.tb_right, on_false, on_true);
+	    return bool_prog_emit(code, len, tp->tr_b.tb_left, rentry, on_false);
+	case OP_XOR:
+	    /* lhs true: rhs must be false, else overlap (guard).
+	     * lhs false: the result is rhs.
+	     */
+	    rentry = bool_prog_emit(code, len, tp->tr_b.tb_right, BOOL_PROG_GUARD, on_true);
+	    rentry2 = bool_prog_emit(code, len, tp->tr_b.tb_right, on_true, on_false);
+	    return bool_prog_emit(code, len, tp->tr_b.tb_left, rentry, rentry2);
+	default:
+	    bu_bomb("bool_prog_emit: bad op\n");
+    }
+    return BOOL_PROG_FALSE;
+}
+
+
+void
+bool_compile_region(struct region *regp)
+{
+    struct bool_prog *prog;
+    size_t len;
+
+    RT_CK_REGION(regp);
+
+    bool_free_region(regp);
+    if (regp->reg_all_unions || !regp->reg_treetop)
+	return;
+
+    len = bool_prog_size(regp->reg_treetop);
+    if (!len)
+	return;
+
+    BU_GET(prog, struct bool_prog);
+    prog->bp_len = 0;
+    prog->bp_insns = (struct bool_insn *)bu_malloc(len * sizeof(struct bool_insn), "bool_prog insns");
+    prog->bp_entry = bool_prog_emit(prog->bp_insns, &prog->bp_len, regp->reg_treetop, BOOL_PROG_TRUE, BOOL_PROG_FALSE);
+    regp->reg_prog = prog;
+}
+
+
+void
+bool_free_region(struct region *regp)
+{
+    if (!regp->reg_prog)
+	return;
+
+    bu_free(regp->reg_prog->bp_insns, "bool_prog insns");
+    BU_PUT(regp->reg_prog, struct bool_prog);
+    regp->reg_prog = NULL;
+}
+
+
+/**
+ * Run a compiled region program over a partition.  Same return
+ * values as bool_eval().
+ */
+static int
+bool_prog_eval(const struct bool_prog *prog, const struct partition *partp)
+{
+    const struct bool_insn *insns = prog->bp_insns;
+    struct seg **segs = (struct seg **)BU_PTBL_BASEADDR(&partp->pt_seglist);
+    size_t nsegs = BU_PTBL_LEN(&partp->pt_seglist);
+    int pc = prog->bp_entry;
+
+    while (pc >= 0) {
+	const struct bool_insn *ip = &insns[pc];
+	size_t i;
+
+	pc = ip->bi_false;
+	if (!ip->bi_stp)
+	    continue;
+	for (i = 0; i < nsegs; i++) {
+	    if (segs[i]->seg_stp == ip->bi_stp) {
+		pc = ip->bi_true;
+		break;
+	    }
+	}
+    }
+
+    if (pc == BOOL_PROG_TRUE)
+	return BOOL_TRUE;
+    if (pc == BOOL_PROG_FALSE)
+	return BOOL_FALSE;
+    return -1;	/* GUARD error */
+}
+
+
 _BU_ATTR_FLATTEN int
 rt_boolfinal(struct partition *InputHdp, struct partition *FinalHdp, fastf_t startdist, fastf_t enddist, struct bu_ptbl *regiontable, struct application *ap, const struct bu_bitv *solidbits)
 {
@@ -1656,7 +1958,8 @@ rt_boolfinal(struct partition *InputHdp, struct partition *FinalHdp, fastf_t sta
 		    lastregion = regp;
 		    continue;
 		}
-		if (bool_eval(regp->reg_treetop, pp, ap->a_resource) == BOOL_FALSE) {
+		if ((regp->reg_prog ? bool_prog_eval(regp->reg_prog, pp) :
+		     bool_eval(regp->reg_treetop, pp, ap->a_resource)) == BOOL_FALSE) {
 		    if (RT_G_DEBUG&RT_DEBUG_PARTITION)
 			bu_log("BOOL_FALSE\n");
 		    /* Null out non-claiming region's pointer */
@@ -55,7 +55,11 @@ extern int brl_LZ4_compress_default(const char* source, char* dest, int sourceSi
 extern int brl_LZ4_compressBound(int inputSize);
 extern int brl_LZ4_decompress_fast (const char* source, char* dest, int originalSize);
 
-#define CACHE_FORMAT 3
+/* v4 adds uncompressed, page-aligned entries (rt_cache::encoding=raw)
+ * alongside the v3 LZ4 ones.  v3 caches are still read as-is.
+ */
+#define CACHE_FORMAT 4
+#define CACHE_FORMAT_LZ4 3
 
 static const char * const cache_mime_type = "brlcad/cache";
 
@@ -72,12 +76,13 @@ struct rt_cache_entry {
 struct rt_cache {
     char dir[MAXPATHLEN];
     int read_only;
+    int uncompressed;
     int semaphore;
     int (*log)(const char *format, ...);
     int (*debug)(const char *format, ...);
     struct bu_hash_tbl *entry_hash;
 };
-#define CACHE_INIT {{0}, 0, 0, bu_log, NULL, NULL}
+#define CACHE_INIT {{0}, 0, 0, 0, bu_log, NULL, NULL}
 
 
 static void
@@ -238,6 +243,27 @@ cache_generate_name(char name[STATIC_ARRAY(37)], const struct soltab *stp)
 }
 
 
+/* (re)writes the cache/dir/format file, returning truthfully on success */
+static int
+cache_set_format(const struct rt_cache *cache, const char *path, int format)
+{
+    int ret;
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+	perror("fopen");
+	cache_warn(cache, path, "Cannot initialize format file.  Caching disabled.");
+	return 0;
+    }
+    ret = fprintf(fp, "%d\n", format);
+    fclose(fp);
+    if (ret <= 0) {
+	cache_warn(cache, path, "Cannot set version in format file.  Caching disabled.");
+	return 0;
+    }
+    return 1;
+}
+
+
 /* returns truthfully if a cache location is exists and is usable,
  * creating and initializing the location if necessary.
  */
@@ -282,20 +308,8 @@ cache_init(struct rt_cache *cache)
 	    cache_warn(cache, path, "Cannot create format file.  Caching disabled.");
 	    return 0;
 	}
-	if (bu_file_writable(path)) {
-	    FILE *fp = fopen(path, "w");
-	    int ret;
-	    if (!fp) {
-		perror("fopen");
-		cache_warn(cache, path, "Cannot initialize format file.  Caching disabled.");
-		return 0;
-	    }
-	    ret = fprintf(fp, "%d\n", CACHE_FORMAT);
-	    fclose(fp);
-	    if (ret <= 0) {
-		cache_warn(cache, path, "Cannot set version in format file.  Caching disabled.");
-		return 0;
-	    }
+	if (bu_file_writable(path) && !cache_set_format(cache, path, CACHE_FORMAT)) {
+	    return 0;
 	}
     }
     if (bu_file_directory(path)) {
@@ -397,6 +411,8 @@ uncompress_external(const struct rt_cache *cache, const struct bu_external *exte
 
     if (!uncompressed) {
 	CACHE_DEBUG("++++++ [%lu.%lu] decompression failed (ret %d, %zu bytes @ %p to %zu bytes max)\n", bu_pid(), bu_parallel_id(), ret, external->ext_nbytes, (void *) external->ext_buf, dest->ext_nbytes);
+	bu_free(buffer, "buffer");
+	dest->ext_nbytes = 0;
 	return;
     }
 
@@ -404,6 +420,45 @@ uncompress_external(const struct rt_cache *cache, const struct bu_external *exte
 }
 
 
+/* exports a cache object.  uncompressed entries are padded (via an
+ * rt_cache::pad attribute) so their body starts on a page boundary of
+ * the mapped file, letting loads hand the pages straight through.
+ */
+static void
+cache_export_entry(const struct rt_cache *cache, struct bu_external *db_external, const char *name, struct bu_attribute_value_set *attributes, const struct bu_external *data_external)
+{
+    struct bu_external attributes_external = BU_EXTERNAL_INIT_ZERO;
+    struct db5_raw_internal raw_internal;
+    struct bu_vls pad = BU_VLS_INIT_ZERO;
+    size_t offset;
+    int tries = 0;
+
+    while (1) {
+	db5_export_attributes(&attributes_external, attributes);
+	db5_export_object3(db_external, 0, name, 0, &attributes_external,
+			   data_external, DB5_MAJORTYPE_BINARY_MIME, 0,
+			   DB5_ZZZ_UNCOMPRESSED, DB5_ZZZ_UNCOMPRESSED);
+	bu_free_external(&attributes_external);
+
+	if (!cache->uncompressed || tries++ > 8)
+	    break;
+	if (db5_get_raw_internal_ptr(&raw_internal, db_external->ext_buf) == NULL)
+	    break;
+
+	/* growing the pad can widen the length encodings, so iterate */
+	offset = (size_t)(raw_internal.body.ext_buf - db_external->ext_buf) % BU_PAGE_SIZE;
+	if (!offset)
+	    break;
+	while (offset++ < BU_PAGE_SIZE)
+	    bu_vls_putc(&pad, '.');
+	bu_avs_add(attributes, "rt_cache::pad", bu_vls_cstr(&pad));
+	bu_free_external(db_external);
+    }
+
+    bu_vls_free(&pad);
+}
+
+
 static struct rt_cache_entry *
 cache_read_entry(const struct rt_cache *cache, const char *name)
 {
@@ -489,6 +544,8 @@ static int
 cache_try_load(const struct rt_cache *cache, const char *name, const struct rt_db_internal *internal, struct soltab *stp)
 {
     size_t version = (size_t)-1;
+    int raw = 0;
+    int ret;
     struct db5_raw_internal raw_internal;
     struct bu_external data_external = BU_EXTERNAL_INIT_ZERO;
     struct rt_cache_entry *e;
@@ -510,6 +567,7 @@ cache_try_load(const struct rt_cache *cache, const char *name, const struct rt_d
     {
 	struct bu_attribute_value_set attributes;
 	const char *version_str;
+	const char *encoding;
 	const char *endptr;
 
 	if (db5_import_attributes(&attributes, &raw_internal.attributes) < 0)
@@ -528,19 +586,32 @@ cache_try_load(const struct rt_cache *cache, const char *name, const struct rt_d
 	if ((version == 0 && errno) || endptr == version_str || *endptr)
 	    return 0; /* invalid version */
 
+	/* v3 entries carry no encoding, they're always LZ4 */
+	encoding = bu_avs_get(&attributes, "rt_cache::encoding");
+	if (encoding && BU_STR_EQUAL(encoding, "raw"))
+	    raw = 1;
+	else if (encoding && !BU_STR_EQUAL(encoding, "lz4"))
+	    return 0; /* unknown encoding */
+
 	bu_avs_free(&attributes);
     }
 
-    uncompress_external(cache, &raw_internal.body, &data_external);
-
-    if (rt_obj_prep_serialize(stp, internal, &data_external, &version)) {
-	/* failed to deserialize */
-	bu_free_external(&data_external);
-	return 0;
+    if (raw) {
+	/* zero-copy: deserialize straight out of the mapped entry,
+	 * which stays mapped until rt_cache_close().
+	 */
+	data_external = raw_internal.body; /* struct copy */
+	return !rt_obj_prep_serialize(stp, internal, &data_external, &version);
     }
 
+    uncompress_external(cache, &raw_internal.body, &data_external);
+    if (!data_external.ext_buf)
+	return 0; /* corrupt */
+
+    ret = rt_obj_prep_serialize(stp, internal, &data_external, &version);
     bu_free_external(&data_external);
-    return 1; /* success! */
+
+    return !ret;
 }
 
 
@@ -548,7 +619,7 @@ static int
 cache_try_store(struct rt_cache *cache, const char *name, const struct rt_db_internal *internal, struct soltab *stp)
 {
     FILE *focache = NULL;
-    struct bu_external attributes_external = BU_EXTERNAL_INIT_ZERO;
+    struct bu_attribute_value_set attributes = BU_AVS_INIT_ZERO;
     struct bu_external data_external = BU_EXTERNAL_INIT_ZERO;
     struct bu_external db_external = BU_EXTERNAL_INIT_ZERO;
     size_t version = (size_t)-1;
@@ -567,30 +638,29 @@ cache_try_store(struct rt_cache *cache, const char *name, const struct rt_db_int
 	return 0; /* can't serialize */
     }
 
-    compress_external(cache, &data_external);
+    if (!cache->uncompressed)
+	compress_external(cache, &data_external);
 
     {
-	struct bu_attribute_value_set attributes = BU_AVS_INIT_ZERO;
 	struct bu_vls version_vls = BU_VLS_INIT_ZERO;
 
 	bu_vls_sprintf(&version_vls, "%zu", version);
 	bu_avs_add(&attributes, "mime_type", cache_mime_type);
 	bu_avs_add(&attributes, "rt_cache::version", bu_vls_addr(&version_vls));
+	bu_avs_add(&attributes, "rt_cache::encoding", cache->uncompressed ? "raw" : "lz4");
 	if (stp->st_dp && stp->st_dp->d_namep) {
 	    bu_avs_add(&attributes, "rt_cache::source_obj", stp->st_dp->d_namep);
 	}
 	if (stp->st_rtip && stp->st_rtip->rti_dbip->dbi_filename) {
 	    bu_avs_add(&attributes, "rt_cache::source_g", stp->st_rtip->rti_dbip->dbi_filename);
 	}
-	db5_export_attributes(&attributes_external, &attributes);
 	bu_vls_free(&version_vls);
-	bu_avs_free(&attributes);
     }
 
     /* [FIXME: redundant] make sure we can write to the cache dir */
     if (!bu_file_writable(cache->dir) || !bu_file_executable(cache->dir)) {
 	cache_warn(cache, cache->dir, "Directory is not writable.  Caching disabled.");
-	bu_free_external(&attributes_external);
+	bu_avs_free(&attributes);
 	bu_free_external(&data_external);
 	return 0;
     }
@@ -599,7 +669,7 @@ cache_try_store(struct rt_cache *cache, const char *name, const struct rt_db_int
 	char objdir[MAXPATHLEN] = {0};
 	bu_path_basename(tmppath, objdir);
 	cache_warn(cache, objdir, "Subdirectory is not writable.  Caching disabled.");
-	bu_free_external(&attributes_external);
+	bu_avs_free(&attributes);
 	bu_free_external(&data_external);
 	return 0;
     }
@@ -612,14 +682,13 @@ cache_try_store(struct rt_cache *cache, const char *name, const struct rt_db_int
 
     if (!cache_create_dir(cache, tmpname)) {
 	CACHE_DEBUG("++++++ [%lu.%lu] Failed to create cache dir %s\n", bu_pid(), bu_parallel_id(), tmpname);
-	bu_free_external(&attributes_external);
+	bu_avs_free(&attributes);
 	bu_free_external(&data_external);
 	return 0; /* no storage */
     }
 
-    db5_export_object3(&db_external, 0, name, 0, &attributes_external,
-		       &data_external, DB5_MAJORTYPE_BINARY_MIME, 0,
-		       DB5_ZZZ_UNCOMPRESSED, DB5_ZZZ_UNCOMPRESSED);
+    cache_export_entry(cache, &db_external, name, &attributes, &data_external);
+    bu_avs_free(&attributes);
 
     focache = fopen(tmppath, "wb");
     if (!focache) {
@@ -631,7 +700,6 @@ cache_try_store(struct rt_cache *cache, const char *name, const struct rt_db_int
 	fclose(focache);
 	bu_file_delete(tmppath);
 	bu_free_external(&db_external);
-	bu_free_external(&attributes_external);
 	bu_free_external(&data_external);
 	CACHE_DEBUG("++++++ [%lu.%lu] Failed to put cache temp %s\n", bu_pid(), bu_parallel_id(), tmpname);
 	return 0; /* can't stash */
@@ -641,7 +709,6 @@ cache_try_store(struct rt_cache *cache, const char *name, const struct rt_db_int
     CACHE_DEBUG("++++++ [%lu.%lu] Successfully wrote cache temp %s\n", bu_pid(), bu_parallel_id(), tmpname);
 
     bu_free_external(&db_external);
-    bu_free_external(&attributes_external);
     bu_free_external(&data_external);
 
     /* get the real / final cache object file name */
@@ -882,10 +949,27 @@ rt_cache_open(void)
 	CACHE_LOG("      Delete or move folder to enable caching with this version.\n");
     }
 
-    if (format != CACHE_FORMAT) {
+    if (format != CACHE_FORMAT && format != CACHE_FORMAT_LZ4) {
 	return NULL;
     }
 
+    /* uncompressed entries trade disk space for mapping the prep data
+     * straight into memory on load instead of decompressing a copy.
+     */
+    cache->uncompressed = bu_str_true(getenv("LIBRT_CACHE_UNCOMPRESSED"));
+
+    if (format == CACHE_FORMAT_LZ4 && cache->uncompressed) {
+	/* raw entries would be misread by v3 readers, so upgrade */
+	struct bu_vls path = BU_VLS_INIT_ZERO;
+
+	bu_vls_printf(&path, "%s%c%s", dir, BU_DIR_SEPARATOR, "format");
+	if (!cache->read_only && cache_set_format(cache, bu_vls_cstr(&path), CACHE_FORMAT))
+	    format = CACHE_FORMAT;
+	else
+	    cache->uncompressed = 0;
+	bu_vls_free(&path);
+    }
+
     BU_GET(result, struct rt_cache);
     *result = CACHE; /* struct copy */
 
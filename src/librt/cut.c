@@ -48,6 +48,7 @@
 #include "raytrace.h"
 #include "bg/plane.h"
 #include "bv/plot3.h"
+#include "./librt_private.h"
 
 
 static int rt_ck_overlap(const vect_t min, const vect_t max, const struct soltab *stp, const struct rt_i *rtip);
@@ -263,6 +264,11 @@ rt_cut_it(register struct rt_i *rtip, int UNUSED(ncpu))
 	rtip->rti_cutdepth = 6;
     }
 
+    if (rtip->rti_space_partition == RT_PART_HLBVH && cut_hlbvh_build(rtip) < 0) {
+	bu_log("rt_cut_it: HLBVH unavailable, using NUBSP\n");
+	rtip->rti_space_partition = RT_PART_NUBSPT;
+    }
+
     switch (rtip->rti_space_partition) {
 	case RT_PART_NUBSPT: {
 	    rtip->rti_CutHead = *finp;	/* union copy */
@@ -275,6 +281,13 @@ rt_cut_it(register struct rt_i *rtip, int UNUSED(ncpu))
 	    }
 
 	    break; }
+	case RT_PART_HLBVH:
+	    /* The BVH is what rt_shootray() walks.  Keep everything in
+	     * one root cell so NUBSP-only consumers (rt_find_backing_dist(),
+	     * rt_cell_n_on_ray(), bundles) still see every solid.
+	     */
+	    rtip->rti_CutHead = *finp;	/* union copy */
+	    break;
 	default:
 	    bu_bomb("rt_cut_it: unknown space partitioning method\n");
     }
@@ -298,6 +311,8 @@ rt_cut_it(register struct rt_i *rtip, int UNUSED(ncpu))
 	rt_pr_cut(&rtip->rti_CutHead, 0);
     }
 
+    cut_flat_build(rtip);
+
     if (RT_G_DEBUG&RT_DEBUG_PL_BOX) {
 	/* Debugging code to plot cuts */
 	if ((plotfp=fopen("rtcut.plot3", "wb"))!=NULL) {
@@ -1112,6 +1127,178 @@ rt_ct_measure(register struct rt_i *rtip, register union cutter *cutp, size_t de
 }
 
 
+static void
+cut_flat_measure(const union cutter *cutp, size_t *nnodes, size_t *nbytes)
+{
+    (*nnodes)++;
+    switch (cutp->cut_type) {
+	case CUT_CUTNODE:
+	    cut_flat_measure(cutp->cn.cn_l, nnodes, nbytes);
+	    cut_flat_measure(cutp->cn.cn_r, nnodes, nbytes);
+	    return;
+	case CUT_BOXNODE:
+	    *nbytes += sizeof(union cutter);
+	    if (cutp->bn.bn_len > 0 && cutp->bn.bn_len <= CUT_FLAT_INLINE)
+		*nbytes += cutp->bn.bn_len * sizeof(struct soltab *);
+	    return;
+	default:
+	    bu_bomb("cut_flat_measure: bad node");
+    }
+}
+
+
+/*
+ * Lay out cutp and everything below it depth first, left child
+ * first, so the common descent walks forward through memory.
+ * Returns the index cutp landed at.
+ */
+static uint32_t
+cut_flat_fill(struct rt_i *rtip, const union cutter *cutp, size_t *nnodes, size_t *nbytes)
+{
+    uint32_t idx = (uint32_t)(*nnodes)++;
+    struct cut_flat_node *fp = &rtip->rti_cut_flat[idx];
+    union cutter *box;
+
+    switch (cutp->cut_type) {
+	case CUT_CUTNODE:
+	    fp->cf_point = cutp->cn.cn_point;
+	    fp->cf_axis = (uint32_t)cutp->cn.cn_axis;
+	    (void)cut_flat_fill(rtip, cutp->cn.cn_l, nnodes, nbytes);
+	    fp->cf_index = cut_flat_fill(rtip, cutp->cn.cn_r, nnodes, nbytes);
+	    break;
+	case CUT_BOXNODE:
+	    fp->cf_point = 0.0;
+	    fp->cf_axis = CUT_FLAT_LEAF;
+	    fp->cf_index = (uint32_t)*nbytes;
+
+	    box = (union cutter *)(rtip->rti_cut_boxes + *nbytes);
+	    *box = *cutp;	/* union copy, piece lists are shared */
+	    *nbytes += sizeof(union cutter);
+
+	    /* bn_maxlen of a packed box is the room for an inline
+	     * list, which cut_flat_update() reuses
+	     */
+	    box->bn.bn_maxlen = 0;
+	    if (cutp->bn.bn_len > 0 && cutp->bn.bn_len <= CUT_FLAT_INLINE) {
+		box->bn.bn_list = (struct soltab **)(rtip->rti_cut_boxes + *nbytes);
+		box->bn.bn_maxlen = cutp->bn.bn_len;
+		memcpy(box->bn.bn_list, cutp->bn.bn_list, cutp->bn.bn_len * sizeof(struct soltab *));
+		*nbytes += cutp->bn.bn_len * sizeof(struct soltab *);
+	    }
+	    break;
+    }
+    return idx;
+}
+
+
+void
+cut_flat_free(struct rt_i *rtip)
+{
+    RT_CK_RTI(rtip);
+
+    if (rtip->rti_cut_flat)
+	bu_free(rtip->rti_cut_flat, "rti_cut_flat");
+    if (rtip->rti_cut_boxes)
+	bu_free(rtip->rti_cut_boxes, "rti_cut_boxes");
+    rtip->rti_cut_flat = NULL;
+    rtip->rti_cut_boxes = NULL;
+}
+
+
+void
+cut_flat_build(struct rt_i *rtip)
+{
+    size_t nnodes = 0;
+    size_t nbytes = 0;
+
+    RT_CK_RTI(rtip);
+
+    cut_flat_free(rtip);
+
+    if (rtip->rti_CutHead.cut_type != CUT_CUTNODE && rtip->rti_CutHead.cut_type != CUT_BOXNODE)
+	return;
+
+    cut_flat_measure(&rtip->rti_CutHead, &nnodes, &nbytes);
+
+    /* offsets are 32 bits, rt_advance_to_next_cell() falls back to
+     * the cut tree itself for anything bigger
+     */
+    if (nnodes > UINT32_MAX || nbytes > UINT32_MAX) {
+	if (RT_G_DEBUG&RT_DEBUG_CUT)
+	    bu_log("cut_flat_build: cut tree too large to pack (%zu nodes, %zu bytes)\n", nnodes, nbytes);
+	return;
+    }
+
+    rtip->rti_cut_flat = (struct cut_flat_node *)bu_malloc(nnodes * sizeof(struct cut_flat_node), "rti_cut_flat");
+    rtip->rti_cut_boxes = (uint8_t *)bu_malloc(nbytes, "rti_cut_boxes");
+
+    nnodes = nbytes = 0;
+    (void)cut_flat_fill(rtip, &rtip->rti_CutHead, &nnodes, &nbytes);
+
+    if (RT_G_DEBUG&RT_DEBUG_CUT) {
+	bu_log("Packed cut tree: %zu nodes, %.2f KB\n", nnodes,
+	       (double)(nnodes * sizeof(struct cut_flat_node) + nbytes) / 1024.0);
+    }
+}
+
+
+/*
+ * Walk the cut tree and its packed copy side by side, down every
+ * branch that remove_from_bsp() or insert_in_bsp() could have taken
+ * for a solid with these bounds, and refresh each packed leaf reached
+ * from its master boxnode.
+ */
+static void
+cut_flat_update_node(struct rt_i *rtip, const union cutter *cutp, uint32_t idx, const fastf_t *min, const fastf_t *max)
+{
+    const struct cut_flat_node *fp = &rtip->rti_cut_flat[idx];
+    union cutter *box;
+    struct soltab **inline_list;
+    size_t room;
+
+    switch (cutp->cut_type) {
+	case CUT_CUTNODE:
+	    if (min[cutp->cn.cn_axis] > cutp->cn.cn_point + rtip->rti_tol.dist) {
+		cut_flat_update_node(rtip, cutp->cn.cn_r, fp->cf_index, min, max);
+	    } else if (max[cutp->cn.cn_axis] < cutp->cn.cn_point - rtip->rti_tol.dist) {
+		cut_flat_update_node(rtip, cutp->cn.cn_l, idx + 1, min, max);
+	    } else {
+		cut_flat_update_node(rtip, cutp->cn.cn_r, fp->cf_index, min, max);
+		cut_flat_update_node(rtip, cutp->cn.cn_l, idx + 1, min, max);
+	    }
+	    return;
+	case CUT_BOXNODE:
+	    box = (union cutter *)(rtip->rti_cut_boxes + fp->cf_index);
+	    room = box->bn.bn_maxlen;
+	    inline_list = (struct soltab **)(rtip->rti_cut_boxes + fp->cf_index + sizeof(union cutter));
+
+	    *box = *cutp;	/* union copy, piece lists are shared */
+	    box->bn.bn_maxlen = room;
+	    if (cutp->bn.bn_len > 0 && cutp->bn.bn_len <= room) {
+		box->bn.bn_list = inline_list;
+		memcpy(inline_list, cutp->bn.bn_list, cutp->bn.bn_len * sizeof(struct soltab *));
+	    }
+	    /* otherwise the list outgrew its slot, share the master's */
+	    return;
+	default:
+	    bu_bomb("cut_flat_update_node: bad node");
+    }
+}
+
+
+void
+cut_flat_update(struct rt_i *rtip, const struct soltab *stp)
+{
+    RT_CK_RTI(rtip);
+    RT_CK_SOLTAB(stp);
+
+    if (!rtip->rti_cut_flat)
+	return;
+
+    cut_flat_update_node(rtip, &rtip->rti_CutHead, 0, stp->st_min, stp->st_max);
+}
+
+
 void
 rt_cut_clean(struct rt_i *rtip)
 {
@@ -1122,6 +1309,9 @@ rt_cut_clean(struct rt_i *rtip)
     if (rtip->rti_cuts_waiting.l.magic)
 	bu_ptbl_free(&rtip->rti_cuts_waiting);
 
+    cut_hlbvh_free(rtip);
+    cut_flat_free(rtip);
+
     /* Abandon the linked list of diced-up structures */
     rtip->rti_CutFree = CUTTER_NULL;
 
@@ -1143,8 +1333,8 @@ rt_pr_cut_info(const struct rt_i *rtip, const char *str)
 
     bu_log("%s %s: %zu cut, %zu box (%zu empty)\n",
 	   str,
-	   rtip->rti_space_partition == RT_PART_NUBSPT ?
-	   "NUBSP" : "unknown",
+	   rtip->rti_space_partition == RT_PART_NUBSPT ? "NUBSP" :
+	   rtip->rti_space_partition == RT_PART_HLBVH ? "HLBVH" : "unknown",
 	   rtip->rti_ncut_by_type[CUT_CUTNODE],
 	   rtip->rti_ncut_by_type[CUT_BOXNODE],
 	   rtip->nempty_cells);
@@ -48,6 +48,7 @@
 #include "raytrace.h"
 #include "bg/plane.h"
 #include "bv/plot3.h"
+#include "./librt_private.h"
 
 struct bvh_build_node {
     fastf_t bounds[6];
@@ -567,6 +568,141 @@ hlbvh_create(long max_prims_in_node, struct bu_pool *pool, const fastf_t *centro
 }
 
 
+static long
+flatten_bvh_node(long *offset, struct bvh_flat_node *nodes, long total_nodes,
+		 const struct bvh_build_node *node, long depth, long *max_depth)
+{
+    long my_offset = *offset;
+    struct bvh_flat_node *linear_node;
+
+    BU_ASSERT(my_offset < total_nodes);
+    ++*offset;
+    linear_node = &nodes[my_offset];
+
+    if (depth > *max_depth)
+	*max_depth = depth;
+
+    VMOVE(&linear_node->bounds[0], &node->bounds[0]);
+    VMOVE(&linear_node->bounds[3], &node->bounds[3]);
+    if (node->n_primitives > 0) {
+	BU_ASSERT(!node->children[0] && !node->children[1]);
+	linear_node->u.primitives_offset = node->first_prim_offset;
+	linear_node->n_primitives = node->n_primitives;
+    } else {
+	/* Create interior flattened BVH node */
+	linear_node->axis = node->split_axis;
+	linear_node->n_primitives = 0;
+	flatten_bvh_node(offset, nodes, total_nodes, node->children[0], depth + 1, max_depth);
+	linear_node->u.second_child_offset =
+	    flatten_bvh_node(offset, nodes, total_nodes, node->children[1], depth + 1, max_depth);
+    }
+    return my_offset;
+}
+
+
+struct bvh_flat_node *
+hlbvh_flatten(const struct bvh_build_node *root, long total_nodes, long *max_depth)
+{
+    struct bvh_flat_node *nodes;
+    long offset = 0;
+
+    nodes = (struct bvh_flat_node *)bu_calloc(total_nodes, sizeof(*nodes), "hlbvh_flatten");
+    *max_depth = 0;
+    flatten_bvh_node(&offset, nodes, total_nodes, root, 0, max_depth);
+    BU_ASSERT(offset <= total_nodes);
+    return nodes;
+}
+
+
+void
+cut_hlbvh_free(struct rt_i *rtip)
+{
+    RT_CK_RTI(rtip);
+
+    if (rtip->rti_bvh_nodes)
+	bu_free(rtip->rti_bvh_nodes, "rti_bvh_nodes");
+    if (rtip->rti_bvh_prims)
+	bu_free(rtip->rti_bvh_prims, "rti_bvh_prims");
+    rtip->rti_bvh_nodes = NULL;
+    rtip->rti_bvh_prims = NULL;
+    rtip->rti_bvh_nnodes = 0;
+}
+
+
+int
+cut_hlbvh_build(struct rt_i *rtip)
+{
+    struct soltab *stp;
+    struct soltab **primitives;
+    long n_primitives = 0;
+    long i;
+
+    RT_CK_RTI(rtip);
+
+    cut_hlbvh_free(rtip);
+
+    primitives = (struct soltab **)bu_calloc(rtip->nsolids + 1, sizeof(struct soltab *), "primitives");
+    RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
+	/* Ignore "dead" solids in the list.  (They failed prep) */
+	if (stp->st_aradius <= 0)
+	    continue;
+	/* Infinite solids stay in rti_inf_box, they'd swallow the BVH */
+	if (stp->st_aradius >= INFINITY)
+	    continue;
+	primitives[n_primitives++] = stp;
+    } RT_VISIT_ALL_SOLTABS_END;
+
+    if (n_primitives != 0) {
+	struct bu_pool *pool;
+	struct bvh_build_node *root;
+	long nodes_created = 0;
+	long max_depth = 0;
+	long *ordered_prims = NULL;
+	fastf_t *centroids;
+	fastf_t *bounds;
+
+	centroids = (fastf_t *)bu_calloc(n_primitives, sizeof(fastf_t)*3, "centroids");
+	bounds = (fastf_t *)bu_calloc(n_primitives, sizeof(fastf_t)*6, "bounds");
+	for (i = 0; i < n_primitives; i++) {
+	    VMOVE(&centroids[i*3], primitives[i]->st_center);
+	    VMOVE(&bounds[i*6+0], primitives[i]->st_min);
+	    VMOVE(&bounds[i*6+3], primitives[i]->st_max);
+	}
+
+	/* Pool must hold the whole tree, see clt_linear_bvh_create() */
+	pool = bu_pool_create(sizeof(struct bvh_build_node)*(2*n_primitives+2*4096));
+	root = hlbvh_create(4, pool, centroids, bounds, &nodes_created,
+			    n_primitives, &ordered_prims);
+	rtip->rti_bvh_nodes = hlbvh_flatten(root, nodes_created, &max_depth);
+	rtip->rti_bvh_nnodes = nodes_created;
+	bu_pool_delete(pool);
+	bu_free(bounds, "bounds");
+	bu_free(centroids, "centroids");
+
+	rtip->rti_bvh_prims = (struct soltab **)bu_calloc(n_primitives, sizeof(struct soltab *), "rti_bvh_prims");
+	for (i = 0; i < n_primitives; i++)
+	    rtip->rti_bvh_prims[i] = primitives[ordered_prims[i]];
+	bu_free(ordered_prims, "ordered prims");
+
+	if (RT_G_DEBUG&RT_DEBUG_CUT) {
+	    bu_log("HLBVH: %ld nodes, %ld primitives, depth %ld (%.2f KB)\n",
+		   nodes_created, n_primitives, max_depth,
+		   (double)(sizeof(struct bvh_flat_node) * nodes_created) / (1024.0));
+	}
+
+	if (max_depth >= BVH_STACK_SIZE) {
+	    bu_log("cut_hlbvh_build: BVH depth %ld exceeds traversal stack (%d)\n",
+		   max_depth, BVH_STACK_SIZE);
+	    cut_hlbvh_free(rtip);
+	    bu_free(primitives, "primitives");
+	    return -1;
+	}
+    }
+    bu_free(primitives, "primitives");
+    return 0;
+}
+
+
 #ifdef USE_OPENCL
 static cl_int
 flatten_bvh_tree(cl_int *offset, struct clt_linear_bvh_node *nodes, long total_nodes,
@@ -230,6 +230,7 @@ db_diradd5(
     dp->d_uses = 0;
     dp->d_forw = *headp;
     *headp = dp;
+    dirindex_add(dbip, dp);
 
     if (BU_PTBL_IS_INITIALIZED(&dbip->dbi_changed_clbks)) {
 	for (size_t i = 0; i < BU_PTBL_LEN(&dbip->dbi_changed_clbks); i++) {
@@ -320,6 +321,7 @@ db5_diradd(struct db_i *dbip,
     dp->d_uses = 0;
     dp->d_forw = *headp;
     *headp = dp;
+    dirindex_add(dbip, dp);
 
     if (BU_PTBL_IS_INITIALIZED(&dbip->dbi_changed_clbks)) {
 	for (size_t i = 0; i < BU_PTBL_LEN(&dbip->dbi_changed_clbks); i++) {
@@ -31,6 +31,8 @@
 #include "bio.h"
 
 #include "vmath.h"
+#include "bu/hash.h"
+#include "bu/parallel.h"
 #include "bu/vls.h"
 #include "rt/db4.h"
 #include "raytrace.h"
@@ -102,6 +104,244 @@ db_dirhash(const char *str)
 }
 
 
+/*
+ * The dbi_Head[] chains are what callers iterate over, but with a
+ * fixed number of buckets and db_dirhash()'s positional sum they get
+ * long on big databases.  Name lookups instead go through an open
+ * addressed table keyed by a 64-bit xxhash of the name, which doubles
+ * as objects are added.
+ *
+ * Readers take no lock.  Writers serialize on a semaphore, fill in a
+ * slot's tag before storing its entry, and only ever move a slot from
+ * empty to an entry to DIRINDEX_TOMB.  A resize builds the new table
+ * completely before publishing it; the old one stays allocated until
+ * dirindex_free() so a reader still probing it is never left with a
+ * dangling table.  Entries, tables and the index itself are published
+ * with release stores and read with acquire loads, so a reader that
+ * sees a pointer also sees everything written before it.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define DIRINDEX_LOAD(p) __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#  define DIRINDEX_STORE(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#elif defined(_WIN32)
+#  define DIRINDEX_LOAD(p) InterlockedCompareExchangePointer((PVOID volatile *)&(p), NULL, NULL)
+#  define DIRINDEX_STORE(p, v) (void)InterlockedExchangePointer((PVOID volatile *)&(p), (PVOID)(v))
+#else
+#  error "no acquire/release atomics for the directory index"
+#endif
+
+#define DIRINDEX_MIN_SLOTS 1024
+
+struct dirindex_table {
+    size_t mask;			/* slots - 1, slots is a power of two */
+    uint32_t *tags;			/* high bits of each entry's hash */
+    struct directory **slots;
+};
+
+struct db_dirindex {
+    struct dirindex_table *table;
+    size_t used;			/* live entries plus tombstones */
+    size_t live;
+    struct bu_ptbl retired;		/* outgrown tables */
+};
+
+static struct directory dirindex_tomb;
+#define DIRINDEX_TOMB (&dirindex_tomb)
+
+static int dirindex_sem = 0;
+
+
+static unsigned long long
+dirindex_hash(const char *name)
+{
+    return bu_data_hash(name, strlen(name));
+}
+
+
+static struct dirindex_table *
+dirindex_table_create(size_t nslots)
+{
+    struct dirindex_table *t;
+
+    BU_GET(t, struct dirindex_table);
+    t->mask = nslots - 1;
+    t->tags = (uint32_t *)bu_calloc(nslots, sizeof(uint32_t), "dirindex tags");
+    t->slots = (struct directory **)bu_calloc(nslots, sizeof(struct directory *), "dirindex slots");
+    return t;
+}
+
+
+static void
+dirindex_table_free(struct dirindex_table *t)
+{
+    bu_free(t->tags, "dirindex tags");
+    bu_free(t->slots, "dirindex slots");
+    BU_PUT(t, struct dirindex_table);
+}
+
+
+/* Caller holds dirindex_sem.  Does not check for duplicates. */
+static void
+dirindex_table_insert(struct dirindex_table *t, struct directory *dp, unsigned long long hash)
+{
+    size_t i = (size_t)hash & t->mask;
+
+    while (t->slots[i] != RT_DIR_NULL)
+	i = (i + 1) & t->mask;
+
+    t->tags[i] = (uint32_t)(hash >> 32);
+    DIRINDEX_STORE(t->slots[i], dp);
+}
+
+
+/* Rebuild into a table sized for twice the live entries, dropping
+ * tombstones.  Caller holds dirindex_sem.
+ */
+static void
+dirindex_rehash(struct db_dirindex *idx)
+{
+    struct dirindex_table *old = idx->table;
+    struct dirindex_table *t;
+    size_t nslots = DIRINDEX_MIN_SLOTS;
+    size_t i;
+
+    while (nslots < (idx->live + 1) * 2)
+	nslots <<= 1;
+
+    t = dirindex_table_create(nslots);
+    for (i = 0; i <= old->mask; i++) {
+	struct directory *dp = old->slots[i];
+	if (dp == RT_DIR_NULL || dp == DIRINDEX_TOMB)
+	    continue;
+	dirindex_table_insert(t, dp, dirindex_hash(dp->d_namep));
+    }
+
+    DIRINDEX_STORE(idx->table, t);
+    idx->used = idx->live;
+    bu_ptbl_ins(&idx->retired, (long *)old);
+}
+
+
+void
+dirindex_add(struct db_i *dbip, struct directory *dp)
+{
+    struct db_dirindex *idx;
+
+    RT_CK_DBI(dbip);
+    RT_CK_DIR(dp);
+
+    if (!dirindex_sem)
+	dirindex_sem = bu_semaphore_register("LIBRT_SEM_DIRINDEX");
+
+    bu_semaphore_acquire(dirindex_sem);
+
+    idx = dbip->dbi_dirindex;
+    if (!idx) {
+	BU_GET(idx, struct db_dirindex);
+	idx->table = dirindex_table_create(DIRINDEX_MIN_SLOTS);
+	idx->used = idx->live = 0;
+	bu_ptbl_init(&idx->retired, 8, "dirindex retired");
+	DIRINDEX_STORE(dbip->dbi_dirindex, idx);
+    }
+
+    /* keep the load, tombstones included, under 3/4 */
+    if ((idx->used + 1) * 4 > (idx->table->mask + 1) * 3)
+	dirindex_rehash(idx);
+
+    dirindex_table_insert(idx->table, dp, dirindex_hash(dp->d_namep));
+    idx->used++;
+    idx->live++;
+
+    bu_semaphore_release(dirindex_sem);
+}
+
+
+void
+dirindex_remove(struct db_i *dbip, struct directory *dp)
+{
+    struct db_dirindex *idx;
+    struct dirindex_table *t;
+    size_t i;
+
+    RT_CK_DBI(dbip);
+    RT_CK_DIR(dp);
+
+    idx = dbip->dbi_dirindex;
+    if (!idx)
+	return;
+
+    bu_semaphore_acquire(dirindex_sem);
+
+    t = idx->table;
+    i = (size_t)dirindex_hash(dp->d_namep) & t->mask;
+    while (t->slots[i] != RT_DIR_NULL) {
+	if (t->slots[i] == dp) {
+	    DIRINDEX_STORE(t->slots[i], DIRINDEX_TOMB);
+	    idx->live--;
+	    break;
+	}
+	i = (i + 1) & t->mask;
+    }
+
+    bu_semaphore_release(dirindex_sem);
+}
+
+
+void
+dirindex_free(struct db_i *dbip)
+{
+    struct db_dirindex *idx = dbip->dbi_dirindex;
+    size_t i;
+
+    if (!idx)
+	return;
+
+    for (i = 0; i < BU_PTBL_LEN(&idx->retired); i++)
+	dirindex_table_free((struct dirindex_table *)BU_PTBL_GET(&idx->retired, i));
+    bu_ptbl_free(&idx->retired);
+    dirindex_table_free(idx->table);
+    BU_PUT(idx, struct db_dirindex);
+    dbip->dbi_dirindex = NULL;
+}
+
+
+/* Exact name match, without db_lookup()'s path handling */
+static struct directory *
+dir_find(const struct db_i *dbip, const char *name)
+{
+    struct directory *dp;
+    struct db_dirindex *idx;
+    char n0 = name[0];
+    char n1 = name[1];
+
+    idx = DIRINDEX_LOAD(((struct db_i *)dbip)->dbi_dirindex);
+    if (idx) {
+	struct dirindex_table *t = DIRINDEX_LOAD(idx->table);
+	unsigned long long hash = dirindex_hash(name);
+	uint32_t tag = (uint32_t)(hash >> 32);
+	size_t i = (size_t)hash & t->mask;
+
+	while ((dp = DIRINDEX_LOAD(t->slots[i])) != RT_DIR_NULL) {
+	    if (dp != DIRINDEX_TOMB && t->tags[i] == tag && BU_STR_EQUAL(name, dp->d_namep))
+		return dp;
+	    i = (i + 1) & t->mask;
+	}
+	return RT_DIR_NULL;
+    }
+
+    /* nothing has been added through db_diradd() and friends yet */
+    for (dp = dbip->dbi_Head[db_dirhash(name)]; dp != RT_DIR_NULL; dp = dp->d_forw) {
+	char *this_obj;
+
+	/* first two checks are for speed */
+	if ((n0 == *(this_obj=dp->d_namep)) && (n1 == this_obj[1]) && (BU_STR_EQUAL(name, this_obj)))
+	    return dp;
+    }
+    return RT_DIR_NULL;
+}
+
+
 int
 db_dircheck(struct db_i *dbip,
 	    struct bu_vls *ret_name,
@@ -110,41 +350,34 @@ db_dircheck(struct db_i *dbip,
 {
     struct directory *dp;
     char *cp = bu_vls_addr(ret_name);
-    char n0 = cp[0];
-    char n1 = cp[1];
 
     /* Compute hash only once (almost always the case) */
     *headp = &(dbip->dbi_Head[db_dirhash(cp)]);
 
-    for (dp = **headp; dp != RT_DIR_NULL; dp=dp->d_forw) {
-	char *this_obj;
-	if (n0 == *(this_obj=dp->d_namep)  &&	/* speed */
-	    n1 == this_obj[1]  &&			/* speed */
-	    BU_STR_EQUAL(cp, this_obj)) {
-	    /* Name exists in directory already */
-	    int c;
-
-	    bu_vls_strcpy(ret_name, "A_");
-	    bu_vls_strcat(ret_name, this_obj);
-	    cp = bu_vls_addr(ret_name);
-
-	    for (c = 'A'; c <= 'Z'; c++) {
-		*cp = c;
-		if (db_lookup(dbip, cp, noisy) == RT_DIR_NULL)
-		    break;
-	    }
-	    if (c > 'Z') {
-		bu_log("db_dircheck: Duplicate of name '%s', ignored\n",
-		       cp);
-		return -1;	/* fail */
-	    }
-	    bu_log("db_dircheck: Duplicate of '%s', given temporary name '%s'\n",
-		   cp+2, cp);
+    dp = dir_find(dbip, cp);
+    if (dp != RT_DIR_NULL) {
+	/* Name exists in directory already */
+	int c;
 
-	    /* no need to recurse, simply recompute the hash and break */
-	    *headp = &(dbip->dbi_Head[db_dirhash(cp)]);
-	    break;
+	bu_vls_strcpy(ret_name, "A_");
+	bu_vls_strcat(ret_name, dp->d_namep);
+	cp = bu_vls_addr(ret_name);
+
+	for (c = 'A'; c <= 'Z'; c++) {
+	    *cp = c;
+	    if (db_lookup(dbip, cp, noisy) == RT_DIR_NULL)
+		break;
+	}
+	if (c > 'Z') {
+	    bu_log("db_dircheck: Duplicate of name '%s', ignored\n",
+		   cp);
+	    return -1;	/* fail */
 	}
+	bu_log("db_dircheck: Duplicate of '%s', given temporary name '%s'\n",
+	       cp+2, cp);
+
+	/* no need to recurse, simply recompute the hash */
+	*headp = &(dbip->dbi_Head[db_dirhash(cp)]);
     }
 
     return 0;	/* success */
@@ -157,8 +390,6 @@ db_lookup(const struct db_i *dbip, const char *name, int noisy)
     int is_path = 0;
     const char *pc = name;
     struct directory *dp = RT_DIR_NULL;
-    char n0;
-    char n1;
 
     /* No string, no lookup */
     if (UNLIKELY(!name || name[0] == '\0')) {
@@ -172,22 +403,14 @@ db_lookup(const struct db_i *dbip, const char *name, int noisy)
     }
 
 
-    n0 = name[0];
-    n1 = name[1];
-
     RT_CK_DBI(dbip);
 
-    dp = dbip->dbi_Head[db_dirhash(name)];
-    for (; dp != RT_DIR_NULL; dp=dp->d_forw) {
-	char *this_obj;
-
-	/* first two checks are for speed */
-	if ((n0 == *(this_obj=dp->d_namep)) && (n1 == this_obj[1]) && (BU_STR_EQUAL(name, this_obj))) {
-	    if (UNLIKELY(RT_G_DEBUG&RT_DEBUG_DB)) {
-		bu_log("db_lookup(%s) %p\n", name, (void *)dp);
-	    }
-	    return dp;
+    dp = dir_find(dbip, name);
+    if (dp != RT_DIR_NULL) {
+	if (UNLIKELY(RT_G_DEBUG&RT_DEBUG_DB)) {
+	    bu_log("db_lookup(%s) %p\n", name, (void *)dp);
 	}
+	return dp;
     }
 
     /* Anything with a forward slash is potentially a path, rather than an object
@@ -296,6 +519,7 @@ db_diradd(struct db_i *dbip, const char *name, b_off_t laddr, size_t len, int fl
     dp->d_forw = *headp;
     BU_LIST_INIT(&dp->d_use_hd);
     *headp = dp;
+    dirindex_add(dbip, dp);
     dp->d_animate = NULL;
     dp->d_nref = 0;
     dp->d_uses = 0;
@@ -353,6 +577,7 @@ db_dirdelete(struct db_i *dbip, struct directory *dp)
 	    }
 	}
 
+	dirindex_remove(dbip, dp);
 	RT_DIR_FREE_NAMEP(dp);	/* frees d_namep */
 	*headp = dp->d_forw;
 
@@ -375,6 +600,7 @@ db_dirdelete(struct db_i *dbip, struct directory *dp)
 	    }
 	}
 
+	dirindex_remove(dbip, dp);
 	RT_DIR_FREE_NAMEP(dp);	/* frees d_namep */
 	findp->d_forw = dp->d_forw;
 
@@ -414,6 +640,7 @@ db_rename(struct db_i *dbip, struct directory *dp, const char *newname)
 
 out:
     /* Effect new name */
+    dirindex_remove(dbip, dp);
     RT_DIR_FREE_NAMEP(dp);			/* frees d_namep */
     RT_DIR_SET_NAMEP(dp, newname);	/* sets d_namep */
 
@@ -421,6 +648,7 @@ out:
     headp = &(dbip->dbi_Head[db_dirhash(newname)]);
     dp->d_forw = *headp;
     *headp = dp;
+    dirindex_add(dbip, dp);
     return 0;
 }
 
@@ -47,6 +47,7 @@
 #include "rt/db4.h"
 #include "raytrace.h"
 #include "wdb.h"
+#include "./librt_private.h"
 
 
 #ifndef SEEK_SET
@@ -501,6 +502,7 @@ db_close(register struct db_i *dbip)
 	}
 	dbip->dbi_Head[i] = RT_DIR_NULL;	/* sanity*/
     }
+    dirindex_free(dbip);
 
     if (dbip->dbi_filepath != NULL) {
 	bu_argv_free(2, dbip->dbi_filepath);
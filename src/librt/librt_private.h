@@ -110,7 +110,98 @@ extern const union cutter *rt_advance_to_next_cell(struct rt_shootray_status *ss
  * used by rt_shootray_bundle()
  * FIXME: non-public API shouldn't be using rt_ prefix
  */
-extern void rt_plot_cell(const union cutter *cutp, struct rt_shootray_status *ssp, struct bu_list *waiting_segs_hd, struct rt_i *rtip);
+extern void rt_plot_cell(const union cutter *cutp, const struct rt_shootray_status *ssp, struct bu_list *waiting_segs_hd, struct rt_i *rtip);
+
+/* bool.c */
+
+/**
+ * Compile regp->reg_treetop into regp->reg_prog, a flat jump program
+ * that rt_boolfinal() runs instead of walking the tree.  Regions that
+ * are all unions, or whose trees can't be compiled, are left with a
+ * NULL reg_prog and evaluated the old way.
+ */
+extern void bool_compile_region(struct region *regp);
+
+/**
+ * Release regp->reg_prog.  Must be called before the soltabs the
+ * program refers to go away or the region tree changes.
+ */
+extern void bool_free_region(struct region *regp);
+
+/* tree.c */
+
+/**
+ * Call func on every region of rtip from first (NULL for the head of
+ * HeadRegion) to the end of the list, spread over ncpu threads.  With
+ * one cpu or only a few regions this is a plain serial walk that
+ * hands func resp; otherwise each thread hands func a private scratch
+ * resource good for re_boolstack use only.
+ */
+extern void tree_region_parallel(struct rt_i *rtip, struct region *first, int ncpu, struct resource *resp,
+				 void (*func)(struct region *regp, struct resource *resp, void *data),
+				 void *data);
+
+/* cut.c */
+
+/**
+ * Pack rti_CutHead into rti_cut_flat/rti_cut_boxes, replacing any
+ * previous packing.  Must be redone whenever the cut tree changes.
+ */
+extern void cut_flat_build(struct rt_i *rtip);
+
+/**
+ * Release the packed cut tree, if any.
+ */
+extern void cut_flat_free(struct rt_i *rtip);
+
+/**
+ * Refresh the packed leaves that remove_from_bsp() or insert_in_bsp()
+ * may just have changed for stp, without repacking the whole tree.
+ * The shape of the cut tree must not have changed.
+ */
+extern void cut_flat_update(struct rt_i *rtip, const struct soltab *stp);
+
+/* cut_hlbvh.c */
+
+/**
+ * Build the RT_PART_HLBVH acceleration structure over all finite,
+ * successfully prepped solids in the model, replacing any previous
+ * one.  Returns 0 on success, -1 if the resulting tree is too deep
+ * for rt_shootray() to walk (nothing is kept in that case).
+ */
+extern int cut_hlbvh_build(struct rt_i *rtip);
+
+/**
+ * Release the RT_PART_HLBVH acceleration structure, if any.
+ */
+extern void cut_hlbvh_free(struct rt_i *rtip);
+
+/* shoot.c */
+
+/**
+ * Release a set of struct rt_profile counters, setting *profp to NULL.
+ */
+extern void shoot_profile_free(struct rt_profile **profp);
+
+/* vshoot.c */
+
+/**
+ * Release the rt_vshootray() packet scratch space cached on a
+ * resource structure.
+ */
+extern void vshoot_clean_resource(struct resource *resp);
+
+/* db_lookup.c */
+
+/**
+ * Maintain the by-name directory index.  Every directory entry
+ * linked onto a dbi_Head[] chain must also be added here, and removed
+ * (while its name is still set) before it is unlinked or renamed.
+ * dirindex_free() releases the index when the db_i is closed.
+ */
+extern void dirindex_add(struct db_i *dbip, struct directory *dp);
+extern void dirindex_remove(struct db_i *dbip, struct directory *dp);
+extern void dirindex_free(struct db_i *dbip);
 
 /* db_fullpath.c */
 
@@ -223,6 +314,33 @@ extern void plot_ellipse(
 	const vect_t b,
 	int num_points);
 
+/**
+ * Helpers for the ft_prep_serialize() implementations.  Prep data is
+ * written in native byte order, behind a header holding the caller's
+ * magic number and sizeof(fastf_t), so a cache entry written on a
+ * different architecture simply fails to load and gets re-prepped.
+ *
+ * primitive_prep_begin() starts a blob sized for about nbytes,
+ * primitive_prep_write() appends to it and primitive_prep_end() hands
+ * the bytes over to external.
+ */
+extern struct bu_pool *primitive_prep_begin(uint32_t magic, size_t nbytes);
+extern void primitive_prep_write(struct bu_pool *pool, const void *data, size_t nbytes);
+extern void primitive_prep_end(struct bu_pool *pool, struct bu_external *external);
+
+/**
+ * Check the header written by primitive_prep_begin(), leaving
+ * *offset just past it.  Returns 0 when the blob is usable.
+ */
+extern int primitive_prep_check(const struct bu_external *external, size_t *offset, uint32_t magic);
+
+/**
+ * Copy nbytes from external at *offset into data and advance
+ * *offset.  Returns 0 on success, or 1 (copying nothing) if the blob
+ * is too short.
+ */
+extern int primitive_prep_read(const struct bu_external *external, size_t *offset, void *data, size_t nbytes);
+
 extern int _rt_tcl_list_to_int_array(const char *list, int **array, int *array_len);
 extern int _rt_tcl_list_to_fastf_array(const char *list, fastf_t **array, int *array_len);
 
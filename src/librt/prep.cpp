@@ -39,6 +39,7 @@
 
 
 #include "bu/parallel.h"
+#include "bu/sort.h"
 #include "vmath.h"
 #include "bn.h"
 #include "raytrace.h"
@@ -46,6 +47,7 @@
 
 #include "optical.h"
 #include "optical/plastic.h"
+#include "./librt_private.h"
 
 
 extern void rt_ck(struct rt_i *rtip);
@@ -202,6 +204,35 @@ rt_free_rti(struct rt_i *rtip)
 }
 
 
+/* Optimize one region's expression tree and set its bit in every
+ * solid contained in the tree.
+ */
+static void
+prep_region(struct region *regp, struct resource *resp, void *UNUSED(data))
+{
+    rt_optim_tree(regp->reg_treetop, resp);
+    rt_solid_bitfinder(regp->reg_treetop, regp, resp);
+    bool_compile_region(regp);
+
+    if (RT_G_DEBUG&RT_DEBUG_REGIONS) {
+	db_ck_tree(regp->reg_treetop);
+	rt_pr_region(regp);
+    }
+}
+
+
+static int
+prep_region_cmp(const void *a, const void *b, void *UNUSED(arg))
+{
+    const struct region *ra = *(const struct region * const *)a;
+    const struct region *rb = *(const struct region * const *)b;
+
+    if (ra->reg_bit < rb->reg_bit)
+	return -1;
+    return (ra->reg_bit > rb->reg_bit);
+}
+
+
 /**
  * This routine should be called just before the first call to
  * rt_shootray().  It should only be called ONCE per execution, unless
@@ -301,15 +332,19 @@ rt_prep_parallel(struct rt_i *rtip, int ncpu)
 	/* Ensure bit numbers are unique */
 	BU_ASSERT(rtip->Regions[regp->reg_bit] == REGION_NULL);
 	rtip->Regions[regp->reg_bit] = regp;
-	rt_optim_tree(regp->reg_treetop, resp);
-	rt_solid_bitfinder(regp->reg_treetop, regp, resp);
-
-	if (RT_G_DEBUG&RT_DEBUG_REGIONS) {
-	    db_ck_tree(regp->reg_treetop);
-	    rt_pr_region(regp);
-	}
     }
 
+    /* region printing wants to stay in order */
+    tree_region_parallel(rtip, NULL, (RT_G_DEBUG&RT_DEBUG_REGIONS) ? 1 : ncpu, resp, prep_region, NULL);
+
+    /* Threads add regions to st_regions in no particular order, put
+     * them back in reg_bit (i.e. HeadRegion) order like a serial
+     * pass would have.
+     */
+    RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
+	bu_sort(BU_PTBL_BASEADDR(&stp->st_regions), BU_PTBL_LEN(&stp->st_regions), sizeof(long *), prep_region_cmp, NULL);
+    } RT_VISIT_ALL_SOLTABS_END;
+
     if (RT_G_DEBUG&RT_DEBUG_REGIONS) {
 	bu_log("rt_prep_parallel() printing primitives' region pointers\n");
 	RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
@@ -888,6 +923,9 @@ rt_init_resource(struct resource *resp, int cpu_num, struct rt_i *rtip)
     if (!BU_LIST_IS_INITIALIZED(&resp->re_region_ptbl))
 	BU_LIST_INIT(&resp->re_region_ptbl);
 
+    if (!BU_LIST_IS_INITIALIZED(&resp->re_vshot_packets))
+	BU_LIST_INIT(&resp->re_vshot_packets);
+
     /* transitioning to using a global independent of the librt
      * structures as an intermediate step during lib refactoring */
     if (!BU_LIST_IS_INITIALIZED(&re_nmgfree))
@@ -1006,6 +1044,9 @@ rt_clean_resource_basic(struct rt_i *rtip, struct resource *resp)
 	}
     }
 
+    /* The rt_vshootray() packets on re_vshot_packets are individually malloc()ed */
+    vshoot_clean_resource(resp);
+
     /* 're_boolstack' is a simple pointer */
     if (resp->re_boolstack) {
 	bu_free((void *)resp->re_boolstack, "boolstack");
@@ -1016,6 +1057,9 @@ rt_clean_resource_basic(struct rt_i *rtip, struct resource *resp)
     /* Release the state variables for 'solid pieces' */
     rt_res_pieces_clean(resp, rtip);
 
+    /* Profiling counters, if rti_profiling was ever set */
+    shoot_profile_free(&resp->re_profile);
+
     /* invalidate the resource */
     if (resp != &rt_uniresource)
 	resp->re_magic = 0;
@@ -1058,6 +1102,7 @@ rt_clean_resource_complete(struct rt_i *rtip, struct resource *resp)
  * partition freelist
  * solid_bitv freelist
  * region_ptbl freelist
+ * rt_vshootray() packet freelist
  * re_boolstack
  *
  * Some care is required, as rt_uniresource may not be fully
@@ -1150,6 +1195,7 @@ rt_clean(struct rt_i *rtip)
     while (BU_LIST_WHILE(regp, region, &rtip->HeadRegion)) {
 	RT_CK_REGION(regp);
 	BU_LIST_DEQUEUE(&(regp->l));
+	bool_free_region(regp);
 	db_free_tree(regp->reg_treetop, NULL);
 	bu_free((void *)regp->reg_name, "region name str");
 	regp->reg_name = (char *)0;
@@ -1188,6 +1234,9 @@ rt_clean(struct rt_i *rtip)
     }
     rt_cut_clean(rtip);
 
+    /* Merged profiling counters are indexed by the solids just freed */
+    shoot_profile_free(&rtip->rti_profile);
+
     /* Free animation structures */
     /* XXX modify to only free those from this rtip */
     if (rtip->rti_dbip)
@@ -1315,6 +1364,7 @@ rt_del_regtree(struct rt_i *rtip, struct region *delregp, struct resource *resp)
 
     BU_LIST_DEQUEUE(&(delregp->l));
 
+    bool_free_region(delregp);
     db_free_tree(delregp->reg_treetop, resp);
     delregp->reg_treetop = TREE_NULL;
     bu_free((char *)delregp->reg_name, "region name str");
@@ -1331,12 +1381,29 @@ rt_del_regtree(struct rt_i *rtip, struct region *delregp, struct resource *resp)
  * the tree to the provided bit vector.  Should be called AFTER the
  * region bits have been assigned.
  */
+static int
+bitfinder_semaphore(const struct soltab *stp)
+{
+    switch (stp->st_bit & 03) {
+	case 0:
+	    return RT_SEM_TREE0;
+	case 1:
+	    return RT_SEM_TREE1;
+	case 2:
+	    return RT_SEM_TREE2;
+	default:
+	    return RT_SEM_TREE3;
+    }
+}
+
+
 static void
 rt_solid_bitfinder(union tree *treep, struct region *regp, struct resource *resp)
 {
     union tree **sp;
     struct soltab *stp;
     union tree **stackend;
+    int sem;
 
     RT_CK_REGION(regp);
     RT_CK_RESOURCE(resp);
@@ -1355,7 +1422,11 @@ rt_solid_bitfinder(union tree *treep, struct region *regp, struct resource *resp
 	    case OP_SOLID:
 		stp = treep->tr_a.tu_stp;
 		RT_CK_SOLTAB(stp);
+		/* regions may be visited in parallel, see rt_prep_parallel() */
+		sem = bitfinder_semaphore(stp);
+		bu_semaphore_acquire(sem);
 		bu_ptbl_ins(&stp->st_regions, (long *)regp);
+		bu_semaphore_release(sem);
 		break;
 	    case OP_UNION:
 	    case OP_INTERSECT:
@@ -1751,6 +1822,7 @@ unprep_leaf(struct db_tree_state *tsp,
 		    /* soltab structure will actually be freed */
 		    remove_from_bsp(stp, &rtip->rti_inf_box, &rtip->rti_tol);
 		    remove_from_bsp(stp, &rtip->rti_CutHead, &rtip->rti_tol);
+		    cut_flat_update(rtip, stp);
 		    rtip->rti_Solids[bit] = (struct soltab *)NULL;
 		}
 		rt_free_soltab(stp);
@@ -1905,6 +1977,7 @@ rt_unprep(struct rt_i *rtip, struct rt_reprep_obj_list *objs, struct resource *r
 	rtip->Regions[rp->reg_bit] = (struct region *)NULL;
 
 	/* XXX db_free_tree(rp->reg_treetop, resp); */
+	bool_free_region(rp);
 	bu_free((void *)rp->reg_name, "region name str");
 	rp->reg_name = (char *)0;
 	if (rp->reg_mater.ma_shader) {
@@ -1965,6 +2038,12 @@ rt_unprep(struct rt_i *rtip, struct rt_reprep_obj_list *objs, struct resource *r
 	}
     }
 
+    /* The BVH references freed soltabs, rebuild it over what's left.
+     * The packed cut tree was patched as solids came out.
+     */
+    if (rtip->rti_space_partition == RT_PART_HLBVH && cut_hlbvh_build(rtip) < 0)
+	rtip->rti_space_partition = RT_PART_NUBSPT;
+
     return 0;
 }
 
@@ -2033,6 +2112,7 @@ rt_reprep(struct rt_i *rtip, struct rt_reprep_obj_list *objs, struct resource *r
 		VMINMAX(rtip->mdl_min, rtip->mdl_max, region_max);
 	    }
 	    rt_solid_bitfinder(rp->reg_treetop, rp, resp);
+	    bool_compile_region(rp);
 	}
 	bitno++;
     }
@@ -2058,6 +2138,7 @@ rt_reprep(struct rt_i *rtip, struct rt_reprep_obj_list *objs, struct resource *r
 	    insert_in_bsp(stp, &rtip->rti_inf_box);
 	} else {
 	    insert_in_bsp(stp, &rtip->rti_CutHead);
+	    cut_flat_update(rtip, stp);
 	}
     }
 
@@ -2072,6 +2153,9 @@ rt_reprep(struct rt_i *rtip, struct rt_reprep_obj_list *objs, struct resource *r
 	VSETALL(bb, INFINITY);
 	VSETALL(&bb[3], -INFINITY);
 	fill_out_bsp(rtip, &rtip->rti_CutHead, resp, bb);
+
+	/* edge cells all changed bounds, repack */
+	cut_flat_build(rtip);
     }
 
     if (BU_PTBL_LEN(&rtip->rti_resources)) {
@@ -2086,6 +2170,12 @@ rt_reprep(struct rt_i *rtip, struct rt_reprep_obj_list *objs, struct resource *r
 	rt_res_pieces_init(&rt_uniresource, rtip);
     }
 
+    /* rti_CutHead is a single cell in HLBVH mode, so the new solids
+     * only become visible to rt_shootray() through a rebuilt BVH.
+     */
+    if (rtip->rti_space_partition == RT_PART_HLBVH && cut_hlbvh_build(rtip) < 0)
+	rtip->rti_space_partition = RT_PART_NUBSPT;
+
     return 0;
 }
 
@@ -435,6 +435,19 @@ rt_bot_bbox(struct rt_db_internal *ip, point_t *min, point_t *max, const struct
 }
 
 
+/* Whether a BoT is big enough to be prepped with a TIE kd-tree */
+static int
+bot_use_tie(const struct rt_bot_internal *bot_ip)
+{
+    size_t rt_bot_mintie = RT_DEFAULT_MINTIE;
+    const char *bmintie = getenv("LIBRT_BOT_MINTIE");
+    if (bmintie)
+	rt_bot_mintie = atoi(bmintie);
+
+    return (rt_bot_mintie > 0 && bot_ip->num_faces >= rt_bot_mintie /* FIXME: (necessary?) && (bot_ip->face_normals != NULL || bot_ip->orientation != RT_BOT_UNORIENTED) */);
+}
+
+
 /**
  * Given a pointer to a GED database record, and a transformation
  * matrix, determine if this is a valid BOT, and if so, precompute
@@ -452,21 +465,15 @@ int
 rt_bot_prep(struct soltab *stp, struct rt_db_internal *ip, struct rt_i *rtip)
 {
     struct rt_bot_internal *bot_ip;
-    size_t rt_bot_mintie;
     int ret;
 
     RT_CK_DB_INTERNAL(ip);
     bot_ip = (struct rt_bot_internal *)ip->idb_ptr;
     RT_BOT_CK_MAGIC(bot_ip);
 
-    rt_bot_mintie = RT_DEFAULT_MINTIE;
-    const char *bmintie = getenv("LIBRT_BOT_MINTIE");
-    if (bmintie)
-	rt_bot_mintie = atoi(bmintie);
-
     if (rt_bot_bbox(ip, &(stp->st_min), &(stp->st_max), &(rtip->rti_tol))) return 1;
 
-    if (rt_bot_mintie > 0 && bot_ip->num_faces >= rt_bot_mintie /* FIXME: (necessary?) && (bot_ip->face_normals != NULL || bot_ip->orientation != RT_BOT_UNORIENTED) */)
+    if (bot_use_tie(bot_ip))
 	ret = bottie_prep_double(stp, bot_ip, rtip);
     else if (bot_ip->bot_flags & RT_BOT_USE_FLOATS)
 	ret = bot_prep_float(stp, bot_ip, rtip);
@@ -480,6 +487,49 @@ rt_bot_prep(struct soltab *stp, struct rt_db_internal *ip, struct rt_i *rtip)
 }
 
 
+/**
+ * Export the TIE kd-tree of a prepped BoT to the prep cache, or
+ * rebuild one from a cache entry.  Smaller BoTs are prepped without
+ * TIE and are not cached.
+ */
+int
+rt_bot_prep_serialize(struct soltab *stp, const struct rt_db_internal *ip, struct bu_external *external, size_t *version)
+{
+    const size_t current_version = 0;
+    struct rt_bot_internal *bot_ip;
+    struct bot_specific *bot;
+    struct bu_pool *pool;
+    size_t offset;
+
+    RT_CK_SOLTAB(stp);
+    RT_CK_DB_INTERNAL(ip);
+    BU_CK_EXTERNAL(external);
+    bot_ip = (struct rt_bot_internal *)ip->idb_ptr;
+    RT_BOT_CK_MAGIC(bot_ip);
+
+    if (stp->st_specific) {
+	/* export to external */
+	bot = (struct bot_specific *)stp->st_specific;
+	if (!bot->tie)
+	    return 1;
+
+	pool = primitive_prep_begin(RT_BOT_INTERNAL_MAGIC, bottie_serialize_size_double(stp));
+	bottie_serialize_double(stp, pool);
+	primitive_prep_end(pool, external);
+	*version = current_version;
+	return 0;
+    }
+
+    /* load from external */
+    if (*version != current_version || !bot_use_tie(bot_ip))
+	return 1;
+    if (primitive_prep_check(external, &offset, RT_BOT_INTERNAL_MAGIC))
+	return 1;
+
+    return bottie_deserialize_double(stp, bot_ip, stp->st_rtip, external, &offset) ? 1 : 0;
+}
+
+
 void
 rt_bot_print(const struct soltab *stp)
 {
@@ -46,12 +46,25 @@ fastf_t TIE_PREC = 0.1;
 
 int rt_bot_makesegs(struct hit *hits, size_t nhits, struct soltab *stp, struct xray *rp, struct application *ap, struct seg *seghead, struct rt_piecestate *psp);
 
+static unsigned int
+bottie_kdmethod(void)
+{
+    /* LIBRT_BOT_KDTREE=sah builds the kd-tree with the binned surface
+     * area heuristic instead of the default mid-split.
+     */
+    const char *bkdtree = getenv("LIBRT_BOT_KDTREE");
+    if (bkdtree && BU_STR_EQUAL(bkdtree, "sah"))
+	return TIE_KDTREE_OPTIMAL;
+    return TIE_KDTREE_FAST;
+}
+
 void *
 bottie_allocn_double(unsigned long long ntri)
 {
     struct tie_s *tie;
+
     BU_ALLOC(tie, struct tie_s);
-    tie_init_double(tie, ntri, TIE_KDTREE_FAST);
+    tie_init_double(tie, ntri, bottie_kdmethod());
     return tie;
 }
 
@@ -63,18 +76,13 @@ bottie_push_double(void *vtie, TIE_3 **tri, unsigned int ntri, void *u, unsigned
     tie_push_double(tie, tri, ntri, u, pstride);
 }
 
-int
-bottie_prep_double(struct soltab *stp, struct rt_bot_internal *bot_ip, struct rt_i *rtip)
+static struct bot_specific *
+bottie_specific(struct rt_bot_internal *bot_ip)
 {
-    struct tie_s *tie;
     struct bot_specific *bot;
-    size_t tri_index, i;
-    TIE_3 *tribuf = NULL, **tribufp = NULL;
-
-    RT_BOT_CK_MAGIC(bot_ip);
+    size_t tri_index;
 
     BU_GET(bot, struct bot_specific);
-    stp->st_specific = (void *)bot;
     bot->bot_mode = bot_ip->mode;
     bot->bot_orientation = bot_ip->orientation;
     bot->bot_flags = bot_ip->bot_flags;
@@ -92,6 +100,39 @@ bottie_prep_double(struct soltab *stp, struct rt_bot_internal *bot_ip, struct rt
 	bot->bot_facemode = BU_BITV_NULL;
     }
     bot->bot_facelist = NULL;
+    bot->tie = NULL;
+
+    return bot;
+}
+
+
+static void
+bottie_bounds(struct soltab *stp, struct tie_s *tie, struct rt_i *rtip)
+{
+    VMOVE(stp->st_min, tie->amin);
+    VMOVE(stp->st_max, tie->amax);
+
+    /* zero thickness will get missed by the raytracer */
+    BBOX_NONDEGEN(stp->st_min, stp->st_max, rtip->rti_tol.dist);
+
+    VMOVE(stp->st_center, tie->mid);
+    stp->st_aradius = tie->radius;
+    stp->st_bradius = tie->radius;
+}
+
+
+int
+bottie_prep_double(struct soltab *stp, struct rt_bot_internal *bot_ip, struct rt_i *rtip)
+{
+    struct tie_s *tie;
+    struct bot_specific *bot;
+    size_t i;
+    TIE_3 *tribuf = NULL, **tribufp = NULL;
+
+    RT_BOT_CK_MAGIC(bot_ip);
+
+    bot = bottie_specific(bot_ip);
+    stp->st_specific = (void *)bot;
 
     tie = (struct tie_s *)bottie_allocn_double(bot_ip->num_faces);
     if (tie != NULL) {
@@ -128,15 +169,58 @@ bottie_prep_double(struct soltab *stp, struct rt_bot_internal *bot_ip, struct rt
 
     tie_prep_double((struct tie_s *)bot->tie);
 
-    VMOVE(stp->st_min, tie->amin);
-    VMOVE(stp->st_max, tie->amax);
+    bottie_bounds(stp, tie, rtip);
 
-    /* zero thickness will get missed by the raytracer */
-    BBOX_NONDEGEN(stp->st_min, stp->st_max, rtip->rti_tol.dist);
+    return 0;
+}
 
-    VMOVE(stp->st_center, tie->mid);
-    stp->st_aradius = tie->radius;
-    stp->st_bradius = tie->radius;
+
+void
+bottie_serialize_double(struct soltab *stp, struct bu_pool *pool)
+{
+    struct bot_specific *bot = (struct bot_specific *)stp->st_specific;
+
+    tie_kdtree_export_double((struct tie_s *)bot->tie, pool);
+}
+
+
+size_t
+bottie_serialize_size_double(struct soltab *stp)
+{
+    struct bot_specific *bot = (struct bot_specific *)stp->st_specific;
+
+    return tie_kdtree_export_size_double((struct tie_s *)bot->tie);
+}
+
+
+int
+bottie_deserialize_double(struct soltab *stp, struct rt_bot_internal *bot_ip, struct rt_i *rtip, const struct bu_external *external, size_t *offset)
+{
+    struct tie_s *tie;
+    struct bot_specific *bot;
+
+    RT_BOT_CK_MAGIC(bot_ip);
+
+    bot = bottie_specific(bot_ip);
+
+    BU_ALLOC(tie, struct tie_s);
+    if (tie_kdtree_import_double(tie, external, offset, bot)
+	|| tie->tri_num != bot_ip->num_faces
+	|| tie->kdmethod != bottie_kdmethod()) {
+	if (tie->kdtree)
+	    tie_free_double(tie);
+	bu_free(tie, "tie");
+	if (bot->bot_thickness)
+	    bu_free(bot->bot_thickness, "bot_thickness");
+	if (bot->bot_facemode)
+	    bu_bitv_free(bot->bot_facemode);
+	BU_PUT(bot, struct bot_specific);
+	return -1;
+    }
+
+    stp->st_specific = (void *)bot;
+    bot_ip->tie = bot->tie = tie;
+    bottie_bounds(stp, tie, rtip);
 
     return 0;
 }
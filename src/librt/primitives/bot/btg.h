@@ -31,6 +31,11 @@ int bottie_prep_double(struct soltab *stp, struct rt_bot_internal *bot, struct r
 int bottie_shot_double(struct soltab *stp, register struct xray *rp, struct application *ap, struct seg *seghead);
 void bottie_free_double(void *vtie);
 
+/* Prep cache support, only for the double precision tie */
+void bottie_serialize_double(struct soltab *stp, struct bu_pool *pool);
+size_t bottie_serialize_size_double(struct soltab *stp);
+int bottie_deserialize_double(struct soltab *stp, struct rt_bot_internal *bot, struct rt_i *rtip, const struct bu_external *external, size_t *offset);
+
 void bottie_push_float(void *vtie, float **tri, unsigned int ntri, void *usr, unsigned int pstride);
 int bottie_prep_float(struct soltab *stp, struct rt_bot_internal *bot, struct rt_i *rtip);
 int bottie_shot_float(struct soltab *stp, register struct xray *rp, struct application *ap, struct seg *seghead);
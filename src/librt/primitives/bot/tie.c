@@ -32,8 +32,20 @@
 # include <xmmintrin.h>
 #endif
 
+/* Leaf intersection kernels for double precision on x86.  The AVX2
+ * variant is compiled through a target attribute and only called when
+ * bu_simd_level() reports the CPU supports it.
+ */
+#if TIE_PRECISION == 1 && defined(__SSE2__) && defined(__GNUC__)
+# define TIE_SIMD 1
+# include <emmintrin.h>
+# include <immintrin.h>
+#endif
+
 #include "bio.h"
 
+#include "bu/simd.h"
+
 #include "tieprivate.h"
 
 #if defined(HAVE_ISNAN) && !defined(HAVE_DECL_ISNAN) && !defined(isnan)
@@ -117,6 +129,270 @@ TIE_VAL(tri_prep)(struct tie_s *tie)
 }
 
 
+#ifdef TIE_SIMD
+
+/* Repack the prepped triangles of every leaf into struct-of-arrays
+ * blocks.  Must run after tri_prep(), the blocks are copies.
+ */
+static void
+TIE_VAL(tri_simd_prep)(struct tie_kdtree_s *node)
+{
+    struct tie_geom_s *g;
+    unsigned int i;
+
+    if (!node || !node->data)
+	return;
+
+    if (TIE_HAS_CHILDREN(node->b)) {
+	TIE_VAL(tri_simd_prep)(&((struct tie_kdtree_s *)(node->data))[0]);
+	TIE_VAL(tri_simd_prep)(&((struct tie_kdtree_s *)(node->data))[1]);
+	return;
+    }
+
+    g = (struct tie_geom_s *)node->data;
+    if (g->simd || g->tri_num == 0)
+	return;
+
+    g->simd_num = (g->tri_num + TIE_SIMD_WIDTH - 1) / TIE_SIMD_WIDTH;
+    g->simd = (struct tie_simd_block_s *)bu_calloc(g->simd_num, sizeof(struct tie_simd_block_s), "simd blocks");
+
+    for (i = 0; i < g->tri_num; i++) {
+	struct tie_simd_block_s *blk = &g->simd[i / TIE_SIMD_WIDTH];
+	struct tie_tri_s *tri = g->tri_list[i];
+	unsigned int l = i % TIE_SIMD_WIDTH;
+	int i1 = TIE_TAB1[tri->b & (uint32_t)0x7L];
+	int i2 = TIE_TAB1[3 + (tri->b & (uint32_t)0x7L)];
+
+	if ((i1 != 0 && i1 != 1) || (i2 != 1 && i2 != 2)) {
+	    /* not an axis pair the kernels can select, stay scalar */
+	    bu_free(g->simd, "simd blocks");
+	    g->simd = NULL;
+	    g->simd_num = 0;
+	    return;
+	}
+
+	blk->nx[l] = tri->data[1].v[0];
+	blk->ny[l] = tri->data[1].v[1];
+	blk->nz[l] = tri->data[1].v[2];
+	blk->dot[l] = tri->data[2].v[0];
+	blk->u1[l] = tri->data[2].v[1];
+	blk->u2[l] = tri->data[2].v[2];
+	blk->v1[l] = tri->v[0];
+	blk->v2[l] = tri->v[1];
+	blk->p1[l] = tri->data[0].v[i1];
+	blk->p2[l] = tri->data[0].v[i2];
+	blk->i1x[l] = i1 == 0 ? ~(uint64_t)0 : 0;
+	blk->i2y[l] = i2 == 1 ? ~(uint64_t)0 : 0;
+	blk->tri[l] = tri;
+    }
+}
+
+
+/*
+ * The kernels below are lane-wise transcriptions of the scalar
+ * triangle test in tie_work(), operation for operation, so they accept
+ * exactly the same hits at exactly the same distances.  Comparisons
+ * are ordered, matching how the C comparisons treat NaN.
+ */
+
+static uint8_t
+TIE_VAL(tri_leaf_sse2)(struct tie_geom_s *data, struct tie_ray_s *ray, TFLOAT near, TFLOAT far, struct tie_tri_s **hit_list, struct tie_id_s *id_list)
+{
+    const __m128d ones = _mm_castsi128_pd(_mm_set1_epi32(-1));
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d small_pos = _mm_set1_pd(SMALL_FASTF);
+    const __m128d small_neg = _mm_set1_pd(-SMALL_FASTF);
+    const __m128d prec = _mm_set1_pd(TIE_PREC);
+    const __m128d lo = _mm_set1_pd(near-TIE_PREC);
+    const __m128d hi = _mm_set1_pd(far+TIE_PREC);
+    const __m128d ox = _mm_set1_pd(ray->pos[0]);
+    const __m128d oy = _mm_set1_pd(ray->pos[1]);
+    const __m128d oz = _mm_set1_pd(ray->pos[2]);
+    const __m128d dx = _mm_set1_pd(ray->dir[0]);
+    const __m128d dy = _mm_set1_pd(ray->dir[1]);
+    const __m128d dz = _mm_set1_pd(ray->dir[2]);
+    uint8_t hit_count = 0;
+    uint32_t b;
+    int h, l;
+
+    for (b = 0; b < data->simd_num; b++) {
+	const struct tie_simd_block_s *blk = &data->simd[b];
+
+	for (h = 0; h < TIE_SIMD_WIDTH; h += 2) {
+	    __m128d nx = _mm_loadu_pd(&blk->nx[h]);
+	    __m128d ny = _mm_loadu_pd(&blk->ny[h]);
+	    __m128d nz = _mm_loadu_pd(&blk->nz[h]);
+	    __m128d u1 = _mm_loadu_pd(&blk->u1[h]);
+	    __m128d u2 = _mm_loadu_pd(&blk->u2[h]);
+	    __m128d v1 = _mm_loadu_pd(&blk->v1[h]);
+	    __m128d v2 = _mm_loadu_pd(&blk->v2[h]);
+	    __m128d sel1 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)&blk->i1x[h]));
+	    __m128d sel2 = _mm_castsi128_pd(_mm_loadu_si128((const __m128i *)&blk->i2y[h]));
+	    __m128d u0, v0, dist, px, py, pz, flat, alpha, beta, alpha_b, beta_b, ok;
+	    double d[2], x[2], y[2], z[2], a[2], bt[2];
+	    int mask;
+
+	    u0 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(nx, ox), _mm_mul_pd(ny, oy)), _mm_mul_pd(nz, oz));
+	    v0 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(nx, dx), _mm_mul_pd(ny, dy)), _mm_mul_pd(nz, dz));
+
+	    /* !ZERO(v0) */
+	    ok = _mm_andnot_pd(_mm_and_pd(_mm_cmpgt_pd(v0, small_neg), _mm_cmplt_pd(v0, small_pos)), ones);
+
+	    dist = _mm_div_pd(_mm_xor_pd(_mm_add_pd(_mm_loadu_pd(&blk->dot[h]), u0), sign), v0);
+	    ok = _mm_and_pd(ok, _mm_cmpord_pd(dist, dist));
+	    ok = _mm_andnot_pd(_mm_or_pd(_mm_cmplt_pd(dist, lo), _mm_cmpgt_pd(dist, hi)), ok);
+	    if (!_mm_movemask_pd(ok))
+		continue;
+
+	    px = _mm_add_pd(ox, _mm_mul_pd(dx, dist));
+	    py = _mm_add_pd(oy, _mm_mul_pd(dy, dist));
+	    pz = _mm_add_pd(oz, _mm_mul_pd(dz, dist));
+
+	    u0 = _mm_sub_pd(_mm_or_pd(_mm_and_pd(sel1, px), _mm_andnot_pd(sel1, py)), _mm_loadu_pd(&blk->p1[h]));
+	    v0 = _mm_sub_pd(_mm_or_pd(_mm_and_pd(sel2, py), _mm_andnot_pd(sel2, pz)), _mm_loadu_pd(&blk->p2[h]));
+
+	    flat = _mm_cmple_pd(_mm_andnot_pd(sign, u1), prec);
+	    beta = _mm_div_pd(u0, u2);
+	    alpha = _mm_div_pd(_mm_sub_pd(v0, _mm_mul_pd(beta, v2)), v1);
+	    beta_b = _mm_div_pd(_mm_sub_pd(_mm_mul_pd(v0, u1), _mm_mul_pd(u0, v1)),
+				_mm_sub_pd(_mm_mul_pd(v2, u1), _mm_mul_pd(u2, v1)));
+	    alpha_b = _mm_div_pd(_mm_sub_pd(u0, _mm_mul_pd(beta_b, u2)), u1);
+	    beta = _mm_or_pd(_mm_and_pd(flat, beta), _mm_andnot_pd(flat, beta_b));
+	    alpha = _mm_or_pd(_mm_and_pd(flat, alpha), _mm_andnot_pd(flat, alpha_b));
+
+	    ok = _mm_andnot_pd(_mm_or_pd(_mm_cmplt_pd(beta, zero), _mm_cmpgt_pd(beta, one)), ok);
+	    ok = _mm_andnot_pd(_mm_or_pd(_mm_cmplt_pd(alpha, zero), _mm_cmpgt_pd(_mm_add_pd(alpha, beta), one)), ok);
+
+	    mask = _mm_movemask_pd(ok);
+	    if (!mask)
+		continue;
+
+	    _mm_storeu_pd(d, dist);
+	    _mm_storeu_pd(x, px);
+	    _mm_storeu_pd(y, py);
+	    _mm_storeu_pd(z, pz);
+	    _mm_storeu_pd(a, alpha);
+	    _mm_storeu_pd(bt, beta);
+
+	    for (l = 0; l < 2; l++) {
+		if (!(mask & (1 << l)) || hit_count >= 0xFF)
+		    continue;
+		hit_list[hit_count] = blk->tri[h+l];
+		VSET(id_list[hit_count].pos, x[l], y[l], z[l]);
+		VSETALL(id_list[hit_count].norm, 0);
+		id_list[hit_count].dist = d[l];
+		id_list[hit_count].alpha = a[l];
+		id_list[hit_count].beta = bt[l];
+		hit_count++;
+	    }
+	}
+    }
+
+    return hit_count;
+}
+
+
+__attribute__((target("avx2")))
+static uint8_t
+TIE_VAL(tri_leaf_avx2)(struct tie_geom_s *data, struct tie_ray_s *ray, TFLOAT near, TFLOAT far, struct tie_tri_s **hit_list, struct tie_id_s *id_list)
+{
+    const __m256d ones = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d small_pos = _mm256_set1_pd(SMALL_FASTF);
+    const __m256d small_neg = _mm256_set1_pd(-SMALL_FASTF);
+    const __m256d prec = _mm256_set1_pd(TIE_PREC);
+    const __m256d lo = _mm256_set1_pd(near-TIE_PREC);
+    const __m256d hi = _mm256_set1_pd(far+TIE_PREC);
+    const __m256d ox = _mm256_set1_pd(ray->pos[0]);
+    const __m256d oy = _mm256_set1_pd(ray->pos[1]);
+    const __m256d oz = _mm256_set1_pd(ray->pos[2]);
+    const __m256d dx = _mm256_set1_pd(ray->dir[0]);
+    const __m256d dy = _mm256_set1_pd(ray->dir[1]);
+    const __m256d dz = _mm256_set1_pd(ray->dir[2]);
+    uint8_t hit_count = 0;
+    uint32_t b;
+    int l;
+
+    for (b = 0; b < data->simd_num; b++) {
+	const struct tie_simd_block_s *blk = &data->simd[b];
+	__m256d nx = _mm256_loadu_pd(blk->nx);
+	__m256d ny = _mm256_loadu_pd(blk->ny);
+	__m256d nz = _mm256_loadu_pd(blk->nz);
+	__m256d u1 = _mm256_loadu_pd(blk->u1);
+	__m256d u2 = _mm256_loadu_pd(blk->u2);
+	__m256d v1 = _mm256_loadu_pd(blk->v1);
+	__m256d v2 = _mm256_loadu_pd(blk->v2);
+	__m256d sel1 = _mm256_castsi256_pd(_mm256_loadu_si256((const __m256i *)blk->i1x));
+	__m256d sel2 = _mm256_castsi256_pd(_mm256_loadu_si256((const __m256i *)blk->i2y));
+	__m256d u0, v0, dist, px, py, pz, flat, alpha, beta, alpha_b, beta_b, ok;
+	double d[4], x[4], y[4], z[4], a[4], bt[4];
+	int mask;
+
+	u0 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(nx, ox), _mm256_mul_pd(ny, oy)), _mm256_mul_pd(nz, oz));
+	v0 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(nx, dx), _mm256_mul_pd(ny, dy)), _mm256_mul_pd(nz, dz));
+
+	/* !ZERO(v0) */
+	ok = _mm256_andnot_pd(_mm256_and_pd(_mm256_cmp_pd(v0, small_neg, _CMP_GT_OQ), _mm256_cmp_pd(v0, small_pos, _CMP_LT_OQ)), ones);
+
+	dist = _mm256_div_pd(_mm256_xor_pd(_mm256_add_pd(_mm256_loadu_pd(blk->dot), u0), sign), v0);
+	ok = _mm256_and_pd(ok, _mm256_cmp_pd(dist, dist, _CMP_ORD_Q));
+	ok = _mm256_andnot_pd(_mm256_or_pd(_mm256_cmp_pd(dist, lo, _CMP_LT_OQ), _mm256_cmp_pd(dist, hi, _CMP_GT_OQ)), ok);
+	if (!_mm256_movemask_pd(ok))
+	    continue;
+
+	px = _mm256_add_pd(ox, _mm256_mul_pd(dx, dist));
+	py = _mm256_add_pd(oy, _mm256_mul_pd(dy, dist));
+	pz = _mm256_add_pd(oz, _mm256_mul_pd(dz, dist));
+
+	u0 = _mm256_sub_pd(_mm256_blendv_pd(py, px, sel1), _mm256_loadu_pd(blk->p1));
+	v0 = _mm256_sub_pd(_mm256_blendv_pd(pz, py, sel2), _mm256_loadu_pd(blk->p2));
+
+	flat = _mm256_cmp_pd(_mm256_andnot_pd(sign, u1), prec, _CMP_LE_OQ);
+	beta = _mm256_div_pd(u0, u2);
+	alpha = _mm256_div_pd(_mm256_sub_pd(v0, _mm256_mul_pd(beta, v2)), v1);
+	beta_b = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(v0, u1), _mm256_mul_pd(u0, v1)),
+			       _mm256_sub_pd(_mm256_mul_pd(v2, u1), _mm256_mul_pd(u2, v1)));
+	alpha_b = _mm256_div_pd(_mm256_sub_pd(u0, _mm256_mul_pd(beta_b, u2)), u1);
+	beta = _mm256_blendv_pd(beta_b, beta, flat);
+	alpha = _mm256_blendv_pd(alpha_b, alpha, flat);
+
+	ok = _mm256_andnot_pd(_mm256_or_pd(_mm256_cmp_pd(beta, zero, _CMP_LT_OQ), _mm256_cmp_pd(beta, one, _CMP_GT_OQ)), ok);
+	ok = _mm256_andnot_pd(_mm256_or_pd(_mm256_cmp_pd(alpha, zero, _CMP_LT_OQ), _mm256_cmp_pd(_mm256_add_pd(alpha, beta), one, _CMP_GT_OQ)), ok);
+
+	mask = _mm256_movemask_pd(ok);
+	if (!mask)
+	    continue;
+
+	_mm256_storeu_pd(d, dist);
+	_mm256_storeu_pd(x, px);
+	_mm256_storeu_pd(y, py);
+	_mm256_storeu_pd(z, pz);
+	_mm256_storeu_pd(a, alpha);
+	_mm256_storeu_pd(bt, beta);
+
+	for (l = 0; l < TIE_SIMD_WIDTH; l++) {
+	    if (!(mask & (1 << l)) || hit_count >= 0xFF)
+		continue;
+	    hit_list[hit_count] = blk->tri[l];
+	    VSET(id_list[hit_count].pos, x[l], y[l], z[l]);
+	    VSETALL(id_list[hit_count].norm, 0);
+	    id_list[hit_count].dist = d[l];
+	    id_list[hit_count].alpha = a[l];
+	    id_list[hit_count].beta = bt[l];
+	    hit_count++;
+	}
+    }
+
+    return hit_count;
+}
+
+#endif /* TIE_SIMD */
+
+
 /*************************************************************
  **************** EXPORTED FUNCTIONS *************************
  *************************************************************/
@@ -144,6 +420,7 @@ TIE_VAL(tie_init)(struct tie_s *tie, unsigned int tri_num, unsigned int kdmethod
     tie->tri_list = tri_num?(struct tie_tri_s *)bu_calloc(tri_num, sizeof(struct tie_tri_s), "tie_init"):NULL;
     tie->stat = 0;
     tie->rays_fired = 0;
+    tie->simd_level = BU_SIMD_NONE;
 }
 
 
@@ -166,6 +443,28 @@ TIE_VAL(tie_free)(struct tie_s *tie)
 }
 
 
+/* Pick the leaf intersection kernel and pack the leaves for it.  Runs
+ * on prepped triangles, either freshly built or imported.
+ */
+static void
+TIE_VAL(tie_simd_setup)(struct tie_s *tie)
+{
+#ifdef TIE_SIMD
+    /* LIBRT_TIE_SIMD caps the kernel level, 0 forces the scalar path */
+    tie->simd_level = bu_simd_level();
+    {
+	const char *tsimd = getenv("LIBRT_TIE_SIMD");
+	if (tsimd && atoi(tsimd) < tie->simd_level)
+	    tie->simd_level = atoi(tsimd);
+    }
+    if (tie->simd_level >= BU_SIMD_SSE2)
+	TIE_VAL(tri_simd_prep)(tie->kdtree);
+#else
+    tie->simd_level = BU_SIMD_NONE;
+#endif
+}
+
+
 /**
  * Get ready to shoot rays at triangles
  *
@@ -184,6 +483,8 @@ TIE_VAL(tie_prep)(struct tie_s *tie)
 
     /* Prep all the triangles */
     TIE_VAL(tri_prep)(tie);
+
+    TIE_VAL(tie_simd_setup)(tie);
 }
 
 
@@ -315,6 +616,14 @@ TIE_VAL(tie_work)(struct tie_s *tie, struct tie_ray_s *ray, struct tie_id_s *id,
 	hit_count = 0;
 	data = (struct tie_geom_s *)(node->data);
 
+#ifdef TIE_SIMD
+	if (data->simd) {
+	    if (tie->simd_level >= BU_SIMD_AVX2)
+		hit_count = TIE_VAL(tri_leaf_avx2)(data, ray, near, far, hit_list, id_list);
+	    else
+		hit_count = TIE_VAL(tri_leaf_sse2)(data, ray, near, far, hit_list, id_list);
+	} else
+#endif
 	for (i = 0; i < data->tri_num; i++) {
 	    /*
 	     * Triangle Intersection Code
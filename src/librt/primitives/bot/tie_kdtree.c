@@ -35,17 +35,20 @@
 #include "raytrace.h"
 
 #include "tieprivate.h"
-
-#define	MAX_SLICES	100
-#define	MIN_SLICES	35
-#define	MIN_DENSITY	0.01
-#define	MIN_SPAN	0.15
-#define	SCALE_COEF	1.80
+#include "../../librt_private.h"
 
 #define	TIE_KDTREE_NODE_MAX	4	/* Maximum number of triangles that can reside in a given node until it should be split */
 #define	TIE_KDTREE_DEPTH_K1	1.4	/* K1 Depth Constant Coefficient */
 #define	TIE_KDTREE_DEPTH_K2	1	/* K2 Constant */
 
+#define	TIE_KDTREE_LEAF		3	/* find_split_*() result when a node should not be split */
+#define	TIE_KDTREE_PARALLEL_MIN	50000	/* Triangles needed before the build is spread across CPUs */
+#define	TIE_KDTREE_TASKS_PER_CPU	8	/* Independent subtrees per CPU for the parallel build */
+
+#define	TIE_SAH_BINS		32	/* Candidate planes per axis is one less than this */
+#define	TIE_SAH_TRAVERSE	1.0	/* Relative cost of a traversal step */
+#define	TIE_SAH_INTERSECT	1.5	/* Relative cost of a ray/triangle test */
+
 #define _MIN(a, b) (a)<(b)?(a):(b)
 #define _MAX(a, b) (a)>(b)?(a):(b)
 #define	MATH_MIN3(_a, _b, _c, _d) _a = _MIN((_b), _MIN((_c), (_d)))
@@ -127,6 +130,8 @@ tie_kdtree_free_node(struct tie_kdtree_s *node)
 	    if (tmp->tri_num > 0) {
 		bu_free(tmp->tri_list, "tri_list");
 	    }
+	    if (tmp->simd)
+		bu_free(tmp->simd, "simd blocks");
 	    bu_free(tmp, "data");
 	}
     }
@@ -295,277 +300,102 @@ find_split_fast(struct tie_kdtree_s *node, TIE_3 *cmin, TIE_3 *cmax)
 }
 
 static unsigned int
-find_split_optimal(struct tie_s *tie, struct tie_kdtree_s *node, TIE_3 *cmin, TIE_3 *cmax)
+find_split_optimal(struct tie_kdtree_s *node, TIE_3 *cmin, TIE_3 *cmax, int *stat)
 {
-    /****************************************
-     * Justin's Aggressive KD-Tree Algorithm *
-     *****************************************/
-    unsigned int slice[3][MAX_SLICES+MIN_SLICES], gap[3][2], active, split_slice = 0, split;
-    unsigned int side[3][MAX_SLICES+MIN_SLICES][2], i, j, d, s, n, k, smax[3], smin, slice_num;
-    TFLOAT coef[3][MAX_SLICES+MIN_SLICES], split_coef, beg, end, d_min = 0.0, d_max = 0.0;
-    struct tie_tri_s *tri;
+    /********************************
+     * BINNED SURFACE AREA HEURISTIC *
+     *********************************/
+    unsigned int lo_bin[3][TIE_SAH_BINS], hi_bin[3][TIE_SAH_BINS];
+    unsigned int d, i, k, b, n_left, n_right, split = TIE_KDTREE_LEAF;
     struct tie_geom_s *node_gd = (struct tie_geom_s *)(node->data);
-    TIE_3 min, max;
-    TIE_3 center[2], half_size[2];
-    VSETALL(min.v, 0.0);
-    VSETALL(max.v, 0.0);
-
-    /*
-     * Calculate number of slices to use as a function of triangle density.
-     * Setting slices as a function of relative node size does not work so well.
-     */
-    /*  slice_num = MIN_SLICES + MAX_SLICES * ((TFLOAT)node_gd->tri_num / (TFLOAT)tie->tri_num); */
-    slice_num = 1*node_gd->tri_num > MAX_SLICES ? MAX_SLICES : 1*node_gd->tri_num;
-
-    for (d = 0; d < 3; d++) {
-	/*
-	 * Optimization: Walk each triangle and find the min and max for the given dimension
-	 * of the complete triangle list.  This will tell us what slices we needn't bother
-	 * doing any computations for.
-	 */
-	for (i = 0; i < node_gd->tri_num; i++) {
-	    tri = node_gd->tri_list[i];
-	    /* Set min anx max */
-	    MATH_MIN3(tri->v[0], tri->data[0].v[d], tri->data[1].v[d], tri->data[2].v[d]);
-	    MATH_MAX3(tri->v[1], tri->data[0].v[d], tri->data[1].v[d], tri->data[2].v[d]);
-
-	    /* Clamp to node AABB */
-	    if (tri->v[0] < min.v[d])
-		tri->v[0] = min.v[d];
-	    if (tri->v[1] > max.v[d])
-		tri->v[1] = max.v[d];
-
-	    if (i == 0 || tri->v[0] < d_min)
-		d_min = tri->v[0];
-
-	    if (i == 0 || tri->v[1] > d_max)
-		d_max = tri->v[1];
-	}
+    TFLOAT area, cost, best_cost, plane = 0.0;
+    TIE_3 min, max, extent, lext, rext;
 
-	for (k = 0; k < slice_num; k++) {
-	    slice[d][k] = 0;
-	    side[d][k][0] = 0;
-	    side[d][k][1] = 0;
+    /* the caller passes the node bounds in the first child's slots */
+    min = cmin[0];
+    max = cmax[0];
+    VSUB2(extent.v, max.v, min.v);
+    area = extent.v[0]*extent.v[1] + extent.v[1]*extent.v[2] + extent.v[2]*extent.v[0];
 
-	    /* Left Child */
-	    cmin[0] = min;
-	    cmax[0] = max;
+    /* splitting has to beat simply testing every triangle here */
+    best_cost = TIE_SAH_INTERSECT * (TFLOAT)node_gd->tri_num;
 
-	    /* Right Child */
-	    cmin[1] = min;
-	    cmax[1] = max;
-
-	    /* construct slices so as not to use the boundaries as slices */
-	    coef[d][k] = ((TFLOAT)k / (TFLOAT)(slice_num-1)) * (TFLOAT)(slice_num-2) / (TFLOAT)slice_num + (TFLOAT)1 / (TFLOAT)slice_num;
-	    cmax[0].v[d] = min.v[d]*(1.0-coef[d][k]) + max.v[d]*coef[d][k];
-	    cmin[1].v[d] = cmax[0].v[d];
-
-	    /* determine whether to bother with this slice */
-	    if (cmax[0].v[d] < d_min || cmax[0].v[d] > d_max)
-		continue;
+    if (area > 0.0) {
+	memset(lo_bin, 0, sizeof(lo_bin));
+	memset(hi_bin, 0, sizeof(hi_bin));
 
-	    for (n = 0; n < 2; n++) {
-		VADD2(center[n].v,  cmax[n].v,  cmin[n].v);
-		VSCALE(center[n].v,  center[n].v,  0.5);
-		VSUB2(half_size[n].v,  cmax[n].v,  cmin[n].v);
-		VSCALE(half_size[n].v,  half_size[n].v,  0.5);
-	    }
+	/* Bin each triangle's extent along every axis */
+	for (i = 0; i < node_gd->tri_num; i++) {
+	    struct tie_tri_s *tri = node_gd->tri_list[i];
+	    TFLOAT tmin, tmax;
 
-	    for (i = 0; i < node_gd->tri_num; i++) {
-		/*
-		 * Optimization: If the points for the triangle of the dimension being tested
-		 * do not span the cutting plane, then do not bother with the next test.
-		 */
-		if ((node_gd->tri_list[i]->data[0].v[d] > cmax[0].v[d] &&
-			    node_gd->tri_list[i]->data[1].v[d] > cmax[0].v[d] &&
-			    node_gd->tri_list[i]->data[2].v[d] > cmax[0].v[d])||
-			(node_gd->tri_list[i]->data[0].v[d] < cmax[0].v[d] &&
-			 node_gd->tri_list[i]->data[1].v[d] < cmax[0].v[d] &&
-			 node_gd->tri_list[i]->data[2].v[d] < cmax[0].v[d]))
+	    for (d = 0; d < 3; d++) {
+		if (extent.v[d] <= 0.0)
 		    continue;
 
-		/* Check that the triangle is in both node A and B for it to span. */
-		s = 0;
-		for (n = 0; n < 2; n++) {
-		    /*
-		     * Check to see if any triangle points are inside of the node before
-		     * spending a lot of cycles on the full blown triangle box overlap
-		     */
-		    for (j = 0; j < 3; j++)
-			if (node_gd->tri_list[i]->data[j].v[0] > cmin[n].v[0] &&
-				node_gd->tri_list[i]->data[j].v[0] < cmax[n].v[0] &&
-				node_gd->tri_list[i]->data[j].v[1] > cmin[n].v[1] &&
-				node_gd->tri_list[i]->data[j].v[1] < cmax[n].v[1] &&
-				node_gd->tri_list[i]->data[j].v[2] > cmin[n].v[2] &&
-				node_gd->tri_list[i]->data[j].v[2] < cmax[n].v[2]) {
-			    j = 4;
-			}
-
-		    if (j == 5) {
-			s++;
-			side[d][k][n]++;
-		    } else {
-			if (tie_kdtree_tri_box_overlap(&center[n], &half_size[n], node_gd->tri_list[i]->data)) {
-			    s++;
-			    side[d][k][n]++;
-			}
-		    }
-		}
+		MATH_MIN3(tmin, tri->data[0].v[d], tri->data[1].v[d], tri->data[2].v[d]);
+		MATH_MAX3(tmax, tri->data[0].v[d], tri->data[1].v[d], tri->data[2].v[d]);
 
-		if (s == 2)
-		    slice[d][k]++;
+		tmin = (tmin - min.v[d]) / extent.v[d] * TIE_SAH_BINS;
+		tmax = (tmax - min.v[d]) / extent.v[d] * TIE_SAH_BINS;
+		lo_bin[d][tmin < 0.0 ? 0 : (tmin >= TIE_SAH_BINS ? TIE_SAH_BINS-1 : (unsigned int)tmin)]++;
+		hi_bin[d][tmax < 0.0 ? 0 : (tmax >= TIE_SAH_BINS ? TIE_SAH_BINS-1 : (unsigned int)tmax)]++;
 	    }
 	}
-    }
-
-    /* Store the max value from each of the 3 Slice arrays */
-    for (d = 0; d < 3; d++) {
-	smax[d] = 0;
-	for (k = 0; k < slice_num; k++)
-	    if (slice[d][k] > smax[d])
-		smax[d] = slice[d][k];
-    }
 
-    /*
-     * To eliminate "empty" areas, build a list of spans where geometric complexity is
-     * less than MIN_SPAN of the overall nodes size and then selecting the splitting plane
-     * that corresponds to the span slice domain nearest the center to bias towards a balanced tree
-     */
-
-    for (d = 0; d < 3; d++) {
-	gap[d][0] = 0;
-	gap[d][1] = 0;
-	beg = 0;
-	end = 0;
-	active = 0;
-
-	for (k = 0; k < slice_num; k++) {
-	    if (slice[d][k] < (unsigned int)(MIN_DENSITY * (TFLOAT)smax[d])) {
-		if (!active) {
-		    active = 1;
-		    beg = k;
-		    end = k;
-		} else
-		    end = k;
-	    } else {
-		if (active)
-		    if (end - beg > gap[d][1] - gap[d][0]) {
-			gap[d][0] = beg;
-			gap[d][1] = end;
-		    }
-		active = 0;
-	    }
-	}
+	/* Sweep the bin boundaries of each axis for the cheapest plane */
+	for (d = 0; d < 3; d++) {
+	    if (extent.v[d] <= 0.0)
+		continue;
 
-	if (active)
-	    if (end - beg > gap[d][1] - gap[d][0]) {
-		gap[d][0] = beg;
-		gap[d][1] = end;
-	    }
-    }
+	    for (k = 1; k < TIE_SAH_BINS; k++) {
+		n_left = n_right = 0;
+		for (b = 0; b < k; b++)
+		    n_left += lo_bin[d][b];
+		for (b = k; b < TIE_SAH_BINS; b++)
+		    n_right += hi_bin[d][b];
 
-    /*
-     * If there is a gap at least MIN_SPAN in side w/r/t the nodes dimension size
-     * then use the nearest edge of the gap to 0.5 as the splitting plane.
-     * Use the gap with the largest span.
-     * If no gaps are found meeting the criteria then weight the span values to
-     * bias towards a balanced kd-tree and choose the minima of that weighted curve.
-     */
+		lext = extent;
+		rext = extent;
+		lext.v[d] = extent.v[d] * (TFLOAT)k / (TFLOAT)TIE_SAH_BINS;
+		rext.v[d] = extent.v[d] - lext.v[d];
 
-    /* Largest gap */
-    d = 0;
-    if (gap[1][1] - gap[1][0] > gap[d][1] - gap[d][0])
-	d = 1;
-    if (gap[2][1] - gap[2][0] > gap[d][1] - gap[d][0])
-	d = 2;
+		cost = TIE_SAH_TRAVERSE + TIE_SAH_INTERSECT *
+		    ((lext.v[0]*lext.v[1] + lext.v[1]*lext.v[2] + lext.v[2]*lext.v[0]) * n_left +
+		     (rext.v[0]*rext.v[1] + rext.v[1]*rext.v[2] + rext.v[2]*rext.v[0]) * n_right) / area;
 
-    /*
-     * Largest gap found must meet MIN_SPAN requirements
-     * There must be at least 500 triangles or we don't bother.
-     * Lower triangle numbers means there is a higher probability that
-     * triangles lack any sort of coherent structure.
-     */
-    if ((TFLOAT)(gap[d][1] - gap[d][0]) / (TFLOAT)slice_num > MIN_SPAN && node_gd->tri_num > 500) {
-	int gap0 = gap[d][0] - slice_num/2;
-	int gap1 = gap[d][1] - slice_num/2;
-	split = d;
-	if (abs(gap0) < abs(gap1)) {
-	    /* choose gap[d][0] as splitting plane */
-	    split_coef = ((TFLOAT)gap[d][0] / (TFLOAT)(slice_num-1)) * (TFLOAT)(slice_num-2) / (TFLOAT)slice_num + (TFLOAT)1 / (TFLOAT)slice_num;
-	    split_slice = gap[d][0];
-	} else {
-	    /* choose gap[d][1] as splitting plane */
-	    split_coef = ((TFLOAT)gap[d][1] / (TFLOAT)(slice_num-1)) * (TFLOAT)(slice_num-2) / (TFLOAT)slice_num + (TFLOAT)1 / (TFLOAT)slice_num;
-	    split_slice = gap[d][1];
-	}
-    } else {
-	/*
-	 * Weight the slices based on a heuristic driven linear scaling function to bias values
-	 * towards the center as more desirable.  This solves the case of a partially linear graph
-	 * to prevent marching in order to determine a desirable splitting point.  If this section of code
-	 * is being executed it's typically because most 'empty space' has now been eliminated
-	 * and/or the resulting geometry is now losing structure as the smaller cells are being
-	 * created, i.e. dividing a fraction of a wing-nut instead of an engine-block.
-	 */
-	for (d = 0; d < 3; d++)
-	    for (k = 0; k < slice_num; k++)
-		slice[d][k] += fabs(coef[d][k]-0.5) * SCALE_COEF * smax[d];
-
-	/* Choose the slice with the graphs minima as the splitting plane. */
-	split = 0;
-	smin = tie->tri_num;
-	split_coef = 0.5;
-	for (d = 0; d < 3; d++) {
-	    for (k = 0; k < slice_num; k++) {
-		if (slice[d][k] < smin) {
-		    split_coef = coef[d][k];
+		if (cost < best_cost) {
+		    best_cost = cost;
 		    split = d;
-		    split_slice = k;
-		    smin = slice[d][k];
+		    plane = min.v[d] + lext.v[d];
 		}
 	    }
 	}
-
-	/*
-	 * If the dimension chosen to split along has a value of 0 for the maximum value
-	 * then the geometry was aligned such that it fell undetectable between the slices
-	 * and therefore was not picked up by the marching slices.  In the event that this
-	 * happens, choose to naively split along the middle as this last ditch decision
-	 * will give better results than the algorithm naively picking the first of the
-	 * the slices forming these irregular, short followed by a long box, splits.
-	 */
-	if (smax[split] == 0) {
-	    split_slice = slice_num / 2;
-	    split_coef = coef[split][split_slice];
-	}
     }
 
-    /*
-     * Lastly, after we have supposedly chosen the ideal splitting point,
-     * check to see that the subdivision that is about to take place is worth
-     * doing.  In other words, if one of the children have the same number of triangles
-     * as the parent does then stop.
-     */
-    if (side[split][split_slice][0] == node_gd->tri_num || side[split][split_slice][1] == node_gd->tri_num) {
-	tie->stat += node_gd->tri_num;
+    if (split == TIE_KDTREE_LEAF) {
+	*stat += node_gd->tri_num;
 	return split;
     }
 
-    /* Based on the winner, construct the two child nodes */
-    VMOVE(cmin[0].v, min.v);
-    VMOVE(cmax[0].v, max.v);
-
-    VMOVE(cmin[1].v, min.v);
-    VMOVE(cmax[1].v, max.v);
-
-    cmax[0].v[split] = min.v[split]*(1.0-split_coef) + max.v[split]*split_coef;
-    cmin[1].v[split] = cmax[0].v[split];
-    node->axis = cmax[0].v[split];
+    /* The traversal compares against the single precision axis, so
+     * distribute the triangles against exactly that plane.
+     */
+    node->axis = plane;
+    cmax[0].v[split] = node->axis;
+    cmin[1].v[split] = node->axis;
     return split;
 }
 
-static void
-tie_kdtree_build(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int depth, point_t min, point_t max)
+
+/*
+ * Split one node in two, handing each child the triangles that touch
+ * it.  Returns 0 if the node stays a leaf, otherwise 1 with the child
+ * bounds in cmin/cmax.  Only the node itself is modified, so disjoint
+ * subtrees may be split concurrently.
+ */
+static int
+tie_kdtree_split(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int depth, point_t min, point_t max, int *stat, point_t lmin[2], point_t lmax[2])
 {
     struct tie_geom_s *child[2], *node_gd = (struct tie_geom_s *)(node->data);
     TIE_3 cmin[2], cmax[2], center[2], half_size[2];
@@ -573,7 +403,7 @@ tie_kdtree_build(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int dept
 
     if (node_gd == NULL) {
 	bu_log("null geom, aborting\n");
-	return;
+	return 0;
     }
 
     /* initialize cmax to make the compiler happy */
@@ -584,17 +414,20 @@ tie_kdtree_build(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int dept
 
     /* Terminating criteria for KDTREE subdivision */
     if (node_gd->tri_num <= TIE_KDTREE_NODE_MAX || depth > tie->max_depth) {
-	tie->stat += node_gd->tri_num;
-	return;
+	*stat += node_gd->tri_num;
+	return 0;
     }
 
     if (tie->kdmethod == TIE_KDTREE_FAST)
 	split = find_split_fast(node, &cmin[0], &cmax[0]);
     else if (tie->kdmethod == TIE_KDTREE_OPTIMAL)
-	split = find_split_optimal(tie, node, &cmin[0], &cmax[0]);
+	split = find_split_optimal(node, &cmin[0], &cmax[0], stat);
     else
 	bu_bomb("Illegal tie kdtree method\n");
 
+    if (split == TIE_KDTREE_LEAF)
+	return 0;
+
     /* Allocate 2 children nodes for the parent node */
     node->data = bu_calloc(2, sizeof(struct tie_kdtree_s), "tie_kdtree_build()");
     node->b = 0;
@@ -671,26 +504,342 @@ tie_kdtree_build(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int dept
     bu_free(node_gd->tri_list, "tri_list");
     bu_free(node_gd, "node");
 
-    /* Push each child through the same process. */
-    {
-	    point_t lmin[2], lmax[2];
-	    VMOVE(lmin[0], cmin[0].v);
-	    VMOVE(lmin[1], cmin[1].v);
-	    VMOVE(lmax[0], cmax[0].v);
-	    VMOVE(lmax[1], cmax[1].v);
-    tie_kdtree_build(tie, &((struct tie_kdtree_s *)(node->data))[0], depth+1, lmin[0], lmax[0]);
-    tie_kdtree_build(tie, &((struct tie_kdtree_s *)(node->data))[1], depth+1, lmin[1], lmax[1]);
-    }
+    VMOVE(lmin[0], cmin[0].v);
+    VMOVE(lmin[1], cmin[1].v);
+    VMOVE(lmax[0], cmax[0].v);
+    VMOVE(lmax[1], cmax[1].v);
 
     /* Assign the splitting dimension to the node */
     /* If we've come this far then YES, this node DOES have child nodes, MARK it as so. */
     node->b = TIE_SET_HAS_CHILDREN(node->b) + split;
+    return 1;
+}
+
+
+static void
+tie_kdtree_build(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int depth, point_t min, point_t max, int *stat)
+{
+    point_t lmin[2], lmax[2];
+
+    if (!tie_kdtree_split(tie, node, depth, min, max, stat, lmin, lmax))
+	return;
+
+    /* Push each child through the same process. */
+    tie_kdtree_build(tie, &((struct tie_kdtree_s *)(node->data))[0], depth+1, lmin[0], lmax[0], stat);
+    tie_kdtree_build(tie, &((struct tie_kdtree_s *)(node->data))[1], depth+1, lmin[1], lmax[1], stat);
+}
+
+
+struct tie_kdtree_task_s {
+    struct tie_kdtree_s *node;
+    unsigned int depth;
+    point_t min, max;
+    int stat;
+};
+
+struct tie_kdtree_work_s {
+    struct tie_s *tie;
+    struct tie_kdtree_task_s *task;
+    size_t task_num;
+    size_t next;
+    int sem;
+};
+
+
+static int
+tie_kdtree_task_cmp(const void *a, const void *b)
+{
+    const struct tie_kdtree_task_s *ta = (const struct tie_kdtree_task_s *)a;
+    const struct tie_kdtree_task_s *tb = (const struct tie_kdtree_task_s *)b;
+    uint32_t na = ((struct tie_geom_s *)ta->node->data)->tri_num;
+    uint32_t nb = ((struct tie_geom_s *)tb->node->data)->tri_num;
+
+    /* biggest subtrees first */
+    return (na < nb) - (na > nb);
+}
+
+
+static void
+tie_kdtree_build_worker(int UNUSED(cpu), void *data)
+{
+    struct tie_kdtree_work_s *work = (struct tie_kdtree_work_s *)data;
+    struct tie_kdtree_task_s *task;
+
+    while (1) {
+	bu_semaphore_acquire(work->sem);
+	task = work->next < work->task_num ? &work->task[work->next++] : NULL;
+	bu_semaphore_release(work->sem);
+
+	if (!task)
+	    return;
+
+	tie_kdtree_build(work->tie, task->node, task->depth, task->min, task->max, &task->stat);
+    }
+}
+
+
+/*
+ * Split the top of the tree breadth first on this thread until there
+ * are several independent subtrees per CPU, then finish those
+ * subtrees in parallel.  Every node is split exactly as the serial
+ * build would split it, so the resulting tree is the same.
+ */
+static void
+tie_kdtree_build_parallel(struct tie_s *tie, size_t ncpu)
+{
+    struct tie_kdtree_work_s work;
+    size_t head = 0, task_max = 64, want = TIE_KDTREE_TASKS_PER_CPU * ncpu;
+    size_t i;
+
+    work.tie = tie;
+    work.task = (struct tie_kdtree_task_s *)bu_calloc(task_max, sizeof(struct tie_kdtree_task_s), "kdtree tasks");
+    work.task[0].node = tie->kdtree;
+    work.task[0].depth = 0;
+    VMOVE(work.task[0].min, tie->min);
+    VMOVE(work.task[0].max, tie->max);
+    work.task_num = 1;
+
+    while (head < work.task_num && work.task_num - head < want) {
+	struct tie_kdtree_task_s *task = &work.task[head++];
+	struct tie_kdtree_s *node = task->node;
+	unsigned int depth = task->depth;
+	point_t lmin[2], lmax[2];
+
+	if (!tie_kdtree_split(tie, node, depth, task->min, task->max, &tie->stat, lmin, lmax))
+	    continue;
+
+	if (work.task_num + 2 > task_max) {
+	    task_max *= 2;
+	    work.task = (struct tie_kdtree_task_s *)bu_realloc(work.task, task_max * sizeof(struct tie_kdtree_task_s), "kdtree tasks");
+	}
+
+	for (i = 0; i < 2; i++) {
+	    task = &work.task[work.task_num++];
+	    task->node = &((struct tie_kdtree_s *)(node->data))[i];
+	    task->depth = depth + 1;
+	    task->stat = 0;
+	    VMOVE(task->min, lmin[i]);
+	    VMOVE(task->max, lmax[i]);
+	}
+    }
+
+    if (head < work.task_num) {
+	work.task += head;
+	work.task_num -= head;
+	work.next = 0;
+	work.sem = bu_semaphore_register("TIE_SEM_BUILD");
+
+	qsort(work.task, work.task_num, sizeof(struct tie_kdtree_task_s), tie_kdtree_task_cmp);
+	bu_parallel(tie_kdtree_build_worker, ncpu, &work);
+
+	for (i = 0; i < work.task_num; i++)
+	    tie->stat += work.task[i].stat;
+
+	work.task -= head;
+    }
+
+    bu_free(work.task, "kdtree tasks");
 }
 
+static void
+tie_kdtree_export_node(struct tie_s *tie, struct tie_kdtree_s *node, struct bu_pool *pool)
+{
+    struct tie_geom_s *g;
+    uint32_t i, n, idx;
+
+    primitive_prep_write(pool, &node->axis, sizeof(node->axis));
+    primitive_prep_write(pool, &node->b, sizeof(node->b));
+
+    if (TIE_HAS_CHILDREN(node->b)) {
+	tie_kdtree_export_node(tie, &((struct tie_kdtree_s *)(node->data))[0], pool);
+	tie_kdtree_export_node(tie, &((struct tie_kdtree_s *)(node->data))[1], pool);
+	return;
+    }
+
+    /* Leaves refer to triangles by their index in tie->tri_list */
+    g = (struct tie_geom_s *)node->data;
+    n = g ? g->tri_num : 0;
+    primitive_prep_write(pool, &n, sizeof(n));
+    for (i = 0; i < n; i++) {
+	idx = (uint32_t)(g->tri_list[i] - tie->tri_list);
+	primitive_prep_write(pool, &idx, sizeof(idx));
+    }
+}
+
+
+static size_t
+tie_kdtree_node_export_size(struct tie_kdtree_s *node)
+{
+    struct tie_geom_s *g;
+    size_t nbytes = sizeof(node->axis) + sizeof(node->b);
+
+    if (TIE_HAS_CHILDREN(node->b))
+	return nbytes
+	    + tie_kdtree_node_export_size(&((struct tie_kdtree_s *)(node->data))[0])
+	    + tie_kdtree_node_export_size(&((struct tie_kdtree_s *)(node->data))[1]);
+
+    g = (struct tie_geom_s *)node->data;
+    return nbytes + sizeof(uint32_t) * (1 + (g ? g->tri_num : 0));
+}
+
+
+/* Rebuild one node, only setting node->b once node->data matches it
+ * so tie_kdtree_free_node() can always clean up a partial tree.
+ */
+static int
+tie_kdtree_import_node(struct tie_s *tie, struct tie_kdtree_s *node, unsigned int depth, const struct bu_external *external, size_t *offset)
+{
+    struct tie_geom_s *g;
+    uint32_t b, i, n, idx;
+
+    if (depth > tie->max_depth + 1)
+	return 1;
+    if (primitive_prep_read(external, offset, &node->axis, sizeof(node->axis))
+	|| primitive_prep_read(external, offset, &b, sizeof(b)))
+	return 1;
+
+    if (TIE_HAS_CHILDREN(b)) {
+	if ((b & (uint32_t)0x3L) > 2)
+	    return 1;
+	node->data = bu_calloc(2, sizeof(struct tie_kdtree_s), "tie_kdtree_import()");
+	node->b = b;
+	if (tie_kdtree_import_node(tie, &((struct tie_kdtree_s *)(node->data))[0], depth+1, external, offset))
+	    return 1;
+	return tie_kdtree_import_node(tie, &((struct tie_kdtree_s *)(node->data))[1], depth+1, external, offset);
+    }
+
+    BU_ALLOC(g, struct tie_geom_s);
+    node->data = g;
+    node->b = b;
+    if (primitive_prep_read(external, offset, &n, sizeof(n)) || n > tie->tri_num)
+	return 1;
+    if (n == 0)
+	return 0;
+
+    g->tri_list = (struct tie_tri_s **)bu_calloc(n, sizeof(struct tie_tri_s *), "tri_list");
+    g->tri_num = n;
+    for (i = 0; i < n; i++) {
+	if (primitive_prep_read(external, offset, &idx, sizeof(idx)) || idx >= tie->tri_num)
+	    return 1;
+	g->tri_list[i] = &tie->tri_list[idx];
+    }
+    return 0;
+}
+
+
 /*************************************************************
  **************** EXPORTED FUNCTIONS *************************
  *************************************************************/
 
+int
+TIE_VAL(tie_kdtree_export)(struct tie_s *tie, struct bu_pool *pool)
+{
+    uint32_t tri_num = tie->tri_num;
+    uint32_t kdmethod = tie->kdmethod;
+    uint32_t tfloat_size = (uint32_t)sizeof(TFLOAT);
+    unsigned int i;
+
+    if (!tie->kdtree || tie->tri_num == 0)
+	return 1;
+
+    primitive_prep_write(pool, &tfloat_size, sizeof(tfloat_size));
+    primitive_prep_write(pool, &tri_num, sizeof(tri_num));
+    primitive_prep_write(pool, &kdmethod, sizeof(kdmethod));
+    primitive_prep_write(pool, tie->amin, sizeof(point_t));
+    primitive_prep_write(pool, tie->amax, sizeof(point_t));
+
+    /* Prepped triangles, without the caller's ptr */
+    for (i = 0; i < tie->tri_num; i++) {
+	struct tie_tri_s *tri = &tie->tri_list[i];
+	primitive_prep_write(pool, tri->data, sizeof(tri->data));
+	primitive_prep_write(pool, tri->v, sizeof(tri->v));
+	primitive_prep_write(pool, &tri->b, sizeof(tri->b));
+    }
+
+    tie_kdtree_export_node(tie, tie->kdtree, pool);
+    return 0;
+}
+
+
+size_t
+TIE_VAL(tie_kdtree_export_size)(struct tie_s *tie)
+{
+    size_t nbytes = 3 * sizeof(uint32_t) + 2 * sizeof(point_t);
+
+    if (!tie->kdtree)
+	return nbytes;
+
+    nbytes += tie->tri_num * (sizeof(TIE_3) * 3 + sizeof(TFLOAT) * 2 + sizeof(uint32_t));
+    return nbytes + tie_kdtree_node_export_size(tie->kdtree);
+}
+
+
+int
+TIE_VAL(tie_kdtree_import)(struct tie_s *tie, const struct bu_external *external, size_t *offset, void *ptr)
+{
+    struct tie_s t;
+    uint32_t tfloat_size, tri_num, kdmethod;
+    TIE_3 delta;
+    fastf_t prec;
+    unsigned int i;
+
+    if (primitive_prep_read(external, offset, &tfloat_size, sizeof(tfloat_size))
+	|| tfloat_size != (uint32_t)sizeof(TFLOAT)
+	|| primitive_prep_read(external, offset, &tri_num, sizeof(tri_num))
+	|| primitive_prep_read(external, offset, &kdmethod, sizeof(kdmethod))
+	|| tri_num == 0
+	|| tri_num > (external->ext_nbytes - *offset) / (sizeof(TIE_3) * 3))
+	return 1;
+
+    memset(&t, 0, sizeof(t));
+    TIE_INIT(&t, tri_num, kdmethod);
+    if (primitive_prep_read(external, offset, t.amin, sizeof(point_t))
+	|| primitive_prep_read(external, offset, t.amax, sizeof(point_t))) {
+	TIE_FREE(&t);
+	return 1;
+    }
+
+    for (i = 0; i < tri_num; i++) {
+	struct tie_tri_s *tri = &t.tri_list[i];
+	if (primitive_prep_read(external, offset, tri->data, sizeof(tri->data))
+	    || primitive_prep_read(external, offset, tri->v, sizeof(tri->v))
+	    || primitive_prep_read(external, offset, &tri->b, sizeof(tri->b))) {
+	    TIE_FREE(&t);
+	    return 1;
+	}
+	tri->ptr = ptr;
+    }
+    t.tri_num = tri_num;
+
+    /* Same derived values as tie_kdtree_prep_head() and tie_kdtree_prep() */
+    VMOVE(t.min, t.amin);
+    VMOVE(t.max, t.amax);
+    VADD2SCALE(t.mid, t.min, t.max, 0.5);
+    t.radius = DIST_PNT_PNT(t.max, t.mid);
+    VSUB2(delta.v,  t.max,  t.min);
+    MATH_MAX3(prec, delta.v[0], delta.v[1], delta.v[2]);
+#if defined(TIE_PRECISION) && TIE_PRECISION == 0
+    prec *= 0.000000001;
+#else
+    prec *= 0.000000000001;
+#endif
+    VSUB2(t.min,  t.min,  delta.v);
+    VADD2(t.max,  t.max,  delta.v);
+    t.max_depth = (int)(TIE_KDTREE_DEPTH_K1 * (log(t.tri_num) / log(2)) + TIE_KDTREE_DEPTH_K2);
+
+    BU_ALLOC(t.kdtree, struct tie_kdtree_s);
+    if (tie_kdtree_import_node(&t, t.kdtree, 0, external, offset)) {
+	TIE_FREE(&t);
+	return 1;
+    }
+
+    TIE_PREC = prec;
+    TIE_VAL(tie_simd_setup)(&t);
+    *tie = t; /* struct copy */
+    return 0;
+}
+
+
 void
 TIE_VAL(tie_kdtree_free)(struct tie_s *tie)
 {
@@ -754,8 +903,16 @@ TIE_VAL(tie_kdtree_prep)(struct tie_s *tie)
     tie->max_depth = (int)(TIE_KDTREE_DEPTH_K1 * (log(tie->tri_num) / log(2)) + TIE_KDTREE_DEPTH_K2);
 
     /* Build the KDTREE */
-    if (!already_built)
-	tie_kdtree_build(tie, tie->kdtree, 0, tie->min, tie->max);
+    if (!already_built) {
+	size_t ncpu = bu_avail_cpus();
+	if (ncpu > MAX_PSW)
+	    ncpu = MAX_PSW;
+
+	if (ncpu > 1 && tie->tri_num >= TIE_KDTREE_PARALLEL_MIN)
+	    tie_kdtree_build_parallel(tie, ncpu);
+	else
+	    tie_kdtree_build(tie, tie->kdtree, 0, tie->min, tie->max, &tie->stat);
+    }
 
     tie->stat = 0;
 }
@@ -38,9 +38,36 @@ extern "C" {
 #define TIE_HAS_CHILDREN(bits) (bits & (uint32_t)0x4L)
 #define TIE_SET_HAS_CHILDREN(bits) (bits | (uint32_t)0x4L)
 
+/* Width of a leaf's struct-of-arrays triangle block.  The SSE2 kernel
+ * walks a block as two pairs, the AVX2 kernel takes it in one go.
+ */
+#define TIE_SIMD_WIDTH 4
+
+/* The fields of tie_tri_s that the intersection test reads, repacked
+ * lane-per-triangle at prep time.  Lanes past the end of a leaf have
+ * a zero normal and a NULL tri so they never report a hit.
+ */
+struct tie_simd_block_s {
+    TFLOAT nx[TIE_SIMD_WIDTH];	/* data[1], the unit normal */
+    TFLOAT ny[TIE_SIMD_WIDTH];
+    TFLOAT nz[TIE_SIMD_WIDTH];
+    TFLOAT dot[TIE_SIMD_WIDTH];	/* data[2].v[0] */
+    TFLOAT u1[TIE_SIMD_WIDTH];	/* data[2].v[1] */
+    TFLOAT u2[TIE_SIMD_WIDTH];	/* data[2].v[2] */
+    TFLOAT v1[TIE_SIMD_WIDTH];	/* v[0] */
+    TFLOAT v2[TIE_SIMD_WIDTH];	/* v[1] */
+    TFLOAT p1[TIE_SIMD_WIDTH];	/* data[0].v[i1] */
+    TFLOAT p2[TIE_SIMD_WIDTH];	/* data[0].v[i2] */
+    uint64_t i1x[TIE_SIMD_WIDTH];	/* all ones when i1 is X, else i1 is Y */
+    uint64_t i2y[TIE_SIMD_WIDTH];	/* all ones when i2 is Y, else i2 is Z */
+    struct tie_tri_s *tri[TIE_SIMD_WIDTH];
+};
+
 struct tie_geom_s {
     struct tie_tri_s **tri_list; /* 4-bytes or 8-bytes */
     uint32_t tri_num; /* 4-bytes */
+    uint32_t simd_num; /* 4-bytes, number of blocks in simd */
+    struct tie_simd_block_s *simd; /* 4-bytes or 8-bytes, NULL when not built */
 };
 
 #ifdef _WIN32
@@ -54,6 +81,19 @@ struct tie_stack_s {
     TFLOAT far; /* 4-bytes or 8-bytes */
 };
 
+struct bu_pool;
+struct bu_external;
+
+/* Write a prepped tie (triangles and kd-tree) to pool, sized with
+ * tie_kdtree_export_size(), or rebuild one from a blob at *offset.
+ * The import leaves each triangle's ptr set to ptr and returns
+ * nonzero, with tie untouched, if the blob does not hold a consistent
+ * tree.
+ */
+extern int TIE_VAL(tie_kdtree_export)(struct tie_s *tie, struct bu_pool *pool);
+extern size_t TIE_VAL(tie_kdtree_export_size)(struct tie_s *tie);
+extern int TIE_VAL(tie_kdtree_import)(struct tie_s *tie, const struct bu_external *external, size_t *offset, void *ptr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -150,6 +150,76 @@ rt_nmg_prep(struct soltab *stp, struct rt_db_internal *ip, struct rt_i *rtip)
 }
 
 
+/**
+ * Export the manifold table of a prepped nmg to the prep cache, or
+ * load one back.  The table is indexed by the model's structure
+ * indices, which a fresh import assigns in the same order, so a
+ * cached table is only used when maxindex matches.
+ */
+int
+rt_nmg_prep_serialize(struct soltab *stp, const struct rt_db_internal *ip, struct bu_external *external, size_t *version)
+{
+    const size_t current_version = 0;
+    struct model *m;
+    struct nmg_specific *nmg_s;
+    struct bu_pool *pool;
+    vect_t work;
+    size_t offset;
+    int64_t maxindex;
+
+    RT_CK_SOLTAB(stp);
+    RT_CK_DB_INTERNAL(ip);
+    BU_CK_EXTERNAL(external);
+
+    if (stp->st_specific) {
+	/* export to external */
+	nmg_s = (struct nmg_specific *)stp->st_specific;
+	m = nmg_s->nmg_model;
+	NMG_CK_MODEL(m);
+
+	maxindex = (int64_t)m->maxindex;
+	pool = primitive_prep_begin(NMG_MODEL_MAGIC, sizeof(maxindex) + (size_t)m->maxindex);
+	primitive_prep_write(pool, &maxindex, sizeof(maxindex));
+	primitive_prep_write(pool, nmg_s->manifolds, (size_t)m->maxindex);
+	primitive_prep_end(pool, external);
+	*version = current_version;
+	return 0;
+    }
+
+    /* load from external */
+    m = (struct model *)ip->idb_ptr;
+    NMG_CK_MODEL(m);
+
+    if (*version != current_version)
+	return 1;
+    if (primitive_prep_check(external, &offset, NMG_MODEL_MAGIC)
+	|| primitive_prep_read(external, &offset, &maxindex, sizeof(maxindex))
+	|| maxindex != (int64_t)m->maxindex
+	|| external->ext_nbytes - offset != (size_t)m->maxindex)
+	return 1;
+
+    if (stp->st_meth->ft_bbox((struct rt_db_internal *)ip, &(stp->st_min), &(stp->st_max), &(stp->st_rtip->rti_tol)))
+	return 1;
+
+    VADD2SCALE(stp->st_center, stp->st_min, stp->st_max, 0.5);
+    VSUB2SCALE(work, stp->st_max, stp->st_min, 0.5);
+    stp->st_aradius = stp->st_bradius = MAGNITUDE(work);
+
+    BU_GET(nmg_s, struct nmg_specific);
+    nmg_s->nmg_model = m;
+    nmg_s->nmg_smagic = NMG_SPEC_START_MAGIC;
+    nmg_s->nmg_emagic = NMG_SPEC_END_MAGIC;
+    nmg_s->manifolds = (char *)bu_calloc(m->maxindex, 1, "manifold table");
+    (void)primitive_prep_read(external, &offset, nmg_s->manifolds, (size_t)m->maxindex);
+
+    /* the soltab owns the model now, as after rt_nmg_prep() */
+    ((struct rt_db_internal *)ip)->idb_ptr = (void *)NULL;
+    stp->st_specific = (void *)nmg_s;
+
+    return 0;
+}
+
+
 void
 rt_nmg_print(const struct soltab *stp)
 {
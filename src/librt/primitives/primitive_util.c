@@ -24,6 +24,10 @@
  * librt_private.h.
  */
 
+#include "common.h"
+
+#include <string.h>
+
 #include "bu/malloc.h"
 #include "bu/opt.h"
 #include "bu/app.h"
@@ -411,6 +415,76 @@ plot_ellipse(
     }
 }
 
+struct bu_pool *
+primitive_prep_begin(uint32_t magic, size_t nbytes)
+{
+    struct bu_pool *pool;
+    uint32_t fastf_size = (uint32_t)sizeof(fastf_t);
+
+    /* bu_pool grows by at least block_size, so size it for the whole blob */
+    pool = bu_pool_create(nbytes + 2 * sizeof(uint32_t));
+    primitive_prep_write(pool, &magic, sizeof(magic));
+    primitive_prep_write(pool, &fastf_size, sizeof(fastf_size));
+    return pool;
+}
+
+
+void
+primitive_prep_write(struct bu_pool *pool, const void *data, size_t nbytes)
+{
+    if (nbytes == 0)
+	return;
+    memcpy(bu_pool_alloc(pool, 1, nbytes), data, nbytes);
+}
+
+
+void
+primitive_prep_end(struct bu_pool *pool, struct bu_external *external)
+{
+    BU_CK_EXTERNAL(external);
+
+    /* the pool's block becomes the external buffer */
+    external->ext_buf = pool->block;
+    external->ext_nbytes = pool->block_pos;
+    pool->block = NULL;
+    bu_pool_delete(pool);
+}
+
+
+int
+primitive_prep_check(const struct bu_external *external, size_t *offset, uint32_t magic)
+{
+    uint32_t stored_magic = 0;
+    uint32_t fastf_size = 0;
+
+    BU_CK_EXTERNAL(external);
+
+    *offset = 0;
+    if (primitive_prep_read(external, offset, &stored_magic, sizeof(stored_magic))
+	|| primitive_prep_read(external, offset, &fastf_size, sizeof(fastf_size)))
+	return 1;
+
+    /* a byte-swapped magic means another architecture wrote this */
+    if (stored_magic != magic || fastf_size != (uint32_t)sizeof(fastf_t))
+	return 1;
+
+    return 0;
+}
+
+
+int
+primitive_prep_read(const struct bu_external *external, size_t *offset, void *data, size_t nbytes)
+{
+    if (*offset > external->ext_nbytes || nbytes > external->ext_nbytes - *offset)
+	return 1;
+
+    if (nbytes > 0)
+	memcpy(data, external->ext_buf + *offset, nbytes);
+    *offset += nbytes;
+    return 0;
+}
+
+
 int
 _rt_tcl_list_to_int_array(const char *list, int **array, int *array_len)
 {
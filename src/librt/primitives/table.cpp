@@ -723,7 +723,7 @@ const struct rt_functab OBJ[] = {
 	NULL, /* find_selections */
 	NULL, /* evaluate_selection */
 	NULL, /* process_selection */
-	NULL, /* serialize */
+	RTFUNCTAB_FUNC_PREP_SERIALIZE_CAST(rt_nmg_prep_serialize),
 	NULL  /* label */
     },
 
@@ -1660,7 +1660,7 @@ const struct rt_functab OBJ[] = {
 	NULL, /* find_selections */
 	NULL, /* evaluate_selection */
 	NULL, /* process_selection */
-	NULL, /* serialize */
+	RTFUNCTAB_FUNC_PREP_SERIALIZE_CAST(rt_bot_prep_serialize),
 	NULL  /* label */
     },
 
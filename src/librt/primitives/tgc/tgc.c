@@ -996,12 +996,13 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
     vect_t work;
     fastf_t k[4], pt[2];
     fastf_t t, b, zval, dir;
-    fastf_t t_scale = 0;
+    fastf_t t_scale;
     fastf_t alf1, alf2;
     int npts;
     int intersect;
     vect_t cor_pprime;	/* corrected P prime */
-    fastf_t cor_proj = 0;	/* corrected projected dist */
+    fastf_t cor_proj;	/* corrected projected dist */
+    fastf_t *ray_scale;	/* per pair t_scale and cor_proj */
     int i;
     bn_poly_t *C;	/* final equation */
     bn_poly_t Xsqr, Ysqr;
@@ -1014,6 +1015,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 
     /* Allocate space for polys and roots */
     C = (bn_poly_t *)bu_malloc(n * sizeof(bn_poly_t), "tor bn_poly_t");
+    ray_scale = (fastf_t *)bu_malloc(2 * n * sizeof(fastf_t), "tgc ray_scale");
 
     /* Initialize seg_stp to assume hit (zero will then flag miss) */
     for (ix = 0; ix < n; ix++) segp[ix].seg_stp = stp[ix];
@@ -1034,6 +1036,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 	 */
 	t_scale = 1/MAGNITUDE(dprime);
 	VSCALE(dprime, dprime, t_scale);	/* VUNITIZE(dprime); */
+	ray_scale[2*ix] = t_scale;
 
 	if (NEAR_ZERO(dprime[Z], RT_PCOEF_TOL))
 	    dprime[Z] = 0.0;	/* prevent rootfinder heartburn */
@@ -1052,6 +1055,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 	 * is 'cor_pprime'.
 	 */
 	cor_proj = VDOT(pprime, dprime);
+	ray_scale[2*ix+1] = cor_proj;
 	VSCALE(cor_pprime, dprime, cor_proj);
 	VSUB2(cor_pprime, pprime, cor_pprime);
 
@@ -1188,7 +1192,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 	    register int nroots;
 
 	    /* The equation is 4th order, so we expect 0 to 4 roots */
-	    nroots = rt_poly_roots(&C[ix], val, (*stp)->st_dp->d_namep);
+	    nroots = rt_poly_roots(&C[ix], val, stp[ix]->st_dp->d_namep);
 
 	    /* Only real roots indicate an intersection in real space.
 	     *
@@ -1223,7 +1227,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 	 * Reverse above translation by adding distance to all 'k' values.
 	 */
 	for (i = 0; i < npts; ++i)
-	    k[i] -= cor_proj;
+	    k[i] -= ray_scale[2*ix+1];
 
 	if (npts != 0 && npts != 2 && npts != 4) {
 	    bu_log("tgc(%s):  %d intersects != {0, 2, 4}\n",
@@ -1271,6 +1275,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 	if (segp[ix].seg_stp == 0) continue; /* Skip */
 
 	tgc = (struct tgc_specific *)stp[ix]->st_specific;
+	t_scale = ray_scale[2*ix];
 	intersect = C[ix].dgr;
 	pt[T_OUT] = C[ix].cf[T_OUT];
 	pt[T_IN]  = C[ix].cf[T_IN];
@@ -1411,6 +1416,7 @@ rt_tgc_vshot(struct soltab **stp, register struct xray **rp, struct seg *segp, i
 	    }
 	}
     } /* end for each ray/cone pair */
+    bu_free((char *)ray_scale, "tgc ray_scale");
     bu_free((char *)C, "tor bn_poly_t");
 }
 
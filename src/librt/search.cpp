@@ -84,6 +84,8 @@
 
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <string.h>
 #include <stdlib.h>
@@ -101,6 +103,7 @@
 
 #include "bu/cmd.h"
 #include "bu/opt.h"
+#include "bu/parallel.h"
 #include "bu/path.h"
 
 #include "rt/db4.h"
@@ -278,6 +281,124 @@ palloc(enum db_search_ntype t, int (*f)(struct db_plan_t *, struct db_node_t *,
 }
 
 
+/*
+ * Primaries that look only at the current object (-name, -type,
+ * -attr, ...) get the same answer every time that object turns up,
+ * and in a tree search the same object usually turns up under many
+ * paths - and again as an ancestor every time -below walks up from
+ * one of its children.  Results for plans marked cacheable are kept
+ * per (plan, object), along with whether the primary cleared
+ * matched_filters.
+ */
+struct search_memo_key {
+    const struct db_plan_t *plan;
+    const struct directory *dp;
+    bool operator==(const search_memo_key &o) const {
+	return plan == o.plan && dp == o.dp;
+    }
+};
+
+
+struct search_memo_hash {
+    size_t operator()(const search_memo_key &k) const {
+	return std::hash<const void *>()(k.plan) ^ (std::hash<const void *>()(k.dp) * 31);
+    }
+};
+
+
+struct db_search_memo {
+    /* first is the return value, second is nonzero if matched_filters was cleared */
+    std::unordered_map<search_memo_key, std::pair<int, int>, search_memo_hash> results;
+};
+
+
+static int
+plan_eval(struct db_plan_t *p, struct db_node_t *db_node, struct db_i *dbip, struct bu_ptbl *results)
+{
+    struct directory *dp;
+    int saved_filters;
+    int ret;
+
+    if (!p->cacheable || !db_node->memo)
+	return (p->eval)(p, db_node, dbip, results);
+
+    dp = DB_FULL_PATH_CUR_DIR(db_node->path);
+    if (!dp)
+	return (p->eval)(p, db_node, dbip, results);
+
+    search_memo_key key = {p, dp};
+    auto it = db_node->memo->results.find(key);
+    if (it != db_node->memo->results.end()) {
+	if (it->second.second)
+	    db_node->matched_filters = 0;
+	return it->second.first;
+    }
+
+    saved_filters = db_node->matched_filters;
+    db_node->matched_filters = 1;
+    ret = (p->eval)(p, db_node, dbip, results);
+    db_node->memo->results[key] = std::make_pair(ret, (db_node->matched_filters == 0) ? 1 : 0);
+    if (db_node->matched_filters)
+	db_node->matched_filters = saved_filters;
+
+    return ret;
+}
+
+
+/*
+ * full_paths is built depth first, each path immediately followed by
+ * everything below it.  Recording where each of those runs ends, and
+ * where each distinct path occurs, lets -above visit just the
+ * descendants of the path in question rather than the whole table.
+ */
+struct db_search_index {
+    std::vector<size_t> end;	/* one past the last descendant of each entry */
+    std::unordered_map<size_t, std::vector<size_t>> occurrences;
+};
+
+
+static size_t
+search_path_hash(const struct db_full_path *fp)
+{
+    size_t h = fp->fp_len;
+    size_t i;
+
+    for (i = 0; i < fp->fp_len; i++) {
+	h = h * 31 + std::hash<const void *>()(fp->fp_names[i]);
+	h = h * 31 + (size_t)fp->fp_cinst[i];
+    }
+    return h;
+}
+
+
+static struct db_search_index *
+search_index_build(struct bu_ptbl *full_paths)
+{
+    struct db_search_index *idx = new db_search_index;
+    std::vector<size_t> open;
+    size_t n = BU_PTBL_LEN(full_paths);
+    size_t i;
+
+    idx->end.resize(n);
+    for (i = 0; i < n; i++) {
+	struct db_full_path *fp = (struct db_full_path *)BU_PTBL_GET(full_paths, i);
+
+	while (!open.empty() && ((struct db_full_path *)BU_PTBL_GET(full_paths, open.back()))->fp_len >= fp->fp_len) {
+	    idx->end[open.back()] = i;
+	    open.pop_back();
+	}
+	open.push_back(i);
+	idx->occurrences[search_path_hash(fp)].push_back(i);
+    }
+    while (!open.empty()) {
+	idx->end[open.back()] = n;
+	open.pop_back();
+    }
+
+    return idx;
+}
+
+
 /*
  * (expression) functions --
  *
@@ -289,7 +410,7 @@ f_expr(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, str
     struct db_plan_t *p = NULL;
     int state = 0;
 
-    for (p = plan->p_un._p_data[0]; p && (state = (p->eval)(p, db_node, dbip, results)); p = p->next)
+    for (p = plan->p_un._p_data[0]; p && (state = plan_eval(p, db_node, dbip, results)); p = p->next)
 	; /* do nothing */
 
     if (!state)
@@ -330,7 +451,7 @@ f_not(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, stru
     struct db_plan_t *p = NULL;
     int state = 0;
 
-    for (p = plan->p_un._p_data[0]; p && (state = (p->eval)(p, db_node, dbip, results)); p = p->next)
+    for (p = plan->p_un._p_data[0]; p && (state = plan_eval(p, db_node, dbip, results)); p = p->next)
 	; /* do nothing */
 
     if (!state && db_node->matched_filters == 0)
@@ -352,7 +473,7 @@ find_execute_nested_plans(struct db_i *dbip, struct bu_ptbl *results, struct db_
 {
     struct db_plan_t *p = NULL;
     int state = 0;
-    for (p = plan; p && (state = (p->eval)(p, db_node, dbip, results)); p = p->next)
+    for (p = plan; p && (state = plan_eval(p, db_node, dbip, results)); p = p->next)
 	; /* do nothing */
 
     return state;
@@ -376,7 +497,9 @@ f_below(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, st
     db_full_path_init(&parent_path);
     db_dup_full_path(&parent_path, db_node->path);
     DB_FULL_PATH_POP(&parent_path);
+    curr_node = *db_node;
     curr_node.path = &parent_path;
+    curr_node.matched_filters = 1;
     distance = db_node->path->fp_len - parent_path.fp_len;
 
     while ((parent_path.fp_len > 0) && (state == 0) && !(db_node->flags & DB_SEARCH_FLAT)) {
@@ -419,6 +542,39 @@ f_above(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, st
 
     unsigned int f_path_len = db_node->path->fp_len;
 
+    curr_node = *db_node;
+
+    if (db_node->index) {
+	/* only the runs following an occurrence of this path can match */
+	auto it = db_node->index->occurrences.find(search_path_hash(db_node->path));
+	if (it != db_node->index->occurrences.end()) {
+	    for (size_t j : it->second) {
+		struct db_full_path *top_path = (struct db_full_path *)BU_PTBL_GET(full_paths, j);
+		size_t k;
+
+		if (top_path->fp_len != f_path_len || !db_full_path_match_top(db_node->path, top_path))
+		    continue;
+
+		for (k = j + 1; k < db_node->index->end[j]; k++) {
+		    struct db_full_path *this_path = (struct db_full_path *)BU_PTBL_GET(full_paths, k);
+		    int relative_depth = this_path->fp_len - f_path_len;
+
+		    if (relative_depth >= plan->min_depth && relative_depth <= plan->max_depth) {
+			curr_node.path = this_path;
+			curr_node.matched_filters = 1;
+
+			state = find_execute_nested_plans(dbip, NULL, &curr_node, plan->p_un._bl_data[0]);
+			if (state)
+			    return 1;
+		    }
+		}
+	    }
+	}
+
+	db_node->matched_filters = 0;
+	return 0;
+    }
+
     for (i = 0; i < (int)BU_PTBL_LEN(full_paths); i++) {
 	struct db_full_path *this_path = (struct db_full_path *)BU_PTBL_GET(full_paths, i);
 
@@ -428,8 +584,7 @@ f_above(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, st
 
 	    if (relative_depth >= plan->min_depth && relative_depth <= plan->max_depth) {
 		curr_node.path = this_path;
-		curr_node.flags = db_node->flags;
-		curr_node.full_paths = full_paths;
+		curr_node.matched_filters = 1;
 
 		state = find_execute_nested_plans(dbip, NULL, &curr_node, plan->p_un._bl_data[0]);
 		if (state)
@@ -463,13 +618,13 @@ f_or(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, struc
     struct db_plan_t *p = NULL;
     int state = 0;
 
-    for (p = plan->p_un._p_data[0]; p && (state = (p->eval)(p, db_node, dbip, results)); p = p->next)
+    for (p = plan->p_un._p_data[0]; p && (state = plan_eval(p, db_node, dbip, results)); p = p->next)
 	; /* do nothing */
 
     if (state)
 	return 1;
 
-    for (p = plan->p_un._p_data[1]; p && (state = (p->eval)(p, db_node, dbip, results)); p = p->next)
+    for (p = plan->p_un._p_data[1]; p && (state = plan_eval(p, db_node, dbip, results)); p = p->next)
 	; /* do nothing */
 
     if (!state)
@@ -518,6 +673,7 @@ c_name(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db_pla
     struct db_plan_t *newplan;
 
     newplan = palloc(N_NAME, f_name, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._c_data = pattern;
     (*resultplan) = newplan;
     return BRLCAD_OK;
@@ -555,6 +711,7 @@ c_iname(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db_pl
     struct db_plan_t *newplan;
 
     newplan = palloc(N_INAME, f_iname, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._ci_data = pattern;
     (*resultplan) = newplan;
 
@@ -827,7 +984,7 @@ f_objparam(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip,
     }
 
     RT_DB_INTERNAL_INIT(&in);
-    if (rt_db_get_internal(&in, dp, dbip, (fastf_t *)NULL, &rt_uniresource) < 0) {
+    if (rt_db_get_internal(&in, dp, dbip, (fastf_t *)NULL, db_node->resp) < 0) {
 	rt_db_free_internal(&in);
 	db_node->matched_filters = 0;
 	return 0;
@@ -865,6 +1022,7 @@ c_objparam(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db
     struct db_plan_t *newplan;
 
     newplan = palloc(N_ATTR, f_objparam, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._attr_data = pattern;
     (*resultplan) = newplan;
 
@@ -944,6 +1102,7 @@ c_attr(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db_pla
     struct db_plan_t *newplan;
 
     newplan = palloc(N_ATTR, f_attr, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._attr_data = pattern;
     (*resultplan) = newplan;
     return BRLCAD_OK;
@@ -1018,6 +1177,7 @@ c_stdattr(char *UNUSED(pattern), char ***UNUSED(ignored), int UNUSED(unused), st
     struct db_plan_t *newplan;
 
     newplan = palloc(N_STDATTR, f_stdattr, tbl);
+    newplan->cacheable = 1;
     (*resultplan) = newplan;
 
     return BRLCAD_OK;
@@ -1067,7 +1227,7 @@ f_type(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, str
 
     }
 
-    if (rt_db_get_internal(&intern, dp, dbip, (fastf_t *)NULL, &rt_uniresource) < 0)
+    if (rt_db_get_internal(&intern, dp, dbip, (fastf_t *)NULL, db_node->resp) < 0)
 	return 0;
     if (intern.idb_major_type != DB5_MAJORTYPE_BRLCAD) {
 	rt_db_free_internal(&intern);
@@ -1184,6 +1344,7 @@ c_type(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db_pla
     struct db_plan_t *newplan;
 
     newplan = palloc(N_TYPE, f_type, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._type_data = pattern;
     (*resultplan) = newplan;
 
@@ -1260,6 +1421,7 @@ c_size(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db_pla
     struct db_plan_t *newplan;
 
     newplan = palloc(N_TYPE, f_size, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._type_data = pattern;
     (*resultplan) = newplan;
 
@@ -1655,7 +1817,7 @@ f_matrix(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, s
 
 	if (dp->d_flags & RT_DIR_COMB) {
 	    struct rt_db_internal intern;
-	    if (rt_db_get_internal(&intern, dp, dbip, (fastf_t *)NULL, &rt_uniresource) > 0) {
+	    if (rt_db_get_internal(&intern, dp, dbip, (fastf_t *)NULL, db_node->resp) > 0) {
 		struct rt_comb_internal *comb = (struct rt_comb_internal *)intern.idb_ptr;
 		if (comb->tree != NULL) {
 		    child_matrix(comb->tree, cdp->d_namep, &mat);
@@ -1752,7 +1914,7 @@ f_nnodes(struct db_plan_t *plan, struct db_node_t *db_node, struct db_i *dbip, s
     }
 
     if (dp->d_flags & RT_DIR_COMB) {
-	rt_db_get_internal(&in, dp, dbip, (fastf_t *)NULL, &rt_uniresource);
+	rt_db_get_internal(&in, dp, dbip, (fastf_t *)NULL, db_node->resp);
 	comb = (struct rt_comb_internal *)in.idb_ptr;
 	if (comb->tree == NULL) {
 	    node_count = 0;
@@ -1791,6 +1953,7 @@ c_nnodes(char *pattern, char ***UNUSED(ignored), int UNUSED(unused), struct db_p
     struct db_plan_t *newplan;
 
     newplan = palloc(N_NNODES, f_nnodes, tbl);
+    newplan->cacheable = 1;
     newplan->p_un._node_data = pattern;
     (*resultplan) = newplan;
 
@@ -2496,11 +2659,158 @@ static void
 find_execute_plans(struct db_i *dbip, struct bu_ptbl *results, struct db_node_t *db_node, struct db_plan_t *plan)
 {
     struct db_plan_t *p;
-    for (p = plan; p && (p->eval)(p, db_node, dbip, results); p = p->next)
+    for (p = plan; p && plan_eval(p, db_node, dbip, results); p = p->next)
 	;
 }
 
 
+/* paths handed to a thread at a time, and the least worth threading */
+#define SEARCH_BATCH 256
+#define SEARCH_PARALLEL_MIN 2048
+
+struct search_eval_state {
+    struct db_i *dbip;
+    struct db_plan_t *plan;
+    struct bu_ptbl *paths;		/* paths to evaluate */
+    struct bu_ptbl *full_paths;		/* NULL for flat searches */
+    struct db_search_index *index;
+    int flags;
+    int memoize;
+    size_t nbatches;
+    size_t next;			/* semaphored */
+    struct bu_ptbl *batch_results;	/* one per batch, NULL if not collecting */
+    int *batch_cnt;
+};
+
+
+static int
+search_eval_range(struct search_eval_state *ses, size_t start, size_t end, struct bu_ptbl *results, struct db_search_memo *memo, struct resource *resp)
+{
+    int cnt = 0;
+    size_t i;
+
+    for (i = start; i < end; i++) {
+	struct db_node_t curr_node;
+	curr_node.path = (struct db_full_path *)BU_PTBL_GET(ses->paths, i);
+	curr_node.full_paths = ses->full_paths;
+	curr_node.flags = ses->flags;
+	curr_node.matched_filters = 1;
+	curr_node.index = ses->index;
+	curr_node.memo = memo;
+	curr_node.resp = resp;
+	find_execute_plans(ses->dbip, results, &curr_node, ses->plan);
+	cnt += curr_node.matched_filters;
+    }
+
+    return cnt;
+}
+
+
+static void
+search_eval_worker(int UNUSED(cpu), void *arg)
+{
+    struct search_eval_state *ses = (struct search_eval_state *)arg;
+    struct db_search_memo memo;
+    struct resource res = RT_RESOURCE_INIT_ZERO;
+    size_t batch, start, end;
+
+    rt_init_resource(&res, 0, NULL);
+
+    while (1) {
+	bu_semaphore_acquire(RT_SEM_WORKER);
+	batch = ses->next++;
+	bu_semaphore_release(RT_SEM_WORKER);
+
+	if (batch >= ses->nbatches)
+	    break;
+
+	start = batch * SEARCH_BATCH;
+	end = start + SEARCH_BATCH;
+	if (end > BU_PTBL_LEN(ses->paths))
+	    end = BU_PTBL_LEN(ses->paths);
+	ses->batch_cnt[batch] = search_eval_range(ses, start, end,
+						  ses->batch_results ? &ses->batch_results[batch] : NULL,
+						  ses->memoize ? &memo : NULL, &res);
+    }
+
+    rt_clean_resource_basic(NULL, &res);
+}
+
+
+/*
+ * Run the plan over each of paths, adding matches to results.  Each
+ * path is independent of the others, so big searches are spread over
+ * threads a batch at a time; batch results are merged back in order so
+ * the output is the same as a serial pass.  Plans using -exec run user
+ * code and are kept serial and uncached.
+ */
+static int
+search_execute(struct db_i *dbip, struct bu_ptbl *results, struct bu_ptbl *paths, struct bu_ptbl *full_paths, int flags, struct db_plan_t *plan, struct bu_ptbl *dbplans)
+{
+    struct search_eval_state ses;
+    struct db_plan_t **pp;
+    size_t ncpu = bu_avail_cpus();
+    int has_exec = 0;
+    int cnt = 0;
+    size_t i, j;
+
+    for (BU_PTBL_FOR(pp, (struct db_plan_t **), dbplans)) {
+	if ((*pp)->type == N_EXEC)
+	    has_exec = 1;
+    }
+
+    ses.dbip = dbip;
+    ses.plan = plan;
+    ses.paths = paths;
+    ses.full_paths = full_paths;
+    ses.index = (full_paths && BU_PTBL_LEN(full_paths)) ? search_index_build(full_paths) : NULL;
+    ses.flags = flags;
+    ses.memoize = !has_exec;
+
+    if (has_exec || ncpu < 2 || BU_PTBL_LEN(paths) < SEARCH_PARALLEL_MIN) {
+	struct db_search_memo memo;
+	cnt = search_eval_range(&ses, 0, BU_PTBL_LEN(paths), results, ses.memoize ? &memo : NULL, &rt_uniresource);
+	delete ses.index;
+	return cnt;
+    }
+
+    ses.nbatches = (BU_PTBL_LEN(paths) + SEARCH_BATCH - 1) / SEARCH_BATCH;
+    ses.next = 0;
+    ses.batch_results = NULL;
+    if (results) {
+	ses.batch_results = (struct bu_ptbl *)bu_calloc(ses.nbatches, sizeof(struct bu_ptbl), "search batch results");
+	for (i = 0; i < ses.nbatches; i++)
+	    bu_ptbl_init(&ses.batch_results[i], 8, "search batch results");
+    }
+    ses.batch_cnt = (int *)bu_calloc(ses.nbatches, sizeof(int), "search batch counts");
+
+    if (!RT_SEM_WORKER)
+	RT_SEM_WORKER = bu_semaphore_register("RT_SEM_WORKER");
+    bu_parallel(search_eval_worker, ncpu, &ses);
+
+    for (i = 0; i < ses.nbatches; i++) {
+	cnt += ses.batch_cnt[i];
+	if (!results)
+	    continue;
+	for (j = 0; j < BU_PTBL_LEN(&ses.batch_results[i]); j++) {
+	    long *entry = BU_PTBL_GET(&ses.batch_results[i], j);
+	    if (flags & DB_SEARCH_FLAT || flags & DB_SEARCH_RETURN_UNIQ_DP)
+		bu_ptbl_ins_unique(results, entry);
+	    else
+		bu_ptbl_ins(results, entry);
+	}
+	bu_ptbl_free(&ses.batch_results[i]);
+    }
+
+    if (ses.batch_results)
+	bu_free(ses.batch_results, "search batch results");
+    bu_free(ses.batch_cnt, "search batch counts");
+    delete ses.index;
+
+    return cnt;
+}
+
+
 static void
 free_exec_plan(struct db_plan_t *splan)
 {
@@ -2658,6 +2968,7 @@ db_search(struct bu_ptbl *search_results,
     /* execute the plan */
     {
 	struct bu_ptbl *full_paths = NULL;
+	struct bu_ptbl flat_paths = BU_PTBL_INIT_ZERO;
 	struct list_client_data_t lcd;
 
 	/* First, check if search_results is initialized - don't trust the caller to do it,
@@ -2697,17 +3008,10 @@ db_search(struct bu_ptbl *search_results,
 		DB_FULL_PATH_SET_CUR_BOOL(start_path, 2);
 
 		/* For a flat search, we don't need to build a table of paths -
-		 * just run the filters on the path */
+		 * just run the filters on the starting paths */
 		if (search_flags & DB_SEARCH_FLAT) {
-		    struct db_node_t curr_node;
 		    /* by convention, a top level node is "unioned" into the global database */
-		    curr_node.path = start_path;
-		    curr_node.flags = search_flags;
-		    curr_node.matched_filters = 1;
-		    curr_node.full_paths = NULL;
-		    find_execute_plans(dbip, search_results, &curr_node, dbplan);
-		    result_cnt += curr_node.matched_filters;
-		    DB_FULL_PATH_POP(start_path);
+		    bu_ptbl_ins(&flat_paths, (long *)start_path);
 		} else {
 		    /* by convention, a top level node is "unioned" into the global database */
 		    bu_ptbl_ins(full_paths, (long *)start_path);
@@ -2718,16 +3022,11 @@ db_search(struct bu_ptbl *search_results,
 	    }
 	}
 
-	if (!(search_flags & DB_SEARCH_FLAT)) {
-	    for (i = 0; i < (int)BU_PTBL_LEN(full_paths); i++) {
-		struct db_node_t curr_node;
-		curr_node.path = (struct db_full_path *)BU_PTBL_GET(full_paths, i);
-		curr_node.full_paths = full_paths;
-		curr_node.flags = search_flags;
-		curr_node.matched_filters = 1;
-		find_execute_plans(dbip, search_results, &curr_node, dbplan);
-		result_cnt += curr_node.matched_filters;
-	    }
+	if (search_flags & DB_SEARCH_FLAT) {
+	    result_cnt = search_execute(dbip, search_results, &flat_paths, NULL, search_flags, dbplan, &dbplans);
+	    db_search_free(&flat_paths);
+	} else {
+	    result_cnt = search_execute(dbip, search_results, full_paths, full_paths, search_flags, dbplan, &dbplans);
 
 	    /* Done with the paths now - we have our answer */
 	    db_search_free(full_paths);
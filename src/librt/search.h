@@ -62,12 +62,18 @@
 #include "bu/ptbl.h"
 #include "raytrace.h"
 
+struct db_search_index;
+struct db_search_memo;
+
 /* node struct - holds data specific to each node under consideration */
 struct db_node_t {
     struct db_full_path *path;
     struct bu_ptbl *full_paths;
     int flags;
     int matched_filters;
+    struct db_search_index *index;	/* subtree lookup for full_paths, may be NULL */
+    struct db_search_memo *memo;	/* per-thread cache of cacheable results, may be NULL */
+    struct resource *resp;		/* for rt_db_get_internal() */
 };
 
 /* search node type */
@@ -96,6 +102,7 @@ struct db_plan_t {
     int max_depth;
     mat_t m;
     int flags;				/* private flags */
+    int cacheable;			/* result depends only on the current object */
     enum db_search_ntype type;		/* plan node type */
     struct bu_ptbl *plans;              /* set of all allocated plans */
     union {
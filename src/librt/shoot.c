@@ -27,8 +27,10 @@
 
 #include "vmath.h"
 
+#include "bu/time.h"
 #include "raytrace.h"
 #include "bv/plot3.h"
+#include "./librt_private.h"
 
 
 #define V3PT_DEPARTING_RPP(_step, _lo, _hi, _pt)			\
@@ -42,6 +44,73 @@
      ((_step)[Z] >= 0 && (_pz) > (_hi)[Z]))
 
 
+/**
+ * Get a set of profiling counters, allocating it on first use and
+ * making room for nsolids solids.
+ */
+static struct rt_profile *
+shoot_profile_get(struct rt_profile **profp, size_t nsolids)
+{
+    struct rt_profile *prof = *profp;
+
+    if (!prof) {
+	BU_ALLOC(prof, struct rt_profile);
+	*profp = prof;
+    }
+    if (prof->pr_nsolids < nsolids) {
+	prof->pr_by_solid = (struct rt_profile_counts *)bu_realloc(prof->pr_by_solid,
+		nsolids * sizeof(struct rt_profile_counts), "pr_by_solid");
+	memset(&prof->pr_by_solid[prof->pr_nsolids], 0,
+	       (nsolids - prof->pr_nsolids) * sizeof(struct rt_profile_counts));
+	prof->pr_nsolids = nsolids;
+    }
+    return prof;
+}
+
+
+static void
+shoot_profile_zero(struct rt_profile *prof)
+{
+    if (!prof)
+	return;
+
+    if (prof->pr_by_solid)
+	memset(prof->pr_by_solid, 0, prof->pr_nsolids * sizeof(struct rt_profile_counts));
+    prof->pr_rays = 0;
+    prof->pr_cells = 0;
+    prof->pr_max_cells = 0;
+}
+
+
+static void
+shoot_profile_count(struct rt_profile *prof, const struct soltab *stp, int ret, int64_t ns)
+{
+    struct rt_profile_counts *pc;
+
+    if ((size_t)stp->st_bit >= prof->pr_nsolids)
+	return;
+
+    pc = &prof->pr_by_solid[stp->st_bit];
+    pc->pc_shots++;
+    if (ret > 0)
+	pc->pc_hits++;
+    pc->pc_ns += ns;
+}
+
+
+void
+shoot_profile_free(struct rt_profile **profp)
+{
+    if (!profp || !*profp)
+	return;
+
+    if ((*profp)->pr_by_solid)
+	bu_free((*profp)->pr_by_solid, "pr_by_solid");
+    bu_free(*profp, "struct rt_profile");
+    *profp = NULL;
+}
+
+
 static void
 shoot_setup_status(struct rt_shootray_status *ss, struct application *ap)
 {
@@ -246,6 +315,22 @@ rt_advance_to_next_cell(register struct rt_shootray_status *ssp)
 		t0 /*ssp->dist_corr*/, px, py, pz);
 	}
 
+	if (cutp == &ap->a_rt_i->rti_CutHead && ap->a_rt_i->rti_cut_flat) {
+	    /* same descent on the packed copy of the tree */
+	    const struct cut_flat_node *nodes = ap->a_rt_i->rti_cut_flat;
+	    const struct cut_flat_node *np = nodes;
+	    point_t pt;
+
+	    VSET(pt, px, py, pz);
+	    while (np->cf_axis != CUT_FLAT_LEAF) {
+		if (!(pt[np->cf_axis] < np->cf_point))
+		    np = &nodes[np->cf_index];
+		else
+		    np++;
+	    }
+	    cutp = (const union cutter *)(ap->a_rt_i->rti_cut_boxes + np->cf_index);
+	}
+
 	while (cutp->cut_type == CUT_CUTNODE) {
 	    switch (cutp->cn.cn_axis) {
 		case X:
@@ -640,6 +725,180 @@ rt_plot_cell(const union cutter *cutp, const struct rt_shootray_status *ssp, str
 }
 
 
+/**
+ * For rt_occluded() rays, tell whether a new segment settles the
+ * query by itself.  It does when a region using its solid is all
+ * unions, so that the segment lies inside the region whatever else is
+ * shot, and that region blocks the ray.
+ */
+static int
+shoot_seg_occludes(struct application *ap, const struct seg *segp)
+{
+    struct region **regpp;
+    fastf_t tol = ap->a_rt_i->rti_tol.dist;
+
+    if (ap->a_ray_length > 0.0 && segp->seg_in.hit_dist >= ap->a_ray_length)
+	return 0;
+    /* the surface the ray leaves from */
+    if (segp->seg_in.hit_dist < tol && segp->seg_out.hit_dist < tol * 10)
+	return 0;
+
+    for (BU_PTBL_FOR(regpp, (struct region **), &segp->seg_stp->st_regions)) {
+	if ((*regpp)->reg_all_unions && ap->a_occluder(ap, *regpp) > 0)
+	    return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * Shoot one solid for the RT_PART_HLBVH traversal, adding any
+ * segments to the waiting_segs list.  Mirrors the bn_list loop in
+ * rt_shootray(), but since every ray starts from the original ray
+ * point there is no distance correction.
+ */
+static void
+shoot_hlbvh_solid(struct rt_shootray_status *ssp, struct soltab *stp, struct bu_bitv *solidbits, struct seg *waiting_segs)
+{
+    struct application *ap = ssp->ap;
+    struct resource *resp = ssp->resp;
+    struct rt_profile *prof = ap->a_rt_i->rti_profiling ? resp->re_profile : NULL;
+    struct seg new_segs;
+    struct seg *s2;
+    int ret;
+
+    if (BU_BITTEST(solidbits, stp->st_bit)) {
+	resp->re_ndup++;
+	return;	/* already shot */
+    }
+    BU_BITSET(solidbits, stp->st_bit);
+
+    if (stp->st_meth->ft_use_rpp) {
+	if (!rt_in_rpp(&ssp->newray, ssp->inv_dir, stp->st_min, stp->st_max)
+	    || ssp->newray.r_max < BACKING_DIST) {
+	    resp->re_prune_solrpp++;
+	    return;	/* MISS */
+	}
+    }
+
+    resp->re_shots++;
+    BU_LIST_INIT(&(new_segs.l));
+
+    ret = -1;
+    if (stp->st_meth->ft_shot) {
+	int64_t start = prof ? bu_gettime_ns() : 0;
+	ret = stp->st_meth->ft_shot(stp, &ssp->newray, ap, &new_segs);
+	if (prof)
+	    shoot_profile_count(prof, stp, ret, bu_gettime_ns() - start);
+    }
+    if (ret <= 0) {
+	resp->re_shot_miss++;
+	return;	/* MISS */
+    }
+
+    while (BU_LIST_WHILE(s2, seg, &(new_segs.l))) {
+	BU_LIST_DEQUEUE(&(s2->l));
+	s2->seg_in.hit_rayp = s2->seg_out.hit_rayp = &ap->a_ray;
+	BU_LIST_INSERT(&(waiting_segs->l), &(s2->l));
+	if (ap->a_occluder && shoot_seg_occludes(ap, s2))
+	    ssp->occluded = 1;
+    }
+    resp->re_shot_hit++;
+}
+
+
+/**
+ * Walk the flattened HLBVH built by cut_hlbvh_build(), near child
+ * first, shooting every solid in every leaf the ray passes through.
+ * Infinite solids are shot up front.
+ *
+ * Each pending stack entry remembers the entry distance of its
+ * parent, which bounds the hits any solid below it can produce, so
+ * for a_onehit rays partitions in front of the nearest pending entry
+ * are final and the walk can stop early.
+ *
+ * Returns -
+ * 2 a segment settled an rt_occluded() ray
+ * 1 enough final partitions were found for a_onehit
+ * 0 otherwise, the caller has to weave and evaluate what is left
+ */
+static int
+shoot_hlbvh(struct rt_shootray_status *ssp, struct bu_bitv *solidbits, struct seg *waiting_segs, struct seg *finished_segs, struct partition *InitialPart, struct partition *FinalPart, struct bu_ptbl *regionbits)
+{
+    struct application *ap = ssp->ap;
+    struct rt_i *rtip = ap->a_rt_i;
+    const struct bvh_flat_node *nodes = rtip->rti_bvh_nodes;
+    long todo[BVH_STACK_SIZE];
+    fastf_t todo_dist[BVH_STACK_SIZE];
+    int todo_offset = 0;
+    long node_num = 0;
+    fastf_t last_bool_start = BACKING_DIST;
+    struct xray ray;
+    size_t i;
+
+    for (i = 0; i < rtip->rti_inf_box.bn.bn_len; i++)
+	shoot_hlbvh_solid(ssp, rtip->rti_inf_box.bn.bn_list[i], solidbits, waiting_segs);
+    if (ssp->occluded)
+	return 2;
+
+    if (!nodes)
+	return 0;
+
+    ray = ap->a_ray;	/* struct copy, rt_in_rpp() writes r_min/r_max */
+    for (;;) {
+	const struct bvh_flat_node *node = &nodes[node_num];
+	int visit = rt_in_rpp(&ray, ssp->inv_dir, &node->bounds[0], &node->bounds[3])
+	    && ray.r_max >= BACKING_DIST
+	    && !(ap->a_ray_length > 0.0 && ray.r_min > ap->a_ray_length);
+
+	if (visit && node->n_primitives == 0) {
+	    /* Visit the near child first, defer the far one */
+	    BU_ASSERT(todo_offset < BVH_STACK_SIZE);
+	    todo_dist[todo_offset] = ray.r_min;
+	    if (ssp->rstep[node->axis] < 0) {
+		todo[todo_offset++] = node_num + 1;
+		node_num = node->u.second_child_offset;
+	    } else {
+		todo[todo_offset++] = node->u.second_child_offset;
+		node_num = node_num + 1;
+	    }
+	    continue;
+	}
+
+	if (visit) {
+	    ssp->box_num++;
+	    for (i = 0; i < (size_t)node->n_primitives; i++)
+		shoot_hlbvh_solid(ssp, rtip->rti_bvh_prims[node->u.primitives_offset + i], solidbits, waiting_segs);
+	    if (ssp->occluded)
+		return 2;
+
+	    if (ap->a_onehit != 0 && todo_offset > 0 && BU_LIST_NON_EMPTY(&(waiting_segs->l))) {
+		fastf_t pending_hit = INFINITY;
+		int j;
+
+		for (j = 0; j < todo_offset; j++) {
+		    if (todo_dist[j] < pending_hit)
+			pending_hit = todo_dist[j];
+		}
+
+		rt_boolweave(finished_segs, waiting_segs, InitialPart, ap);
+		if (pending_hit > last_bool_start) {
+		    int done = rt_boolfinal(InitialPart, FinalPart, last_bool_start, pending_hit, regionbits, ap, solidbits);
+		    last_bool_start = pending_hit;
+		    if (done > 0)
+			return 1;
+		}
+	    }
+	}
+
+	if (todo_offset == 0)
+	    break;
+	node_num = todo[--todo_offset];
+    }
+    return 0;
+}
+
+
 _BU_ATTR_FLATTEN int
 rt_shootray(register struct application *ap)
 {
@@ -661,6 +920,8 @@ rt_shootray(register struct application *ap)
     struct rt_i *rtip;
     const int debug_shoot = RT_G_DEBUG & RT_DEBUG_SHOOT;
     fastf_t pending_hit = 0; /* dist of closest odd hit pending */
+    struct rt_profile *prof = NULL;	/* non-null when profiling */
+    size_t ncells = 0;		/* cells visited, for profiling */
 
     RT_AP_CHECK(ap);
     if (ap->a_magic) {
@@ -720,6 +981,7 @@ rt_shootray(register struct application *ap)
     FinalPart.pt_forw = FinalPart.pt_back = &FinalPart;
     FinalPart.pt_magic = PT_HD_MAGIC;
     ap->a_Final_Part_hdp = &FinalPart;
+    ss.occluded = 0;
 
     BU_LIST_INIT(&new_segs.l);
     BU_LIST_INIT(&waiting_segs.l);
@@ -784,6 +1046,8 @@ rt_shootray(register struct application *ap)
      * Record essential statistics in per-processor data structure.
      */
     resp->re_nshootray++;
+    if (rtip->rti_profiling)
+	prof = shoot_profile_get(&resp->re_profile, rtip->nsolids);
 
     /* Compute the inverse of the direction cosines */
     if (ap->a_ray.r_dir[X] < -SQRT_SMALL_FASTF) {
@@ -852,6 +1116,23 @@ rt_shootray(register struct application *ap)
 	goto out;
     }
 
+    if (rtip->rti_space_partition == RT_PART_HLBVH) {
+	/* All hits along the ray come from whole-solid ft_shot() calls,
+	 * so there is no backing distance or pieces state to set up.
+	 */
+	int done;
+
+	shoot_setup_status(&ss, ap);
+	done = shoot_hlbvh(&ss, solidbits, &waiting_segs, &finished_segs,
+			   &InitialPart, &FinalPart, regionbits);
+	ncells = ss.box_num;
+	if (done > 1)
+	    goto occluded;
+	if (done > 0)
+	    goto hitit;
+	goto weave;
+    }
+
     /*
      * The interesting part of the ray starts at distance 0.  If the
      * ray enters the model at a negative distance, (i.e., the ray
@@ -955,6 +1236,7 @@ rt_shootray(register struct application *ap)
      */
     while ((cutp = rt_advance_to_next_cell(&ss)) != CUTTER_NULL) {
     start_cell:
+	ncells++;
 	if (debug_shoot) {
 	    bu_log("BOX #%d interval is %g..%g\n", ss.box_num, ss.box_start, ss.box_end);
 	    rt_pr_cut(cutp, 0);
@@ -1039,7 +1321,10 @@ rt_shootray(register struct application *ap)
 
 		ret = -1;
 		if (stp->st_meth->ft_piece_shot) {
+		    int64_t start = prof ? bu_gettime_ns() : 0;
 		    ret = stp->st_meth->ft_piece_shot(psp, plp, ss.dist_corr, &ss.newray, ap, &waiting_segs);
+		    if (prof)
+			shoot_profile_count(prof, stp, ret, bu_gettime_ns() - start);
 		}
 		if (ret <= 0) {
 		    /* No hits at all */
@@ -1108,7 +1393,10 @@ rt_shootray(register struct application *ap)
 
 		ret = -1;
 		if (stp->st_meth->ft_shot) {
+		    int64_t start = prof ? bu_gettime_ns() : 0;
 		    ret = stp->st_meth->ft_shot(stp, &ss.newray, ap, &new_segs);
+		    if (prof)
+			shoot_profile_count(prof, stp, ret, bu_gettime_ns() - start);
 		}
 		if (ret <= 0) {
 		    resp->re_shot_miss++;
@@ -1125,9 +1413,13 @@ rt_shootray(register struct application *ap)
 			s2->seg_out.hit_dist += ss.dist_corr;
 			s2->seg_in.hit_rayp = s2->seg_out.hit_rayp = &ap->a_ray;
 			BU_LIST_INSERT(&(waiting_segs.l), &(s2->l));
+			if (ap->a_occluder && shoot_seg_occludes(ap, s2))
+			    ss.occluded = 1;
 		    }
 		}
 		resp->re_shot_hit++;
+		if (ss.occluded)
+		    goto occluded;
 	    }
 	}
 	if (RT_G_DEBUG & RT_DEBUG_ADVANCE)
@@ -1284,11 +1576,30 @@ hitit:
 
     RT_FREE_SEG_LIST(&finished_segs, resp);
     RT_FREE_PT_LIST(&FinalPart, resp);
+    goto out;
+
+occluded:
+    /* an rt_occluded() ray needs nothing past its first conclusive
+     * segment, drop everything gathered so far
+     */
+    RT_FREE_SEG_LIST(&waiting_segs, resp);
+    RT_FREE_SEG_LIST(&finished_segs, resp);
+    RT_FREE_PT_LIST(&InitialPart, resp);
+    RT_FREE_PT_LIST(&FinalPart, resp);
+    ap->a_return = 1;
+    status = "OCCLUDED";
 
     /*
      * Processing of this ray is complete.
      */
 out:
+    if (prof) {
+	prof->pr_rays++;
+	prof->pr_cells += ncells;
+	if (ncells > prof->pr_max_cells)
+	    prof->pr_max_cells = ncells;
+    }
+
     /* Return dynamic resources to their freelists.  */
     BU_CK_BITV(solidbits);
     BU_LIST_APPEND(&resp->re_solid_bitv, &solidbits->l);
@@ -1323,6 +1634,89 @@ out:
 }
 
 
+/**
+ * a_hit() for rt_occluded() rays that were not settled by a single
+ * segment.  Walks the final partitions in order, and presses on past
+ * the last one when a_onehit may have cut the list short.
+ */
+static int
+occluded_hit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(segp))
+{
+    struct partition *pp;
+    struct application sub_ap;
+    fastf_t tol = ap->a_rt_i->rti_tol.dist;
+    fastf_t max_dist = (ap->a_ray_length > 0.0) ? ap->a_ray_length : INFINITY;
+    fastf_t resume;
+    int undecided = 0;
+    int ret;
+
+    for (pp = PartHeadp->pt_forw; pp != PartHeadp; pp = pp->pt_forw) {
+	if (pp->pt_inhit->hit_dist >= max_dist)
+	    return undecided ? -1 : 0;
+	/* the surface the ray leaves from */
+	if (pp->pt_inhit->hit_dist < tol && pp->pt_outhit->hit_dist < tol * 10)
+	    continue;
+	ret = ap->a_occluder(ap, pp->pt_regionp);
+	if (ret > 0)
+	    return 1;
+	if (ret < 0)
+	    undecided = 1;
+    }
+
+    pp = PartHeadp->pt_back;
+    if (pp == PartHeadp || pp->pt_outhit->hit_dist >= INFINITY)
+	return undecided ? -1 : 0;
+    resume = pp->pt_outhit->hit_dist + tol;
+    if (resume >= max_dist)
+	return undecided ? -1 : 0;
+
+    sub_ap = *ap;	/* struct copy */
+    sub_ap.a_level++;
+    VJOIN1(sub_ap.a_ray.r_pt, ap->a_ray.r_pt, resume, ap->a_ray.r_dir);
+    if (ap->a_ray_length > 0.0)
+	sub_ap.a_ray_length = ap->a_ray_length - resume;
+    ret = rt_shootray(&sub_ap);
+    if (ret == 0 && undecided)
+	return -1;
+    return ret;
+}
+
+
+static int
+occluded_miss(struct application *UNUSED(ap))
+{
+    return 0;
+}
+
+
+/* default for rt_occluded(), anything but air blocks */
+static int
+occluded_by_solid(struct application *UNUSED(ap), const struct region *regp)
+{
+    return regp->reg_aircode == 0;
+}
+
+
+int
+rt_occluded(struct application *ap, fastf_t max_dist, int (*occluder)(struct application *, const struct region *))
+{
+    struct application occ_ap;
+
+    RT_CK_AP(ap);
+    RT_CK_RTI(ap->a_rt_i);
+
+    occ_ap = *ap;	/* struct copy, occluder sees the caller's fields */
+    occ_ap.a_hit = occluded_hit;
+    occ_ap.a_miss = occluded_miss;
+    occ_ap.a_occluder = occluder ? occluder : occluded_by_solid;
+    /* air can only be skipped over when the caller has no say in it */
+    occ_ap.a_onehit = occluder ? 1 : -1;
+    occ_ap.a_ray_length = (max_dist > 0.0) ? max_dist : 0.0;
+
+    return rt_shootray(&occ_ap);
+}
+
+
 const union cutter *
 rt_cell_n_on_ray(register struct application *ap, int n)
 
@@ -1535,6 +1929,8 @@ rt_zero_res_stats(struct resource *resp)
     resp->re_piece_shot_hit = 0;
     resp->re_piece_shot_miss = 0;
     resp->re_piece_ndup = 0;
+
+    shoot_profile_zero(resp->re_profile);
 }
 
 
@@ -1560,10 +1956,127 @@ rt_add_res_stats(register struct rt_i *rtip, register struct resource *resp)
     rtip->ndup += resp->re_ndup + resp->re_piece_ndup;
     rtip->nempty_cells += resp->re_nempty_cells;
 
+    if (resp->re_profile && resp->re_profile->pr_rays > 0) {
+	const struct rt_profile *from = resp->re_profile;
+	struct rt_profile *to = shoot_profile_get(&rtip->rti_profile, from->pr_nsolids);
+	size_t i;
+
+	for (i = 0; i < from->pr_nsolids; i++) {
+	    to->pr_by_solid[i].pc_shots += from->pr_by_solid[i].pc_shots;
+	    to->pr_by_solid[i].pc_hits += from->pr_by_solid[i].pc_hits;
+	    to->pr_by_solid[i].pc_ns += from->pr_by_solid[i].pc_ns;
+	}
+	to->pr_rays += from->pr_rays;
+	to->pr_cells += from->pr_cells;
+	if (from->pr_max_cells > to->pr_max_cells)
+	    to->pr_max_cells = from->pr_max_cells;
+    }
+
     /* Zero out resource totals, so repeated calls are not harmful */
     rt_zero_res_stats(resp);
 }
 
+void
+rt_profile_zero(struct rt_i *rtip)
+{
+    RT_CK_RTI(rtip);
+    shoot_profile_zero(rtip->rti_profile);
+}
+
+
+static void
+profile_json_counts(struct bu_vls *json, const struct rt_profile_counts *pc)
+{
+    bu_vls_printf(json, "\"shots\": %zu, \"hits\": %zu, \"ns\": %lld, \"ns_per_shot\": %.1f",
+		  pc->pc_shots, pc->pc_hits, (long long)pc->pc_ns,
+		  pc->pc_shots > 0 ? (double)pc->pc_ns / (double)pc->pc_shots : 0.0);
+}
+
+
+static void
+profile_json_string(struct bu_vls *json, const char *str)
+{
+    const char *cp;
+
+    bu_vls_putc(json, '"');
+    for (cp = str; cp && *cp; cp++) {
+	if (*cp == '"' || *cp == '\\')
+	    bu_vls_printf(json, "\\%c", *cp);
+	else if ((unsigned char)*cp < 0x20)
+	    bu_vls_printf(json, "\\u%04x", (unsigned char)*cp);
+	else
+	    bu_vls_putc(json, *cp);
+    }
+    bu_vls_putc(json, '"');
+}
+
+
+void
+rt_profile_report(struct bu_vls *json, const struct rt_i *rtip)
+{
+    struct rt_profile_counts by_type[ID_MAX_SOLID+1];
+    const struct rt_profile *prof;
+    size_t i;
+    int id;
+    int first;
+
+    RT_CK_RTI(rtip);
+    BU_CK_VLS(json);
+
+    prof = rtip->rti_profile;
+    memset(by_type, 0, sizeof(by_type));
+
+    bu_vls_printf(json, "{\n  \"rays\": %zu,\n  \"cells\": %zu,\n", prof ? prof->pr_rays : 0, prof ? prof->pr_cells : 0);
+    bu_vls_printf(json, "  \"cells_per_ray\": %.3f,\n  \"max_cells_per_ray\": %zu,\n",
+		  (prof && prof->pr_rays > 0) ? (double)prof->pr_cells / (double)prof->pr_rays : 0.0,
+		  prof ? prof->pr_max_cells : 0);
+
+    /* Per-solid counters, only for solids that were actually shot */
+    bu_vls_strcat(json, "  \"solids\": [");
+    first = 1;
+    for (i = 0; prof && i < prof->pr_nsolids && i < rtip->nsolids; i++) {
+	const struct rt_profile_counts *pc = &prof->pr_by_solid[i];
+	const struct soltab *stp = rtip->rti_Solids ? rtip->rti_Solids[i] : NULL;
+
+	if (!stp || pc->pc_shots == 0)
+	    continue;
+
+	id = stp->st_id;
+	if (id >= 0 && id <= ID_MAX_SOLID) {
+	    by_type[id].pc_shots += pc->pc_shots;
+	    by_type[id].pc_hits += pc->pc_hits;
+	    by_type[id].pc_ns += pc->pc_ns;
+	}
+
+	bu_vls_printf(json, "%s\n    {\"name\": ", first ? "" : ",");
+	profile_json_string(json, stp->st_dp ? stp->st_name : "");
+	bu_vls_strcat(json, ", \"type\": ");
+	profile_json_string(json, stp->st_meth ? stp->st_meth->ft_label : "");
+	bu_vls_printf(json, ", \"bit\": %zu, ", i);
+	profile_json_counts(json, pc);
+	bu_vls_putc(json, '}');
+	first = 0;
+    }
+    bu_vls_strcat(json, first ? "],\n" : "\n  ],\n");
+
+    /* Per-type totals, derived from the per-solid counters */
+    bu_vls_strcat(json, "  \"types\": [");
+    first = 1;
+    for (id = 0; id <= ID_MAX_SOLID; id++) {
+	if (by_type[id].pc_shots == 0)
+	    continue;
+
+	bu_vls_printf(json, "%s\n    {\"type\": ", first ? "" : ",");
+	profile_json_string(json, OBJ[id].ft_label);
+	bu_vls_strcat(json, ", ");
+	profile_json_counts(json, &by_type[id]);
+	bu_vls_putc(json, '}');
+	first = 0;
+    }
+    bu_vls_strcat(json, first ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+
 static int
 rt_shootray_simple_hit(struct application *a, struct partition *PartHeadp, struct seg *UNUSED(s))
 {
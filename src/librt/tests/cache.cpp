@@ -525,6 +525,7 @@ const char *rt_cache_test_usage =
 "       rt_cache 5 [obj_count] (Multiple distinct object serial test)\n"
 "       rt_cache 6 [obj_count] (Multiple distinct object parallel test)\n"
 "       rt_cache 7 [obj_count] (Multiple distinct objects, multiple instances in tree parallel test)\n"
+"       rt_cache 8 [obj_count] (Multiple distinct object serial test, uncompressed cache)\n"
 "       rt_cache 20 [obj_count] [subprocess_count] (Multiple process identical objects test)\n"
 "       rt_cache 21 [obj_count] [subprocess_count] (Multiple process distinct objects test)\n";
 
@@ -607,6 +608,10 @@ main(int ac, char *av[])
 	case 7:
 	    /* Parallel prep API, multiple objects, non-unique content, multiple instances in tree */
 	    return test_cache(rp, test_num, obj_cnt, 1, 1, 0, 5);
+	case 8:
+	    /* Serial prep API, multiple objects, different content, mapped raw entries */
+	    bu_setenv("LIBRT_CACHE_UNCOMPRESSED", "1", 1);
+	    return test_cache(rp, test_num, obj_cnt, 0, 1, 0, 0);
 	case 20:
 	    /* Multiple objects, same content, multi-process */
 	    return test_cache(rp, test_num, obj_cnt, 1, 0, subprocess_cnt, 0);
@@ -0,0 +1,157 @@
+/*                     D I R I N D E X . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file dirindex.c
+ *
+ * Exercise the by-name directory index behind db_lookup() through
+ * enough additions, renames and deletions to force several resizes,
+ * checking it against FOR_ALL_DIRECTORY_START iteration.
+ *
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+
+#include "vmath.h"
+#include "bu/app.h"
+#include "bu/parallel.h"
+#include "raytrace.h"
+
+
+#define NOBJ 20000
+
+static struct db_i *test_dbip;
+static int lookup_errors;
+
+
+static void
+lookup_worker(int UNUSED(cpu), void *UNUSED(data))
+{
+    char name[64];
+    int i;
+
+    for (i = 0; i < NOBJ; i++) {
+	struct directory *dp;
+
+	snprintf(name, sizeof(name), "part.s%d", i);
+	dp = db_lookup(test_dbip, name, LOOKUP_QUIET);
+	if ((i % 4 == 0) != (dp == RT_DIR_NULL)) {
+	    bu_semaphore_acquire(BU_SEM_GENERAL);
+	    lookup_errors++;
+	    bu_semaphore_release(BU_SEM_GENERAL);
+	}
+    }
+}
+
+
+int
+main(int UNUSED(argc), char *argv[])
+{
+    struct directory *dp;
+    unsigned char minor_type = ID_SPH;
+    char name[64];
+    size_t count;
+    int i;
+    int ret = 0;
+
+    bu_setprogname(argv[0]);
+
+    test_dbip = db_open_inmem();
+    if (test_dbip == DBI_NULL)
+	bu_exit(1, "ERROR: unable to create an in-memory database\n");
+
+    for (i = 0; i < NOBJ; i++) {
+	snprintf(name, sizeof(name), "part.s%d", i);
+	if (db_diradd(test_dbip, name, RT_DIR_PHONY_ADDR, 0, RT_DIR_SOLID, (void *)&minor_type) == RT_DIR_NULL)
+	    bu_exit(1, "ERROR: db_diradd(%s) failed\n", name);
+    }
+
+    /* duplicates get a temporary name rather than a second entry */
+    dp = db_diradd(test_dbip, "part.s7", RT_DIR_PHONY_ADDR, 0, RT_DIR_SOLID, (void *)&minor_type);
+    if (dp == RT_DIR_NULL || BU_STR_EQUAL(dp->d_namep, "part.s7")) {
+	bu_log("duplicate name was not renamed\n");
+	ret = 1;
+    } else {
+	db_dirdelete(test_dbip, dp);
+    }
+
+    /* rename every other object, then delete every fourth original */
+    for (i = 0; i < NOBJ; i += 2) {
+	snprintf(name, sizeof(name), "part.s%d", i);
+	dp = db_lookup(test_dbip, name, LOOKUP_QUIET);
+	if (dp == RT_DIR_NULL) {
+	    bu_log("lookup of %s failed\n", name);
+	    ret = 1;
+	    continue;
+	}
+	snprintf(name, sizeof(name), "renamed.s%d", i);
+	db_rename(test_dbip, dp, name);
+    }
+    for (i = 0; i < NOBJ; i += 2) {
+	snprintf(name, sizeof(name), "renamed.s%d", i);
+	dp = db_lookup(test_dbip, name, LOOKUP_QUIET);
+	if (dp == RT_DIR_NULL) {
+	    bu_log("lookup of %s failed\n", name);
+	    ret = 1;
+	    continue;
+	}
+	if (i % 4 == 0) {
+	    db_dirdelete(test_dbip, dp);
+	} else {
+	    snprintf(name, sizeof(name), "part.s%d", i);
+	    db_rename(test_dbip, dp, name);
+	}
+    }
+
+    /* every surviving entry is reachable both ways */
+    count = 0;
+    FOR_ALL_DIRECTORY_START(dp, test_dbip) {
+	if (db_lookup(test_dbip, dp->d_namep, LOOKUP_QUIET) != dp) {
+	    bu_log("%s is in the directory but not found by db_lookup\n", dp->d_namep);
+	    ret = 1;
+	}
+	count++;
+    } FOR_ALL_DIRECTORY_END;
+
+    if (count != (size_t)(NOBJ - NOBJ / 4) || count != db_directory_size(test_dbip)) {
+	bu_log("expected %d entries, iterated %zu, db_directory_size %zu\n",
+	       NOBJ - NOBJ / 4, count, db_directory_size(test_dbip));
+	ret = 1;
+    }
+
+    bu_parallel(lookup_worker, 0, NULL);
+    if (lookup_errors) {
+	bu_log("%d lookups returned the wrong result\n", lookup_errors);
+	ret = 1;
+    }
+
+    db_close(test_dbip);
+    return ret;
+}
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
@@ -0,0 +1,163 @@
+/*                      O C C L U D E D . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file occluded.c
+ *
+ * Check rt_occluded() against a sphere in front of a block: rays that
+ * pass through, beside and short of the sphere, rays leaving the
+ * block's surface, and occluder callbacks that let the sphere through
+ * or cannot decide on it.
+ *
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vmath.h"
+#include "bu/app.h"
+#include "raytrace.h"
+
+
+static int
+sphere_passes(struct application *UNUSED(ap), const struct region *regp)
+{
+    return strstr(regp->reg_name, "sph") ? 0 : 1;
+}
+
+
+static int
+sphere_undecided(struct application *UNUSED(ap), const struct region *regp)
+{
+    return strstr(regp->reg_name, "sph") ? -1 : 1;
+}
+
+
+static int
+check(struct rt_i *rtip, const char *what, point_t pt, vect_t dir, fastf_t max_dist,
+      int (*occluder)(struct application *, const struct region *), int expect)
+{
+    struct application ap;
+    int ret;
+
+    RT_APPLICATION_INIT(&ap);
+    ap.a_rt_i = rtip;
+    ap.a_resource = &rt_uniresource;
+    VMOVE(ap.a_ray.r_pt, pt);
+    VMOVE(ap.a_ray.r_dir, dir);
+    VUNITIZE(ap.a_ray.r_dir);
+
+    ret = rt_occluded(&ap, max_dist, occluder);
+    if (ret != expect) {
+	bu_log("%s: rt_occluded returned %d, expected %d\n", what, ret, expect);
+	return 1;
+    }
+    return 0;
+}
+
+
+int
+main(int UNUSED(argc), char *argv[])
+{
+    const char *names[2] = {"sph.s", "block.s"};
+    struct db_i *dbip;
+    struct rt_wdb *wdbp;
+    struct rt_i *rtip;
+    struct rt_ell_internal ell;
+    struct rt_arb_internal arb;
+    point_t pt;
+    vect_t dir;
+    int i;
+    int ret = 0;
+
+    bu_setprogname(argv[0]);
+
+    dbip = db_open_inmem();
+    if (dbip == DBI_NULL)
+	bu_exit(1, "ERROR: unable to create an in-memory database\n");
+    wdbp = wdb_dbopen(dbip, RT_WDB_TYPE_DB_INMEM);
+
+    /* unit sphere at the origin */
+    ell.magic = RT_ELL_INTERNAL_MAGIC;
+    VSETALL(ell.v, 0);
+    VSET(ell.a, 1, 0, 0);
+    VSET(ell.b, 0, 1, 0);
+    VSET(ell.c, 0, 0, 1);
+    if (wdb_export(wdbp, "sph.s", (void *)&ell, ID_ELL, 1.0) < 0)
+	bu_exit(1, "ERROR: unable to write sph.s\n");
+
+    /* block from z = -10 to z = -5 */
+    arb.magic = RT_ARB_INTERNAL_MAGIC;
+    for (i = 0; i < 8; i++) {
+	VSET(arb.pt[i], (i == 1 || i == 2 || i == 5 || i == 6) ? 10 : -10,
+	     (i == 2 || i == 3 || i == 6 || i == 7) ? 10 : -10,
+	     (i < 4) ? -10 : -5);
+    }
+    if (wdb_export(wdbp, "block.s", (void *)&arb, ID_ARB8, 1.0) < 0)
+	bu_exit(1, "ERROR: unable to write block.s\n");
+
+    rtip = rt_new_rti(dbip);
+    if (rt_gettrees(rtip, 2, names, 1) < 0)
+	bu_exit(1, "ERROR: rt_gettrees failed\n");
+    rt_prep(rtip);
+
+    /* from above, straight down through the sphere */
+    VSET(pt, 0, 0, 10);
+    VSET(dir, 0, 0, -1);
+    ret += check(rtip, "through sphere", pt, dir, 0.0, NULL, 1);
+    ret += check(rtip, "short of sphere", pt, dir, 8.0, NULL, 0);
+    ret += check(rtip, "through sphere to block", pt, dir, 12.0, NULL, 1);
+    ret += check(rtip, "sphere passes, block does not", pt, dir, 0.0, sphere_passes, 1);
+    ret += check(rtip, "sphere passes, short of block", pt, dir, 12.0, sphere_passes, 0);
+    ret += check(rtip, "sphere undecided", pt, dir, 12.0, sphere_undecided, -1);
+
+    /* beside the sphere, stopping short of the block */
+    VSET(pt, 3, 0, 10);
+    ret += check(rtip, "beside sphere", pt, dir, 12.0, NULL, 0);
+    ret += check(rtip, "beside sphere to block", pt, dir, 0.0, NULL, 1);
+
+    /* leaving the top of the block, up through the sphere or beside it */
+    VSET(pt, 0, 0, -5);
+    VSET(dir, 0, 0, 1);
+    ret += check(rtip, "from block through sphere", pt, dir, 0.0, NULL, 1);
+    ret += check(rtip, "from block, sphere passes", pt, dir, 0.0, sphere_passes, 0);
+    VSET(pt, 3, 0, -5);
+    ret += check(rtip, "from block, beside sphere", pt, dir, 0.0, NULL, 0);
+
+    /* sideways into empty space */
+    VSET(pt, 0, 0, 10);
+    VSET(dir, 1, 0, 0);
+    ret += check(rtip, "into empty space", pt, dir, 0.0, NULL, 0);
+
+    rt_free_rti(rtip);
+    wdb_close(wdbp);
+
+    return ret ? 1 : 0;
+}
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
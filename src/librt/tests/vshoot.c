@@ -0,0 +1,177 @@
+/*                        V S H O O T . C
+ * BRL-CAD
+ *
+ * Copyright (c) 2024 United States Government as represented by
+ * the U.S. Army Research Laboratory.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this file; see the file named COPYING for more
+ * information.
+ */
+/** @file vshoot.c
+ *
+ * Fire a fan of rays at a row of differently shaped TGCs through both
+ * rt_shootray() and rt_vshootray(), and check that each ray gets the
+ * same first in and last out distances either way.  Every packet holds
+ * several TGC/ray pairs with different scale factors.
+ *
+ */
+
+#include "common.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vmath.h"
+#include "bu/app.h"
+#include "bn.h"
+#include "raytrace.h"
+
+
+#define NTGC 4
+#define NRAYS 96
+
+/* the two paths share the root solvers, so this is generous */
+#define DIST_TOL 0.01
+
+struct ray_result {
+    int hit;
+    fastf_t in, out;
+};
+
+
+static int
+record_hit(struct application *ap, struct partition *PartHeadp, struct seg *UNUSED(segs))
+{
+    struct ray_result *rr = (struct ray_result *)ap->a_uptr;
+
+    rr->hit = 1;
+    rr->in = PartHeadp->pt_forw->pt_inhit->hit_dist;
+    rr->out = PartHeadp->pt_back->pt_outhit->hit_dist;
+    return 1;
+}
+
+
+static int
+record_miss(struct application *ap)
+{
+    struct ray_result *rr = (struct ray_result *)ap->a_uptr;
+
+    rr->hit = 0;
+    return 0;
+}
+
+
+static void
+add_tgc(struct rt_wdb *wdbp, const char *name, int i)
+{
+    struct rt_tgc_internal tgc;
+
+    tgc.magic = RT_TGC_INTERNAL_MAGIC;
+    VSET(tgc.v, i * 40.0, 0, -20.0 - 5.0 * i);
+    VSET(tgc.h, 3.0 * i, 0, 40.0 + 10.0 * i);
+    VSET(tgc.a, 10.0 + 2.0 * i, 0, 0);
+    VSET(tgc.b, 0, 6.0 + i, 0);
+    /* odd ones have unequal eccentricities, so take the quartic path */
+    VSCALE(tgc.c, tgc.a, 0.5);
+    VSCALE(tgc.d, tgc.b, (i & 1) ? 0.6 : 0.5);
+
+    if (wdb_export(wdbp, name, (void *)&tgc, ID_TGC, 1.0) < 0)
+	bu_exit(1, "ERROR: unable to write %s\n", name);
+}
+
+
+int
+main(int UNUSED(argc), char *argv[])
+{
+    struct application aps[NRAYS];
+    struct application ap;
+    struct ray_result shot[NRAYS], vshot[NRAYS];
+    const char *names[NTGC] = {"tgc.0", "tgc.1", "tgc.2", "tgc.3"};
+    struct db_i *dbip;
+    struct rt_wdb *wdbp;
+    struct rt_i *rtip;
+    int nhit = 0;
+    int i;
+    int ret = 0;
+
+    bu_setprogname(argv[0]);
+
+    dbip = db_open_inmem();
+    if (dbip == DBI_NULL)
+	bu_exit(1, "ERROR: unable to create an in-memory database\n");
+    wdbp = wdb_dbopen(dbip, RT_WDB_TYPE_DB_INMEM);
+    for (i = 0; i < NTGC; i++)
+	add_tgc(wdbp, names[i], i);
+
+    rtip = rt_new_rti(dbip);
+    if (rt_gettrees(rtip, NTGC, names, 1) < 0)
+	bu_exit(1, "ERROR: rt_gettrees failed\n");
+    rt_prep(rtip);
+
+    /* a fan from one eye point across the row of cones */
+    for (i = 0; i < NRAYS; i++) {
+	RT_APPLICATION_INIT(&aps[i]);
+	aps[i].a_rt_i = rtip;
+	aps[i].a_resource = &rt_uniresource;
+	aps[i].a_hit = record_hit;
+	aps[i].a_miss = record_miss;
+	aps[i].a_onehit = 0;
+	VSET(aps[i].a_ray.r_pt, 60.0, -200.0, 7.0);
+	VSET(aps[i].a_ray.r_dir, -80.0 + 280.0 * i / (NRAYS - 1), 200.0, -15.0 + 30.0 * (i % 7) / 6.0);
+	VUNITIZE(aps[i].a_ray.r_dir);
+
+	ap = aps[i];
+	ap.a_uptr = (void *)&shot[i];
+	(void)rt_shootray(&ap);
+
+	aps[i].a_uptr = (void *)&vshot[i];
+    }
+    (void)rt_vshootray(aps, NRAYS);
+
+    for (i = 0; i < NRAYS; i++) {
+	if (shot[i].hit != vshot[i].hit) {
+	    bu_log("ray %d: rt_shootray %s, rt_vshootray %s\n", i,
+		   shot[i].hit ? "hit" : "missed", vshot[i].hit ? "hit" : "missed");
+	    ret = 1;
+	    continue;
+	}
+	if (!shot[i].hit)
+	    continue;
+	nhit++;
+	if (!NEAR_EQUAL(shot[i].in, vshot[i].in, DIST_TOL)
+	    || !NEAR_EQUAL(shot[i].out, vshot[i].out, DIST_TOL)) {
+	    bu_log("ray %d: rt_shootray %g to %g, rt_vshootray %g to %g\n", i,
+		   shot[i].in, shot[i].out, vshot[i].in, vshot[i].out);
+	    ret = 1;
+	}
+    }
+    if (nhit < NRAYS / 4) {
+	bu_log("only %d of %d rays hit, the fan no longer covers the cones\n", nhit, NRAYS);
+	ret = 1;
+    }
+
+    rt_free_rti(rtip);
+    wdb_close(wdbp);
+
+    return ret;
+}
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * mode: C
+ * indent-tabs-mode: t
+ * c-file-style: "stroustrup"
+ * End:
+ * ex: shiftwidth=4 tabstop=8
+ */
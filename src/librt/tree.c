@@ -33,6 +33,14 @@
 #include "raytrace.h"
 
 #include "./cache.h"
+#include "./librt_private.h"
+
+
+/* regions handed to a thread at a time by tree_region_parallel() */
+#define TREE_REGION_BATCH 16
+
+/* below this many regions, tree_region_parallel() stays serial */
+#define TREE_REGION_PARALLEL_MIN 256
 
 
 #define ACQUIRE_SEMAPHORE_TREE(_hash) switch ((_hash)&03) {	\
@@ -705,17 +713,144 @@ _rt_tree_kill_dead_solid_refs(union tree *tp)
 }
 
 
+struct tree_region_state {
+    struct region **regions;
+    size_t nregions;
+    size_t next;		/* semaphored */
+    void (*func)(struct region *, struct resource *, void *);
+    void *data;
+};
+
+
+static void
+_tree_region_worker(int UNUSED(cpu), void *arg)
+{
+    struct tree_region_state *trs = (struct tree_region_state *)arg;
+    /* private scratch space, region trees only need the boolstack */
+    struct resource res = RT_RESOURCE_INIT_ZERO;
+    size_t start, end, i;
+
+    while (1) {
+	bu_semaphore_acquire(RT_SEM_WORKER);
+	start = trs->next;
+	trs->next += TREE_REGION_BATCH;
+	bu_semaphore_release(RT_SEM_WORKER);
+
+	if (start >= trs->nregions)
+	    break;
+
+	end = start + TREE_REGION_BATCH;
+	if (end > trs->nregions)
+	    end = trs->nregions;
+	for (i = start; i < end; i++)
+	    trs->func(trs->regions[i], &res, trs->data);
+    }
+
+    if (res.re_boolstack)
+	bu_free((void *)res.re_boolstack, "boolstack");
+}
+
+
+void
+tree_region_parallel(struct rt_i *rtip, struct region *first, int ncpu, struct resource *resp, void (*func)(struct region *, struct resource *, void *), void *data)
+{
+    struct tree_region_state trs;
+    struct region *regp;
+    size_t i = 0;
+
+    RT_CK_RTI(rtip);
+    RT_CK_RESOURCE(resp);
+
+    if (!first)
+	first = BU_LIST_FIRST(region, &rtip->HeadRegion);
+
+    trs.nregions = 0;
+    for (regp = first; BU_LIST_NOT_HEAD(regp, &rtip->HeadRegion); regp = BU_LIST_PNEXT(region, regp))
+	trs.nregions++;
+
+    if (ncpu <= 1 || trs.nregions < TREE_REGION_PARALLEL_MIN) {
+	for (regp = first; BU_LIST_NOT_HEAD(regp, &rtip->HeadRegion); regp = BU_LIST_PNEXT(region, regp))
+	    func(regp, resp, data);
+	return;
+    }
+
+    trs.regions = (struct region **)bu_calloc(trs.nregions, sizeof(struct region *), "regions");
+    for (regp = first; BU_LIST_NOT_HEAD(regp, &rtip->HeadRegion); regp = BU_LIST_PNEXT(region, regp))
+	trs.regions[i++] = regp;
+    trs.next = 0;
+    trs.func = func;
+    trs.data = data;
+
+    bu_parallel(_tree_region_worker, (size_t)ncpu, &trs);
+
+    bu_free(trs.regions, "regions");
+}
+
+
+/* Eliminate references to "dead" solids in one region's tree */
+static void
+_rt_gettree_region_kill_dead(struct region *regp, struct resource *resp, void *UNUSED(data))
+{
+    RT_CK_REGION(regp);
+
+    /* DEBUG:  Ensure that all region trees are valid */
+    db_ck_tree(regp->reg_treetop);
+
+    _rt_tree_kill_dead_solid_refs(regp->reg_treetop);
+    (void)rt_tree_elim_nops(regp->reg_treetop, resp);
+}
+
+
+/* Finishing touches on one region's tree, which needed soltab structs
+ * that the db_walk_tree() pass couldn't look at yet.
+ */
+static void
+_rt_gettree_region_finish(struct region *regp, struct resource *UNUSED(resp), void *data)
+{
+    struct rt_i *rtip = (struct rt_i *)data;
+    point_t region_min, region_max;
+
+    RT_CK_REGION(regp);
+
+    /* The region and the entire tree are cross-referenced */
+    _rt_tree_region_assign(regp->reg_treetop, regp);
+
+    /*
+     * Find region RPP, and update the model maxima and
+     * minima.
+     *
+     * Don't update min & max for halfspaces; instead, add
+     * them to the list of infinite solids, for special
+     * handling.
+     */
+    if (rt_bound_tree(regp->reg_treetop, region_min, region_max) < 0) {
+	bu_log("rt_gettrees() %s\n", regp->reg_name);
+	bu_bomb("rt_gettrees(): rt_bound_tree() fail\n");
+    }
+    if (region_max[X] < INFINITY) {
+	/* infinite regions are exempted from this */
+	bu_semaphore_acquire(RT_SEM_RESULTS);
+	VMINMAX(rtip->mdl_min, rtip->mdl_max, region_min);
+	VMINMAX(rtip->mdl_min, rtip->mdl_max, region_max);
+	bu_semaphore_release(RT_SEM_RESULTS);
+    }
+
+    /* DEBUG:  Ensure that all region trees are valid */
+    db_ck_tree(regp->reg_treetop);
+}
+
+
 int
 rt_gettrees_and_attrs(struct rt_i *rtip, const char **attrs, int argc, const char **argv, int ncpus)
 {
     struct soltab *stp;
-    struct region *regp;
     struct bu_hash_tbl *tbl;
+    struct region *first_new = NULL;
+    struct bu_ptbl dead_solids = BU_PTBL_INIT_ZERO;
 
     size_t prev_sol_count;
     int ret = 0;
     int num_attrs=0;
-    point_t region_min, region_max;
 
     RT_CHECK_RTI(rtip);
     RT_CK_DBI(rtip->rti_dbip);
@@ -733,6 +868,14 @@ rt_gettrees_and_attrs(struct rt_i *rtip, const char **attrs, int argc, const cha
 
     prev_sol_count = rtip->nsolids;
 
+    /* When rt_reprep() is adding to an already prepped model, the new
+     * regions land after the current tail of HeadRegion and the new
+     * solids are collected in rti_new_solids.  Only those need the
+     * finishing passes below.
+     */
+    if (rtip->rti_add_to_new_solids_list && BU_LIST_NON_EMPTY(&rtip->HeadRegion))
+	first_new = BU_LIST_LAST(region, &rtip->HeadRegion);
+
     {
 	struct gettree_data data;
 	struct db_tree_state tree_state;
@@ -813,86 +956,99 @@ rt_gettrees_and_attrs(struct rt_i *rtip, const char **attrs, int argc, const cha
 	}
     }
 
-    /* DEBUG:  Ensure that all region trees are valid */
-    for (BU_LIST_FOR(regp, region, &(rtip->HeadRegion))) {
-	RT_CK_REGION(regp);
-	db_ck_tree(regp->reg_treetop);
-    }
-
     /*
      * Eliminate any "dead" solids that parallel code couldn't change.
      * First remove any references from the region tree, then remove
      * actual soltab structs from the soltab list.
      */
-    for (BU_LIST_FOR(regp, region, &(rtip->HeadRegion))) {
-	RT_CK_REGION(regp);
-	_rt_tree_kill_dead_solid_refs(regp->reg_treetop);
-	(void)rt_tree_elim_nops(regp->reg_treetop, &rt_uniresource);
-    }
-again:
-    RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
-	RT_CK_SOLTAB(stp);
-	if (stp->st_aradius <= 0) {
-	    bu_log("rt_gettrees() cleaning up dead solid '%s'\n",
-		   stp->st_dp->d_namep);
-	    rt_free_soltab(stp);
-	    /* Can't do rtip->nsolids--, that doubles as max bit number! */
-	    /* The macro makes it hard to regain place, punt */
-	    goto again;
-	}
-    } RT_VISIT_ALL_SOLTABS_END;
+    if (rtip->rti_add_to_new_solids_list) {
+	size_t i = BU_PTBL_LEN(&rtip->rti_new_solids);
 
-    /*
-     * Another pass, no restarting.  Assign "piecestate" indices
-     * for those solids which contain pieces.
-     */
-    RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
-	if (stp->st_npieces > 1) {
-	    /* all pieces must be within model bounding box for pieces
-	     * to work correctly.
-	     */
-	    VMINMAX(rtip->mdl_min, rtip->mdl_max, stp->st_min);
-	    VMINMAX(rtip->mdl_min, rtip->mdl_max, stp->st_max);
-	    stp->st_piecestate_num = rtip->rti_nsolids_with_pieces++;
+	/* Only solids from this walk can be dead.  Take them off
+	 * rti_new_solids, which rt_reprep() walks next, and hold a use
+	 * of each so that they outlive the region tree cleanup.
+	 */
+	bu_ptbl_init(&dead_solids, 8, "dead_solids");
+	while (i-- > 0) {
+	    stp = (struct soltab *)BU_PTBL_GET(&rtip->rti_new_solids, i);
+	    RT_CK_SOLTAB(stp);
+	    if (stp->st_aradius <= 0) {
+		bu_ptbl_rm(&rtip->rti_new_solids, (long *)stp);
+		bu_ptbl_ins(&dead_solids, (long *)stp);
+		stp->st_uses++;
+	    }
 	}
-	if (RT_G_DEBUG&RT_DEBUG_SOLIDS)
-	    rt_pr_soltab(stp);
-    } RT_VISIT_ALL_SOLTABS_END;
+    }
 
-    /* Handle finishing touches on the trees that needed soltab
-     * structs that the parallel code couldn't look at yet.
-     */
-    for (BU_LIST_FOR(regp, region, &(rtip->HeadRegion))) {
-	RT_CK_REGION(regp);
+    if (first_new)
+	first_new = BU_LIST_PNEXT(region, first_new);
+    tree_region_parallel(rtip, first_new, ncpus, &rt_uniresource, _rt_gettree_region_kill_dead, NULL);
 
-	/* The region and the entire tree are cross-referenced */
-	_rt_tree_region_assign(regp->reg_treetop, regp);
+    if (rtip->rti_add_to_new_solids_list) {
+	size_t i;
 
-	/*
-	 * Find region RPP, and update the model maxima and
-	 * minima.
-	 *
-	 * Don't update min & max for halfspaces; instead, add
-	 * them to the list of infinite solids, for special
-	 * handling.
+	/* Drop every remaining use, as the full walk below does by
+	 * restarting, so that none is left on the solid lists.
 	 */
-	if (rt_bound_tree(regp->reg_treetop, region_min, region_max) < 0) {
-	    bu_log("rt_gettrees() %s\n", regp->reg_name);
-	    bu_bomb("rt_gettrees(): rt_bound_tree() fail\n");
+	for (i = 0; i < BU_PTBL_LEN(&dead_solids); i++) {
+	    long uses;
+
+	    stp = (struct soltab *)BU_PTBL_GET(&dead_solids, i);
+	    RT_CK_SOLTAB(stp);
+	    bu_log("rt_gettrees() cleaning up dead solid '%s'\n",
+		   stp->st_dp->d_namep);
+	    for (uses = stp->st_uses; uses > 0; uses--)
+		rt_free_soltab(stp);
 	}
-	if (region_max[X] < INFINITY) {
-	    /* infinite regions are exempted from this */
-	    VMINMAX(rtip->mdl_min, rtip->mdl_max, region_min);
-	    VMINMAX(rtip->mdl_min, rtip->mdl_max, region_max);
+	bu_ptbl_free(&dead_solids);
+
+	for (i = 0; i < BU_PTBL_LEN(&rtip->rti_new_solids); i++) {
+	    stp = (struct soltab *)BU_PTBL_GET(&rtip->rti_new_solids, i);
+	    if (stp->st_npieces > 1) {
+		VMINMAX(rtip->mdl_min, rtip->mdl_max, stp->st_min);
+		VMINMAX(rtip->mdl_min, rtip->mdl_max, stp->st_max);
+		stp->st_piecestate_num = rtip->rti_nsolids_with_pieces++;
+	    }
+	    if (RT_G_DEBUG&RT_DEBUG_SOLIDS)
+		rt_pr_soltab(stp);
 	}
-    }
+    } else {
+again:
+	RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
+	    RT_CK_SOLTAB(stp);
+	    if (stp->st_aradius <= 0) {
+		bu_log("rt_gettrees() cleaning up dead solid '%s'\n",
+		       stp->st_dp->d_namep);
+		rt_free_soltab(stp);
+		/* Can't do rtip->nsolids--, that doubles as max bit number! */
+		/* The macro makes it hard to regain place, punt */
+		goto again;
+	    }
+	} RT_VISIT_ALL_SOLTABS_END;
 
-    /* DEBUG:  Ensure that all region trees are valid */
-    for (BU_LIST_FOR(regp, region, &(rtip->HeadRegion))) {
-	RT_CK_REGION(regp);
-	db_ck_tree(regp->reg_treetop);
+	/*
+	 * Another pass, no restarting.  Assign "piecestate" indices
+	 * for those solids which contain pieces.
+	 */
+	RT_VISIT_ALL_SOLTABS_START(stp, rtip) {
+	    if (stp->st_npieces > 1) {
+		/* all pieces must be within model bounding box for pieces
+		 * to work correctly.
+		 */
+		VMINMAX(rtip->mdl_min, rtip->mdl_max, stp->st_min);
+		VMINMAX(rtip->mdl_min, rtip->mdl_max, stp->st_max);
+		stp->st_piecestate_num = rtip->rti_nsolids_with_pieces++;
+	    }
+	    if (RT_G_DEBUG&RT_DEBUG_SOLIDS)
+		rt_pr_soltab(stp);
+	} RT_VISIT_ALL_SOLTABS_END;
     }
 
+    /* Handle finishing touches on the trees that needed soltab
+     * structs that the parallel code couldn't look at yet.
+     */
+    tree_region_parallel(rtip, first_new, ncpus, &rt_uniresource, _rt_gettree_region_finish, (void *)rtip);
+
     if (ret < 0)
 	return ret;
 
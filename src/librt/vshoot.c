@@ -24,354 +24,566 @@
  * EXPERIMENTAL vector version of the Ray Tracing program shot
  * coordinator.
  *
+ * A packet of coherent rays walks the space partition together,
+ * gathering the union of the solids any of them may hit.  All of the
+ * ray/solid pairs for one solid type are then intersected together,
+ * with a single ft_vshot() call where that routine has been checked
+ * against ft_shot(), and each ray is woven and evaluated separately,
+ * exactly as in rt_shootray().
+ *
  */
 
 #include "common.h"
 
-#include <stdio.h>
+#include <string.h>
 #include <math.h>
+
 #include "vmath.h"
+#include "bu/bitv.h"
+#include "bu/log.h"
+#include "bu/malloc.h"
+#include "bu/ptbl.h"
 #include "raytrace.h"
+#include "./librt_private.h"
+
+
+#define BACKING_DIST (-2.0)		/* mm to look behind start point */
+
+/**
+ * Largest number of rays carried through the space partition as one
+ * packet.  The set of rays still active in a subtree is kept in a
+ * 64-bit mask, so this may not exceed 64.  Bigger requests are split.
+ */
+#define VSHOOT_MAX_RAYS 64
+
+/**
+ * Number of ray/solid pairs handed to one ft_vshot() call.
+ */
+#define VSHOOT_BATCH 512
+
+
+struct vshoot_ray {
+    struct application *ap;
+    vect_t inv_dir;			/* inverses of ap->a_ray.r_dir */
+    struct seg waiting_segs;		/* awaiting rt_boolweave() */
+    struct seg finished_segs;		/* processed by rt_boolweave() */
+    struct partition InitialPart;	/* Head of Initial Partitions */
+    struct partition FinalPart;		/* Head of Final Partitions */
+};
 
 
 /**
- * Stub function which will "simulate" a call to a vector shot routine
+ * Scratch space for one packet.  These are kept on the
+ * re_vshot_packets freelist of the resource structure rather than
+ * being allocated per call.  A packet is off the freelist for as long
+ * as it is in use, so a_hit() and a_miss() routines may recursively
+ * call rt_vshootray() with the same resource.
  */
+struct vshoot_packet {
+    struct bu_list l;
+    struct vshoot_ray ray[VSHOOT_MAX_RAYS];
+    /* ft_vshot() arguments, one entry per ray/solid pair */
+    struct soltab *ary_stp[VSHOOT_BATCH];
+    struct xray *ary_rp[VSHOOT_BATCH];
+    struct seg ary_seg[VSHOOT_BATCH];
+    struct xray ary_ray[VSHOOT_BATCH];	/* ray clipped to the solid RPP */
+    int ary_idx[VSHOOT_BATCH];		/* index into ray[] */
+    /* solids found while walking the space partition */
+    struct soltab **cand;		/* [2*cand_max], 2nd half sorted by type */
+    size_t cand_max;
+};
+
+
+static struct vshoot_packet *
+vshoot_get_packet(struct resource *resp, size_t nsolids)
+{
+    struct vshoot_packet *pk;
+
+    if (BU_LIST_IS_INITIALIZED(&resp->re_vshot_packets) && BU_LIST_NON_EMPTY(&resp->re_vshot_packets)) {
+	pk = BU_LIST_FIRST(vshoot_packet, &resp->re_vshot_packets);
+	BU_LIST_DEQUEUE(&pk->l);
+    } else {
+	BU_ALLOC(pk, struct vshoot_packet);
+    }
+
+    if (pk->cand_max < nsolids) {
+	if (pk->cand)
+	    bu_free(pk->cand, "vshoot candidates");
+	pk->cand_max = nsolids;
+	pk->cand = (struct soltab **)bu_malloc(2 * nsolids * sizeof(struct soltab *), "vshoot candidates");
+    }
+    return pk;
+}
+
+
 static void
-vshot_stub(struct soltab **stp, struct xray **rp, struct seg *segp, int n, struct application *ap)
-/* An array of solid pointers */
-/* An array of ray pointers */
-/* array of segs (results returned) */
-/* Number of ray/object pairs */
-/* pointer to an application */
+vshoot_put_packet(struct resource *resp, struct vshoot_packet *pk)
 {
-    register int i;
-    register struct seg *tmp_seg;
-    struct seg seghead;
-    int ret;
+    if (!BU_LIST_IS_INITIALIZED(&resp->re_vshot_packets))
+	BU_LIST_INIT(&resp->re_vshot_packets);
+    BU_LIST_APPEND(&resp->re_vshot_packets, &pk->l);
+}
 
-    BU_LIST_INIT(&(seghead.l));
 
-    /* go through each ray/solid pair and call a scalar function */
-    for (i = 0; i < n; i++) {
-	if (stp[i] != 0) {
-	    /* skip call if solid table pointer is NULL */
-	    /* do scalar call, place results in segp array */
-	    ret = -1;
-	    if (OBJ[stp[i]->st_id].ft_shot) {
-		ret = OBJ[stp[i]->st_id].ft_shot(stp[i], rp[i], ap, &seghead);
-	    }
-	    if (ret <= 0) {
-		segp[i].seg_stp=(struct soltab *) 0;
-	    } else {
-		tmp_seg = BU_LIST_FIRST(seg, &(seghead.l));
-		BU_LIST_DEQUEUE(&(tmp_seg->l));
-		segp[i] = *tmp_seg; /* structure copy */
-		RT_FREE_SEG(tmp_seg, ap->a_resource);
+void
+vshoot_clean_resource(struct resource *resp)
+{
+    struct vshoot_packet *pk;
+
+    if (!BU_LIST_IS_INITIALIZED(&resp->re_vshot_packets))
+	return;
+
+    while (BU_LIST_WHILE(pk, vshoot_packet, &resp->re_vshot_packets)) {
+	BU_LIST_DEQUEUE(&pk->l);
+	if (pk->cand)
+	    bu_free(pk->cand, "vshoot candidates");
+	bu_free(pk, "struct vshoot_packet");
+    }
+    resp->re_vshot_packets.forw = BU_LIST_NULL;
+}
+
+
+/**
+ * Return the subset of the rays in mask that pass through the given
+ * box somewhere in front of BACKING_DIST.
+ */
+static uint64_t
+vshoot_box_mask(const struct vshoot_packet *pk, int nrays, uint64_t mask, const fastf_t *min, const fastf_t *max)
+{
+    int i;
+
+    for (i = 0; i < nrays; i++) {
+	struct xray ray;
+
+	if (!(mask & ((uint64_t)1 << i)))
+	    continue;
+
+	ray = pk->ray[i].ap->a_ray;	/* struct copy, rt_in_rpp() writes r_min/r_max */
+	if (!rt_in_rpp(&ray, pk->ray[i].inv_dir, min, max) || ray.r_max < BACKING_DIST)
+	    mask &= ~((uint64_t)1 << i);
+    }
+    return mask;
+}
+
+
+static void
+vshoot_add_solid(struct vshoot_packet *pk, size_t *ncand, struct bu_bitv *solidbits, struct soltab *stp)
+{
+    if (BU_BITTEST(solidbits, stp->st_bit))
+	return;
+    BU_BITSET(solidbits, stp->st_bit);
+    pk->cand[(*ncand)++] = stp;
+}
+
+
+/**
+ * Collect the solids of every NUBSP cell that at least one ray of the
+ * packet passes through.  min/max are the bounds of cutp.
+ */
+static void
+vshoot_walk_cut(struct vshoot_packet *pk, int nrays, uint64_t mask, const union cutter *cutp, const fastf_t *min, const fastf_t *max, struct bu_bitv *solidbits, size_t *ncand)
+{
+    size_t i;
+
+    switch (cutp->cut_type) {
+	case CUT_CUTNODE: {
+	    vect_t lmax, rmin;
+	    uint64_t submask;
+
+	    VMOVE(lmax, max);
+	    lmax[cutp->cn.cn_axis] = cutp->cn.cn_point;
+	    submask = vshoot_box_mask(pk, nrays, mask, min, lmax);
+	    if (submask)
+		vshoot_walk_cut(pk, nrays, submask, cutp->cn.cn_l, min, lmax, solidbits, ncand);
+
+	    VMOVE(rmin, min);
+	    rmin[cutp->cn.cn_axis] = cutp->cn.cn_point;
+	    submask = vshoot_box_mask(pk, nrays, mask, rmin, max);
+	    if (submask)
+		vshoot_walk_cut(pk, nrays, submask, cutp->cn.cn_r, rmin, max, solidbits, ncand);
+	    break;
+	}
+	case CUT_BOXNODE:
+	    if (!vshoot_box_mask(pk, nrays, mask, cutp->bn.bn_min, cutp->bn.bn_max))
+		break;
+	    for (i = 0; i < cutp->bn.bn_len; i++)
+		vshoot_add_solid(pk, ncand, solidbits, cutp->bn.bn_list[i]);
+	    /* solids with pieces are shot whole */
+	    for (i = 0; i < cutp->bn.bn_piecelen; i++)
+		vshoot_add_solid(pk, ncand, solidbits, cutp->bn.bn_piecelist[i].stp);
+	    break;
+	default:
+	    bu_log("vshoot_walk_cut: cut_type=%d unknown\n", cutp->cut_type);
+	    bu_bomb("vshoot_walk_cut: unknown cut_type\n");
+    }
+}
+
+
+/**
+ * Collect the solids of every RT_PART_HLBVH leaf that at least one
+ * ray of the packet passes through.
+ */
+static void
+vshoot_walk_bvh(struct vshoot_packet *pk, int nrays, uint64_t mask, const struct rt_i *rtip, struct bu_bitv *solidbits, size_t *ncand)
+{
+    long todo[BVH_STACK_SIZE];
+    uint64_t todo_mask[BVH_STACK_SIZE];
+    int todo_offset = 0;
+    long current = 0;
+    long i;
+
+    if (rtip->rti_bvh_nnodes <= 0)
+	return;
+
+    while (1) {
+	const struct bvh_flat_node *node = &rtip->rti_bvh_nodes[current];
+
+	mask = vshoot_box_mask(pk, nrays, mask, &node->bounds[0], &node->bounds[3]);
+	if (mask) {
+	    if (node->n_primitives == 0) {
+		todo[todo_offset] = node->u.second_child_offset;
+		todo_mask[todo_offset++] = mask;
+		current++;
+		continue;
 	    }
+	    for (i = 0; i < node->n_primitives; i++)
+		vshoot_add_solid(pk, ncand, solidbits, rtip->rti_bvh_prims[node->u.primitives_offset + i]);
 	}
+	if (todo_offset == 0)
+	    break;
+	current = todo[--todo_offset];
+	mask = todo_mask[todo_offset];
     }
 }
 
 
 /**
- * Given a ray, shoot it at all the relevant parts of the model,
- * (building the HeadSeg chain), and then call rt_boolregions() to
- * build and evaluate the partition chain.  If the ray actually hit
- * anything, call the application's a_hit() routine with a pointer to
- * the partition chain, otherwise, call the application's a_miss()
- * routine.
- *
- * It is important to note that rays extend infinitely only in the
- * positive direction.  The ray is composed of all points P, where
- *
- * P = r_pt + K * r_dir
- *
- * for K ranging from 0 to +infinity.  There is no looking backwards.
- *
- * It is also important to note that the direction vector r_dir must
- * have unit length; this is mandatory, and is not ordinarily checked,
- * in the name of efficiency.
- *
- * Input:  Pointer to an application structure, with these mandatory fields:
- * a_ray.r_pt Starting point of ray to be fired
- * a_ray.r_dir UNIT VECTOR with direction to fire in (dir cosines)
- * a_hit Routine to call when something is hit
- * a_miss Routine to call when ray misses everything
- *
- * Calls user's a_miss() or a_hit() routine as appropriate.  Passes
- * a_hit() routine list of partitions, with only hit_dist fields
- * valid.  Normal computation deferred to user code, to avoid needless
- * computation here.
- *
- * Returns: whatever the application function returns (an int).
+ * Intersect the first n ray/solid pairs queued in pk, all of which
+ * are for solids of type id, and move the resulting segments onto the
+ * waiting_segs list of each pair's ray.
  *
- * NOTE: The application functions may call rt_shootray() recursively.
- * Thus, none of the local variables may be static.
- *
- * An open issue for execution in a PARALLEL environment is locking of
- * the statistics variables.
+ * Only types whose ft_vshot() is checked against ft_shot() by
+ * tests/vshoot.c are batched; the rest, whose vector routines have
+ * gone untested for years, go through ft_shot() one pair at a time.
+ * Add a type here only together with its case in that test.
  */
-int
-rt_vshootray(struct application *ap)
+static void
+vshoot_flush(struct vshoot_packet *pk, int n, int id, struct resource *resp)
 {
-    struct seg *HeadSeg;
-    int ret;
-    vect_t inv_dir;	/* inverses of ap->a_ray.r_dir */
-    struct bu_bitv *solidbits;	/* bits for all solids shot so far */
-    struct bu_ptbl *regionbits;	/* bits for all involved regions */
-    char *status;
-    struct partition InitialPart;	/* Head of Initial Partitions */
-    struct partition FinalPart;	/* Head of Final Partitions */
-    int nrays = 1;			/* for now */
-    int vlen;
-    int id;
     int i;
-    struct soltab **ary_stp;	/* array of pointers */
-    struct xray **ary_rp;	/* array of pointers */
-    struct seg *ary_seg;	/* array of structures */
-    struct rt_i *rtip;
-    int done;
 
-#define BACKING_DIST (-2.0)		/* mm to look behind start point */
-    rtip = ap->a_rt_i;
-    RT_AP_CHECK(ap);
-    if (!ap->a_resource) {
-	ap->a_resource = &rt_uniresource;
-    }
-    RT_CK_RESOURCE(ap->a_resource);
-
-    if (RT_G_DEBUG&(RT_DEBUG_ALLRAYS|RT_DEBUG_SHOOT|RT_DEBUG_PARTITION)) {
-	bu_log("\n**********mshootray cpu=%d  %d, %d lvl=%d (%s)\n",
-	       ap->a_resource->re_cpu,
-	       ap->a_x, ap->a_y,
-	       ap->a_level,
-	       ap->a_purpose != (char *)0 ? ap->a_purpose : "?");
-	VPRINT("Pnt", ap->a_ray.r_pt);
-	VPRINT("Dir", ap->a_ray.r_dir);
-    }
+    resp->re_shots += n;
 
-    rtip->rti_nrays++;
-    if (rtip->needprep)
-	rt_prep(rtip);
+    if (OBJ[id].ft_vshot && id == ID_TGC) {
+	for (i = 0; i < n; i++)
+	    pk->ary_seg[i].seg_stp = SOLTAB_NULL;
 
-    /* Allocate dynamic memory */
-    vlen = nrays * rtip->rti_maxsol_by_type;
-    ary_stp = (struct soltab **)bu_calloc(vlen, sizeof(struct soltab *),
-					  "*ary_stp[]");
-    ary_rp = (struct xray **)bu_calloc(vlen, sizeof(struct xray *),
-				       "*ary_rp[]");
-    ary_seg = (struct seg *)bu_calloc(vlen, sizeof(struct seg),
-				      "ary_seg[]");
+	OBJ[id].ft_vshot(pk->ary_stp, pk->ary_rp, pk->ary_seg, n, pk->ray[0].ap);
 
-    /**** for each ray, do this ****/
+	for (i = 0; i < n; i++) {
+	    struct vshoot_ray *vr = &pk->ray[pk->ary_idx[i]];
+	    struct seg *s2;
 
-    InitialPart.pt_forw = InitialPart.pt_back = &InitialPart;
-    FinalPart.pt_forw = FinalPart.pt_back = &FinalPart;
+	    if (pk->ary_seg[i].seg_stp == SOLTAB_NULL) {
+		resp->re_shot_miss++;
+		continue;
+	    }
+	    RT_GET_SEG(s2, resp);
+	    s2->seg_stp = pk->ary_seg[i].seg_stp;
+	    s2->seg_in = pk->ary_seg[i].seg_in;		/* struct copy */
+	    s2->seg_out = pk->ary_seg[i].seg_out;	/* struct copy */
+	    s2->seg_in.hit_magic = s2->seg_out.hit_magic = RT_HIT_MAGIC;
+	    s2->seg_in.hit_rayp = s2->seg_out.hit_rayp = &vr->ap->a_ray;
+	    BU_LIST_INSERT(&(vr->waiting_segs.l), &(s2->l));
+	    resp->re_shot_hit++;
+	}
+	return;
+    }
 
-    HeadSeg = RT_SEG_NULL;
+    for (i = 0; i < n; i++) {
+	struct vshoot_ray *vr = &pk->ray[pk->ary_idx[i]];
+	struct soltab *stp = pk->ary_stp[i];
+	struct seg new_segs;
+	struct seg *s2;
+	int ret = -1;
+
+	BU_LIST_INIT(&(new_segs.l));
+	if (stp->st_meth->ft_shot)
+	    ret = stp->st_meth->ft_shot(stp, pk->ary_rp[i], vr->ap, &new_segs);
+	if (ret <= 0) {
+	    resp->re_shot_miss++;
+	    continue;
+	}
+	while (BU_LIST_WHILE(s2, seg, &(new_segs.l))) {
+	    BU_LIST_DEQUEUE(&(s2->l));
+	    s2->seg_in.hit_rayp = s2->seg_out.hit_rayp = &vr->ap->a_ray;
+	    BU_LIST_INSERT(&(vr->waiting_segs.l), &(s2->l));
+	}
+	resp->re_shot_hit++;
+    }
+}
 
-    solidbits = rt_get_solidbitv(rtip->nsolids, ap->a_resource);
 
-    if (BU_LIST_IS_EMPTY(&ap->a_resource->re_region_ptbl)) {
+/**
+ * Fire one packet of at most VSHOOT_MAX_RAYS rays.
+ */
+static int
+vshoot_packet(struct application *aps, int nrays)
+{
+    struct vshoot_packet *pk;
+    struct bu_bitv *solidbits;	/* all solids shot by any ray of the packet */
+    struct bu_ptbl *regionbits;	/* table of all involved regions */
+    struct resource *resp;
+    struct rt_i *rtip;
+    uint64_t mask = 0;
+    size_t count[ID_MAX_SOLID+2];
+    size_t ncand = 0;
+    size_t i;
+    int r;
+    int nhit = 0;
+
+    rtip = aps[0].a_rt_i;
+    resp = aps[0].a_resource;
+
+    pk = vshoot_get_packet(resp, rtip->nsolids);
+    solidbits = rt_get_solidbitv(rtip->nsolids, resp);
+
+    if (BU_LIST_IS_EMPTY(&resp->re_region_ptbl)) {
 	BU_ALLOC(regionbits, struct bu_ptbl);
-	bu_ptbl_init(regionbits, 7, "rt_shootray() regionbits ptbl");
+	bu_ptbl_init(regionbits, 7, "rt_vshootray() regionbits ptbl");
     } else {
-	regionbits = BU_LIST_FIRST(bu_ptbl, &ap->a_resource->re_region_ptbl);
+	regionbits = BU_LIST_FIRST(bu_ptbl, &resp->re_region_ptbl);
 	BU_LIST_DEQUEUE(&regionbits->l);
 	BU_CK_PTBL(regionbits);
     }
 
-    /* Compute the inverse of the direction cosines */
-    if (!ZERO(ap->a_ray.r_dir[X])) {
-	inv_dir[X]=1.0/ap->a_ray.r_dir[X];
-    } else {
-	inv_dir[X] = INFINITY;
-	ap->a_ray.r_dir[X] = 0.0;
-    }
-    if (!ZERO(ap->a_ray.r_dir[Y])) {
-	inv_dir[Y]=1.0/ap->a_ray.r_dir[Y];
-    } else {
-	inv_dir[Y] = INFINITY;
-	ap->a_ray.r_dir[Y] = 0.0;
-    }
-    if (!ZERO(ap->a_ray.r_dir[Z])) {
-	inv_dir[Z]=1.0/ap->a_ray.r_dir[Z];
-    } else {
-	inv_dir[Z] = INFINITY;
-	ap->a_ray.r_dir[Z] = 0.0;
-    }
+    /* Set up each ray */
+    for (r = 0; r < nrays; r++) {
+	struct vshoot_ray *vr = &pk->ray[r];
+	struct application *ap = &aps[r];
+	struct xray ray;
+
+	RT_AP_CHECK(ap);
+	if (ap->a_magic) {
+	    RT_CK_AP(ap);
+	} else {
+	    ap->a_magic = RT_AP_MAGIC;
+	}
+	if (ap->a_ray.magic) {
+	    RT_CK_RAY(&(ap->a_ray));
+	} else {
+	    ap->a_ray.magic = RT_RAY_MAGIC;
+	}
+	if (ap->a_rt_i != rtip || (ap->a_resource && ap->a_resource != resp))
+	    bu_bomb("rt_vshootray: all rays of a packet must share a_rt_i and a_resource\n");
+	ap->a_resource = resp;
+
+	vr->ap = ap;
+	vr->InitialPart.pt_forw = vr->InitialPart.pt_back = &vr->InitialPart;
+	vr->InitialPart.pt_magic = PT_HD_MAGIC;
+	vr->FinalPart.pt_forw = vr->FinalPart.pt_back = &vr->FinalPart;
+	vr->FinalPart.pt_magic = PT_HD_MAGIC;
+	BU_LIST_INIT(&vr->waiting_segs.l);
+	BU_LIST_INIT(&vr->finished_segs.l);
+	ap->a_Final_Part_hdp = &vr->FinalPart;
+	ap->a_finished_segs_hdp = &vr->finished_segs;
+
+	if (RT_G_DEBUG&(RT_DEBUG_ALLRAYS|RT_DEBUG_SHOOT|RT_DEBUG_PARTITION)) {
+	    bu_log("\n**********vshootray cpu=%d  %d, %d lvl=%d (%s)\n",
+		   resp->re_cpu,
+		   ap->a_x, ap->a_y,
+		   ap->a_level,
+		   ap->a_purpose != (char *)0 ? ap->a_purpose : "?");
+	    VPRINT("Pnt", ap->a_ray.r_pt);
+	    VPRINT("Dir", ap->a_ray.r_dir);
+	}
+	resp->re_nshootray++;
 
-    /*
-     * XXX handle infinite solids here, later.
-     */
-
-    /*
-     * If ray does not enter the model RPP, skip on.
-     * If ray ends exactly at the model RPP, trace it.
-     */
-    if (!rt_in_rpp(&ap->a_ray, inv_dir, rtip->mdl_min, rtip->mdl_max)  ||
-	ap->a_ray.r_max < 0.0) {
-	rtip->nmiss_model++;
-	if (ap->a_miss)
-	    ret = ap->a_miss(ap);
+	/* Compute the inverse of the direction cosines */
+	if (ap->a_ray.r_dir[X] < -SQRT_SMALL_FASTF || ap->a_ray.r_dir[X] > SQRT_SMALL_FASTF) {
+	    vr->inv_dir[X] = 1.0/ap->a_ray.r_dir[X];
+	} else {
+	    ap->a_ray.r_dir[X] = 0.0;
+	    vr->inv_dir[X] = INFINITY;
+	}
+	if (ap->a_ray.r_dir[Y] < -SQRT_SMALL_FASTF || ap->a_ray.r_dir[Y] > SQRT_SMALL_FASTF) {
+	    vr->inv_dir[Y] = 1.0/ap->a_ray.r_dir[Y];
+	} else {
+	    ap->a_ray.r_dir[Y] = 0.0;
+	    vr->inv_dir[Y] = INFINITY;
+	}
+	if (ap->a_ray.r_dir[Z] < -SQRT_SMALL_FASTF || ap->a_ray.r_dir[Z] > SQRT_SMALL_FASTF) {
+	    vr->inv_dir[Z] = 1.0/ap->a_ray.r_dir[Z];
+	} else {
+	    ap->a_ray.r_dir[Z] = 0.0;
+	    vr->inv_dir[Z] = INFINITY;
+	}
+	VMOVE(ap->a_inv_dir, vr->inv_dir);
+
+	/* Only rays entering the model RPP walk the space partition.
+	 * All of them are tried against the infinite solids.
+	 */
+	ray = ap->a_ray;
+	if (rt_in_rpp(&ray, vr->inv_dir, rtip->mdl_min, rtip->mdl_max) && ray.r_max >= 0.0)
+	    mask |= (uint64_t)1 << r;
 	else
-	    ret = 0;
-	status = "MISS model";
-	goto out;
+	    resp->re_nmiss_model++;
     }
 
-    /* For each type of solid to be shot at, assemble the vectors */
-    for (id = 1; id <= ID_MAX_SOLID; id++) {
-	register int nsol;
-
-	if ((nsol = rtip->rti_nsol_by_type[id]) <= 0) continue;
-
-	/* For each instance of this solid type */
-	for (i = nsol-1; i >= 0; i--) {
-	    ary_stp[i] = rtip->rti_sol_by_type[id][i];
-	    ary_rp[i] = &(ap->a_ray);	/* XXX, sb [ray] */
-	    ary_seg[i].seg_stp = SOLTAB_NULL;
-	    BU_LIST_INIT(&ary_seg[i].l);
+    /* Walk the space partition once for the whole packet */
+    if (mask) {
+	if (rtip->rti_space_partition == RT_PART_HLBVH)
+	    vshoot_walk_bvh(pk, nrays, mask, rtip, solidbits, &ncand);
+	else if (rtip->rti_CutHead.cut_type)
+	    vshoot_walk_cut(pk, nrays, mask, &rtip->rti_CutHead, rtip->mdl_min, rtip->mdl_max, solidbits, &ncand);
+    }
+    for (i = 0; i < rtip->rti_inf_box.bn.bn_len; i++)
+	vshoot_add_solid(pk, &ncand, solidbits, rtip->rti_inf_box.bn.bn_list[i]);
+
+    /* Group the candidates by solid type (counting sort) */
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < ncand; i++)
+	count[pk->cand[i]->st_id + 1]++;
+    for (i = 1; i <= ID_MAX_SOLID+1; i++)
+	count[i] += count[i-1];
+    for (i = 0; i < ncand; i++)
+	pk->cand[pk->cand_max + count[pk->cand[i]->st_id]++] = pk->cand[i];
+
+    /* Batch every ray/solid pair of each type */
+    for (i = 0; i < ncand;) {
+	struct soltab **sorted = &pk->cand[pk->cand_max];
+	int id = sorted[i]->st_id;
+	int n = 0;
+
+	for (; i < ncand && sorted[i]->st_id == id; i++) {
+	    struct soltab *stp = sorted[i];
+
+	    for (r = 0; r < nrays; r++) {
+		struct xray *rp = &pk->ary_ray[n];
+
+		*rp = pk->ray[r].ap->a_ray;	/* struct copy */
+
+		/* Check against bounding RPP, if desired by solid */
+		if (stp->st_meth->ft_use_rpp) {
+		    if (!rt_in_rpp(rp, pk->ray[r].inv_dir, stp->st_min, stp->st_max)
+			|| rp->r_max < BACKING_DIST) {
+			resp->re_prune_solrpp++;
+			continue;	/* MISS */
+		    }
+		}
+		pk->ary_stp[n] = stp;
+		pk->ary_rp[n] = rp;
+		pk->ary_idx[n] = r;
+		if (++n == VSHOOT_BATCH) {
+		    vshoot_flush(pk, n, id, resp);
+		    n = 0;
+		}
+	    }
 	}
-	/* bounding box check */
-	/* bit vector per ray check */
-	/* mark elements to be skipped with ary_stp[] = SOLTAB_NULL */
-	ap->a_rt_i->nshots += nsol;	/* later: skipped ones */
-	if (OBJ[id].ft_vshot) {
-	    OBJ[id].ft_vshot(ary_stp, ary_rp, ary_seg, nsol, ap);
-	} else {
-	    vshot_stub(ary_stp, ary_rp, ary_seg, nsol, ap);
+	if (n > 0)
+	    vshoot_flush(pk, n, id, resp);
+    }
+
+    /* Evaluate and report each ray in order */
+    for (r = 0; r < nrays; r++) {
+	struct vshoot_ray *vr = &pk->ray[r];
+	struct application *ap = vr->ap;
+	const char *status;
+
+	if (BU_LIST_NON_EMPTY(&(vr->waiting_segs.l)))
+	    rt_boolweave(&vr->finished_segs, &vr->waiting_segs, &vr->InitialPart, ap);
+
+	if (BU_LIST_IS_EMPTY(&(vr->finished_segs.l))) {
+	    if (ap->a_miss)
+		ap->a_return = ap->a_miss(ap);
+	    else
+		ap->a_return = 0;
+	    status = "MISS primitives";
+	    goto next;
 	}
 
+	(void)rt_boolfinal(&vr->InitialPart, &vr->FinalPart, BACKING_DIST,
+			   INFINITY, regionbits, ap, solidbits);
+	RT_FREE_PT_LIST(&vr->InitialPart, resp);
+
+	if (vr->FinalPart.pt_forw == &vr->FinalPart) {
+	    if (ap->a_miss)
+		ap->a_return = ap->a_miss(ap);
+	    else
+		ap->a_return = 0;
+	    status = "MISS bool";
+	    RT_FREE_SEG_LIST(&vr->finished_segs, resp);
+	    goto next;
+	}
 
-	/* set bits for all solids shot at for each ray */
+	if (RT_G_DEBUG&RT_DEBUG_SHOOT) rt_pr_partitions(rtip, &vr->FinalPart, "a_hit()");
 
-	/* append resulting seg list to input for boolweave */
-	for (i = nsol-1; i >= 0; i--) {
-	    register struct seg *seg2;
+	if (ap->a_hit) {
+	    ap->a_return = ap->a_hit(ap, &vr->FinalPart, &vr->finished_segs);
+	    status = "HIT";
+	    nhit++;
+	} else {
+	    ap->a_return = 0;
+	    status = "MISS (unexpected)";
+	}
 
-	    if (ary_seg[i].seg_stp == SOLTAB_NULL) {
-		/* MISS */
-		ap->a_rt_i->nmiss++;
-		continue;
-	    }
-	    ap->a_rt_i->nhits++;
-
-	    /* For now, do it the slow way.  sb [ray] */
-	    /* MUST dup it -- all segs have to live till after a_hit() */
-	    RT_GET_SEG(seg2, ap->a_resource);
-	    *seg2 = ary_seg[i];	/* struct copy */
-	    /* rt_boolweave(seg2, &InitialPart, ap); */
-	    bu_bomb("FIXME: need to call boolweave here");
-
-	    /* Add seg chain to list of used segs awaiting reclaim */
-
-#if 0
-	    /* FIXME: need to use waiting_segs/finished_segs here in
-	     * conjunction with rt_boolweave()
-	     {
-	     register struct seg *seg3 = seg2;
-	     while (seg3->seg_next != RT_SEG_NULL)
-	     seg3 = seg3->seg_next;
-	     seg3->seg_next = HeadSeg;
-	     HeadSeg = seg2;
-	     }
-	    */
-#endif
+	RT_FREE_SEG_LIST(&vr->finished_segs, resp);
+	RT_FREE_PT_LIST(&vr->FinalPart, resp);
+
+    next:
+	if (RT_G_DEBUG&(RT_DEBUG_ALLRAYS|RT_DEBUG_SHOOT|RT_DEBUG_PARTITION)) {
+	    bu_log("----------vshootray cpu=%d  %d, %d lvl=%d (%s) %s ret=%d\n",
+		   resp->re_cpu,
+		   ap->a_x, ap->a_y,
+		   ap->a_level,
+		   ap->a_purpose != (char *)0 ? ap->a_purpose : "?",
+		   status, ap->a_return);
 	}
     }
 
-    /*
-     * Ray has finally left known space.
-     */
-    if (InitialPart.pt_forw == &InitialPart) {
-	if (ap->a_miss)
-	    ret = ap->a_miss(ap);
-	else
-	    ret = 0;
-	status = "MISSed all primitives";
-	goto freeup;
-    }
+    /* Return dynamic resources to their freelists */
+    BU_CK_BITV(solidbits);
+    BU_LIST_APPEND(&resp->re_solid_bitv, &solidbits->l);
+    BU_CK_PTBL(regionbits);
+    BU_LIST_APPEND(&resp->re_region_ptbl, &regionbits->l);
+    vshoot_put_packet(resp, pk);
 
-    /*
-     * All intersections of the ray with the model have been computed.
-     * Evaluate the boolean trees over each partition.
-     */
-    done = rt_boolfinal(&InitialPart, &FinalPart, BACKING_DIST, INFINITY, regionbits, ap, solidbits);
+    return nhit;
+}
 
-    if (done > 0) goto hitit;
 
-    if (FinalPart.pt_forw == &FinalPart) {
-	if (ap->a_miss)
-	    ret = ap->a_miss(ap);
-	else
-	    ret = 0;
-	status = "MISS bool";
-	goto freeup;
-    }
+int
+rt_vshootray(struct application *aps, int nrays)
+{
+    struct resource *resp;
+    struct rt_i *rtip;
+    int nhit = 0;
+    int i;
 
-    /*
-     * Ray/model intersections exist.  Pass the list to the user's
-     * a_hit() routine.  Note that only the hit_dist elements of
-     * pt_inhit and pt_outhit have been computed yet.  To compute both
-     * hit_point and hit_normal, use the
-     *
-     * RT_HIT_NORMAL(NULL, hitp, stp, rayp, 0);
-     *
-     * macro.  To compute just hit_point, use
-     *
-     * VJOIN1(hitp->hit_point, rp->r_pt, hitp->hit_dist, rp->r_dir);
-     */
-hitit:
-    if (RT_G_DEBUG&RT_DEBUG_SHOOT) rt_pr_partitions(rtip, &FinalPart, "a_hit()");
-
-    if (ap->a_hit)
-	ret = ap->a_hit(ap, &FinalPart, HeadSeg/* &finished_segs */);
-    else
-	ret = 0;
-    status = "HIT";
-
-    /*
-     * Processing of this ray is complete.  Free dynamic resources.
-     */
-freeup:
-    {
-	register struct partition *pp;
-
-	/* Free up initial partition list */
-	for (pp = InitialPart.pt_forw; pp != &InitialPart;) {
-	    register struct partition *newpp;
-	    newpp = pp;
-	    pp = pp->pt_forw;
-	    FREE_PT(newpp, ap->a_resource);
-	}
-	/* Free up final partition list */
-	for (pp = FinalPart.pt_forw; pp != &FinalPart;) {
-	    register struct partition *newpp;
-	    newpp = pp;
-	    pp = pp->pt_forw;
-	    FREE_PT(newpp, ap->a_resource);
-	}
-    }
+    if (nrays <= 0)
+	return 0;
 
-out:
-    bu_free((char *)ary_stp, "*ary_stp[]");
-    bu_free((char *)ary_rp, "*ary_rp[]");
-    bu_free((char *)ary_seg, "ary_seg[]");
+    RT_AP_CHECK(&aps[0]);
+    rtip = aps[0].a_rt_i;
+    RT_CK_RTI(rtip);
 
-    if (solidbits != NULL) {
-	bu_bitv_free(solidbits);
+    if (aps[0].a_resource == RESOURCE_NULL) {
+	aps[0].a_resource = &rt_uniresource;
+	if (rt_uniresource.re_magic == 0)
+	    rt_init_resource(&rt_uniresource, 0, rtip);
     }
-    if (RT_G_DEBUG&(RT_DEBUG_ALLRAYS|RT_DEBUG_SHOOT|RT_DEBUG_PARTITION)) {
-	bu_log("----------mshootray cpu=%d  %d, %d lvl=%d (%s) %s ret=%d\n",
-	       ap->a_resource->re_cpu,
-	       ap->a_x, ap->a_y,
-	       ap->a_level,
-	       ap->a_purpose != (char *)0 ? ap->a_purpose : "?",
-	       status, ret);
+    resp = aps[0].a_resource;
+    RT_CK_RESOURCE(resp);
+
+    if (rtip->needprep)
+	rt_prep_parallel(rtip, 1);	/* Stay on our CPU */
+
+    for (i = 0; i < nrays; i += VSHOOT_MAX_RAYS) {
+	if (!aps[i].a_resource)
+	    aps[i].a_resource = resp;
+	nhit += vshoot_packet(&aps[i], (nrays - i < VSHOOT_MAX_RAYS) ? nrays - i : VSHOOT_MAX_RAYS);
     }
-    return ret;
+    return nhit;
 }
 
 
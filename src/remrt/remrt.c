@@ -46,6 +46,9 @@
 #ifdef HAVE_SYS_TIME_H
 #  include <sys/time.h>		/* sometimes includes <time.h> */
 #endif
+#ifdef HAVE_POLL_H
+#  include <poll.h>
+#endif
 #include "bio.h"
 #include "bresource.h"
 #include "bsocket.h"
@@ -66,12 +69,6 @@ extern int fchmod(int fd, mode_t mode);
 extern int gettimeofday(struct timeval *, void *);
 #endif
 
-/* FIXME: is this basically FD_COPY()? */
-#ifndef FD_MOVE
-#  define FD_MOVE(a, b) { unsigned int _i; for (_i = 0; _i < FD_SETSIZE; _i++) \
-					       if (FD_ISSET(_i, b)) FD_SET(_i, a); else FD_CLR(_i, a); }
-#endif
-
 #include "bu/getopt.h"
 #include "bu/list.h"
 #include "vmath.h"
@@ -103,6 +100,9 @@ extern int gettimeofday(struct timeval *, void *);
 #define N_SERVER_ASSIGNMENTS	1		/* desired # of assignments */
 #define MIN_ASSIGNMENT_TIME	5		/* desired seconds/result */
 #define SERVER_CHECK_INTERVAL	(10*60)		/* seconds */
+#define DISPATCH_RATE		20		/* desired results/sec, all servers */
+#define SLICES_PER_SHARE	4		/* assignments per server per frame */
+#define LISTEN_BACKLOG		128		/* pending server connections */
 #ifndef RSH
 #  define RSH "/usr/ucb/rsh"
 #endif
@@ -146,7 +146,9 @@ extern int gettimeofday(struct timeval *, void *);
  * XXX should probably re-vamp send_matrix routine.
  */
 #define NFD 32
-#ifdef FD_SETSIZE
+#if defined(HAVE_POLL_H)
+#  define MAXSERVERS 4096	/* poll() has no descriptor limit of its own */
+#elif defined(FD_SETSIZE)
 #  define MAXSERVERS FD_SETSIZE
 #else
 #  define MAXSERVERS NFD		/* No relay function yet */
@@ -215,6 +217,7 @@ struct servers {
     double sr_prep_cpu;	/* sum of cpu time for preps */
     double sr_l_percent;	/* last: percent of CPU */
 } servers[MAXSERVERS];
+int server_hiwat = 0;	/* servers[] at and above this are all unused */
 
 
 struct fb *fbp = FB_NULL;		/* Current framebuffer ptr */
@@ -225,9 +228,21 @@ int fbheight;			/* fb height - S command */
 int running = 0;		/* actually working on it */
 int detached = 0;		/* continue after EOF */
 
-fd_set clients;
+/*
+ * Descriptors to wait on for input, besides tcp_listen_fd.  Kept
+ * packed, so that waiting and checking for "any clients left" cost
+ * time in proportion to the number of connections, not the largest
+ * descriptor.  client_slot[fd] is the index in clients[] plus one.
+ */
+int clients[MAXSERVERS];
+int nclients = 0;
+int client_slot[MAXSERVERS];
 int print_on = 1;
 
+/* Updated by survey_servers() once per scheduling pass */
+int ready_servers = 0;	/* # of servers ready for work */
+double farm_rate = 0.0;	/* sum of their pix/elapsed_sec */
+
 
 /*
  * Scan the ihost table.  For all eligible hosts that don't
@@ -463,6 +478,36 @@ remrt_log(const char *msg)
 }
 
 
+static void
+client_set(int fd)
+{
+    if (fd < 0 || fd >= MAXSERVERS || client_slot[fd]) return;
+    clients[nclients++] = fd;
+    client_slot[fd] = nclients;
+}
+
+
+static void
+client_clr(int fd)
+{
+    int i;
+
+    if (fd < 0 || fd >= MAXSERVERS || !client_slot[fd]) return;
+    i = client_slot[fd] - 1;
+    clients[i] = clients[--nclients];
+    client_slot[clients[i]] = i + 1;
+    client_slot[fd] = 0;
+}
+
+
+static void
+client_zero(void)
+{
+    while (nclients > 0)
+	client_clr(clients[0]);
+}
+
+
 /*
  * Note that final connection closeout is handled in schedule(),
  * to prevent recursion problems.
@@ -498,13 +543,13 @@ drop_server(struct servers *sp, char *why)
 	return;
     }
 
-    /* Clear the bits from "clients" now, to prevent further select()s */
+    /* Remove it from "clients" now, to prevent further polling */
     fd = pc->pkc_fd;
     if (fd <= 3 || fd >= (int)MAXSERVERS) {
 	bu_log("drop_server: fd=%d is unreasonable, forget it!\n", fd);
 	return;
     }
-    FD_CLR(sp->sr_pc->pkc_fd, &clients);
+    client_clr(sp->sr_pc->pkc_fd);
 
     if (oldstate != SRST_READY && oldstate != SRST_NEED_TREE) return;
 
@@ -563,10 +608,10 @@ interactive_cmd(FILE *fp)
 	if (fp != stdin) return;
 
 	/* Eof on stdin */
-	FD_CLR(fileno(fp), &clients);
+	client_clr(fileno(fp));
 
 	/* We might want to wait if something is running? */
-	for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+	for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	    if (sp->sr_pc == PKC_NULL) continue;
 	    if (!running)
 		drop_server(sp, "EOF on Stdin");
@@ -620,7 +665,15 @@ addclient(struct pkg_conn *pc)
     }
     if (rem_debug) bu_log("%s addclient(%s)\n", stamp(), ihp->ht_name);
 
-    FD_SET(fd, &clients);
+    if (fd >= (int)MAXSERVERS) {
+	bu_log("%s %s: fd=%d, too many servers, need %d or fewer\n",
+	       stamp(), ihp->ht_name, fd, MAXSERVERS);
+	pkg_close(pc);
+	return;
+    }
+    client_set(fd);
+    if (fd >= server_hiwat)
+	server_hiwat = fd + 1;
 
     sp = &servers[fd];
     memset((char *)sp, 0, sizeof(*sp));
@@ -645,17 +698,90 @@ input_error(const char *str)
 }
 
 
+/*
+ * Wait up to waittime seconds for input on the listening socket or
+ * on any of the clients.  The descriptors with input are listed in
+ * ready[], and their number is returned, or -1 on error.
+ */
+static int
+wait_for_input(int waittime, int *ready)
+{
+    int i, n, val;
+#ifdef HAVE_POLL_H
+    static struct pollfd *pfd = NULL;
+    static int pfdlen = 0;
+
+    if (pfdlen < nclients + 1) {
+	pfdlen = nclients + 1 + 64;
+	pfd = (struct pollfd *)bu_realloc(pfd, pfdlen * sizeof(struct pollfd), "pollfd");
+    }
+    pfd[0].fd = tcp_listen_fd;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    for (i = 0; i < nclients; i++) {
+	pfd[i+1].fd = clients[i];
+	pfd[i+1].events = POLLIN;
+	pfd[i+1].revents = 0;
+    }
+
+    val = poll(pfd, nclients + 1, waittime * 1000);
+    if (val < 0) {
+	if (errno != EINTR)
+	    perror("poll");
+	return -1;
+    }
+
+    n = 0;
+    for (i = 0; i < nclients + 1 && n < val; i++) {
+	if (pfd[i].revents)
+	    ready[n++] = pfd[i].fd;
+    }
+#else
+    fd_set ifdset;
+    struct timeval tv;
+    int maxfd = tcp_listen_fd;
+
+    FD_ZERO(&ifdset);
+    FD_SET(tcp_listen_fd, &ifdset);
+    for (i = 0; i < nclients; i++) {
+	FD_SET(clients[i], &ifdset);
+	if (clients[i] > maxfd)
+	    maxfd = clients[i];
+    }
+    tv.tv_sec = waittime;
+    tv.tv_usec = 0;
+
+    val = select(maxfd + 1, &ifdset, (fd_set *)0, (fd_set *)0, &tv);
+    if (val < 0) {
+	if (errno != EINTR)
+	    perror("select");
+	return -1;
+    }
+
+    n = 0;
+    if (FD_ISSET(tcp_listen_fd, &ifdset))
+	ready[n++] = tcp_listen_fd;
+    for (i = 0; i < nclients; i++) {
+	if (FD_ISSET(clients[i], &ifdset))
+	    ready[n++] = clients[i];
+    }
+#endif
+    return n;
+}
+
+
 static void
 check_input(int waittime)
 {
-    static fd_set ifdset;
-    int i;
+    int ready[MAXSERVERS + 1];
+    int nready;
+    int i, fd;
+    int stdin_ready = 0;
     struct pkg_conn *pc;
-    static struct timeval tv;
     int val;
 
     /* First, handle any packages waiting in internal buffers */
-    for (i = 0; i <(int)MAXSERVERS; i++) {
+    for (i = 0; i < server_hiwat; i++) {
 	pc = servers[i].sr_pc;
 	if (pc == PKC_NULL) continue;
 	val = pkg_process(pc);
@@ -663,58 +789,54 @@ check_input(int waittime)
 	    drop_server(&servers[i], "pkg_process() error");
     }
 
-    /* Second, hang in select() waiting for something to happen */
-    tv.tv_sec = waittime;
-    tv.tv_usec = 0;
-
-    FD_MOVE(&ifdset, &clients);	/* ibits = clients */
-    FD_SET(tcp_listen_fd, &ifdset);	/* ibits |= tcp_listen_fd */
-    val = select(32, &ifdset, (fd_set *)0, (fd_set *)0, &tv);
-    if (val < 0) {
-	perror("select");
-	return;
-    }
-    if (val == 0) {
-	/* At this point, ibits==0 */
-	if (rem_debug>1) bu_log("%s select timed out after %d seconds\n", stamp(), waittime);
+    /* Second, hang in poll() waiting for something to happen */
+    nready = wait_for_input(waittime, ready);
+    if (nready <= 0) {
+	if (nready == 0 && rem_debug>1) bu_log("%s poll timed out after %d seconds\n", stamp(), waittime);
 	return;
     }
 
-    /* Third, accept any pending connections */
-    if (FD_ISSET(tcp_listen_fd, &ifdset)) {
-	pc = pkg_getclient(tcp_listen_fd, pkgswitch, input_error, 1);
-	if (pc != PKC_NULL && pc != PKC_ERROR)
-	    addclient(pc);
-	FD_CLR(tcp_listen_fd, &ifdset);
-    }
+    for (i = 0; i < nready; i++) {
+	fd = ready[i];
 
-    /* Fourth, get any new traffic off the network into libpkg buffers */
-    for (i = 0; i < (int)MAXSERVERS; i++) {
-	if (!feof(stdin) && i == fileno(stdin)) continue;
-	if (!FD_ISSET(i, &ifdset)) continue;
-	pc = servers[i].sr_pc;
+	/* Third, accept all pending connections */
+	if (fd == tcp_listen_fd) {
+	    while ((pc = pkg_getclient(tcp_listen_fd, pkgswitch, input_error, 1)) != PKC_NULL &&
+		   pc != PKC_ERROR)
+		addclient(pc);
+	    continue;
+	}
+
+	if (fd == fileno(stdin)) {
+	    stdin_ready = 1;
+	    if (!feof(stdin)) continue;
+	}
+
+	/* Fourth, get any new traffic off the network into libpkg buffers */
+	pc = servers[fd].sr_pc;
 	if (pc == PKC_NULL) continue;
 	val = pkg_suckin(pc);
 	if (val < 0) {
-	    drop_server(&servers[i], "pkg_suckin() error");
+	    drop_server(&servers[fd], "pkg_suckin() error");
 	} else if (val == 0) {
-	    drop_server(&servers[i], "EOF");
+	    drop_server(&servers[fd], "EOF");
 	}
-	FD_CLR(i, &ifdset);
     }
 
     /* Fifth, handle any new packages now waiting in internal buffers */
-    for (i = 0; i < (int)MAXSERVERS; i++) {
-	pc = servers[i].sr_pc;
+    for (i = 0; i < nready; i++) {
+	fd = ready[i];
+	if (fd == tcp_listen_fd) continue;
+	pc = servers[fd].sr_pc;
 	if (pc == PKC_NULL) continue;
 	if (pkg_process(pc) < 0)
-	    drop_server(&servers[i], "pkg_process() error");
+	    drop_server(&servers[fd], "pkg_process() error");
     }
 
     /* Finally, handle any command input (This can recurse via "read") */
     if (waittime>0 &&
 	!feof(stdin) &&
-	FD_ISSET(fileno(stdin), &ifdset)) {
+	stdin_ready) {
 	interactive_cmd(stdin);
     }
 }
@@ -1141,7 +1263,7 @@ get_server_by_name(const char *str)
     if ((ihp = host_lookup_by_name(str, 0)) == IHOST_NULL)
 	return SERVERS_NULL;
 
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	if (sp->sr_host == ihp) return sp;
     }
@@ -1170,7 +1292,7 @@ destroy_frame(struct frame *fr)
 	bu_free(fr->fr_filename, "filename");
 	fr->fr_filename = (char *)0;
     }
-    for (sp = &servers[0]; sp<&servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp<&servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	if (sp->sr_curframe == fr) {
 	    sp->sr_curframe = FRAME_NULL;
@@ -1297,22 +1419,26 @@ pr_list(struct bu_list *lhp)
 
 
 /*
- * Returns the number of servers that are ready (or busy) with
- * computing frames.
+ * Count the servers that are ready (or busy) with computing frames,
+ * and total up their measured pixel rates.  Called once per pass of
+ * the scheduler, rather than once per assignment, so that handing
+ * out work stays linear in the number of servers.
  */
-static int
-number_of_ready_servers(void)
+static void
+survey_servers(void)
 {
     struct servers *sp;
-    int count = 0;
 
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    ready_servers = 0;
+    farm_rate = 0;
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	if (sp->sr_state == SRST_READY ||
-	    sp->sr_state == SRST_DOING_GETTREES)
-	    count++;
+	    sp->sr_state == SRST_DOING_GETTREES) {
+	    ready_servers++;
+	    farm_rate += sp->sr_w_elapsed;
+	}
     }
-    return count;
 }
 
 
@@ -1320,7 +1446,7 @@ number_of_ready_servers(void)
  * Determine how many seconds of work should be assigned to
  * a worker, given the current configuration of workers.
  * One overall goal is to keep the dispatcher (us) from
- * having to process more than one response every two seconds,
+ * having to process more than DISPATCH_RATE responses a second,
  * to ensure adequate processing power will be available to
  * handle the LOG messages, starting new servers, writing
  * results to the disk and/or framebuffer, etc.
@@ -1330,7 +1456,7 @@ assignment_time(void)
 {
     int sec;
 
-    sec = 2 * number_of_ready_servers();
+    sec = ready_servers / DISPATCH_RATE;
     if (sec < MIN_ASSIGNMENT_TIME)
 	return MIN_ASSIGNMENT_TIME;
     return sec;
@@ -1395,7 +1521,7 @@ all_servers_idle(void)
 {
     struct servers *sp;
 
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	if (sp->sr_state != SRST_READY &&
 	    sp->sr_state != SRST_NEED_TREE) continue;
@@ -1487,7 +1613,7 @@ this_frame_done(struct frame *fr)
     if (BU_LIST_NON_EMPTY(&fr->fr_todo))
 	return 1;		/* more work still to be sent */
 
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	for (BU_LIST_FOR(lp, list, &sp->sr_work)) {
 	    if (fr != lp->li_frame) continue;
@@ -1671,7 +1797,7 @@ task_server(struct servers *sp, struct frame *fr, struct timeval *nowp)
 	if (sp->sr_curframe != FRAME_NULL) return 3;
 	if (work_allocate_method==OPT_MOVIE) {
 	    struct servers *csp;
-	    for (csp = &servers[0]; csp < &servers[MAXSERVERS]; csp++) {
+	    for (csp = &servers[0]; csp < &servers[server_hiwat]; csp++) {
 		if (csp->sr_curframe == fr) return 2;
 	    }
 	} else if (work_allocate_method==OPT_LOAD) {
@@ -1708,8 +1834,26 @@ task_server(struct servers *sp, struct frame *fr, struct timeval *nowp)
     if (work_allocate_method == OPT_MOVIE) {
 	lump = fr->fr_width * 2;	/* 2 scanlines at a whack */
     } else {
-	/* Limit growth in assignment size to 1.5X each assignment */
-	if (lump > 1.5*sp->sr_lump) lump = 1.5*sp->sr_lump;
+	/*
+	 * Limit growth in assignment size to 1.5X each assignment,
+	 * or 4X while a measured server is finishing well short of
+	 * its target time, so fast servers reach full speed quickly.
+	 */
+	double growth = 1.5;
+	if (sp->sr_nsamp > 0 && sp->sr_l_elapsed < assignment_time() / 4.0)
+	    growth = 4;
+	if (lump > growth*sp->sr_lump) lump = growth*sp->sr_lump;
+
+	/*
+	 * Don't let one server take more than a slice of its fair
+	 * share of the frame, in proportion to its speed, so the
+	 * last assignments of a frame finish close together.
+	 */
+	if (farm_rate > 0 && sp->sr_w_elapsed > 0) {
+	    double share = (double)fr->fr_width * fr->fr_height *
+		sp->sr_w_elapsed / farm_rate / SLICES_PER_SHARE;
+	    if (lump > share) lump = share;
+	}
     }
     /* Provide some bounds checking */
     if (lump < 32) lump = 32;
@@ -1793,7 +1937,7 @@ schedule(struct timeval *nowp)
     if (file_fullname[0] == '\0') goto out;
 
     /* Handle various state transitions */
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 
 	switch (sp->sr_state) {
@@ -1809,7 +1953,7 @@ schedule(struct timeval *nowp)
 	    case SRST_CLOSING:
 		/* Handle final closing */
 		if (rem_debug>1) bu_log("%s Final close on %s\n", stamp(), sp->sr_host->ht_name);
-		FD_CLR(sp->sr_pc->pkc_fd, &clients);
+		client_clr(sp->sr_pc->pkc_fd);
 		pkg_close(sp->sr_pc);
 
 		sp->sr_pc = PKC_NULL;
@@ -1819,6 +1963,8 @@ schedule(struct timeval *nowp)
 		break;
 	}
     }
+    while (server_hiwat > 0 && servers[server_hiwat-1].sr_pc == PKC_NULL)
+	server_hiwat--;
 
     /* Look for finished frames */
     fr = FrameHead.fr_forw;
@@ -1848,6 +1994,7 @@ schedule(struct timeval *nowp)
 
     /* Keep assigning work until all servers are fully loaded */
 top:
+    survey_servers();
     for (fr = FrameHead.fr_forw; fr != &FrameHead; fr = fr->fr_forw) {
 	CHECK_FRAME(fr);
 	nxt_frame = 0;
@@ -1862,7 +2009,7 @@ top:
 			 * make additional assignments.
 			 * This should keep all workers evenly "stoked".
 			 */
-	    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+	    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 		if (sp->sr_pc == PKC_NULL) continue;
 
 		if ((ret = task_server(sp, fr, nowp)) < 0) {
@@ -1911,7 +2058,7 @@ cd_load(const int argc, const char **argv)
     /* Really ought to reset here, too */
     if (file_fullname[0] != '\0') {
 	bu_log("Was loaded with %s, restarting all\n", file_fullname);
-	for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+	for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	    if (sp->sr_pc == PKC_NULL) continue;
 	    send_restart(sp);
 	}
@@ -1955,7 +2102,7 @@ cd_rdebug(const int argc, const char **argv)
     bu_vls_strcpy(&cmd, "opt ");
     bu_vls_strcat(&cmd, argv[1]);
     len = bu_vls_strlen(&cmd)+1;
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	if (pkg_send(MSG_OPTIONS, bu_vls_addr(&cmd), len, sp->sr_pc) < 0)
 	    drop_server(sp, "MSG_OPTIONS pkg_send error");
@@ -2072,7 +2219,7 @@ static int
 cd_detach(const int UNUSED(argc), const char **UNUSED(argv))
 {
     detached = 1;
-    FD_CLR(fileno(stdin), &clients);	/* drop stdin */
+    client_clr(fileno(stdin));	/* drop stdin */
     close(0);
     return 0;
 }
@@ -2289,7 +2436,7 @@ cd_restart(const int argc, const char **argv)
     if (argc <= 1) {
 	/* Restart all */
 	bu_log("%s Restarting all\n", stamp());
-	for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+	for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	    if (sp->sr_pc == PKC_NULL) continue;
 	    send_restart(sp);
 	}
@@ -2408,7 +2555,7 @@ cd_stat(const int UNUSED(argc), const char **UNUSED(argv))
     bu_log("   Server   Last  Last   Average  Cur   Machine\n");
     bu_log("    State   Lump Elapsed pix/sec Frame   Name \n");
     bu_log("  -------- ----- ------- ------- ----- -------------\n");
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 
 	/* Ignore one-shot command interfaces */
@@ -2476,7 +2623,7 @@ cd_status(const int UNUSED(argc), const char **UNUSED(argv))
     /* Print work assignments */
     bu_log("%s Worker assignment interval=%d seconds:\n",
 	   s, assignment_time());
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	bu_log("  %2d  %s %s",
 	       sp->sr_pc->pkc_fd, sp->sr_host->ht_name,
@@ -2529,7 +2676,7 @@ cd_print(const int argc, const char **argv)
     else
 	print_on = !print_on;	/* toggle */
 
-    for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+    for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	if (sp->sr_pc == PKC_NULL) continue;
 	send_loglvl(sp);
     }
@@ -2553,17 +2700,15 @@ cd_wait(const int UNUSED(argc), const char **UNUSED(argv))
 {
     struct timeval now;
 
-    FD_CLR(fileno(stdin), &clients);
+    client_clr(fileno(stdin));
     if (running) {
 	/*
 	 * When running, WAIT command waits for all
 	 * outstanding frames to be completed.
 	 */
-/* Aargh.  We really need a FD_ISZERO macro. */
-	int done = 0, i;
+	int done = 0;
 	while (!done && FrameHead.fr_forw != &FrameHead) {
-	    for (i = 0, done = 1; i < (int)FD_SETSIZE; i++)
-		if (FD_ISSET(i, &clients)) { done = 0; break; }
+	    done = (nclients == 0);
 	    check_input(30);	/* delay up to 30 secs */
 
 	    (void)gettimeofday(&now, (struct timezone *)0);
@@ -2580,7 +2725,7 @@ cd_wait(const int UNUSED(argc), const char **UNUSED(argv))
 	}
 	bu_log("%s All servers idle\n", stamp());
     }
-    FD_SET(fileno(stdin), &clients);
+    client_set(fileno(stdin));
     return 0;
 }
 
@@ -2808,7 +2953,7 @@ start_servers(struct timeval *nowp)
 	}
 
 	/* See if this host is already in contact as a server */
-	for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+	for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	    if (sp->sr_pc == PKC_NULL) continue;
 	    if (sp->sr_host != ihp) continue;
 
@@ -3535,11 +3680,7 @@ do_work(int auto_start)
 	    (void)gettimeofday(&now, (struct timezone *)0);
 	    start_servers(&now);
 	} else {
-/* Aargh.  We really need a FD_ISZERO macro. */
-	    int done, i;
-	    for (i = 0, done = 1; i < (int)FD_SETSIZE; i++)
-		if (FD_ISSET(i, &clients)) { done = 0; break; }
-	    if (done) break;
+	    if (nclients == 0) break;
 	}
 
 	check_input(30);	/* delay up to 30 secs */
@@ -3549,7 +3690,7 @@ do_work(int auto_start)
 
 	/* Count servers */
 	cur_serv = 0;
-	for (sp = &servers[0]; sp < &servers[MAXSERVERS]; sp++) {
+	for (sp = &servers[0]; sp < &servers[server_hiwat]; sp++) {
 	    if (sp->sr_pc == PKC_NULL) continue;
 	    cur_serv++;
 	}
@@ -3562,11 +3703,35 @@ do_work(int auto_start)
 }
 
 
+/*
+ * Each server holds a descriptor open for the length of the run, so
+ * the default soft limit of a few hundred descriptors would cap the
+ * farm size well below MAXSERVERS.  Raise it as far as we're allowed.
+ */
+static void
+raise_fd_limit(void)
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(RLIMIT_NOFILE)
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0)
+	return;
+    if (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= (rlim_t)MAXSERVERS)
+	return;
+    rl.rlim_cur = MAXSERVERS;
+    if (rl.rlim_max != RLIM_INFINITY && rl.rlim_cur > rl.rlim_max)
+	rl.rlim_cur = rl.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rl) != 0)
+	bu_log("%s Unable to raise open file limit to %d\n", stamp(), (int)MAXSERVERS);
+#endif
+}
+
+
 int
 main(int argc, char *argv[])
 {
     struct servers *sp;
-    int i, done;
+    int i;
 
     bu_setprogname(argv[0]);
 
@@ -3587,15 +3752,17 @@ main(int argc, char *argv[])
 	sp->sr_curframe = FRAME_NULL;
     }
 
+    raise_fd_limit();
+
     /* Listen for our PKG connections */
     int tcp_num = 0;
-    if ((tcp_listen_fd = pkg_permserver("rtsrv", "tcp", 8, remrt_log)) < 0) {
+    if ((tcp_listen_fd = pkg_permserver("rtsrv", "tcp", LISTEN_BACKLOG, remrt_log)) < 0) {
 	char num[128];
 	/* Do it by the numbers */
 	for (i = 0; i < 10; i++) {
 	    tcp_num = REMRT_TCP_DEFAULT_PORT+i;
 	    snprintf(num, sizeof(num), "%d", tcp_num);
-	    if ((tcp_listen_fd = pkg_permserver(num, "tcp", 8, remrt_log)) < 0)
+	    if ((tcp_listen_fd = pkg_permserver(num, "tcp", LISTEN_BACKLOG, remrt_log)) < 0)
 		continue;
 	    break;
 	}
@@ -3613,19 +3780,14 @@ main(int argc, char *argv[])
 	if (tcp_num > 0) {
 	    bu_log("%s Listening at TCP port %d\n", stamp(), tcp_num);
 	}
-	FD_ZERO(&clients);
-	FD_SET(fileno(stdin), &clients);
+	client_zero();
+	client_set(fileno(stdin));
 
 	/* Read .remrtrc file to acquire server info */
 	read_rc_file();
 
 	/* Go until no more clients */
-/* Aargh.  We really need a FD_ISZERO macro. */
-	for (i = 0, done = 1; i < (int)FD_SETSIZE; i++)
-	    if (FD_ISSET(i, &clients)) { done = 0; break; }
-	while (!done) {
-	    for (i = 0, done = 1; i < (int)FD_SETSIZE; i++)
-		if (FD_ISSET(i, &clients)) { done = 0; break; }
+	while (nclients > 0) {
 	    do_work(0);	/* no auto starting of servers */
 	}
 	/*
@@ -3640,7 +3802,7 @@ main(int argc, char *argv[])
 	    bu_log("%s Listening at TCP port %d\n", stamp(), tcp_num);
 	}
 	bu_log("%s Reading script on stdin\n", stamp());
-	FD_ZERO(&clients);
+	client_zero();
 
 	/* parse command line args for sizes, etc. */
 	finalframe = -1;
@@ -3681,7 +3843,7 @@ main(int argc, char *argv[])
 	    }
 	} else {
 	    /* if -M, read RT script from stdin */
-	    FD_ZERO(&clients);
+	    client_zero();
 	    eat_script(stdin);
 	}
 	if (rem_debug>1) cd_frames(0, (const char **)0);
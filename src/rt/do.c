@@ -501,6 +501,7 @@ struct bu_structparse set_parse[] = {
     {"%d",	1, "save_overlaps",		bu_byteoffset(save_overlaps),		BU_STRUCTPARSE_FUNC_NULL, NULL, NULL },
     {"%f",	1, "perspective",		bu_byteoffset(rt_perspective),		BU_STRUCTPARSE_FUNC_NULL, NULL, NULL },
     {"%f",	1, "angle",			bu_byteoffset(rt_perspective),		BU_STRUCTPARSE_FUNC_NULL, NULL, NULL },
+    {"%d",	1, "packet_size",		bu_byteoffset(packet_size),		BU_STRUCTPARSE_FUNC_NULL, NULL, NULL },
 #if !defined(_WIN32) || defined(__CYGWIN__)
     /* FIXME: these cannot be listed in here because they are LIBRT
      * globals.  due to the way symbols are not imported until a DLL
@@ -768,8 +769,8 @@ do_prep(struct rt_i *rtip)
     memory_summary();
     if (rt_verbosity & VERBOSE_STATS) {
 	bu_log("%s: %zu cut, %zu box (%zu empty)\n",
-	       rtip->rti_space_partition == RT_PART_NUBSPT ?
-	       "NUBSP" : "unknown",
+	       rtip->rti_space_partition == RT_PART_NUBSPT ? "NUBSP" :
+	       rtip->rti_space_partition == RT_PART_HLBVH ? "HLBVH" : "unknown",
 	       rtip->rti_ncut_by_type[CUT_CUTNODE],
 	       rtip->rti_ncut_by_type[CUT_BOXNODE],
 	       rtip->nempty_cells);
@@ -797,6 +798,37 @@ validate_raytrace(struct rt_i *rtip)
 }
 
 
+/**
+ * Write the profiling counters gathered for this frame as JSON,
+ * following the same naming as the output file.
+ */
+static void
+write_profile(struct rt_i *rtip, int framenumber)
+{
+    struct bu_vls json = BU_VLS_INIT_ZERO;
+    char filename[128] = {0};
+    FILE *fp;
+
+    if (framenumber <= 0) {
+	snprintf(filename, 128, "%s", profilefile);
+    } else {
+	snprintf(filename, 128, "%s.%d", profilefile, framenumber);
+    }
+
+    rt_profile_report(&json, rtip);
+
+    fp = fopen(filename, "wb");
+    if (fp == NULL) {
+	perror(filename);
+    } else {
+	if (fwrite(bu_vls_cstr(&json), bu_vls_strlen(&json), 1, fp) != 1)
+	    bu_log("ERROR: unable to write profile to \"%s\"\n", filename);
+	fclose(fp);
+    }
+    bu_vls_free(&json);
+}
+
+
 /**
  * Do all the actual work to run a frame.
  *
@@ -1060,6 +1092,9 @@ do_frame(int framenumber)
     rtip->nhits = 0;
     rtip->rti_nrays = 0;
 
+    rtip->rti_profiling = (profilefile != NULL);
+    rt_profile_zero(rtip);
+
     if (rt_verbosity & (VERBOSE_LIGHTINFO|VERBOSE_STATS))
 	bu_log("\n");
     fflush(stdout);
@@ -1168,6 +1203,9 @@ do_frame(int framenumber)
 	       rtip->rti_nrays,
 	       wallclock, ((double)(rtip->rti_nrays))/wallclock);
     }
+    if (profilefile != NULL)
+	write_profile(rtip, framenumber);
+
     if (bif != NULL) {
 	icv_write(bif, framename, BU_MIME_IMAGE_AUTO);
 	icv_destroy(bif);
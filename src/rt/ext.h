@@ -117,6 +117,8 @@ extern int hypersample;			/* number of extra rays to fire */
 extern int incr_mode;			/* !0 for incremental resolution */
 extern int full_incr_mode;              /* !0 for fully incremental resolution */
 extern ssize_t npsw;			/* number of worker PSWs to run */
+extern int packet_size;			/* primary rays per rt_vshootray() packet */
+extern int tile_2d;			/* !0 when the view module takes 2-D tiles */
 extern int reproj_cur;			/* number of pixels reprojected this frame */
 extern int reproj_max;			/* out of total number of pixels */
 extern int reproject_mode;
@@ -153,6 +155,7 @@ extern int objc;			/* Number of cmd-line treetops */
 extern char **objv;			/* array of treetop strings */
 extern struct bu_ptbl *cmd_objs;               /* container to hold cmd specified objects */
 extern char *outputfile;		/* name of base of output file */
+extern char *profilefile;		/* name of base of JSON profile file */
 extern int benchmark;			/* No random numbers:  benchmark */
 extern int curframe;			/* current frame number */
 extern int desiredframe;		/* frame to start at */
@@ -124,6 +124,7 @@ int finalframe = -1;                    /* frame to halt at */
 int curframe = 0;                       /* current frame number,
 					 * also shared with view.c */
 char *outputfile = (char *)NULL;        /* name of base of output file */
+char *profilefile = (char *)NULL;       /* name of base of JSON profile file */
 int benchmark = 0;                      /* No random numbers:  benchmark */
 
 int sub_grid_mode = 0;                  /* mode to raytrace a rectangular portion of view */
@@ -167,8 +168,8 @@ char *framebuffer = NULL;       /* desired framebuffer */
 
 /**
  * space partitioning algorithm to use.  previously had experimental
- * grid support, but now only uses a Non-uniform Binary Spatial
- * Partitioning (BSP) tree.
+ * grid support, now defaults to a Non-uniform Binary Spatial
+ * Partitioning (BSP) tree with an optional HLBVH (RT_PART_HLBVH).
  */
 int space_partition = RT_PART_NUBSPT;
 
@@ -211,7 +212,7 @@ get_args(int argc, const char *argv[])
     bu_optind = 1;                /* restart */
 
 #define GETOPT_STR	\
-    ".:, :@:a:b:c:d:e:f:g:m:ij:k:l:n:o:p:q:rs:tu:v::w:x:z:A:BC:D:E:F:G:H:I:J:K:MN:O:P:Q:RST:U:V:WX:!:+:h?"
+    ".:, :@:a:b:c:d:e:f:g:m:ij:k:l:n:o:p:q:rs:tu:v::w:x:z:A:BC:D:E:F:G:H:I:J:K:MN:O:P:Q:RST:U:V:WX:Y:!:+:h?"
 
     while ((c=bu_getopt(argc, (char * const *)argv, GETOPT_STR)) != -1) {
 	if (bu_optopt == '?')
@@ -498,6 +499,10 @@ get_args(int argc, const char *argv[])
 		outputfile = bu_optarg;
 		doubles_out = 0;
 		break;
+	    case 'Y':
+		/* Per-primitive profiling counters, written as JSON */
+		profilefile = bu_optarg;
+		break;
 	    case 'p':
 		rt_perspective = atof(bu_optarg);
 		if (rt_perspective < 0 || rt_perspective > 179) {
@@ -143,10 +143,11 @@ default_options(void)
     option("Developer", "-x #", "Specify librt debugging flags", 1);
     option("Developer", "-N #", "Specify libnmg debugging flags", 1);
     option("Developer", "-! #", "Specify libbu debugging flags", 1);
-    option("Developer", "-, #", "Specify space partitioning algorithm", 1);
+    option("Developer", "-, #", "Specify space partitioning algorithm (0=NUBSP, 1=HLBVH)", 1);
     option("Developer", "-B", "Disable randomness for \"benchmark\"-style repeatability", 1);
     option("Developer", "-b \"x y\"", "Only shoot one ray at pixel coordinates (quotes required)", 1);
     option("Developer", "-Q x,y", "Shoot one pixel with debugging; compute others without", 1);
+    option("Developer", "-Y filename", "Write per-primitive shot counts and timings as JSON", 1);
 #ifdef USE_OPENCL
     option("Developer", "-z #", "Turn on OpenCL ray-trace engine (default: 0 - off)", 1);
 #endif
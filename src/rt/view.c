@@ -113,7 +113,7 @@ static int buf_mode=0;
 #define BUFMODE_INCR      3	/* incr_mode set, dynamic buffering */
 #define BUFMODE_RTSRV     4	/* output buffering into scanbuf */
 #define BUFMODE_FULLFLOAT 5	/* buffer entire frame as floats */
-#define BUFMODE_SCANLINE  6	/* Like _DYNAMIC, one scanline/cpu */
+#define BUFMODE_SCANLINE  6	/* Like _DYNAMIC, one cpu only */
 #define BUFMODE_ACC       7     /* Cumulative buffer - The buffer
 				   always have the average of the
 				   colors sampled for each pixel */
@@ -361,7 +361,7 @@ view_pixel(struct application *ap)
 	    break;
 
 	    /*
-	     * Only one CPU is working on this scanline, no parallel
+	     * Only one CPU is working on the frame, no parallel
 	     * interlock required! Much faster.
 	     */
 	case BUFMODE_SCANLINE:
@@ -438,9 +438,9 @@ view_pixel(struct application *ap)
 		}
 		bu_free(tmp_pixel, "tmp_pixel");
 
-		bu_semaphore_release(RT_SEM_RESULTS);
 		if (--(slp->sl_left) <= 0)
 		    do_eol = 1;
+		bu_semaphore_release(RT_SEM_RESULTS);
 	    }
 	    break;
 
@@ -1553,12 +1553,10 @@ view_2init(struct application *ap, char *UNUSED(framename))
 	buf_mode = BUFMODE_ACC;
     } else if (width <= 96 || random_mode) {
 	buf_mode = BUFMODE_UNBUF;
-    } else if ((size_t)npsw <= (size_t)height/4) {
-	/* Have each CPU do a whole scanline.  Saves lots of semaphore
-	 * overhead.  For load balancing make sure each CPU has
-	 * several lines to do.
+    } else if (npsw == 1) {
+	/* A single CPU needs no interlock on scanline[], whatever
+	 * the shape of its tiles.
 	 */
-	per_processor_chunk = width;
 	buf_mode = BUFMODE_SCANLINE;
     }
     else {
@@ -1566,6 +1564,11 @@ view_2init(struct application *ap, char *UNUSED(framename))
     }
 #endif
 
+    /* Every mode but incremental and remote rendering tracks each
+     * pixel on its own, so the workers may hand out 2-D tiles.
+     */
+    tile_2d = (buf_mode != BUFMODE_INCR && buf_mode != BUFMODE_RTSRV);
+
     switch (buf_mode) {
 	case BUFMODE_UNBUF:
 	    bu_log("Mode: Single pixel I/O, unbuffered\n");
@@ -1637,7 +1640,7 @@ view_2init(struct application *ap, char *UNUSED(framename))
 	    break;
 
 	case BUFMODE_SCANLINE:
-	    bu_log("Mode: scanline-per-CPU buffering\n");
+	    bu_log("Mode: single CPU scanline buffering\n");
 	    /* Fall through... */
 	case BUFMODE_DYNAMIC:
 	    if ((buf_mode == BUFMODE_DYNAMIC) && (rt_verbosity & VERBOSE_OUTPUTFILE)) {
@@ -1832,6 +1835,9 @@ application_init(void)
     view_parse[10].sp_offset = bu_byteoffset(ambOffset);
     view_parse[11].sp_offset = bu_byteoffset(ambSlow);
 
+    /* primary rays are perfectly coherent, fire them in packets */
+    packet_size = 16;
+
     option("", "-A #", "Set image brightness, ambient light intensity (default: 0.4)", 0);
     option("Raytrace", "-i", "Enable incremental (progressive-style) rendering", 1);
     option("Raytrace", "-t", "Render from top to bottom (default: from bottom up)", 1);
@@ -65,6 +65,8 @@ extern int query_debug;
 extern unsigned char *pixmap;	/* pixmap for rerendering of black pixels */
 
 int per_processor_chunk = 0;	/* how many pixels to do at once */
+int packet_size = 0;		/* primary rays per rt_vshootray() packet, <= 1 disables */
+int tile_2d = 0;		/* !0 when the view module takes 2-D tiles */
 
 int fullfloat_mode = 0;
 int reproject_mode = 0;
@@ -74,7 +76,7 @@ int reproj_cur;	/* number of pixels reprojected this frame */
 int reproj_max;	/* out of total number of pixels */
 
 /* Local communication with worker() */
-int cur_pixel = 0;			/* current pixel number, 0..last_pixel */
+int cur_pixel = 0;			/* first pixel number of the current run */
 int last_pixel = 0;			/* last pixel number */
 
 int stop_worker = 0;
@@ -452,32 +454,137 @@ do_pixel(int cpu, int pat_num, int pixelnum)
 
 
 /**
- * Compute some pixels, and store them.
+ * Primary rays can only be fired as packets in the plain case of one
+ * ray per pixel, straight from the view grid.  rt_vshootray() does not
+ * gather the per-solid profile, so -Y keeps to rt_shootray().
+ */
+static int
+packet_eligible(void)
+{
+    return packet_size > 1
+	&& hypersample == 0
+	&& !(jitter & JITTER_CELL)
+	&& !stereo
+	&& !incr_mode
+	&& !fullfloat_mode
+	&& !sub_grid_mode
+	&& !Query_one_pixel
+	&& !pixmap
+	&& lightmodel != 8
+	&& !profilefile
+	&& !APP.a_rt_i->rti_prismtrace;
+}
+
+
+/**
+ * Same as calling do_pixel() on each of pixels[0..npix-1], for the
+ * packet_eligible() case, but with all of the primary rays fired at
+ * once through rt_vshootray().
+ */
+static void
+do_pixel_packet(int cpu, struct application *apps, const int *pixels, int npix)
+{
+    int i;
+
+    for (i = 0; i < npix; i++) {
+	struct application *ap = &apps[i];
+	vect_t point;
+
+	/* Obtain fresh copy of global application struct */
+	*ap = APP;			/* struct copy */
+	ap->a_resource = &resource[cpu];
+	ap->a_y = (int)(pixels[i]/width);
+	ap->a_x = (int)(pixels[i] - (ap->a_y * width));
+	ap->a_pixelext = (struct pixel_ext *)NULL;
+
+	VJOIN2(point, viewbase_model, ap->a_x, dx_model, ap->a_y, dy_model);
+	if (rt_perspective > 0.0) {
+	    VSUB2(ap->a_ray.r_dir, point, eye_model);
+	    VUNITIZE(ap->a_ray.r_dir);
+	    VMOVE(ap->a_ray.r_pt, eye_model);
+	} else {
+	    VMOVE(ap->a_ray.r_pt, point);
+	    VMOVE(ap->a_ray.r_dir, APP.a_ray.r_dir);
+	}
+	ap->a_level = 0;		/* recursion level */
+	ap->a_purpose = "main ray";
+    }
+
+    if (report_progress) {
+	report_progress = 0;
+	bu_log("\tframe %d, xy=%d, %d on cpu %d, samp=0\n", curframe, apps[0].a_x, apps[0].a_y, cpu);
+    }
+
+    (void)rt_vshootray(apps, npix);
+
+    for (i = 0; i < npix; i++) {
+	view_pixel(&apps[i]);
+	if ((size_t)apps[i].a_x == width-1) {
+	    view_eol(&apps[i]);		/* End of scan line */
+	}
+    }
+}
+
+
+/**
+ * A rectangle of the pixel grid, columns [x0, x1) of rows [y0, y1),
+ * handed to a worker as one unit of work.
+ */
+struct tile {
+    int x0, x1;
+    int y0, y1;
+};
+
+
+/**
+ * Each worker owns a contiguous run [head, tail) of the tile list.
+ * The owner takes tiles from the head, in rendering order; a worker
+ * that runs dry steals tiles from the tail of another worker's run.
+ * Only a worker and its thieves ever contend for a deque's
+ * semaphore.
+ */
+struct tile_deque {
+    size_t head;
+    size_t tail;
+    int sem;
+};
+
+
+#define TILE_NSEM 16
+static const char * const tile_sem_names[TILE_NSEM] = {
+    "RT_SEM_TILE0", "RT_SEM_TILE1", "RT_SEM_TILE2", "RT_SEM_TILE3",
+    "RT_SEM_TILE4", "RT_SEM_TILE5", "RT_SEM_TILE6", "RT_SEM_TILE7",
+    "RT_SEM_TILE8", "RT_SEM_TILE9", "RT_SEM_TILE10", "RT_SEM_TILE11",
+    "RT_SEM_TILE12", "RT_SEM_TILE13", "RT_SEM_TILE14", "RT_SEM_TILE15"
+};
+static int tile_sem[TILE_NSEM] = {0};
+
+static struct tile *tile_list = NULL;	/* tiles of the current run */
+static size_t tile_list_max = 0;	/* # of tiles allocated */
+static struct tile_deque tile_deques[MAX_PSW];
+static int tile_grid_width = 0;		/* pixels per row of the pixel numbering */
+static int tile_nworkers = 0;		/* workers that have claimed a deque */
+
+
+/**
+ * Pick the tile dimensions for the run of pixels cur_pixel through
+ * last_pixel.
  *
- * This uses a "self-dispatching" parallel algorithm.  Executes until
- * there is no more work to be done, or is told to stop.
+ * Unless a view module has already chosen per_processor_chunk, we
+ * pick a tile size that should keep most workers busy all the way to
+ * the end.  Tiles range from 1x1 up to 512x512, so that all CPUs
+ * work on at least 8 tiles, depending on the number of cores and the
+ * size of our rendering.  Work stealing evens out whatever imbalance
+ * is left.
  *
- * In order to reduce the traffic through the res_worker critical
- * section, a multiple pixel block may be removed from the work queue
- * at once.
+ * Tiles are whole rows, in rendering order, unless the view module
+ * has set tile_2d.  Most view modules keep a single scanline buffer
+ * filled by a_x and written out by view_eol(), and so need every row
+ * done start to finish by one CPU.
  */
-void
-worker(int cpu, void *UNUSED(arg))
+static void
+tile_dimensions(int *tile_width, int *tile_height)
 {
-    int pixel_start;
-    int pixelnum;
-    int pat_num = -1;
-
-    /* Figure out a reasonable chunk size that should keep most
-     * workers busy all the way to the end.  We divide up the image
-     * into chunks equating to tiles 1x1, 2x2, 4x4, 8x8 ... in size.
-     * Work is distributed so that all CPUs work on at least 8 chunks
-     * with the chunking adjusted from a maximum chunk size (512x512)
-     * all the way down to 1 pixel at a time, depending on the number
-     * of cores and the size of our rendering.
-     *
-     * TODO: actually work on image tiles instead of pixel spans.
-     */
     if (per_processor_chunk <= 0) {
 	size_t chunk_size;
 	size_t one_eighth = (last_pixel - cur_pixel) * (hypersample + 1) / 8;
@@ -505,11 +612,164 @@ worker(int cpu, void *UNUSED(arg))
 	else
 	    chunk_size = 1; /* one pixel at a time */
 
-	bu_semaphore_acquire(RT_SEM_WORKER);
 	per_processor_chunk = chunk_size;
-	bu_semaphore_release(RT_SEM_WORKER);
     }
 
+    if (!tile_2d || per_processor_chunk >= tile_grid_width) {
+	*tile_width = tile_grid_width;
+	*tile_height = per_processor_chunk / tile_grid_width;
+	if (*tile_height < 1)
+	    *tile_height = 1;
+    } else {
+	int side = 1;
+	while ((side * 2) * (side * 2) <= per_processor_chunk)
+	    side *= 2;
+	*tile_width = *tile_height = side;
+    }
+}
+
+
+/**
+ * Cut the run of pixels cur_pixel through last_pixel into tiles, put
+ * them in rendering order, and deal them out to npsw workers.
+ */
+static void
+tile_setup(void)
+{
+    int tile_width, tile_height;
+    int first_row, last_row;
+    int x, y;
+    size_t ntiles;
+    size_t i;
+
+    if (!tile_sem[0]) {
+	for (i = 0; i < TILE_NSEM; i++)
+	    tile_sem[i] = bu_semaphore_register(tile_sem_names[i]);
+    }
+
+    if (incr_mode)
+	tile_grid_width = 1<<incr_level;
+    else
+	tile_grid_width = (int)width;
+    tile_dimensions(&tile_width, &tile_height);
+
+    first_row = cur_pixel / tile_grid_width;
+    last_row = last_pixel / tile_grid_width;
+
+    ntiles = (size_t)((last_row - first_row) / tile_height + 1)
+	* (size_t)((tile_grid_width + tile_width - 1) / tile_width);
+    if (ntiles > tile_list_max) {
+	tile_list = (struct tile *)bu_realloc(tile_list, ntiles * sizeof(struct tile), "tile list");
+	tile_list_max = ntiles;
+    }
+
+    ntiles = 0;
+    for (y = first_row; y <= last_row; y += tile_height) {
+	for (x = 0; x < tile_grid_width; x += tile_width) {
+	    struct tile *tp = &tile_list[ntiles++];
+	    tp->x0 = x;
+	    tp->x1 = (x + tile_width < tile_grid_width) ? x + tile_width : tile_grid_width;
+	    tp->y0 = y;
+	    tp->y1 = (y + tile_height <= last_row) ? y + tile_height : last_row + 1;
+	}
+    }
+
+    if (random_mode) {
+	/* Fisher-Yates shuffle */
+	for (i = ntiles - 1; i > 0; i--) {
+	    size_t j = (size_t)(rand() * 1.0 / ((double)RAND_MAX + 1.0) * (i + 1));
+	    struct tile t = tile_list[i];
+	    tile_list[i] = tile_list[j];
+	    tile_list[j] = t;
+	}
+    } else if (top_down) {
+	for (i = 0; i < ntiles / 2; i++) {
+	    struct tile t = tile_list[i];
+	    tile_list[i] = tile_list[ntiles - 1 - i];
+	    tile_list[ntiles - 1 - i] = t;
+	}
+    }
+
+    /* Each worker gets a contiguous run, keeping its tiles adjacent */
+    for (i = 0; i < (size_t)npsw; i++) {
+	tile_deques[i].head = i * ntiles / npsw;
+	tile_deques[i].tail = (i + 1) * ntiles / npsw;
+	tile_deques[i].sem = tile_sem[i % TILE_NSEM];
+    }
+    tile_nworkers = 0;
+}
+
+
+/**
+ * Claim a deque for the calling worker.  The cpu numbers handed out
+ * by bu_parallel() are not necessarily 0..npsw-1, so deques are
+ * assigned in order of arrival instead.
+ */
+static int
+tile_claim(void)
+{
+    int slot;
+
+    bu_semaphore_acquire(tile_sem[0]);
+    slot = tile_nworkers++;
+    bu_semaphore_release(tile_sem[0]);
+
+    return slot;
+}
+
+
+/**
+ * Take the next tile for this worker, stealing one from another
+ * worker when its own deque is empty.  Returns 0 when there is no
+ * work left anywhere.
+ */
+static int
+tile_next(int slot, struct tile *tp)
+{
+    struct tile_deque *dq = &tile_deques[slot];
+    ssize_t i;
+
+    bu_semaphore_acquire(dq->sem);
+    if (dq->head < dq->tail) {
+	*tp = tile_list[dq->head++];
+	bu_semaphore_release(dq->sem);
+	return 1;
+    }
+    bu_semaphore_release(dq->sem);
+
+    for (i = 1; i < npsw; i++) {
+	dq = &tile_deques[(slot + i) % npsw];
+
+	bu_semaphore_acquire(dq->sem);
+	if (dq->head < dq->tail) {
+	    *tp = tile_list[--dq->tail];
+	    bu_semaphore_release(dq->sem);
+	    return 1;
+	}
+	bu_semaphore_release(dq->sem);
+    }
+    return 0;
+}
+
+
+/**
+ * Compute some pixels, and store them.
+ *
+ * Executes until there is no more work to be done, or is told to
+ * stop.  The image is handed out as 2-D tiles by tile_next(), which
+ * keeps the rays of a worker coherent in the space partitioning tree
+ * and in cache.
+ */
+void
+worker(int cpu, void *UNUSED(arg))
+{
+    struct tile t;
+    int slot;
+    int pat_num = -1;
+    struct application *apps = NULL;
+    int *pixels = NULL;
+    int npix = 0;
+
     if (cpu >= MAX_PSW) {
 	bu_log("rt/worker() cpu %d > MAX_PSW %d, array overrun\n", cpu, MAX_PSW);
 	bu_exit(EXIT_FAILURE, "rt/worker() cpu > MAX_PSW, array overrun\n");
@@ -524,60 +784,57 @@ worker(int cpu, void *UNUSED(arg))
 	for (i=0; pt_pats[i].num_samples != 0; i++) {
 	    if (pt_pats[i].num_samples == ray_samples) {
 		pat_num = i;
-		goto pat_found;
+		break;
 	    }
 	}
     }
 
-pat_found:
-
-    if (random_mode) {
-
-	/* FIXME: this currently runs forever. It should probably
-	 *        generate a list of random pixels and then process
-	 *        them in that order.
-	 */
+    if (packet_eligible()) {
+	apps = (struct application *)bu_calloc(packet_size, sizeof(struct application), "worker packet apps");
+	pixels = (int *)bu_calloc(packet_size, sizeof(int), "worker packet pixels");
+    }
 
-	while (1) {
-	    /* Generate a random pixel id between 0 and last_pixel
-	       inclusive - TODO: check if there is any issue related
-	       with multi-threaded RNG */
-	    pixelnum = rand()*1.0/RAND_MAX*(last_pixel + 1);
-	    if (pixelnum >= last_pixel)
-		pixelnum = last_pixel;
-	    do_pixel(cpu, pat_num, pixelnum);
-	}
+    slot = tile_claim();
+    if (slot >= npsw) {
+	bu_log("rt/worker() more workers than the %zd expected\n", npsw);
+	slot = slot % npsw;
+    }
 
-    } else {
-	int from;
-	int to;
+    while (!stop_worker && tile_next(slot, &t)) {
+	int x, y;
 
-	while (1) {
-	    if (stop_worker)
-		return;
+	/* bu_log("TILE[%d..%d, %d..%d]\n", t.x0, t.x1, t.y0, t.y1); */
+	for (y = 0; y < t.y1 - t.y0; y++) {
+	    for (x = 0; x < t.x1 - t.x0; x++) {
+		int pixelnum;
 
-	    bu_semaphore_acquire(RT_SEM_WORKER);
-	    pixel_start = cur_pixel;
-	    cur_pixel += per_processor_chunk;
-	    bu_semaphore_release(RT_SEM_WORKER);
+		if (top_down)
+		    pixelnum = (t.y1 - 1 - y) * tile_grid_width + (t.x1 - 1 - x);
+		else
+		    pixelnum = (t.y0 + y) * tile_grid_width + (t.x0 + x);
+		if (pixelnum < cur_pixel || pixelnum > last_pixel)
+		    continue;
 
-	    if (top_down) {
-		from = last_pixel - pixel_start;
-		to = from - per_processor_chunk;
-	    } else {
-		from = pixel_start;
-		to = pixel_start + per_processor_chunk;
-	    }
-
-	    /* bu_log("SPAN[%d -> %d] for %d pixels\n", pixel_start, pixel_start+per_processor_chunk, per_processor_chunk); */
-	    for (pixelnum = from; pixelnum != to; (from < to) ? pixelnum++ : pixelnum--) {
-		if (pixelnum > last_pixel || pixelnum < 0)
-		    return;
-
-		/* bu_log("    PIXEL[%d]\n", pixelnum); */
-		do_pixel(cpu, pat_num, pixelnum);
+		if (!apps) {
+		    do_pixel(cpu, pat_num, pixelnum);
+		    continue;
+		}
+		pixels[npix++] = pixelnum;
+		if (npix == packet_size) {
+		    do_pixel_packet(cpu, apps, pixels, npix);
+		    npix = 0;
+		}
 	    }
 	}
+	if (npix > 0) {
+	    do_pixel_packet(cpu, apps, pixels, npix);
+	    npix = 0;
+	}
+    }
+
+    if (apps) {
+	bu_free(apps, "worker packet apps");
+	bu_free(pixels, "worker packet pixels");
     }
 }
 
@@ -596,11 +853,13 @@ do_run(int a, int b)
 	 * SERIAL case -- one CPU does all the work.
 	 */
 	npsw = 1;
+	tile_setup();
 	worker(0, NULL);
     } else {
 	/*
 	 * Parallel case.
 	 */
+	tile_setup();
 	bu_parallel(worker, (size_t)npsw, NULL);
     }
 
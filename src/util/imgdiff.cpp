@@ -88,7 +88,8 @@ main(int ac, const char **av)
     int matching = 0;
     int off_by_1 = 0;
     int off_by_many = 0;
-    icv_image_t *img1, *img2, *oimg;
+    icv_image_t *img1 = NULL, *img2 = NULL, *oimg = NULL;
+    icv_mapped_image_t *mimg1 = NULL, *mimg2 = NULL;
     const char *img_path_1 = NULL;
     const char *img_path_2 = NULL;
     bu_setprogname(av[0]);
@@ -204,18 +205,48 @@ main(int ac, const char **av)
 	}
     }
 
-    img1 = icv_read(img_path_1, in_type_1, width1, height1);
-    img2 = icv_read(img_path_2, in_type_2, width2, height2);
+    /* PIX and BW files are compared straight from the mapped file data,
+     * without expanding either image into doubles.  Other formats have
+     * to be decoded with icv_read(). */
+    if (in_type_1 == in_type_2 && (in_type_1 == BU_MIME_IMAGE_PIX || in_type_1 == BU_MIME_IMAGE_BW)) {
+	mimg1 = icv_map(img_path_1, in_type_1, width1, height1);
+	mimg2 = icv_map(img_path_2, in_type_2, width2, height2);
+	if (!mimg1 || !mimg2) {
+	    icv_unmap(mimg1);
+	    icv_unmap(mimg2);
+	    mimg1 = mimg2 = NULL;
+	}
+    }
 
-    ret = icv_diff(&matching, &off_by_1, &off_by_many, img1, img2);
+    if (mimg1 && mimg2) {
+	ret = icv_mapped_diff(&matching, &off_by_1, &off_by_many, mimg1, mimg2);
+    } else {
+	img1 = icv_read(img_path_1, in_type_1, width1, height1);
+	img2 = icv_read(img_path_2, in_type_2, width2, height2);
+	ret = icv_diff(&matching, &off_by_1, &off_by_many, img1, img2);
+    }
 
     bu_log("%d matching, %d off by 1, %d off by many\n", matching, off_by_1, off_by_many);
 
     if (out_path && (off_by_1 || off_by_many)) {
+	/* the difference image is built from doubles, so only now do
+	 * mapped inputs get expanded */
+	if (mimg1 && mimg2) {
+	    img1 = icv_mapped_rect(mimg1, 0, 0, mimg1->width, mimg1->height);
+	    img2 = icv_mapped_rect(mimg2, 0, 0, mimg2->width, mimg2->height);
+	}
 	oimg = icv_diffimg(img1, img2);
-	icv_write(oimg, out_path, out_type);
+	if (oimg) {
+	    icv_write(oimg, out_path, out_type);
+	    icv_destroy(oimg);
+	}
     }
 
+    icv_destroy(img1);
+    icv_destroy(img2);
+    icv_unmap(mimg1);
+    icv_unmap(mimg2);
+
     /* Clean up */
 cleanup:
     if (bu_vls_strlen(&slog) > 0)